@@ -0,0 +1,302 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "AudioSyncParser.h"
+
+#include <string.h>
+
+#define DTS_HEADER_SIZE     10
+#define AC3_HEADER_SIZE     6
+
+/* sync words as read big endian from the first four bytes */
+#define DTS_SYNC_16_LE      0x7FFE8001
+#define DTS_SYNC_14_LE      0x1FFFE800
+#define DTS_SYNC_16_BE      0xFE7F0180
+#define DTS_SYNC_14_BE      0xFF1F00E8
+#define DTS_SYNC_HD         0x64582025
+#define DTS_SYNC_HD_BE      0x58642520
+
+static const uint16_t AC3Bitrates[] = {32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 576, 640};
+static const uint16_t AC3FSCod   [] = {48000, 44100, 32000, 0};
+
+static const uint16_t DTSFSCod   [] = {0, 8000, 16000, 32000, 0, 0, 11025, 22050, 44100, 0, 0, 12000, 24000, 48000, 0, 0};
+
+/* CRC-16 with polynomial 0x8005, same as ffmpeg's AV_CRC_16_ANSI */
+static uint16_t crc16_table[256];
+static bool     crc16_table_init = false;
+
+static void InitCrc16()
+{
+  if(crc16_table_init)
+    return;
+
+  for(unsigned int i = 0; i < 256; i++)
+  {
+    unsigned int crc = i << 8;
+    for(int bit = 0; bit < 8; bit++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+    crc16_table[i] = crc & 0xFFFF;
+  }
+  crc16_table_init = true;
+}
+
+static uint16_t Crc16(const uint8_t *data, unsigned int size)
+{
+  uint16_t crc = 0;
+  while(size--)
+    crc = (crc << 8) ^ crc16_table[((crc >> 8) ^ *data++) & 0xFF];
+  return crc;
+}
+
+static inline uint32_t ReadBE32(const uint8_t *p)
+{
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+CAudioSyncParser::CAudioSyncParser()
+{
+  InitCrc16();
+
+  m_frame_size    = 0;
+  m_sample_rate   = 0;
+  m_dts_blocks    = 0;
+  m_little_endian = false;
+  m_14bit         = false;
+  m_last_skipped  = 0;
+  m_total_skipped = 0;
+  m_resyncs       = 0;
+  Reset();
+}
+
+void CAudioSyncParser::Reset()
+{
+  m_pending = 0;
+}
+
+unsigned int CAudioSyncParser::Found(unsigned int skip)
+{
+  m_last_skipped   = m_pending + skip;
+  m_total_skipped += m_last_skipped;
+  m_pending        = 0;
+  if(m_last_skipped)
+    m_resyncs++;
+  return skip;
+}
+
+unsigned int CAudioSyncParser::NotFound(unsigned int size)
+{
+  m_pending += size;
+  return size;
+}
+
+bool CAudioSyncParser::ParseDTS(uint32_t sync, const uint8_t *p)
+{
+  unsigned int srCode;
+
+  switch(sync)
+  {
+    case DTS_SYNC_16_LE:
+      m_little_endian = true;
+      m_14bit         = false;
+      m_dts_blocks    = (((p[4] & 0x1) << 6) | (p[5] >> 2)) + 1;
+      break;
+    case DTS_SYNC_14_LE:
+      if(p[4] != 0x07 || (p[5] & 0xF0) != 0xF0)
+        return false;
+      m_little_endian = true;
+      m_14bit         = true;
+      m_dts_blocks    = (((p[5] & 0x7) << 4) | (p[7] & 0x3C) >> 2) + 1;
+      break;
+    case DTS_SYNC_16_BE:
+      m_little_endian = false;
+      m_14bit         = false;
+      m_dts_blocks    = (((p[5] & 0x1) << 6) | (p[4] >> 2)) + 1;
+      break;
+    case DTS_SYNC_14_BE:
+      if(p[5] != 0x07 || (p[4] & 0xF0) != 0xF0)
+        return false;
+      m_little_endian = false;
+      m_14bit         = true;
+      m_dts_blocks    = (((p[4] & 0x7) << 4) | (p[6] & 0x3C) >> 2) + 1;
+      break;
+    default:
+      return false;
+  }
+
+  if (m_little_endian)
+  {
+    /* if it is not a termination frame, check the next 6 bits are set */
+    if ((p[4] & 0x80) == 0x80 && (p[4] & 0x7C) != 0x7C)
+      return false;
+
+    m_frame_size = ((((p[5] & 0x3) << 8 | p[6]) << 4) | ((p[7] & 0xF0) >> 4)) + 1;
+    srCode = (p[8] & 0x3C) >> 2;
+  }
+  else
+  {
+    /* if it is not a termination frame, check the next 6 bits are set */
+    if ((p[5] & 0x80) == 0x80 && (p[5] & 0x7C) != 0x7C)
+      return false;
+
+    m_frame_size = ((((p[4] & 0x3) << 8 | p[7]) << 4) | ((p[6] & 0xF0) >> 4)) + 1;
+    srCode = (p[9] & 0x3C) >> 2;
+  }
+
+  /* make sure the framesize and samplerate are sane */
+  if (m_frame_size < 96 || m_frame_size > 16384)
+    return false;
+
+  m_sample_rate = DTSFSCod[srCode];
+  if (!m_sample_rate)
+    return false;
+
+  return true;
+}
+
+unsigned int CAudioSyncParser::SyncDTS(const uint8_t *data, unsigned int size)
+{
+  if(size < DTS_HEADER_SIZE)
+    return NotFound(size);
+
+  const uint8_t *end  = data + size;
+  const uint8_t *last = end - DTS_HEADER_SIZE;
+
+  /* slide a 32 bit window over the data, one compare per byte for all four sync words */
+  uint32_t state = ((uint32_t)data[0] << 16) | ((uint32_t)data[1] << 8) | data[2];
+
+  for(const uint8_t *p = data; p <= last; p++)
+  {
+    state = (state << 8) | p[3];
+
+    if(state != DTS_SYNC_16_LE && state != DTS_SYNC_14_LE &&
+       state != DTS_SYNC_16_BE && state != DTS_SYNC_14_BE)
+      continue;
+
+    if(!ParseDTS(state, p))
+      continue;
+
+    /* confirm with the following core frame or DTS-HD substream, 14 bit
+       frames are packed so their size on the wire is not the header size */
+    if(!m_14bit && m_frame_size + 4 <= (unsigned int)(end - p))
+    {
+      uint32_t next = ReadBE32(p + m_frame_size);
+      if(next != state && next != DTS_SYNC_HD && next != DTS_SYNC_HD_BE)
+        continue;
+    }
+
+    return Found(p - data);
+  }
+
+  return NotFound(size);
+}
+
+bool CAudioSyncParser::ParseAC3(const uint8_t *p, unsigned int avail)
+{
+  uint8_t      bsid = p[5] >> 3;
+  unsigned int words;
+
+  if(bsid > 16)
+    return false;
+
+  if(bsid <= 10)
+  {
+    uint8_t fscod      = p[4] >> 6;
+    uint8_t frmsizecod = p[4] & 0x3F;
+
+    if(fscod == 3 || frmsizecod > 37)
+      return false;
+
+    uint16_t bitrate = AC3Bitrates[frmsizecod >> 1];
+    switch(fscod)
+    {
+      case 0:  words = bitrate * 2; break;
+      case 1:  words = (320 * bitrate / 147 + (frmsizecod & 1 ? 1 : 0)); break;
+      default: words = bitrate * 3; break;
+    }
+    m_sample_rate = AC3FSCod[fscod];
+  }
+  else
+  {
+    /* E-AC3 carries the frame size in the header */
+    words = (((p[2] & 0x07) << 8) | p[3]) + 1;
+
+    uint8_t fscod = p[4] >> 6;
+    if(fscod == 3)
+    {
+      uint8_t fscod2 = (p[4] >> 4) & 0x03;
+      if(fscod2 == 3)
+        return false;
+      m_sample_rate = AC3FSCod[fscod2] / 2;
+    }
+    else
+    {
+      m_sample_rate = AC3FSCod[fscod];
+    }
+  }
+
+  m_frame_size = words * 2;
+  if(m_frame_size < AC3_HEADER_SIZE)
+    return false;
+
+  /* validate the entire frame if we have it, else crc1 over the first 5/8 */
+  if(m_frame_size <= avail)
+    return Crc16(p + 2, m_frame_size - 2) == 0;
+
+  if(bsid <= 10)
+  {
+    unsigned int crc1_size = ((words >> 1) + (words >> 3)) * 2;
+    if(crc1_size <= avail)
+      return Crc16(p + 2, crc1_size - 2) == 0;
+  }
+
+  return true;
+}
+
+unsigned int CAudioSyncParser::SyncAC3(const uint8_t *data, unsigned int size)
+{
+  const uint8_t *p   = data;
+  const uint8_t *end = data + size;
+
+  while(end - p >= AC3_HEADER_SIZE)
+  {
+    /* let memchr find the first sync byte */
+    p = (const uint8_t *)memchr(p, 0x0B, end - p - AC3_HEADER_SIZE + 1);
+    if(!p)
+      break;
+
+    if(p[1] == 0x77 && ParseAC3(p, end - p))
+    {
+      /* confirm with the next sync word if it is in the data */
+      if(m_frame_size + 2 > (unsigned int)(end - p) ||
+         (p[m_frame_size] == 0x0B && p[m_frame_size + 1] == 0x77))
+        return Found(p - data);
+    }
+    p++;
+  }
+
+  return NotFound(size);
+}
@@ -0,0 +1,68 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _AUDIO_SYNC_PARSER_H_
+#define _AUDIO_SYNC_PARSER_H_
+
+#include <stdint.h>
+
+// Finds the start of the next valid DTS or (E-)AC3 frame in a bitstream.
+// A candidate is accepted when its header is sane, its CRC matches (AC3)
+// and, if the data reaches that far, the next frame starts with a sync word.
+class CAudioSyncParser
+{
+public:
+  CAudioSyncParser();
+  // forget bytes skipped so far, e.g. after a flush
+  void Reset();
+  // return the offset of the first frame, or size when there is none
+  unsigned int SyncDTS(const uint8_t *data, unsigned int size);
+  unsigned int SyncAC3(const uint8_t *data, unsigned int size);
+
+  // header of the frame found by the last successful sync
+  unsigned int GetFrameSize()     { return m_frame_size; };
+  unsigned int GetSampleRate()    { return m_sample_rate; };
+  unsigned int GetDTSBlocks()     { return m_dts_blocks; };
+  bool         IsLittleEndian()   { return m_little_endian; };
+  bool         Is14Bit()          { return m_14bit; };
+
+  // bytes dropped before the last sync, also across calls
+  unsigned int GetLastSkipped()   { return m_last_skipped; };
+  uint64_t     GetTotalSkipped()  { return m_total_skipped; };
+  unsigned int GetResyncCount()   { return m_resyncs; };
+private:
+  bool ParseDTS(uint32_t sync, const uint8_t *p);
+  bool ParseAC3(const uint8_t *p, unsigned int avail);
+  unsigned int Found(unsigned int skip);
+  unsigned int NotFound(unsigned int size);
+
+  unsigned int  m_frame_size;
+  unsigned int  m_sample_rate;
+  unsigned int  m_dts_blocks;
+  bool          m_little_endian;
+  bool          m_14bit;
+
+  unsigned int  m_pending;
+  unsigned int  m_last_skipped;
+  uint64_t      m_total_skipped;
+  unsigned int  m_resyncs;
+};
+#endif
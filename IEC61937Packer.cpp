@@ -0,0 +1,311 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "IEC61937Packer.h"
+#include "utils/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CLASSNAME "CIEC61937Packer"
+
+#define IEC61937_PREAMBLE1      0xF872
+#define IEC61937_PREAMBLE2      0x4E1F
+#define IEC61937_HEADER_SIZE    8
+
+#define IEC61937_TYPE_AC3       0x01
+#define IEC61937_TYPE_DTS1      0x0B
+#define IEC61937_TYPE_DTS2      0x0C
+#define IEC61937_TYPE_DTS3      0x0D
+#define IEC61937_TYPE_DTSHD     0x11
+#define IEC61937_TYPE_EAC3      0x15
+
+#define IEC61937_AC3_PERIOD     1536
+#define IEC61937_EAC3_PERIOD    6144
+
+/* E-AC3 frames needed for six audio blocks, by numblkscod */
+static const unsigned int EAC3Repeat[4] = { 6, 3, 2, 1 };
+
+static const uint8_t DTSHDStartCode[10] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFE, 0xFE };
+
+static inline void PutLE16(uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+CIEC61937Packer::CIEC61937Packer()
+{
+  m_encoded   = IAudioRenderer::ENCODED_NONE;
+  m_dtshd     = false;
+  m_hd_buf    = NULL;
+  m_hd_alloc  = 0;
+  m_out       = NULL;
+  m_out_alloc = 0;
+  Reset();
+}
+
+CIEC61937Packer::~CIEC61937Packer()
+{
+  free(m_hd_buf);
+  free(m_out);
+}
+
+bool CIEC61937Packer::Open(IAudioRenderer::EEncoded encoded, bool dtshd)
+{
+  switch(encoded)
+  {
+    case IAudioRenderer::ENCODED_IEC61937_AC3:
+    case IAudioRenderer::ENCODED_IEC61937_EAC3:
+    case IAudioRenderer::ENCODED_IEC61937_DTS:
+      break;
+    default:
+      CLog::Log(LOGERROR, "%s::%s - unsupported encoding %d\n", CLASSNAME, __func__, (int)encoded);
+      return false;
+  }
+
+  m_encoded = encoded;
+  m_dtshd   = dtshd && encoded == IAudioRenderer::ENCODED_IEC61937_DTS;
+  Reset();
+  return true;
+}
+
+void CIEC61937Packer::Reset()
+{
+  m_hd_size  = 0;
+  m_hd_count = 0;
+  m_out_size = 0;
+  m_sync.Reset();
+}
+
+unsigned int CIEC61937Packer::GetOutputRate(unsigned int sample_rate)
+{
+  if(m_encoded == IAudioRenderer::ENCODED_IEC61937_EAC3 || m_dtshd)
+    return sample_rate * 4;
+  return sample_rate;
+}
+
+bool CIEC61937Packer::Reserve(uint8_t **buffer, unsigned int *alloc, unsigned int size)
+{
+  if(*alloc >= size)
+    return true;
+
+  uint8_t *data = (uint8_t *)realloc(*buffer, size);
+  if(!data)
+    return false;
+
+  *buffer = data;
+  *alloc  = size;
+  return true;
+}
+
+/* appends one burst of period PCM frames to the output. The payload is
+   sent as 16 bit little endian words, swap turns big endian words around. */
+bool CIEC61937Packer::WriteBurst(uint16_t type, const uint8_t *payload, unsigned int size, unsigned int length_code,
+                                 unsigned int period, bool swap, bool preamble)
+{
+  unsigned int burst  = period * 4;
+  unsigned int header = preamble ? IEC61937_HEADER_SIZE : 0;
+
+  if(header + ((size + 1) & ~1) > burst)
+  {
+    CLog::Log(LOGERROR, "%s::%s - %u bytes do not fit a burst of %u\n", CLASSNAME, __func__, size, burst);
+    return false;
+  }
+
+  if(!Reserve(&m_out, &m_out_alloc, m_out_size + burst))
+    return false;
+
+  uint8_t *dst = m_out + m_out_size;
+
+  if(preamble)
+  {
+    PutLE16(dst + 0, IEC61937_PREAMBLE1);
+    PutLE16(dst + 2, IEC61937_PREAMBLE2);
+    PutLE16(dst + 4, type);
+    PutLE16(dst + 6, length_code);
+  }
+
+  uint8_t *data = dst + header;
+  if(swap)
+  {
+    unsigned int i;
+    for(i = 0; i + 1 < size; i += 2)
+    {
+      data[i]     = payload[i + 1];
+      data[i + 1] = payload[i];
+    }
+    /* an odd last byte goes into the high half of the word */
+    if(i < size)
+    {
+      data[i]     = 0;
+      data[i + 1] = payload[i];
+      i += 2;
+    }
+    size = i;
+  }
+  else
+  {
+    memcpy(data, payload, size);
+  }
+
+  memset(data + size, 0, burst - header - size);
+  m_out_size += burst;
+  return true;
+}
+
+bool CIEC61937Packer::PackAC3(const uint8_t *data, unsigned int size)
+{
+  uint8_t bsid = data[5] >> 3;
+
+  if(bsid <= 10)
+  {
+    /* the bitstream mode goes into the data type dependent info */
+    uint16_t type = IEC61937_TYPE_AC3 | ((data[5] & 0x07) << 8);
+    return WriteBurst(type, data, size, size << 3, IEC61937_AC3_PERIOD, true);
+  }
+
+  /* E-AC3 fills a period with six audio blocks, collect frames until then */
+  uint8_t fscod = data[4] >> 6;
+  unsigned int repeat = fscod == 3 ? 6 : EAC3Repeat[(data[4] >> 4) & 0x03];
+
+  if(!Reserve(&m_hd_buf, &m_hd_alloc, m_hd_size + size))
+    return false;
+
+  memcpy(m_hd_buf + m_hd_size, data, size);
+  m_hd_size += size;
+
+  if(++m_hd_count < repeat)
+    return true;
+
+  bool ret = WriteBurst(IEC61937_TYPE_EAC3, m_hd_buf, m_hd_size, m_hd_size, IEC61937_EAC3_PERIOD, true);
+  m_hd_size  = 0;
+  m_hd_count = 0;
+  return ret;
+}
+
+bool CIEC61937Packer::PackDTS(const uint8_t *data, unsigned int size)
+{
+  unsigned int samples   = m_sync.GetDTSBlocks() << 5;
+  unsigned int core_size = m_sync.Is14Bit() ? size : m_sync.GetFrameSize();
+  /* 0x7FFE8001 in stream order is what the parser calls little endian,
+     those are big endian 16 bit words that have to be swapped */
+  bool         swap      = m_sync.IsLittleEndian();
+
+  if(core_size > size)
+    core_size = size;
+
+  if(m_dtshd)
+  {
+    unsigned int period  = samples * 4;
+    unsigned int subtype = 0;
+    while((512u << subtype) < period && subtype < 5)
+      subtype++;
+
+    if((512u << subtype) != period)
+    {
+      CLog::Log(LOGERROR, "%s::%s - no DTS-HD repetition period for %u samples\n", CLASSNAME, __func__, samples);
+      return false;
+    }
+
+    /* when the whole frame does not fit the period, send the core alone */
+    unsigned int payload = size;
+    if(sizeof(DTSHDStartCode) + 2 + payload > period * 4 - IEC61937_HEADER_SIZE)
+    {
+      CLog::Log(LOGDEBUG, "%s::%s - DTS-HD frame of %u bytes too big, sending core only\n", CLASSNAME, __func__, size);
+      payload = core_size;
+    }
+
+    unsigned int hd_size = sizeof(DTSHDStartCode) + 2 + payload;
+    if(!Reserve(&m_hd_buf, &m_hd_alloc, hd_size))
+      return false;
+
+    memcpy(m_hd_buf, DTSHDStartCode, sizeof(DTSHDStartCode));
+    m_hd_buf[sizeof(DTSHDStartCode)]     = payload >> 8;
+    m_hd_buf[sizeof(DTSHDStartCode) + 1] = payload & 0xFF;
+    memcpy(m_hd_buf + sizeof(DTSHDStartCode) + 2, data, payload);
+
+    /* receivers want the length code to end in 0x8 */
+    unsigned int length_code = ((hd_size + 0x8 + 0xF) & ~0xF) - 0x8;
+
+    return WriteBurst(IEC61937_TYPE_DTSHD | (subtype << 8), m_hd_buf, hd_size, length_code, period, swap);
+  }
+
+  uint16_t type;
+  switch(samples)
+  {
+    case 512:  type = IEC61937_TYPE_DTS1; break;
+    case 1024: type = IEC61937_TYPE_DTS2; break;
+    case 2048: type = IEC61937_TYPE_DTS3; break;
+    default:
+      CLog::Log(LOGERROR, "%s::%s - no DTS burst type for %u samples\n", CLASSNAME, __func__, samples);
+      return false;
+  }
+
+  /* a frame that fills the period exactly is sent without the preamble */
+  bool preamble = core_size != samples * 4;
+
+  return WriteBurst(type, data, core_size, core_size << 3, samples, swap, preamble);
+}
+
+unsigned int CIEC61937Packer::Pack(const uint8_t *data, unsigned int size)
+{
+  m_out_size = 0;
+
+  if(m_encoded == IAudioRenderer::ENCODED_NONE)
+    return 0;
+
+  while(size)
+  {
+    bool dts = m_encoded == IAudioRenderer::ENCODED_IEC61937_DTS;
+    unsigned int skip = dts ? m_sync.SyncDTS(data, size) : m_sync.SyncAC3(data, size);
+    if(skip >= size)
+      break;
+
+    data += skip;
+    size -= skip;
+
+    /* DTS-HD takes the rest of the packet, the extension follows the core */
+    unsigned int frame_size = m_sync.GetFrameSize();
+    if(dts && (m_dtshd || m_sync.Is14Bit()))
+      frame_size = size;
+
+    if(frame_size > size)
+    {
+      CLog::Log(LOGDEBUG, "%s::%s - dropping partial frame of %u/%u bytes\n", CLASSNAME, __func__, size, frame_size);
+      break;
+    }
+
+    if(!(dts ? PackDTS(data, frame_size) : PackAC3(data, frame_size)))
+      break;
+
+    data += frame_size;
+    size -= frame_size;
+  }
+
+  return m_out_size;
+}
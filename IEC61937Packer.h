@@ -0,0 +1,76 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _IEC61937_PACKER_H_
+#define _IEC61937_PACKER_H_
+
+#ifdef STANDALONE
+#include "IAudioRenderer.h"
+#else
+#include "../AudioRenderers/IAudioRenderer.h"
+#endif
+#include "AudioSyncParser.h"
+
+#include <stdint.h>
+
+// Wraps AC3, E-AC3 and DTS frames into IEC 61937 bursts carried by 16 bit
+// stereo PCM, so a sink that only takes PCM can still pass them through.
+// Every burst fills one repetition period: 1536 frames for AC3, 6144 for
+// E-AC3, the frame's sample count for DTS and 4x that for DTS-HD. E-AC3
+// and DTS-HD need the PCM at four times the stream sample rate.
+class CIEC61937Packer
+{
+public:
+  CIEC61937Packer();
+  ~CIEC61937Packer();
+  // dtshd sends the whole DTS-HD frame instead of just the core
+  bool Open(IAudioRenderer::EEncoded encoded, bool dtshd);
+  void Reset();
+  // packs the frames in data, returns the bytes of complete bursts in
+  // GetOutput(). E-AC3 frames are collected until a period is full.
+  unsigned int Pack(const uint8_t *data, unsigned int size);
+  const uint8_t *GetOutput() { return m_out; };
+  // rate of the PCM carrying the bursts of a stream at sample_rate
+  unsigned int GetOutputRate(unsigned int sample_rate);
+  // PCM frames the last Pack() produced
+  unsigned int GetOutputFrames() { return m_out_size >> 2; };
+private:
+  bool PackAC3(const uint8_t *data, unsigned int size);
+  bool PackDTS(const uint8_t *data, unsigned int size);
+  bool WriteBurst(uint16_t type, const uint8_t *payload, unsigned int size, unsigned int length_code,
+                  unsigned int period, bool swap, bool preamble = true);
+  bool Reserve(uint8_t **buffer, unsigned int *alloc, unsigned int size);
+
+  IAudioRenderer::EEncoded m_encoded;
+  bool              m_dtshd;
+  CAudioSyncParser  m_sync;
+
+  // collects E-AC3 frames and builds the DTS-HD payload
+  uint8_t           *m_hd_buf;
+  unsigned int      m_hd_alloc;
+  unsigned int      m_hd_size;
+  unsigned int      m_hd_count;
+
+  uint8_t           *m_out;
+  unsigned int      m_out_alloc;
+  unsigned int      m_out_size;
+};
+#endif
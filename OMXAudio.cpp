@@ -25,6 +25,8 @@
 #endif
 
 #include "OMXAudio.h"
+#include "OMXBringUp.h"
+#include "OMXStartup.h"
 #include "utils/log.h"
 
 #define CLASSNAME "COMXAudio"
@@ -76,11 +78,6 @@ static unsigned int WAVEChannels[OMX_MAX_CHANNELS] =
   SPEAKER_BACK_CENTER
 };
 
-static const uint16_t AC3Bitrates[] = {32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 576, 640};
-static const uint16_t AC3FSCod   [] = {48000, 44100, 32000, 0};
-
-static const uint16_t DTSFSCod   [] = {0, 8000, 16000, 32000, 0, 0, 11025, 22050, 44100, 0, 0, 12000, 24000, 48000, 0, 0};
-
 // Dolby 5.1 downmixing coefficients
 const float downmixing_coefficients_6[16] = {
   //        L       R
@@ -141,7 +138,15 @@ COMXAudio::COMXAudio() :
   m_extrasize       (0      ),
   m_fifo_size       (0.0    ),
   m_visBufferLength (0      ),
-  m_last_pts        (DVD_NOPTS_VALUE)
+  m_last_pts        (DVD_NOPTS_VALUE),
+  m_pcm_buffer      (NULL   ),
+  m_pcm_samples     (0      ),
+  m_pcm_capacity    (0      ),
+  m_pcm_pts         (DVD_NOPTS_VALUE),
+  m_submit_count    (0      ),
+  m_remap_downmix   (false  ),
+  m_downmix_buffer  (NULL   ),
+  m_downmix_size    (0      )
 {
 }
 
@@ -149,6 +154,8 @@ COMXAudio::~COMXAudio()
 {
   if(m_Initialized)
     Deinitialize();
+
+  free(m_downmix_buffer);
 }
 
 
@@ -298,6 +305,28 @@ bool COMXAudio::Initialize(IAudioCallback* pCallback, const CStdString& device,
     }
   }
 
+  /* without normalising, the mixer clips whatever goes above full scale. The
+     downmix is done by m_remap then, where the limiter keeps the peaks in */
+  m_remap_downmix = !m_Passthrough && !m_HWDecode && !m_normalize_downmix && outLayout &&
+                    uiBitsPerSample == 32 && m_OutputChannels == 2 &&
+                    (downmixChannels == 6 || downmixChannels == 8) && (unsigned int)iChannels == downmixChannels;
+  if (m_remap_downmix)
+  {
+    enum PCMChannels stereo[2] = { PCM_FRONT_LEFT, PCM_FRONT_RIGHT };
+    m_remap.SetOutputFormat(2, stereo, true);
+    m_remap.SetMatrix(downmixChannels == 6 ? downmixing_coefficients_6 : downmixing_coefficients_8);
+
+    m_InputChannels     = 2;
+    m_downmix_channels  = 0;
+    for (int chan = 0; chan < OMX_AUDIO_MAXCHANNELS; chan++)
+      m_pcm_input.eChannelMapping[chan] = OMX_AUDIO_ChannelNone;
+    m_pcm_input.eChannelMapping[0] = OMX_AUDIO_ChannelLF;
+    m_pcm_input.eChannelMapping[1] = OMX_AUDIO_ChannelRF;
+    m_wave_header.dwChannelMask    = SPEAKER_FRONT_LEFT | SPEAKER_FRONT_RIGHT;
+
+    CLog::Log(LOGDEBUG, "COMXAudio::Initialize - downmixing %d channels with limiter\n", iChannels);
+  }
+
   // set the m_pcm_output parameters
   m_pcm_output.eNumData            = OMX_NumericalDataSigned;
   m_pcm_output.eEndian             = OMX_EndianLittle;
@@ -341,84 +370,25 @@ bool COMXAudio::Initialize(IAudioCallback* pCallback, const CStdString& device,
   PrintPCM(&m_pcm_output);
 
   OMX_ERRORTYPE omx_err = OMX_ErrorNone;
-  std::string componentName = "";
-
-  componentName = "OMX.broadcom.audio_render";
-  if(!m_omx_render.Initialize(componentName, OMX_IndexParamAudioInit))
-    return false;
-
-  OMX_CONFIG_BRCMAUDIODESTINATIONTYPE audioDest;
-  OMX_INIT_STRUCTURE(audioDest);
-  strncpy((char *)audioDest.sName, device.c_str(), strlen(device.c_str()));
-
-  omx_err = m_omx_render.SetConfig(OMX_IndexConfigBrcmAudioDestination, &audioDest);
-  if (omx_err != OMX_ErrorNone)
-    return false;
-
-  componentName = "OMX.broadcom.audio_decode";
-  if(!m_omx_decoder.Initialize(componentName, OMX_IndexParamAudioInit))
-    return false;
-
-  if(!m_Passthrough)
-  {
-    componentName = "OMX.broadcom.audio_mixer";
-    if(!m_omx_mixer.Initialize(componentName, OMX_IndexParamAudioInit))
-      return false;
-  }
+  COMXBringUp bring_up("COMXAudio::Initialize");
 
-  if(m_Passthrough)
+  bring_up.Run([this]()
   {
-    OMX_CONFIG_BOOLEANTYPE boolType;
-    OMX_INIT_STRUCTURE(boolType);
-    boolType.bEnabled = OMX_TRUE;
-    omx_err = m_omx_decoder.SetParameter(OMX_IndexParamBrcmDecoderPassThrough, &boolType);
-    if(omx_err != OMX_ErrorNone)
-    {
-      CLog::Log(LOGERROR, "COMXAudio::Initialize - Error OMX_IndexParamBrcmDecoderPassThrough 0x%08x", omx_err);
-      printf("OMX_IndexParamBrcmDecoderPassThrough omx_err(0x%08x)\n", omx_err);
-      return false;
-    }
-  }
-
-  // set up the number/size of buffers
-  OMX_PARAM_PORTDEFINITIONTYPE port_param;
-  OMX_INIT_STRUCTURE(port_param);
-  port_param.nPortIndex = m_omx_decoder.GetInputPort();
-
-  omx_err = m_omx_decoder.GetParameter(OMX_IndexParamPortDefinition, &port_param);
-  if(omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXAudio::Initialize error get OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
-    return false;
-  }
-
-  port_param.format.audio.eEncoding = m_eEncoding;
-
-  port_param.nBufferSize = m_ChunkLen;
-  port_param.nBufferCountActual = m_BufferLen / m_ChunkLen;
-
-  omx_err = m_omx_decoder.SetParameter(OMX_IndexParamPortDefinition, &port_param);
-  if(omx_err != OMX_ErrorNone)
+    return m_omx_render.Initialize("OMX.broadcom.audio_render", OMX_IndexParamAudioInit);
+  });
+  bring_up.Run([this]()
   {
-    CLog::Log(LOGERROR, "COMXAudio::Initialize error set OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
-    return false;
-  }
-
-  if(m_HWDecode)
+    return m_omx_decoder.Initialize("OMX.broadcom.audio_decode", OMX_IndexParamAudioInit);
+  });
+  if(!m_Passthrough)
   {
-    OMX_AUDIO_PARAM_PORTFORMATTYPE formatType;
-    OMX_INIT_STRUCTURE(formatType);
-    formatType.nPortIndex = m_omx_decoder.GetInputPort();
-
-    formatType.eEncoding = m_eEncoding;
-
-    omx_err = m_omx_decoder.SetParameter(OMX_IndexParamAudioPortFormat, &formatType);
-    if(omx_err != OMX_ErrorNone)
+    bring_up.Run([this]()
     {
-      CLog::Log(LOGERROR, "COMXAudio::Initialize error OMX_IndexParamAudioPortFormat omx_err(0x%08x)\n", omx_err);
-      return false;
-    }
+      return m_omx_mixer.Initialize("OMX.broadcom.audio_mixer", OMX_IndexParamAudioInit);
+    });
   }
+  if(!bring_up.Join("init"))
+    return false;
 
   if(m_av_clock == NULL)
   {
@@ -440,39 +410,17 @@ bool COMXAudio::Initialize(IAudioCallback* pCallback, const CStdString& device,
 
   m_omx_tunnel_clock.Initialize(m_omx_clock, m_omx_clock->GetInputPort(), &m_omx_render, m_omx_render.GetInputPort()+1);
 
-  omx_err = m_omx_tunnel_clock.Establish(false);
-  if(omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXAudio::Initialize m_omx_tunnel_clock.Establish\n");
-    return false;
-  }
-
-  if(!m_external_clock)
+  // render with its clock tunnel and the decoder input are set up side by side
+  bring_up.Run([this, &device]()
   {
-    omx_err = m_omx_clock->SetStateForComponent(OMX_StateExecuting);
-    if (omx_err != OMX_ErrorNone)
-    {
-      CLog::Log(LOGERROR, "COMXAudio::Initialize m_omx_clock.SetStateForComponent\n");
-      return false;
-    }
-  }
-
-  /*
-  m_pcm_output.nPortIndex          = m_omx_render.GetInputPort();
-  omx_err = m_omx_render.SetParameter(OMX_IndexParamAudioPcm, &m_pcm_output);
-  if(omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXAudio::Initialize OMX_IndexParamAudioPcm omx_err(0x%08x)\n", omx_err);
-    return false;
-  }
-  */
-
-  omx_err = m_omx_decoder.AllocInputBuffers();
-  if(omx_err != OMX_ErrorNone) 
+    return SetupRender(device);
+  });
+  bring_up.Run([this]()
   {
-    CLog::Log(LOGERROR, "COMXAudio::Initialize - Error alloc buffers 0x%08x", omx_err);
+    return SetupDecoder();
+  });
+  if(!bring_up.Join("setup"))
     return false;
-  }
 
   if(!m_Passthrough)
   {
@@ -528,6 +476,8 @@ bool COMXAudio::Initialize(IAudioCallback* pCallback, const CStdString& device,
     return false;
   }
 
+  bring_up.Mark("tunnels");
+
   if(m_eEncoding == OMX_AUDIO_CodingPCM)
   {
     OMX_BUFFERHEADERTYPE *omx_buffer = m_omx_decoder.GetInputBuffer();
@@ -601,6 +551,119 @@ bool COMXAudio::Initialize(IAudioCallback* pCallback, const CStdString& device,
   CLog::Log(LOGDEBUG, "COMXAudio::Initialize Input bps %d samplerate %d channels %d device %s buffer size %d bytes per second %d passthrough %d hwdecode %d", 
       (int)m_pcm_input.nBitPerSample, (int)m_pcm_input.nSamplingRate, (int)m_pcm_input.nChannels, deviceuse.c_str(), m_BufferLen, m_BytesPerSec, m_Passthrough, m_HWDecode);
 
+  bring_up.Mark("config");
+  bring_up.Log();
+
+  return true;
+}
+
+bool COMXAudio::SetupRender(const CStdString& device)
+{
+  OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+
+  OMX_CONFIG_BRCMAUDIODESTINATIONTYPE audioDest;
+  OMX_INIT_STRUCTURE(audioDest);
+  strncpy((char *)audioDest.sName, device.c_str(), strlen(device.c_str()));
+
+  omx_err = m_omx_render.SetConfig(OMX_IndexConfigBrcmAudioDestination, &audioDest);
+  if (omx_err != OMX_ErrorNone)
+    return false;
+
+  omx_err = m_omx_tunnel_clock.Establish(false);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXAudio::SetupRender m_omx_tunnel_clock.Establish\n");
+    return false;
+  }
+
+  if(!m_external_clock)
+  {
+    omx_err = m_omx_clock->SetStateForComponent(OMX_StateExecuting);
+    if (omx_err != OMX_ErrorNone)
+    {
+      CLog::Log(LOGERROR, "COMXAudio::SetupRender m_omx_clock.SetStateForComponent\n");
+      return false;
+    }
+  }
+
+  /*
+  m_pcm_output.nPortIndex          = m_omx_render.GetInputPort();
+  omx_err = m_omx_render.SetParameter(OMX_IndexParamAudioPcm, &m_pcm_output);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXAudio::SetupRender OMX_IndexParamAudioPcm omx_err(0x%08x)\n", omx_err);
+    return false;
+  }
+  */
+
+  return true;
+}
+
+bool COMXAudio::SetupDecoder()
+{
+  OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+
+  if(m_Passthrough)
+  {
+    OMX_CONFIG_BOOLEANTYPE boolType;
+    OMX_INIT_STRUCTURE(boolType);
+    boolType.bEnabled = OMX_TRUE;
+    omx_err = m_omx_decoder.SetParameter(OMX_IndexParamBrcmDecoderPassThrough, &boolType);
+    if(omx_err != OMX_ErrorNone)
+    {
+      CLog::Log(LOGERROR, "COMXAudio::SetupDecoder - Error OMX_IndexParamBrcmDecoderPassThrough 0x%08x", omx_err);
+      printf("OMX_IndexParamBrcmDecoderPassThrough omx_err(0x%08x)\n", omx_err);
+      return false;
+    }
+  }
+
+  // set up the number/size of buffers
+  OMX_PARAM_PORTDEFINITIONTYPE port_param;
+  OMX_INIT_STRUCTURE(port_param);
+  port_param.nPortIndex = m_omx_decoder.GetInputPort();
+
+  omx_err = m_omx_decoder.GetParameter(OMX_IndexParamPortDefinition, &port_param);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXAudio::SetupDecoder error get OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
+    return false;
+  }
+
+  port_param.format.audio.eEncoding = m_eEncoding;
+
+  port_param.nBufferSize = m_ChunkLen;
+  port_param.nBufferCountActual = m_BufferLen / m_ChunkLen;
+
+  omx_err = m_omx_decoder.SetParameter(OMX_IndexParamPortDefinition, &port_param);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXAudio::SetupDecoder error set OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
+    return false;
+  }
+
+  if(m_HWDecode)
+  {
+    OMX_AUDIO_PARAM_PORTFORMATTYPE formatType;
+    OMX_INIT_STRUCTURE(formatType);
+    formatType.nPortIndex = m_omx_decoder.GetInputPort();
+
+    formatType.eEncoding = m_eEncoding;
+
+    omx_err = m_omx_decoder.SetParameter(OMX_IndexParamAudioPortFormat, &formatType);
+    if(omx_err != OMX_ErrorNone)
+    {
+      CLog::Log(LOGERROR, "COMXAudio::SetupDecoder error OMX_IndexParamAudioPortFormat omx_err(0x%08x)\n", omx_err);
+      return false;
+    }
+  }
+
+  omx_err = m_omx_decoder.AllocInputBuffers();
+  if(omx_err != OMX_ErrorNone) 
+  {
+    CLog::Log(LOGERROR, "COMXAudio::SetupDecoder - Error alloc buffers 0x%08x", omx_err);
+    return false;
+  }
+
   return true;
 }
 
@@ -625,6 +688,11 @@ bool COMXAudio::Deinitialize()
 
   m_omx_decoder.FlushInput();
 
+  // the buffer being filled was never submitted, the port teardown expects it back
+  m_omx_decoder.ReturnInputBuffer(m_pcm_buffer);
+  m_pcm_buffer  = NULL;
+  m_pcm_samples = 0;
+
   m_omx_render.Deinitialize();
   if(!m_Passthrough)
     m_omx_mixer.Deinitialize();
@@ -644,6 +712,10 @@ bool COMXAudio::Deinitialize()
   m_omx_clock = NULL;
   m_av_clock  = NULL;
 
+  if(m_sync.GetResyncCount())
+    CLog::Log(LOGDEBUG, "COMXAudio::Deinitialize - resynced %u times, skipped %llu bytes\n",
+              m_sync.GetResyncCount(), (unsigned long long)m_sync.GetTotalSkipped());
+
   m_Initialized = false;
   m_LostSync    = true;
   m_HWDecode    = false;
@@ -675,6 +747,10 @@ void COMXAudio::Flush()
   //m_setStartTime  = true;
   m_last_pts      = DVD_NOPTS_VALUE;
   m_LostSync      = true;
+  m_sync.Reset();
+  // keep the buffer we are filling, just drop what is in it
+  m_pcm_samples   = 0;
+  m_pcm_pts       = DVD_NOPTS_VALUE;
   //m_first_frame   = true;
 }
 
@@ -851,25 +927,49 @@ unsigned int COMXAudio::AddPackets(const void* data, unsigned int len, double dt
     m_visBufferLength = mylen;
   }
 
-  if(m_eEncoding == OMX_AUDIO_CodingDTS && m_LostSync && (m_Passthrough || m_HWDecode))
+  if(m_LostSync && (m_Passthrough || m_HWDecode) &&
+     (m_eEncoding == OMX_AUDIO_CodingDTS || m_eEncoding == OMX_AUDIO_CodingDDP))
   {
-    int skip = SyncDTS((uint8_t *)data, len);
-    if(skip > 0)
+    unsigned int skip;
+    if(m_eEncoding == OMX_AUDIO_CodingDTS)
+      skip = SyncDTS((uint8_t *)data, len);
+    else
+      skip = SyncAC3((uint8_t *)data, len);
+
+    if(skip == len)
       return len;
+
+    if(m_sync.GetLastSkipped())
+      CLog::Log(LOGDEBUG, "COMXAudio::AddPackets - resynced after skipping %u bytes\n", m_sync.GetLastSkipped());
+
+    // submit from the first good frame instead of dropping the packet
+    unsigned int used = AddPackets((const uint8_t *)data + skip, len - skip, dts, pts);
+    return used + skip;
   }
 
-  if(m_eEncoding == OMX_AUDIO_CodingDDP && m_LostSync && (m_Passthrough || m_HWDecode))
+  if(m_remap_downmix)
   {
-    int skip = SyncAC3((uint8_t *)data, len);
-    if(skip > 0)
-      return len;
+    unsigned int frames = m_remap.InBytesToFrames(len);
+    unsigned int size   = m_remap.FramesToOutBytes(frames);
+    if(m_downmix_size < size)
+    {
+      float *buffer = (float *)realloc(m_downmix_buffer, size);
+      if(!buffer)
+        return len;
+      m_downmix_buffer  = buffer;
+      m_downmix_size    = size;
+    }
+
+    m_remap.RemapPlanar((void *)data, m_downmix_buffer, frames);
+    return AddPacketsPCM(m_downmix_buffer, size, pts) ? len : 0;
   }
 
+  if(!m_Passthrough && !m_HWDecode)
+    return AddPacketsPCM(data, len, pts);
+
   unsigned int demuxer_bytes = (unsigned int)len;
   uint8_t *demuxer_content = (uint8_t *)data;
 
-  OMX_ERRORTYPE omx_err;
-
   OMX_BUFFERHEADERTYPE *omx_buffer = NULL;
 
   while(demuxer_bytes)
@@ -899,207 +999,305 @@ unsigned int COMXAudio::AddPackets(const void* data, unsigned int len, double dt
           (float)pts / AV_TIME_BASE, omx_buffer, omx_buffer->pBuffer, (int)omx_buffer->pAppPrivate);
     */
 
-    uint64_t val  = (uint64_t)(pts == DVD_NOPTS_VALUE) ? 0 : pts;
+    demuxer_bytes -= omx_buffer->nFilledLen;
+    demuxer_content += omx_buffer->nFilledLen;
+
+    if(!SubmitBuffer(omx_buffer, pts, demuxer_bytes == 0))
+      return 0;
+  }
+
+  return len;
+}
+
+/* Packs consecutive planar PCM frames into whole input buffers instead of
+   sending one buffer per decoded frame. While a buffer is being filled its
+   planes sit at full capacity stride, FlushPCM() moves them together when it
+   goes out early. A jump in the timestamps starts a new buffer. */
+unsigned int COMXAudio::AddPacketsPCM(const void* data, unsigned int len, double pts)
+{
+  unsigned int sample_size = m_BitsPerSample >> 3;
+  unsigned int frame_size  = sample_size * m_InputChannels;
+  if(!frame_size)
+    return len;
+
+  unsigned int samples = len / frame_size;
+  const uint8_t *src = (const uint8_t *)data;
 
-    if(m_setStartTime)
+  if(m_pcm_samples && pts != DVD_NOPTS_VALUE)
+  {
+    double expected = m_pcm_pts + (double)m_pcm_samples * DVD_TIME_BASE / m_SampleRate;
+    if(m_pcm_pts == DVD_NOPTS_VALUE || fabs(pts - expected) > DVD_MSEC_TO_TIME(1))
     {
-      omx_buffer->nFlags = OMX_BUFFERFLAG_STARTTIME;
+      if(!FlushPCM())
+        return 0;
+    }
+  }
+
+  unsigned int done = 0;
+  while(done < samples)
+  {
+    if(!m_pcm_buffer)
+    {
+      // 200ms timeout
+      m_pcm_buffer = m_omx_decoder.GetInputBuffer(200);
+      if(m_pcm_buffer == NULL)
+      {
+        CLog::Log(LOGERROR, "COMXAudio::Decode timeout\n");
+        printf("COMXAudio::Decode timeout\n");
+        return len;
+      }
+      m_pcm_capacity = m_pcm_buffer->nAllocLen / frame_size;
+      m_pcm_samples  = 0;
+    }
+
+    if(!m_pcm_samples)
+      m_pcm_pts = pts == DVD_NOPTS_VALUE ? DVD_NOPTS_VALUE : pts + (double)done * DVD_TIME_BASE / m_SampleRate;
+
+    unsigned int count = std::min(samples - done, m_pcm_capacity - m_pcm_samples);
+    for(unsigned int ch = 0; ch < m_InputChannels; ch++)
+      memcpy(m_pcm_buffer->pBuffer + (ch * m_pcm_capacity + m_pcm_samples) * sample_size,
+             src + (ch * samples + done) * sample_size, count * sample_size);
+
+    m_pcm_samples += count;
+    done          += count;
+
+    if(m_pcm_samples == m_pcm_capacity && !FlushPCM())
+      return 0;
+  }
+
+  return len;
+}
+
+bool COMXAudio::FlushPCM()
+{
+  if(!m_pcm_buffer || !m_pcm_samples)
+    return true;
+
+  OMX_BUFFERHEADERTYPE *omx_buffer = m_pcm_buffer;
+  unsigned int sample_size = m_BitsPerSample >> 3;
+
+  if(m_pcm_samples < m_pcm_capacity)
+  {
+    for(unsigned int ch = 1; ch < m_InputChannels; ch++)
+      memmove(omx_buffer->pBuffer + ch * m_pcm_samples * sample_size,
+              omx_buffer->pBuffer + ch * m_pcm_capacity * sample_size, m_pcm_samples * sample_size);
+  }
+
+  omx_buffer->nOffset    = 0;
+  omx_buffer->nFlags     = 0;
+  omx_buffer->nFilledLen = m_pcm_samples * sample_size * m_InputChannels;
+
+  m_pcm_buffer  = NULL;
+  m_pcm_samples = 0;
 
-      m_setStartTime = false;
+  return SubmitBuffer(omx_buffer, m_pcm_pts, true);
+}
+
+/* stamps and hands a filled input buffer to the decoder */
+bool COMXAudio::SubmitBuffer(OMX_BUFFERHEADERTYPE *omx_buffer, double pts, bool end_of_frame)
+{
+  OMX_ERRORTYPE omx_err;
+
+  uint64_t val  = (uint64_t)(pts == DVD_NOPTS_VALUE) ? 0 : pts;
+
+  if(m_setStartTime)
+  {
+    omx_buffer->nFlags = OMX_BUFFERFLAG_STARTTIME;
+
+    m_setStartTime = false;
+    m_last_pts = pts;
+  }
+  else
+  {
+    if(pts == DVD_NOPTS_VALUE)
+    {
+      omx_buffer->nFlags = OMX_BUFFERFLAG_TIME_UNKNOWN;
       m_last_pts = pts;
     }
-    else
+    else if (m_last_pts != pts)
     {
-      if(pts == DVD_NOPTS_VALUE)
-      {
-        omx_buffer->nFlags = OMX_BUFFERFLAG_TIME_UNKNOWN;
+      if(pts > m_last_pts)
         m_last_pts = pts;
-      }
-      else if (m_last_pts != pts)
-      {
-        if(pts > m_last_pts)
-          m_last_pts = pts;
-        else
-          omx_buffer->nFlags = OMX_BUFFERFLAG_TIME_UNKNOWN;;
-      }
-      else if (m_last_pts == pts)
-      {
-        omx_buffer->nFlags = OMX_BUFFERFLAG_TIME_UNKNOWN;
-      }
+      else
+        omx_buffer->nFlags = OMX_BUFFERFLAG_TIME_UNKNOWN;;
     }
+    else if (m_last_pts == pts)
+    {
+      omx_buffer->nFlags = OMX_BUFFERFLAG_TIME_UNKNOWN;
+    }
+  }
 
-    omx_buffer->nTimeStamp = ToOMXTime(val);
+  omx_buffer->nTimeStamp = ToOMXTime(val);
 
-    demuxer_bytes -= omx_buffer->nFilledLen;
-    demuxer_content += omx_buffer->nFilledLen;
+  if(end_of_frame)
+    omx_buffer->nFlags |= OMX_BUFFERFLAG_ENDOFFRAME;
 
-    if(demuxer_bytes == 0)
-      omx_buffer->nFlags |= OMX_BUFFERFLAG_ENDOFFRAME;
+  int nRetry = 0;
+  while(true)
+  {
+    omx_err = m_omx_decoder.EmptyThisBuffer(omx_buffer);
+    if (omx_err == OMX_ErrorNone)
+    {
+      break;
+    }
+    else
+    {
+      CLog::Log(LOGERROR, "%s::%s - OMX_EmptyThisBuffer() failed with result(0x%x)\n", CLASSNAME, __func__, omx_err);
+      nRetry++;
+    }
+    if(nRetry == 5)
+    {
+      CLog::Log(LOGERROR, "%s::%s - OMX_EmptyThisBuffer() finaly failed\n", CLASSNAME, __func__);
+      printf("%s::%s - OMX_EmptyThisBuffer() finaly failed\n", CLASSNAME, __func__);
+      m_omx_decoder.ReturnInputBuffer(omx_buffer);
+      return false;
+    }
+  }
 
-    int nRetry = 0;
-    while(true)
+  m_submit_count++;
+  COMXStartup::Event(OMXSTARTUP_AUDIO_SUBMITTED, pts);
+
+  if(m_first_frame)
+  {
+    m_first_frame = false;
+    //m_omx_render.WaitForEvent(OMX_EventPortSettingsChanged);
+
+    m_omx_render.DisablePort(m_omx_render.GetInputPort(), false);
+    if(!m_Passthrough)
     {
-      omx_err = m_omx_decoder.EmptyThisBuffer(omx_buffer);
-      if (omx_err == OMX_ErrorNone)
+      m_omx_mixer.DisablePort(m_omx_mixer.GetOutputPort(), false);
+      m_omx_mixer.DisablePort(m_omx_mixer.GetInputPort(), false);
+    }
+    m_omx_decoder.DisablePort(m_omx_decoder.GetOutputPort(), false);
+
+    if(!m_Passthrough)
+    {
+      OMX_INIT_STRUCTURE(m_pcm_input);
+      m_pcm_input.nPortIndex      = m_omx_decoder.GetOutputPort();
+      omx_err = m_omx_decoder.GetParameter(OMX_IndexParamAudioPcm, &m_pcm_input);
+      if(omx_err != OMX_ErrorNone)
       {
-        break;
+        CLog::Log(LOGERROR, "COMXAudio::AddPackets error GetParameter 1 omx_err(0x%08x)\n", omx_err);
       }
-      else
+
+      /* setup mixer input */
+      m_pcm_input.nPortIndex      = m_omx_mixer.GetInputPort();
+      omx_err = m_omx_mixer.SetParameter(OMX_IndexParamAudioPcm, &m_pcm_input);
+      if(omx_err != OMX_ErrorNone)
       {
-        CLog::Log(LOGERROR, "%s::%s - OMX_EmptyThisBuffer() failed with result(0x%x)\n", CLASSNAME, __func__, omx_err);
-        nRetry++;
+        CLog::Log(LOGERROR, "COMXAudio::AddPackets error SetParameter 1 omx_err(0x%08x)\n", omx_err);
       }
-      if(nRetry == 5)
+      omx_err = m_omx_mixer.GetParameter(OMX_IndexParamAudioPcm, &m_pcm_input);
+      if(omx_err != OMX_ErrorNone)
       {
-        CLog::Log(LOGERROR, "%s::%s - OMX_EmptyThisBuffer() finaly failed\n", CLASSNAME, __func__);
-        printf("%s::%s - OMX_EmptyThisBuffer() finaly failed\n", CLASSNAME, __func__);
-        return 0;
+        CLog::Log(LOGERROR, "COMXAudio::AddPackets error GetParameter 2  omx_err(0x%08x)\n", omx_err);
       }
-    }
 
-    if(m_first_frame)
-    {
-      m_first_frame = false;
-      //m_omx_render.WaitForEvent(OMX_EventPortSettingsChanged);
-
-      m_omx_render.DisablePort(m_omx_render.GetInputPort(), false);
-      if(!m_Passthrough)
+      /* setup mixer output */
+      m_pcm_output.nPortIndex      = m_omx_mixer.GetOutputPort();
+      omx_err = m_omx_mixer.SetParameter(OMX_IndexParamAudioPcm, &m_pcm_output);
+      if(omx_err != OMX_ErrorNone)
+      {
+        CLog::Log(LOGERROR, "COMXAudio::AddPackets error SetParameter 1 omx_err(0x%08x)\n", omx_err);
+      }
+      omx_err = m_omx_mixer.GetParameter(OMX_IndexParamAudioPcm, &m_pcm_output);
+      if(omx_err != OMX_ErrorNone)
       {
-        m_omx_mixer.DisablePort(m_omx_mixer.GetOutputPort(), false);
-        m_omx_mixer.DisablePort(m_omx_mixer.GetInputPort(), false);
+        CLog::Log(LOGERROR, "COMXAudio::AddPackets error GetParameter 2  omx_err(0x%08x)\n", omx_err);
       }
-      m_omx_decoder.DisablePort(m_omx_decoder.GetOutputPort(), false);
 
-      if(!m_Passthrough)
+      m_pcm_output.nPortIndex      = m_omx_render.GetInputPort();
+      omx_err = m_omx_render.SetParameter(OMX_IndexParamAudioPcm, &m_pcm_output);
+      if(omx_err != OMX_ErrorNone)
       {
-        OMX_INIT_STRUCTURE(m_pcm_input);
-        m_pcm_input.nPortIndex      = m_omx_decoder.GetOutputPort();
-        omx_err = m_omx_decoder.GetParameter(OMX_IndexParamAudioPcm, &m_pcm_input);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "COMXAudio::AddPackets error GetParameter 1 omx_err(0x%08x)\n", omx_err);
-        }
+        CLog::Log(LOGERROR, "COMXAudio::AddPackets error SetParameter 1 omx_err(0x%08x)\n", omx_err);
+      }
+      omx_err = m_omx_render.GetParameter(OMX_IndexParamAudioPcm, &m_pcm_output);
+      if(omx_err != OMX_ErrorNone)
+      {
+        CLog::Log(LOGERROR, "COMXAudio::AddPackets error GetParameter 2  omx_err(0x%08x)\n", omx_err);
+      }
 
-        /* setup mixer input */
-        m_pcm_input.nPortIndex      = m_omx_mixer.GetInputPort();
-        omx_err = m_omx_mixer.SetParameter(OMX_IndexParamAudioPcm, &m_pcm_input);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "COMXAudio::AddPackets error SetParameter 1 omx_err(0x%08x)\n", omx_err);
-        }
-        omx_err = m_omx_mixer.GetParameter(OMX_IndexParamAudioPcm, &m_pcm_input);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "COMXAudio::AddPackets error GetParameter 2  omx_err(0x%08x)\n", omx_err);
-        }
+      PrintPCM(&m_pcm_input);
+      PrintPCM(&m_pcm_output);
+    }
+    else
+    {
+      OMX_AUDIO_PARAM_PORTFORMATTYPE formatType;
+      OMX_INIT_STRUCTURE(formatType);
+      formatType.nPortIndex = m_omx_render.GetInputPort();
 
-        /* setup mixer output */
-        m_pcm_output.nPortIndex      = m_omx_mixer.GetOutputPort();
-        omx_err = m_omx_mixer.SetParameter(OMX_IndexParamAudioPcm, &m_pcm_output);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "COMXAudio::AddPackets error SetParameter 1 omx_err(0x%08x)\n", omx_err);
-        }
-        omx_err = m_omx_mixer.GetParameter(OMX_IndexParamAudioPcm, &m_pcm_output);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "COMXAudio::AddPackets error GetParameter 2  omx_err(0x%08x)\n", omx_err);
-        }
+      omx_err = m_omx_render.GetParameter(OMX_IndexParamAudioPortFormat, &formatType);
+      if(omx_err != OMX_ErrorNone)
+      {
+        CLog::Log(LOGERROR, "COMXAudio::AddPackets error OMX_IndexParamAudioPortFormat omx_err(0x%08x)\n", omx_err);
+        assert(0);
+      }
 
-        m_pcm_output.nPortIndex      = m_omx_render.GetInputPort();
-        omx_err = m_omx_render.SetParameter(OMX_IndexParamAudioPcm, &m_pcm_output);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "COMXAudio::AddPackets error SetParameter 1 omx_err(0x%08x)\n", omx_err);
-        }
-        omx_err = m_omx_render.GetParameter(OMX_IndexParamAudioPcm, &m_pcm_output);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "COMXAudio::AddPackets error GetParameter 2  omx_err(0x%08x)\n", omx_err);
-        }
+      formatType.eEncoding = m_eEncoding;
 
-        PrintPCM(&m_pcm_input);
-        PrintPCM(&m_pcm_output);
-      }
-      else
+      omx_err = m_omx_render.SetParameter(OMX_IndexParamAudioPortFormat, &formatType);
+      if(omx_err != OMX_ErrorNone)
       {
-        OMX_AUDIO_PARAM_PORTFORMATTYPE formatType;
-        OMX_INIT_STRUCTURE(formatType);
-        formatType.nPortIndex = m_omx_render.GetInputPort();
+        CLog::Log(LOGERROR, "COMXAudio::AddPackets error OMX_IndexParamAudioPortFormat omx_err(0x%08x)\n", omx_err);
+        assert(0);
+      }
 
-        omx_err = m_omx_render.GetParameter(OMX_IndexParamAudioPortFormat, &formatType);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "COMXAudio::AddPackets error OMX_IndexParamAudioPortFormat omx_err(0x%08x)\n", omx_err);
-          assert(0);
-        }
+      if(m_eEncoding == OMX_AUDIO_CodingDDP)
+      {
+        OMX_AUDIO_PARAM_DDPTYPE m_ddParam;
+        OMX_INIT_STRUCTURE(m_ddParam);
 
-        formatType.eEncoding = m_eEncoding;
+        m_ddParam.nPortIndex      = m_omx_render.GetInputPort();
 
-        omx_err = m_omx_render.SetParameter(OMX_IndexParamAudioPortFormat, &formatType);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "COMXAudio::AddPackets error OMX_IndexParamAudioPortFormat omx_err(0x%08x)\n", omx_err);
-          assert(0);
-        }
+        m_ddParam.nChannels       = m_InputChannels;
+        m_ddParam.nSampleRate     = m_SampleRate;
+        m_ddParam.eBitStreamId    = OMX_AUDIO_DDPBitStreamIdAC3;
+        m_ddParam.nBitRate        = 0;
 
-        if(m_eEncoding == OMX_AUDIO_CodingDDP)
+        for(unsigned int i = 0; i < OMX_MAX_CHANNELS; i++)
         {
-          OMX_AUDIO_PARAM_DDPTYPE m_ddParam;
-          OMX_INIT_STRUCTURE(m_ddParam);
+          if(i >= m_ddParam.nChannels)
+            break;
 
-          m_ddParam.nPortIndex      = m_omx_render.GetInputPort();
+          m_ddParam.eChannelMapping[i] = OMXChannels[i];
+        }
 
-          m_ddParam.nChannels       = m_InputChannels;
-          m_ddParam.nSampleRate     = m_SampleRate;
-          m_ddParam.eBitStreamId    = OMX_AUDIO_DDPBitStreamIdAC3;
-          m_ddParam.nBitRate        = 0;
+        m_omx_render.SetParameter(OMX_IndexParamAudioDdp, &m_ddParam);
+        m_omx_render.GetParameter(OMX_IndexParamAudioDdp, &m_ddParam);
+        PrintDDP(&m_ddParam);
+      }
+      else if(m_eEncoding == OMX_AUDIO_CodingDTS)
+      {
+        m_dtsParam.nPortIndex      = m_omx_render.GetInputPort();
 
-          for(unsigned int i = 0; i < OMX_MAX_CHANNELS; i++)
-          {
-            if(i >= m_ddParam.nChannels)
-              break;
+        m_dtsParam.nChannels       = m_InputChannels;
+        m_dtsParam.nBitRate        = 0;
 
-            m_ddParam.eChannelMapping[i] = OMXChannels[i];
-          }
-  
-          m_omx_render.SetParameter(OMX_IndexParamAudioDdp, &m_ddParam);
-          m_omx_render.GetParameter(OMX_IndexParamAudioDdp, &m_ddParam);
-          PrintDDP(&m_ddParam);
-        }
-        else if(m_eEncoding == OMX_AUDIO_CodingDTS)
+        for(unsigned int i = 0; i < OMX_MAX_CHANNELS; i++)
         {
-          m_dtsParam.nPortIndex      = m_omx_render.GetInputPort();
-
-          m_dtsParam.nChannels       = m_InputChannels;
-          m_dtsParam.nBitRate        = 0;
-
-          for(unsigned int i = 0; i < OMX_MAX_CHANNELS; i++)
-          {
-            if(i >= m_dtsParam.nChannels)
-              break;
+          if(i >= m_dtsParam.nChannels)
+            break;
 
-            m_dtsParam.eChannelMapping[i] = OMXChannels[i];
-          }
-  
-          m_omx_render.SetParameter(OMX_IndexParamAudioDts, &m_dtsParam);
-          m_omx_render.GetParameter(OMX_IndexParamAudioDts, &m_dtsParam);
-          PrintDTS(&m_dtsParam);
+          m_dtsParam.eChannelMapping[i] = OMXChannels[i];
         }
-      }
 
-      m_omx_render.EnablePort(m_omx_render.GetInputPort(), false);
-      if(!m_Passthrough)
-      {
-        m_omx_mixer.EnablePort(m_omx_mixer.GetOutputPort(), false);
-        m_omx_mixer.EnablePort(m_omx_mixer.GetInputPort(), false);
+        m_omx_render.SetParameter(OMX_IndexParamAudioDts, &m_dtsParam);
+        m_omx_render.GetParameter(OMX_IndexParamAudioDts, &m_dtsParam);
+        PrintDTS(&m_dtsParam);
       }
-      m_omx_decoder.EnablePort(m_omx_decoder.GetOutputPort(), false);
     }
- 
+
+    m_omx_render.EnablePort(m_omx_render.GetInputPort(), false);
+    if(!m_Passthrough)
+    {
+      m_omx_mixer.EnablePort(m_omx_mixer.GetOutputPort(), false);
+      m_omx_mixer.EnablePort(m_omx_mixer.GetInputPort(), false);
+    }
+    m_omx_decoder.EnablePort(m_omx_decoder.GetOutputPort(), false);
   }
 
-  return len;
+  return true;
 }
 
 //***********************************************************************************************
@@ -1179,6 +1377,8 @@ void COMXAudio::WaitCompletion()
   if(!m_Initialized || m_Pause)
     return;
 
+  FlushPCM();
+
   OMX_ERRORTYPE omx_err = OMX_ErrorNone;
   OMX_BUFFERHEADERTYPE *omx_buffer = m_omx_decoder.GetInputBuffer();
 
@@ -1439,157 +1639,54 @@ unsigned int COMXAudio::SyncDTS(BYTE* pData, unsigned int iSize)
 {
   OMX_INIT_STRUCTURE(m_dtsParam);
 
-  unsigned int skip;
-  unsigned int srCode;
-  unsigned int dtsBlocks;
-  bool littleEndian;
-
-  for(skip = 0; iSize - skip > 8; ++skip, ++pData)
+  unsigned int skip = m_sync.SyncDTS(pData, iSize);
+  if(skip == iSize)
   {
-    if (pData[0] == 0x7F && pData[1] == 0xFE && pData[2] == 0x80 && pData[3] == 0x01) 
-    {
-      /* 16bit le */
-      littleEndian = true; 
-      dtsBlocks    = ((pData[4] >> 2) & 0x7f) + 1;
-      m_dtsParam.nFormat = 0x1 | 0x2;
-    }
-    else if (pData[0] == 0x1F && pData[1] == 0xFF && pData[2] == 0xE8 && pData[3] == 0x00 && pData[4] == 0x07 && (pData[5] & 0xF0) == 0xF0) 
-    {
-      /* 14bit le */
-      littleEndian = true;
-      dtsBlocks    = (((pData[4] & 0x7) << 4) | (pData[7] & 0x3C) >> 2) + 1;
-      m_dtsParam.nFormat = 0x1 | 0x0;
-    }
-    else if (pData[1] == 0x7F && pData[0] == 0xFE && pData[3] == 0x80 && pData[2] == 0x01) 
-    {
-      /* 16bit be */ 
-      littleEndian = false;
-      dtsBlocks    = ((pData[5] >> 2) & 0x7f) + 1;
-      m_dtsParam.nFormat = 0x0 | 0x2;
-    }
-    else if (pData[1] == 0x1F && pData[0] == 0xFF && pData[3] == 0xE8 && pData[2] == 0x00 && pData[5] == 0x07 && (pData[4] & 0xF0) == 0xF0) 
-    {
-      /* 14bit be */
-      littleEndian = false; 
-      dtsBlocks    = (((pData[5] & 0x7) << 4) | (pData[6] & 0x3C) >> 2) + 1;
-      m_dtsParam.nFormat = 0x0 | 0x0;
-    }
-    else
-    {
-      continue;
-    }
+    m_LostSync = true;
+    return iSize;
+  }
 
-    if (littleEndian)
-    {
-      /* if it is not a termination frame, check the next 6 bits are set */
-      if ((pData[4] & 0x80) == 0x80 && (pData[4] & 0x7C) != 0x7C)
-        continue;
-
-      /* get the frame size */
-      m_dtsParam.nDtsFrameSizeBytes = ((((pData[5] & 0x3) << 8 | pData[6]) << 4) | ((pData[7] & 0xF0) >> 4)) + 1;
-      srCode = (pData[8] & 0x3C) >> 2;
-   }
-   else
-   {
-      /* if it is not a termination frame, check the next 6 bits are set */
-      if ((pData[5] & 0x80) == 0x80 && (pData[5] & 0x7C) != 0x7C)
-        continue;
-
-      /* get the frame size */
-      m_dtsParam.nDtsFrameSizeBytes = ((((pData[4] & 0x3) << 8 | pData[7]) << 4) | ((pData[6] & 0xF0) >> 4)) + 1;
-      srCode = (pData[9] & 0x3C) >> 2;
-   }
-
-    /* make sure the framesize is sane */
-    if (m_dtsParam.nDtsFrameSizeBytes < 96 || m_dtsParam.nDtsFrameSizeBytes > 16384)
-      continue;
-
-    m_dtsParam.nSampleRate = DTSFSCod[srCode];
-
-    switch(dtsBlocks << 5)
-    {
-      case 512 : 
-        m_dtsParam.nDtsType = 1;
-        break;
-      case 1024: 
-        m_dtsParam.nDtsType = 2;
-        break;
-      case 2048: 
-        m_dtsParam.nDtsType = 3;
-        break;
-      default:
-        m_dtsParam.nDtsType = 0;
-        break;
-    }
+  m_dtsParam.nFormat            = (m_sync.IsLittleEndian() ? 0x1 : 0x0) | (m_sync.Is14Bit() ? 0x0 : 0x2);
+  m_dtsParam.nDtsFrameSizeBytes = m_sync.GetFrameSize();
+  m_dtsParam.nSampleRate        = m_sync.GetSampleRate();
 
-    //m_dtsParam.nFormat = 1;
-    m_dtsParam.nDtsType = 1;
+  switch(m_sync.GetDTSBlocks() << 5)
+  {
+    case 512 : 
+      m_dtsParam.nDtsType = 1;
+      break;
+    case 1024: 
+      m_dtsParam.nDtsType = 2;
+      break;
+    case 2048: 
+      m_dtsParam.nDtsType = 3;
+      break;
+    default:
+      m_dtsParam.nDtsType = 0;
+      break;
+  }
 
-    m_LostSync = false;
+  //m_dtsParam.nFormat = 1;
+  m_dtsParam.nDtsType = 1;
 
-    return skip;
-  }
+  m_LostSync = false;
 
-  m_LostSync = true;
-  return iSize;
+  return skip;
 }
 
 unsigned int COMXAudio::SyncAC3(BYTE* pData, unsigned int iSize)
 {
-  unsigned int skip = 0;
-  //unsigned int fSize = 0;
-
-  for(skip = 0; iSize - skip > 6; ++skip, ++pData)
+  unsigned int skip = m_sync.SyncAC3(pData, iSize);
+  if(skip == iSize)
   {
-    /* search for an ac3 sync word */
-    if(pData[0] != 0x0b || pData[1] != 0x77)
-      continue;
-
-    uint8_t fscod      = pData[4] >> 6;
-    uint8_t frmsizecod = pData[4] & 0x3F;
-    uint8_t bsid       = pData[5] >> 3;
-
-    /* sanity checks on the header */
-    if (
-        fscod      ==   3 ||
-        frmsizecod >   37 ||
-        bsid       > 0x11
-    ) continue;
-
-    /* get the details we need to check crc1 and framesize */
-    uint16_t     bitrate   = AC3Bitrates[frmsizecod >> 1];
-    unsigned int framesize = 0;
-    switch(fscod)
-    {
-      case 0: framesize = bitrate * 2; break;
-      case 1: framesize = (320 * bitrate / 147 + (frmsizecod & 1 ? 1 : 0)); break;
-      case 2: framesize = bitrate * 4; break;
-    }
-
-    //fSize = framesize * 2;
-    m_SampleRate = AC3FSCod[fscod];
-
-    /* dont do extensive testing if we have not lost sync */
-    if (!m_LostSync && skip == 0)
-      return 0;
-
-    unsigned int crc_size;
-    /* if we have enough data, validate the entire packet, else try to validate crc2 (5/8 of the packet) */
-    if (framesize <= iSize - skip)
-         crc_size = framesize - 1;
-    else crc_size = (framesize >> 1) + (framesize >> 3) - 1;
-
-    if (crc_size <= iSize - skip)
-      if(m_dllAvUtil.av_crc(m_dllAvUtil.av_crc_get_table(AV_CRC_16_ANSI), 0, &pData[2], crc_size * 2))
-        continue;
-
-    /* if we get here, we can sync */
-    m_LostSync = false;
-    return skip;
+    /* the entire packet is invalid and we have lost sync */
+    m_LostSync = true;
+    return iSize;
   }
 
-  /* if we get here, the entire packet is invalid and we have lost sync */
-  m_LostSync = true;
-  return iSize;
+  m_SampleRate = m_sync.GetSampleRate();
+  m_LostSync   = false;
+
+  return skip;
 }
 
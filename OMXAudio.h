@@ -29,11 +29,7 @@
 
 //#define STANDALONE
 
-#ifdef STANDALONE
-#include "IAudioRenderer.h"
-#else
-#include "../AudioRenderers/IAudioRenderer.h"
-#endif
+#include "OMXAudioSink.h"
 #include "cores/IAudioCallback.h"
 #include "linux/PlatformDefs.h"
 #include "DllAvCodec.h"
@@ -42,10 +38,11 @@
 #include "OMXClock.h"
 #include "OMXStreamInfo.h"
 #include "BitstreamConverter.h"
+#include "AudioSyncParser.h"
 
 #define VIS_PACKET_SIZE 3840
 
-class COMXAudio : public IAudioRenderer
+class COMXAudio : public IOMXAudioSink
 {
 public:
   void UnRegisterAudioCallback();
@@ -94,6 +91,7 @@ public:
   void PrintDTS(OMX_AUDIO_PARAM_DTSTYPE *dtsparam);
   unsigned int SyncDTS(BYTE* pData, unsigned int iSize);
   unsigned int SyncAC3(BYTE* pData, unsigned int iSize);
+  unsigned int GetSubmitCount() { return m_submit_count; };
 
 private:
   IAudioCallback* m_pCallback;
@@ -119,6 +117,7 @@ private:
   int           m_SampleSize;
   bool          m_first_frame;
   bool          m_LostSync;
+  CAudioSyncParser m_sync;
   int           m_SampleRate;
   OMX_AUDIO_CODINGTYPE m_eEncoding;
   uint8_t       *m_extradata;
@@ -128,6 +127,16 @@ private:
   unsigned int  m_visBufferLength;
   double        m_last_pts;
   short            m_visBuffer[VIS_PACKET_SIZE+2];
+  // input buffer being filled with PCM
+  OMX_BUFFERHEADERTYPE *m_pcm_buffer;
+  unsigned int  m_pcm_samples;
+  unsigned int  m_pcm_capacity;
+  double        m_pcm_pts;
+  unsigned int  m_submit_count;
+  // downmix done by m_remap instead of the mixer
+  bool          m_remap_downmix;
+  float         *m_downmix_buffer;
+  unsigned int  m_downmix_size;
   OMX_AUDIO_PARAM_PCMMODETYPE m_pcm_output;
   OMX_AUDIO_PARAM_PCMMODETYPE m_pcm_input;
   OMX_AUDIO_PARAM_DTSTYPE     m_dtsParam;
@@ -141,6 +150,13 @@ protected:
   COMXCoreTunel     m_omx_tunnel_mixer;
   COMXCoreTunel     m_omx_tunnel_decoder;
   DllAvUtil         m_dllAvUtil;
+
+  unsigned int AddPacketsPCM(const void* data, unsigned int len, double pts);
+  bool FlushPCM();
+  bool SubmitBuffer(OMX_BUFFERHEADERTYPE *omx_buffer, double pts, bool end_of_frame);
+  // steps of Initialize() that run next to each other
+  bool SetupRender(const CStdString& device);
+  bool SetupDecoder();
 };
 #endif
 
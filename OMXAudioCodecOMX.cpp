@@ -24,11 +24,33 @@
 #include "XMemUtils.h"
 #endif
 #include "utils/log.h"
+#include "utils/SampleConvert.h"
 
 #define MAX_AUDIO_FRAME_SIZE (AVCODEC_MAX_AUDIO_FRAME_SIZE*2)
 
 #define AV_SAMPLE_FMT_DESIRED AV_SAMPLE_FMT_FLTP
 
+/* converts the decoder output to AV_SAMPLE_FMT_FLTP without going through
+   libswresample, returns false for formats that are not handled here */
+static bool ConvertToDesired(BYTE **out, BYTE **in, enum AVSampleFormat format, int channels, int samples)
+{
+  switch(format)
+  {
+    case AV_SAMPLE_FMT_U8:   ConvertToFloatPlanar<uint8_t>(out, in, false, channels, samples); break;
+    case AV_SAMPLE_FMT_U8P:  ConvertToFloatPlanar<uint8_t>(out, in, true,  channels, samples); break;
+    case AV_SAMPLE_FMT_S16:  ConvertToFloatPlanar<int16_t>(out, in, false, channels, samples); break;
+    case AV_SAMPLE_FMT_S16P: ConvertToFloatPlanar<int16_t>(out, in, true,  channels, samples); break;
+    case AV_SAMPLE_FMT_S32:  ConvertToFloatPlanar<int32_t>(out, in, false, channels, samples); break;
+    case AV_SAMPLE_FMT_S32P: ConvertToFloatPlanar<int32_t>(out, in, true,  channels, samples); break;
+    case AV_SAMPLE_FMT_FLT:  ConvertToFloatPlanar<float>  (out, in, false, channels, samples); break;
+    case AV_SAMPLE_FMT_DBL:  ConvertToFloatPlanar<double> (out, in, false, channels, samples); break;
+    case AV_SAMPLE_FMT_DBLP: ConvertToFloatPlanar<double> (out, in, true,  channels, samples); break;
+    default:
+      return false;
+  }
+  return true;
+}
+
 COMXAudioCodecOMX::COMXAudioCodecOMX()
 {
   m_iBufferSize2 = 0;
@@ -192,6 +214,19 @@ int COMXAudioCodecOMX::Decode(BYTE* pData, int iSize)
 
   if(m_pCodecContext->sample_fmt != AV_SAMPLE_FMT_DESIRED && m_iBufferSize1 > 0)
   {
+    BYTE *out_planes[] = {
+            m_pBuffer2 + 0 * linesize2, m_pBuffer2 + 1 * linesize2, m_pBuffer2 + 2 * linesize2, m_pBuffer2 + 3 * linesize2,
+            m_pBuffer2 + 4 * linesize2, m_pBuffer2 + 5 * linesize2, m_pBuffer2 + 6 * linesize2, m_pBuffer2 + 7 * linesize2,
+    };
+
+    // plain format/interleave changes don't need a resampler context
+    if(m_pCodecContext->channels <= 8 && m_iBufferSize2 <= MAX_AUDIO_FRAME_SIZE &&
+       ConvertToDesired(out_planes, m_pFrame1->data, m_pCodecContext->sample_fmt, m_pCodecContext->channels, m_pFrame1->nb_samples))
+    {
+      m_iBufferSize1 = 0;
+      return iBytesUsed;
+    }
+
     if(m_pConvert && m_pCodecContext->sample_fmt != m_iSampleFormat)
       m_dllSwResample.swr_free(&m_pConvert);
 
@@ -215,11 +250,6 @@ int COMXAudioCodecOMX::Decode(BYTE* pData, int iSize)
     }
     m_iBufferSize1 = 0;
 
-    BYTE *out_planes[] = {
-            m_pBuffer2 + 0 * linesize2, m_pBuffer2 + 1 * linesize2, m_pBuffer2 + 2 * linesize2, m_pBuffer2 + 3 * linesize2,
-            m_pBuffer2 + 4 * linesize2, m_pBuffer2 + 5 * linesize2, m_pBuffer2 + 6 * linesize2, m_pBuffer2 + 7 * linesize2,
-    };
-
     if(m_dllSwResample.swr_convert(m_pConvert, out_planes, m_pFrame1->nb_samples, (const uint8_t **)m_pFrame1->data, m_pFrame1->nb_samples) < 0)
     {
       CLog::Log(LOGERROR, "COMXAudioCodecOMX::Decode - Unable to convert %d to %d", (int)m_pCodecContext->sample_fmt, AV_SAMPLE_FMT_DESIRED);
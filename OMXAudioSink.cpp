@@ -0,0 +1,380 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "OMXAudioSink.h"
+#include "utils/log.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#define CLASSNAME "COMXNullAudio"
+
+COMXNullAudio::COMXNullAudio(bool realtime)
+{
+  m_pCallback     = NULL;
+  m_av_clock      = NULL;
+  m_realtime      = realtime;
+  m_Initialized   = false;
+  m_Pause         = false;
+  m_CurrentVolume = 0;
+  m_InputChannels = 0;
+  m_SampleRate    = 0;
+  m_BitsPerSample = 0;
+  m_BytesPerSec   = 0;
+  m_BufferLen     = 0;
+  m_ChunkLen      = 0;
+  m_queued        = 0;
+  m_last_drain    = 0;
+  m_submit_count  = 0;
+
+  pthread_mutex_init(&m_lock, NULL);
+}
+
+COMXNullAudio::~COMXNullAudio()
+{
+  Deinitialize();
+
+  pthread_mutex_destroy(&m_lock);
+}
+
+bool COMXNullAudio::Initialize(IAudioCallback* pCallback, const CStdString& device, enum PCMChannels *channelMap,
+                               COMXStreamInfo &hints, OMXClock *clock, EEncoded bPassthrough, bool bUseHWDecode,
+                               bool boostOnDownmix, long initialVolume, float fifo_size)
+{
+  if(bPassthrough != IAudioRenderer::ENCODED_NONE || bUseHWDecode)
+  {
+    CLog::Log(LOGERROR, "%s::%s - only PCM is supported\n", CLASSNAME, __func__);
+    return false;
+  }
+
+  SetClock(clock);
+
+  return Initialize(pCallback, device, hints.channels, channelMap, hints.channels, hints.samplerate, hints.bitspersample,
+                    false, boostOnDownmix, false, bPassthrough, initialVolume, fifo_size);
+}
+
+bool COMXNullAudio::Initialize(IAudioCallback* pCallback, const CStdString& device, int iChannels, enum PCMChannels *channelMap,
+                               unsigned int downmixChannels, unsigned int uiSamplesPerSec, unsigned int uiBitsPerSample,
+                               bool bResample, bool boostOnDownmix, bool bIsMusic, EEncoded bPassthrough,
+                               long initialVolume, float fifo_size)
+{
+  if(bPassthrough != IAudioRenderer::ENCODED_NONE || iChannels <= 0 || !uiSamplesPerSec || uiBitsPerSample < 8)
+  {
+    CLog::Log(LOGERROR, "%s::%s - unsupported format channels %d samplerate %u bitspersample %u\n",
+              CLASSNAME, __func__, iChannels, uiSamplesPerSec, uiBitsPerSample);
+    return false;
+  }
+
+  Deinitialize();
+
+  m_pCallback     = pCallback;
+  m_CurrentVolume = initialVolume;
+  m_InputChannels = iChannels;
+  m_SampleRate    = uiSamplesPerSec;
+  m_BitsPerSample = uiBitsPerSample;
+  m_BytesPerSec   = uiSamplesPerSec * (uiBitsPerSample >> 3) * iChannels;
+  m_BufferLen     = m_BytesPerSec * (fifo_size > 0.0f ? fifo_size : 1.0f);
+  m_ChunkLen      = 2048 * (uiBitsPerSample >> 3) * iChannels;
+  m_queued        = 0;
+  m_last_drain    = OMXClock::CurrentHostCounter();
+  m_submit_count  = 0;
+  m_Pause         = false;
+
+  if(!Open(device))
+    return false;
+
+  m_Initialized = true;
+
+  CLog::Log(LOGDEBUG, "%s::%s - %s channels %d samplerate %u bitspersample %u fifo %.2fs\n",
+            CLASSNAME, __func__, m_realtime ? "realtime" : "unlimited",
+            iChannels, uiSamplesPerSec, uiBitsPerSample, (float)m_BufferLen / m_BytesPerSec);
+
+  return true;
+}
+
+bool COMXNullAudio::Deinitialize()
+{
+  if(!m_Initialized)
+    return true;
+
+  Close();
+
+  m_Initialized = false;
+  m_BytesPerSec = 0;
+  m_BufferLen   = 0;
+  m_queued      = 0;
+
+  return true;
+}
+
+/* removes what would have been played since the last call. Called with m_lock held. */
+void COMXNullAudio::Drain()
+{
+  int64_t now = OMXClock::CurrentHostCounter();
+
+  if(!m_realtime)
+    m_queued = 0;
+  else if(!m_Pause)
+  {
+    m_queued -= (double)(now - m_last_drain) * m_BytesPerSec / OMXClock::CurrentHostFrequency();
+    if(m_queued < 0)
+      m_queued = 0;
+  }
+
+  m_last_drain = now;
+}
+
+unsigned int COMXNullAudio::GetSpace()
+{
+  if(!m_Initialized)
+    return 0;
+
+  pthread_mutex_lock(&m_lock);
+  Drain();
+  unsigned int space = m_BufferLen - (unsigned int)m_queued;
+  pthread_mutex_unlock(&m_lock);
+
+  return space;
+}
+
+unsigned int COMXNullAudio::AddPackets(const void* data, unsigned int len)
+{
+  return AddPackets(data, len, 0, 0);
+}
+
+unsigned int COMXNullAudio::AddPackets(const void* data, unsigned int len, double dts, double pts)
+{
+  if(!m_Initialized)
+  {
+    CLog::Log(LOGERROR, "%s::%s - sanity failed. no valid play handle!\n", CLASSNAME, __func__);
+    return len;
+  }
+
+  /* block like the IL component does when its buffers are full */
+  while(GetSpace() < len && m_queued > 0 && !m_Pause)
+    OMXClock::OMXSleep(10);
+
+  Consume((const uint8_t *)data, len);
+
+  pthread_mutex_lock(&m_lock);
+  Drain();
+  m_queued += len;
+  if(!m_realtime)
+    m_queued = 0;
+  m_submit_count++;
+  pthread_mutex_unlock(&m_lock);
+
+  return len;
+}
+
+float COMXNullAudio::GetDelay()
+{
+  if(!m_Initialized)
+    return 0.0f;
+
+  pthread_mutex_lock(&m_lock);
+  Drain();
+  float delay = m_queued / m_BytesPerSec;
+  pthread_mutex_unlock(&m_lock);
+
+  return delay;
+}
+
+float COMXNullAudio::GetCacheTime()
+{
+  return GetDelay();
+}
+
+float COMXNullAudio::GetCacheTotal()
+{
+  if(!m_Initialized)
+    return 0.0f;
+
+  return (float)m_BufferLen / (float)m_BytesPerSec;
+}
+
+bool COMXNullAudio::Pause()
+{
+  pthread_mutex_lock(&m_lock);
+  Drain();
+  m_Pause = true;
+  pthread_mutex_unlock(&m_lock);
+  return true;
+}
+
+bool COMXNullAudio::Resume()
+{
+  pthread_mutex_lock(&m_lock);
+  Drain();
+  m_Pause = false;
+  pthread_mutex_unlock(&m_lock);
+  return true;
+}
+
+bool COMXNullAudio::Stop()
+{
+  Flush();
+  m_Pause = false;
+  return true;
+}
+
+void COMXNullAudio::Flush()
+{
+  pthread_mutex_lock(&m_lock);
+  m_queued     = 0;
+  m_last_drain = OMXClock::CurrentHostCounter();
+  pthread_mutex_unlock(&m_lock);
+}
+
+void COMXNullAudio::WaitCompletion()
+{
+  if(!m_Initialized || m_Pause)
+    return;
+
+  float delay;
+  while((delay = GetDelay()) > 0.0f)
+    OMXClock::OMXSleep(std::max(1, (int)(delay * 1000.0f)));
+}
+
+#undef CLASSNAME
+#define CLASSNAME "COMXWavAudio"
+
+COMXWavAudio::COMXWavAudio() : COMXNullAudio(false)
+{
+  m_file            = NULL;
+  m_data_size       = 0;
+  m_interleave      = NULL;
+  m_interleave_size = 0;
+}
+
+COMXWavAudio::~COMXWavAudio()
+{
+  Deinitialize();
+
+  free(m_interleave);
+}
+
+static void PutLE16(uint8_t *p, uint16_t v)
+{
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static void PutLE32(uint8_t *p, uint32_t v)
+{
+  p[0] = v & 0xFF;
+  p[1] = (v >> 8) & 0xFF;
+  p[2] = (v >> 16) & 0xFF;
+  p[3] = v >> 24;
+}
+
+/* 44 byte canonical header, 32 bit samples are IEEE float */
+void COMXWavAudio::WriteHeader()
+{
+  uint8_t header[44];
+  unsigned int block_align = m_InputChannels * (m_BitsPerSample >> 3);
+
+  memcpy(header, "RIFF", 4);
+  PutLE32(header + 4, 36 + m_data_size);
+  memcpy(header + 8, "WAVEfmt ", 8);
+  PutLE32(header + 16, 16);
+  PutLE16(header + 20, m_BitsPerSample == 32 ? 3 : 1);
+  PutLE16(header + 22, m_InputChannels);
+  PutLE32(header + 24, m_SampleRate);
+  PutLE32(header + 28, m_SampleRate * block_align);
+  PutLE16(header + 32, block_align);
+  PutLE16(header + 34, m_BitsPerSample);
+  memcpy(header + 36, "data", 4);
+  PutLE32(header + 40, m_data_size);
+
+  fseek(m_file, 0, SEEK_SET);
+  fwrite(header, 1, sizeof(header), m_file);
+  fseek(m_file, 0, SEEK_END);
+}
+
+bool COMXWavAudio::Open(const CStdString& device)
+{
+  m_file = fopen(device.c_str(), "wb");
+  if(!m_file)
+  {
+    CLog::Log(LOGERROR, "%s::%s - could not open %s\n", CLASSNAME, __func__, device.c_str());
+    return false;
+  }
+
+  m_data_size = 0;
+  WriteHeader();
+  return true;
+}
+
+void COMXWavAudio::Consume(const uint8_t *data, unsigned int len)
+{
+  if(!m_file)
+    return;
+
+  /* decoded PCM arrives as float planes, WAVE wants it interleaved */
+  if(m_BitsPerSample == 32 && m_InputChannels > 1)
+  {
+    if(m_interleave_size < len)
+    {
+      uint8_t *interleave = (uint8_t *)realloc(m_interleave, len);
+      if(!interleave)
+        return;
+      m_interleave      = interleave;
+      m_interleave_size = len;
+    }
+
+    unsigned int  channels = m_InputChannels;
+    unsigned int  samples  = len / (channels * sizeof(float));
+    const float   *src     = (const float *)data;
+    float         *dst     = (float *)m_interleave;
+
+    for(unsigned int ch = 0; ch < channels; ch++)
+    {
+      const float *plane = src + ch * samples;
+      for(unsigned int i = 0; i < samples; i++)
+        dst[i * channels + ch] = plane[i];
+    }
+
+    data = m_interleave;
+    len  = samples * channels * sizeof(float);
+  }
+
+  m_data_size += fwrite(data, 1, len, m_file);
+}
+
+void COMXWavAudio::Close()
+{
+  if(!m_file)
+    return;
+
+  WriteHeader();
+  fclose(m_file);
+  m_file = NULL;
+
+  CLog::Log(LOGDEBUG, "%s::%s - wrote %u bytes\n", CLASSNAME, __func__, m_data_size);
+}
@@ -0,0 +1,140 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _OMX_AUDIOSINK_H_
+#define _OMX_AUDIOSINK_H_
+
+#ifdef STANDALONE
+#include "IAudioRenderer.h"
+#else
+#include "../AudioRenderers/IAudioRenderer.h"
+#endif
+#include "OMXClock.h"
+#include "OMXStreamInfo.h"
+
+#include <stdio.h>
+#include <pthread.h>
+
+// What OMXPlayerAudio needs from an audio output on top of IAudioRenderer.
+// COMXAudio renders through the IL audio_render, the software sinks below
+// let the rest of the audio path run without it.
+class IOMXAudioSink : public IAudioRenderer
+{
+public:
+  using IAudioRenderer::Initialize;
+  using IAudioRenderer::AddPackets;
+
+  virtual bool Initialize(IAudioCallback* pCallback, const CStdString& device, enum PCMChannels *channelMap,
+                          COMXStreamInfo &hints, OMXClock *clock, EEncoded bPassthrough, bool bUseHWDecode,
+                          bool boostOnDownmix, long initialVolume, float fifo_size) = 0;
+  virtual unsigned int AddPackets(const void* data, unsigned int len, double dts, double pts) = 0;
+  virtual void Flush() = 0;
+  virtual void DoAudioWork() {};
+  virtual bool SetClock(OMXClock *clock) = 0;
+  virtual unsigned int GetSubmitCount() = 0;
+};
+
+// Consumes PCM at the sample rate, or as fast as it comes when not
+// realtime. The fifo is accounted like the IL one so GetDelay(),
+// GetCacheTime() and GetCacheTotal() report the same things.
+class COMXNullAudio : public IOMXAudioSink
+{
+public:
+  COMXNullAudio(bool realtime);
+  virtual ~COMXNullAudio();
+
+  bool Initialize(IAudioCallback* pCallback, const CStdString& device, enum PCMChannels *channelMap,
+                  COMXStreamInfo &hints, OMXClock *clock, EEncoded bPassthrough, bool bUseHWDecode,
+                  bool boostOnDownmix, long initialVolume, float fifo_size);
+  bool Initialize(IAudioCallback* pCallback, const CStdString& device, int iChannels, enum PCMChannels *channelMap,
+                  unsigned int downmixChannels, unsigned int uiSamplesPerSec, unsigned int uiBitsPerSample,
+                  bool bResample, bool boostOnDownmix, bool bIsMusic=false, EEncoded bPassthrough = IAudioRenderer::ENCODED_NONE,
+                  long initialVolume = 0, float fifo_size = 0);
+  bool Deinitialize();
+
+  void UnRegisterAudioCallback() { m_pCallback = NULL; };
+  void RegisterAudioCallback(IAudioCallback* pCallback) { m_pCallback = pCallback; };
+  float GetDelay();
+  float GetCacheTime();
+  float GetCacheTotal();
+
+  unsigned int AddPackets(const void* data, unsigned int len);
+  unsigned int AddPackets(const void* data, unsigned int len, double dts, double pts);
+  unsigned int GetSpace();
+  bool Pause();
+  bool Stop();
+  bool Resume();
+  unsigned int GetChunkLen() { return m_ChunkLen; };
+
+  long GetCurrentVolume() const { return m_CurrentVolume; };
+  void Mute(bool bMute) {};
+  bool SetCurrentVolume(long nVolume) { m_CurrentVolume = nVolume; return true; };
+  int SetPlaySpeed(int iSpeed) { return 0; };
+  void WaitCompletion();
+  void SwitchChannels(int iAudioStream, bool bAudioOnAllSpeakers) {};
+
+  void Flush();
+  bool SetClock(OMXClock *clock) { m_av_clock = clock; return true; };
+  unsigned int GetSubmitCount() { return m_submit_count; };
+protected:
+  // called with every packet accepted by the sink
+  virtual bool Open(const CStdString& device) { return true; };
+  virtual void Consume(const uint8_t *data, unsigned int len) {};
+  virtual void Close() {};
+  void Drain();
+
+  IAudioCallback  *m_pCallback;
+  OMXClock        *m_av_clock;
+  bool            m_realtime;
+  bool            m_Initialized;
+  bool            m_Pause;
+  long            m_CurrentVolume;
+  unsigned int    m_InputChannels;
+  unsigned int    m_SampleRate;
+  unsigned int    m_BitsPerSample;
+  unsigned int    m_BytesPerSec;
+  unsigned int    m_BufferLen;
+  unsigned int    m_ChunkLen;
+  double          m_queued;
+  int64_t         m_last_drain;
+  unsigned int    m_submit_count;
+  pthread_mutex_t m_lock;
+};
+
+// Writes what it is given to a RIFF WAVE file, planar float is
+// interleaved on the way. Consumes as fast as the file can be written.
+class COMXWavAudio : public COMXNullAudio
+{
+public:
+  COMXWavAudio();
+  virtual ~COMXWavAudio();
+protected:
+  bool Open(const CStdString& device);
+  void Consume(const uint8_t *data, unsigned int len);
+  void Close();
+  void WriteHeader();
+
+  FILE            *m_file;
+  uint32_t        m_data_size;
+  uint8_t         *m_interleave;
+  unsigned int    m_interleave_size;
+};
+#endif
@@ -0,0 +1,109 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "OMXBringUp.h"
+#include "OMXClock.h"
+#include "utils/log.h"
+
+COMXBringUp::COMXBringUp(const char *owner)
+{
+  m_owner = owner;
+  m_start = OMXClock::CurrentHostCounter();
+  m_last  = m_start;
+}
+
+COMXBringUp::~COMXBringUp()
+{
+  // a failed phase may return before the jobs of the next one are joined
+  if(!m_jobs.empty())
+    Join("abandoned");
+}
+
+void *COMXBringUp::Process(void *arg)
+{
+  Job *job = (Job *)arg;
+  job->result = job->job();
+  return NULL;
+}
+
+void COMXBringUp::Run(const std::function<bool()> &job)
+{
+  Job *entry = new Job;
+  entry->job      = job;
+  entry->result   = false;
+  entry->started  = pthread_create(&entry->thread, NULL, &COMXBringUp::Process, entry) == 0;
+
+  // no thread, do it now
+  if(!entry->started)
+    entry->result = entry->job();
+
+  m_jobs.push_back(entry);
+}
+
+bool COMXBringUp::Join(const char *phase)
+{
+  bool result = true;
+
+  for(size_t i = 0; i < m_jobs.size(); i++)
+  {
+    if(m_jobs[i]->started)
+      pthread_join(m_jobs[i]->thread, NULL);
+    result = result && m_jobs[i]->result;
+    delete m_jobs[i];
+  }
+  m_jobs.clear();
+
+  Mark(phase);
+
+  return result;
+}
+
+void COMXBringUp::Mark(const char *phase)
+{
+  int64_t now = OMXClock::CurrentHostCounter();
+  m_phases.push_back(std::make_pair(std::string(phase), (now - m_last) / 1e6));
+  m_last = now;
+}
+
+double COMXBringUp::GetTotal()
+{
+  return (m_last - m_start) / 1e6;
+}
+
+void COMXBringUp::Log()
+{
+  std::string line;
+  char phase[64];
+
+  for(size_t i = 0; i < m_phases.size(); i++)
+  {
+    snprintf(phase, sizeof(phase), " %s %.1fms", m_phases[i].first.c_str(), m_phases[i].second);
+    line += phase;
+  }
+
+  CLog::Log(LOGINFO, "%s -%s total %.1fms\n", m_owner.c_str(), line.c_str(), GetTotal());
+}
@@ -0,0 +1,76 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _OMX_BRINGUP_H_
+#define _OMX_BRINGUP_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Brings up a component graph in phases. Steps of a phase that touch
+// different components are started with Run() and go on their own threads
+// until Join(), so their IL round trips overlap. A COMXCoreComponent
+// serialises its own calls, but not a sequence of them such as a tunnel
+// setup, so every job of a phase must only touch components of the one
+// graph being brought up. The clock is shared: clock tunnels of different
+// graphs must not be set up at the same time, which is why the audio and
+// video graphs are opened one after the other.
+// Each phase is timed and Log() reports them in one line.
+class COMXBringUp
+{
+public:
+  COMXBringUp(const char *owner);
+  ~COMXBringUp();
+
+  // start job on its own thread, false from it fails the phase
+  void Run(const std::function<bool()> &job);
+  // wait for the jobs of the phase, true when all of them succeeded
+  bool Join(const char *phase);
+  // end a phase that ran on the calling thread
+  void Mark(const char *phase);
+  void Log();
+
+  // phase name and ms, in order
+  const std::vector<std::pair<std::string, double> > &GetPhases() { return m_phases; };
+  double GetTotal(); // ms
+private:
+  typedef struct Job
+  {
+    std::function<bool()> job;
+    pthread_t             thread;
+    bool                  started;
+    bool                  result;
+  } Job;
+
+  static void *Process(void *arg);
+
+  std::string                                   m_owner;
+  int64_t                                       m_start;
+  int64_t                                       m_last;
+  std::vector<Job *>                            m_jobs;
+  std::vector<std::pair<std::string, double> >  m_phases;
+};
+#endif
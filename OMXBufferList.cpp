@@ -0,0 +1,209 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "OMXBufferList.h"
+#include "utils/log.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+static int64_t MonotonicNow()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+COMXBufferList::COMXBufferList()
+{
+  m_cells       = NULL;
+  m_mask        = 0;
+  m_head        = 0;
+  m_tail        = 0;
+  m_futex       = 0;
+  m_waiters     = 0;
+  m_wait_time   = 0;
+  m_wait_count  = 0;
+}
+
+COMXBufferList::~COMXBufferList()
+{
+  delete [] m_cells;
+}
+
+void COMXBufferList::Reset(unsigned int count)
+{
+  uint32_t size = 1;
+  while(size < count)
+    size <<= 1;
+
+  if(!m_cells || size != m_mask + 1)
+  {
+    delete [] m_cells;
+    m_cells = new Cell[size];
+    m_mask  = size - 1;
+  }
+
+  // a cell is free to push when its seq equals the tail, full when it is one ahead
+  for(uint32_t i = 0; i < size; i++)
+  {
+    m_cells[i].seq    = i;
+    m_cells[i].buffer = NULL;
+  }
+  m_head = 0;
+  m_tail = 0;
+  __sync_synchronize();
+}
+
+void COMXBufferList::Push(OMX_BUFFERHEADERTYPE *buffer)
+{
+  if(!m_cells)
+    return;
+
+  while(true)
+  {
+    uint32_t tail = m_tail;
+    Cell &cell    = m_cells[tail & m_mask];
+    uint32_t seq  = cell.seq;
+    __sync_synchronize();
+    int32_t diff  = (int32_t)(seq - tail);
+
+    if(diff == 0)
+    {
+      if(__sync_bool_compare_and_swap(&m_tail, tail, tail + 1))
+      {
+        cell.buffer = buffer;
+        __sync_synchronize();
+        cell.seq    = tail + 1;
+        break;
+      }
+    }
+    else if(diff < 0)
+    {
+      // more buffers than the ring was sized for, a bug in the caller.
+      // Losing the header here only shows up much later when the port is freed
+      CLog::Log(LOGERROR, "COMXBufferList::Push - list of %u is full, dropping buffer %p",
+          m_mask + 1, buffer);
+      assert(diff >= 0);
+      return;
+    }
+  }
+
+  Signal();
+}
+
+OMX_BUFFERHEADERTYPE *COMXBufferList::Pop()
+{
+  if(!m_cells)
+    return NULL;
+
+  while(true)
+  {
+    uint32_t head = m_head;
+    Cell &cell    = m_cells[head & m_mask];
+    uint32_t seq  = cell.seq;
+    __sync_synchronize();
+    int32_t diff  = (int32_t)(seq - (head + 1));
+
+    if(diff == 0)
+    {
+      if(__sync_bool_compare_and_swap(&m_head, head, head + 1))
+      {
+        OMX_BUFFERHEADERTYPE *buffer = cell.buffer;
+        __sync_synchronize();
+        cell.seq = head + m_mask + 1;
+        return buffer;
+      }
+    }
+    else if(diff < 0)
+    {
+      return NULL;
+    }
+  }
+}
+
+OMX_BUFFERHEADERTYPE *COMXBufferList::Pop(long timeout, volatile bool *abort)
+{
+  OMX_BUFFERHEADERTYPE *buffer = Pop();
+  if(buffer || (abort && *abort))
+    return buffer;
+
+  int64_t start     = MonotonicNow();
+  int64_t deadline  = start + (int64_t)timeout * 1000000LL;
+
+  // registered before the last look, so a Push after it bumps the futex
+  __sync_fetch_and_add(&m_waiters, 1);
+  while(!abort || !*abort)
+  {
+    int futex = m_futex;
+    __sync_synchronize();
+
+    buffer = Pop();
+    if(buffer)
+      break;
+
+    int64_t remaining = deadline - MonotonicNow();
+    if(remaining <= 0)
+      break;
+
+    struct timespec wait;
+    wait.tv_sec   = remaining / 1000000000LL;
+    wait.tv_nsec  = remaining % 1000000000LL;
+    syscall(SYS_futex, &m_futex, FUTEX_WAIT_PRIVATE, futex, &wait, NULL, 0);
+  }
+  __sync_fetch_and_sub(&m_waiters, 1);
+
+  __sync_fetch_and_add(&m_wait_time, MonotonicNow() - start);
+  __sync_fetch_and_add(&m_wait_count, 1);
+
+  return buffer;
+}
+
+void COMXBufferList::Signal()
+{
+  __sync_synchronize();
+  if(m_waiters == 0)
+    return;
+
+  __sync_fetch_and_add(&m_futex, 1);
+  syscall(SYS_futex, &m_futex, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+void COMXBufferList::Wake()
+{
+  Signal();
+}
+
+unsigned int COMXBufferList::Size()
+{
+  int32_t size = (int32_t)(m_tail - m_head);
+  return size > 0 ? size : 0;
+}
@@ -0,0 +1,71 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _OMX_BUFFERLIST_H_
+#define _OMX_BUFFERLIST_H_
+
+#include <stdint.h>
+
+struct OMX_BUFFERHEADERTYPE;
+
+// The free buffer headers of one port. The decoding thread takes buffers
+// while the IL callback thread gives them back, so this is a bounded ring
+// both sides reach with a compare and swap instead of a lock. A taker
+// only sleeps when the ring is empty, on a futex that givers touch only
+// while somebody waits on it. Timeouts run on the monotonic clock, and the
+// time spent blocked is summed up.
+class COMXBufferList
+{
+public:
+  COMXBufferList();
+  ~COMXBufferList();
+
+  // room for count buffers, empties the list. Not while it is in use
+  void Reset(unsigned int count);
+  void Push(OMX_BUFFERHEADERTYPE *buffer);
+  OMX_BUFFERHEADERTYPE *Pop();
+  // timeout in milliseconds, NULL on timeout or once abort is set and Wake() called
+  OMX_BUFFERHEADERTYPE *Pop(long timeout, volatile bool *abort);
+  // get all waiters to look at their abort flag
+  void Wake();
+
+  unsigned int Size();
+  int64_t GetWaitTime()    { return m_wait_time; };  // ns
+  uint64_t GetWaitCount()  { return m_wait_count; };
+private:
+  typedef struct Cell
+  {
+    volatile uint32_t     seq;
+    OMX_BUFFERHEADERTYPE  *buffer;
+  } Cell;
+
+  void Signal();
+
+  Cell              *m_cells;
+  uint32_t          m_mask;
+  volatile uint32_t m_head;     // next to pop
+  volatile uint32_t m_tail;     // next to push
+  volatile int      m_futex;    // bumped when a buffer comes back to a waiter
+  volatile int      m_waiters;
+  volatile int64_t  m_wait_time;
+  volatile uint64_t m_wait_count;
+};
+#endif
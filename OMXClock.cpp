@@ -26,17 +26,18 @@
 #endif
 
 #include "OMXClock.h"
+#include "OMXTimeSource.h"
+#include "OMXTimer.h"
 
 #define OMX_PRE_ROLL 200
 
 int64_t OMXClock::m_systemOffset;
 int64_t OMXClock::m_systemFrequency;
 bool    OMXClock::m_ismasterclock;
+IOMXTimeSource *OMXClock::m_timesource = NULL;
 
 OMXClock::OMXClock()
 {
-  m_dllAvFormat.Load();
-
   m_video_clock = DVD_NOPTS_VALUE;
   m_audio_clock = DVD_NOPTS_VALUE;
   m_has_video   = false;
@@ -55,6 +56,9 @@ OMXClock::OMXClock()
   m_ismasterclock = true;
   m_ClockOffset = 0;
   m_fps = 25.0f;
+  m_seq = 0;
+  m_media_time = 0;
+  m_media_host = 0;
 
   pthread_mutex_init(&m_lock, NULL);
 
@@ -67,7 +71,6 @@ OMXClock::~OMXClock()
 {
   Deinitialize();
 
-  m_dllAvFormat.Unload();
   pthread_mutex_destroy(&m_lock);
 }
 
@@ -81,6 +84,48 @@ void OMXClock::UnLock()
   pthread_mutex_unlock(&m_lock);
 }
 
+void OMXClock::WriteBegin()
+{
+  m_seq++;
+  __sync_synchronize();
+}
+
+void OMXClock::WriteEnd()
+{
+  __sync_synchronize();
+  m_seq++;
+}
+
+unsigned int OMXClock::ReadBegin()
+{
+  unsigned int seq = m_seq;
+
+  /* a writer is updating, wait for it on the lock instead of spinning */
+  while (seq & 1)
+  {
+    Lock();
+    UnLock();
+    seq = m_seq;
+  }
+
+  __sync_synchronize();
+  return seq;
+}
+
+bool OMXClock::ReadRetry(unsigned int seq)
+{
+  __sync_synchronize();
+  return m_seq != seq;
+}
+
+void OMXClock::InvalidateMediaTime()
+{
+  WriteBegin();
+  m_media_host = 0;
+  WriteEnd();
+}
+
+// frequency and offset are set once by the constructor, no locking needed
 double OMXClock::SystemToAbsolute(int64_t system)
 {
   return DVD_TIME_BASE * (double)(system - m_systemOffset) / m_systemFrequency;
@@ -88,23 +133,41 @@ double OMXClock::SystemToAbsolute(int64_t system)
 
 double OMXClock::SystemToPlaying(int64_t system)
 {
-  int64_t current;
+  int64_t current, start, pause, used;
+  double disc;
+  unsigned int seq;
 
   if (m_bReset)
   {
-    m_startClock = system;
-    m_systemUsed = m_systemFrequency;
-    m_pauseClock = 0;
-    m_iDisc = 0;
-    m_bReset = false;
+    Lock();
+    if (m_bReset)
+    {
+      WriteBegin();
+      m_startClock = system;
+      m_systemUsed = m_systemFrequency;
+      m_pauseClock = 0;
+      m_iDisc = 0;
+      m_bReset = false;
+      WriteEnd();
+    }
+    UnLock();
   }
 
-  if (m_pauseClock)
-    current = m_pauseClock;
+  do
+  {
+    seq   = ReadBegin();
+    start = m_startClock;
+    pause = m_pauseClock;
+    used  = m_systemUsed;
+    disc  = m_iDisc;
+  } while (ReadRetry(seq));
+
+  if (pause)
+    current = pause;
   else
     current = system;
 
-  return DVD_TIME_BASE * (double)(current - m_startClock) / m_systemUsed + m_iDisc;
+  return DVD_TIME_BASE * (double)(current - start) / used + disc;
 }
 
 int64_t OMXClock::GetFrequency()
@@ -115,14 +178,12 @@ int64_t OMXClock::GetFrequency()
 int64_t OMXClock::Wait(int64_t Target)
 {
   int64_t       Now;
-  int           SleepTime;
   int64_t       ClockOffset = m_ClockOffset;
 
   Now = CurrentHostCounter();
   //sleep until the timestamp has passed
-  SleepTime = (int)((Target - (Now + ClockOffset)) * 1000 / m_systemFrequency);
-  if (SleepTime > 0)
-    OMXSleep(SleepTime);
+  if (Target - ClockOffset > Now)
+    COMXTimer::WaitUntil(Target - ClockOffset);
 
   Now = CurrentHostCounter();
   return Now;
@@ -130,11 +191,9 @@ int64_t OMXClock::Wait(int64_t Target)
 
 double OMXClock::WaitAbsoluteClock(double target)
 {
-  Lock();
   int64_t systemtarget, freq, offset;
   freq   = m_systemFrequency;
   offset = m_systemOffset;
-  UnLock();
 
   systemtarget = (int64_t)(target / DVD_TIME_BASE * (double)freq);
   systemtarget += offset;
@@ -146,11 +205,7 @@ double OMXClock::WaitAbsoluteClock(double target)
 // Returns the current absolute clock in units of DVD_TIME_BASE (usually microseconds).
 double OMXClock::GetAbsoluteClock(bool interpolated /*= true*/)
 {
-  Lock();
-  CheckSystemClock();
-  double current = GetTime();
-  UnLock();
-  return SystemToAbsolute(current);
+  return SystemToAbsolute(GetTime());
 }
 
 int64_t OMXClock::GetTime(bool interpolated)
@@ -169,20 +224,14 @@ void OMXClock::CheckSystemClock()
 
 double OMXClock::GetClock(bool interpolated /*= true*/)
 {
-  Lock();
-  double clock = GetTime(interpolated);
-  UnLock();
-  return SystemToPlaying(clock);
+  return SystemToPlaying(GetTime(interpolated));
 }
 
 double OMXClock::GetClock(double& absolute, bool interpolated /*= true*/)
 {
   int64_t current = GetTime(interpolated);
 
-  Lock();
-  CheckSystemClock();
   absolute = SystemToAbsolute(current);
-  UnLock();
 
   return SystemToPlaying(current);
 }
@@ -195,7 +244,11 @@ void OMXClock::SetSpeed(int iSpeed)
   if(iSpeed == DVD_PLAYSPEED_PAUSE)
   {
     if(!m_pauseClock)
+    {
+      WriteBegin();
       m_pauseClock = GetTime();
+      WriteEnd();
+    }
     UnLock();
     return;
   }
@@ -203,6 +256,7 @@ void OMXClock::SetSpeed(int iSpeed)
   int64_t current;
   int64_t newfreq = m_systemFrequency * DVD_PLAYSPEED_NORMAL / iSpeed;
 
+  WriteBegin();
   current = GetTime();
   if( m_pauseClock )
   {
@@ -212,17 +266,20 @@ void OMXClock::SetSpeed(int iSpeed)
 
   m_startClock = current - (int64_t)((double)(current - m_startClock) * newfreq / m_systemUsed);
   m_systemUsed = newfreq;
+  WriteEnd();
   UnLock();
 }
 
 void OMXClock::Discontinuity(double currentPts)
 {
   Lock();
+  WriteBegin();
   m_startClock = GetTime();
   if(m_pauseClock)
     m_pauseClock = m_startClock;
   m_iDisc = currentPts;
   m_bReset = false;
+  WriteEnd();
   UnLock();
 }
 
@@ -230,7 +287,11 @@ void OMXClock::Pause()
 {
   Lock();
   if(!m_pauseClock)
+  {
+    WriteBegin();
     m_pauseClock = GetTime();
+    WriteEnd();
+  }
   UnLock();
 }
 
@@ -242,8 +303,10 @@ void OMXClock::Resume()
     int64_t current;
     current = GetTime();
 
+    WriteBegin();
     m_startClock += current - m_pauseClock;
     m_pauseClock = 0;
+    WriteEnd();
   }
   UnLock();
 }
@@ -436,6 +499,8 @@ bool  OMXClock::OMXStop(bool lock /* = true */)
     return false;
   }
 
+  InvalidateMediaTime();
+
   if(lock)
     UnLock();
 
@@ -466,6 +531,8 @@ bool OMXClock::OMXStart(double pts, bool lock /* = true */)
     return false;
   }
 
+  InvalidateMediaTime();
+
   if(lock)
     UnLock();
 
@@ -477,7 +544,10 @@ bool OMXClock::OMXReset(bool lock /* = true */)
   if(lock)
     Lock();
 
+  WriteBegin();
   m_iCurrentPts = DVD_NOPTS_VALUE;
+  m_media_host  = 0;
+  WriteEnd();
 
   m_video_clock = DVD_NOPTS_VALUE;
   m_audio_clock = DVD_NOPTS_VALUE;
@@ -578,12 +648,47 @@ double OMXClock::OMXMediaTime(bool lock /* = true */)
   }
 
   pts = FromOMXTime(timeStamp.nTimestamp);
+
+  WriteBegin();
+  m_media_time = pts;
+  m_media_host = CurrentHostCounter();
+  WriteEnd();
+
   if(lock)
     UnLock();
   
   return pts;
 }
 
+/* the media time extrapolated from the last read of the clock component while
+   that is younger than max_age_ms, saves polling loops the IL round trip */
+double OMXClock::OMXMediaTimeCached(unsigned int max_age_ms)
+{
+  double  media;
+  int64_t host;
+  bool    pause;
+  int     speed;
+  unsigned int seq;
+
+  do
+  {
+    seq   = ReadBegin();
+    media = m_media_time;
+    host  = m_media_host;
+    pause = m_pause;
+    speed = m_play_speed;
+  } while (ReadRetry(seq));
+
+  int64_t age = CurrentHostCounter() - host;
+  if(!host || age > (int64_t)max_age_ms * m_systemFrequency / 1000)
+    return OMXMediaTime();
+
+  if(pause)
+    return media;
+
+  return media + (double)age * DVD_TIME_BASE / m_systemFrequency * speed;
+}
+
 bool OMXClock::OMXPause(bool lock /* = true */)
 {
   if(m_omx_clock.GetComponent() == NULL)
@@ -610,7 +715,10 @@ bool OMXClock::OMXPause(bool lock /* = true */)
     return false;
   }
 
+  WriteBegin();
   m_pause = true;
+  m_media_host = 0;
+  WriteEnd();
 
   if(lock)
     UnLock();
@@ -644,7 +752,10 @@ bool OMXClock::OMXResume(bool lock /* = true */)
     return false;
   }
 
+  WriteBegin();
   m_pause = false;
+  m_media_host = 0;
+  WriteEnd();
 
   if(lock)
     UnLock();
@@ -680,6 +791,8 @@ bool OMXClock::OMXUpdateClock(double pts, bool lock /* = true */)
       CLog::Log(LOGERROR, "OMXClock::OMXUpdateClock error setting OMX_IndexConfigTimeCurrentVideoReference\n");
   }
 
+  InvalidateMediaTime();
+
   if(lock)
     UnLock();
 
@@ -733,6 +846,8 @@ bool OMXClock::OMXWaitStart(double pts, bool lock /* = true */)
     return false;
   }
 
+  InvalidateMediaTime();
+
   if(lock)
     UnLock();
 
@@ -753,7 +868,10 @@ bool OMXClock::OMXSpeed(int speed, bool lock /* = true */)
 
   scaleType.xScale = (speed << 16);
 
+  WriteBegin();
   m_play_speed = speed;
+  m_media_host = 0;
+  WriteEnd();
 
   omx_err = OMX_SetConfig(m_omx_clock.GetComponent(), OMX_IndexConfigTimeScale, &scaleType);
   if(omx_err != OMX_ErrorNone)
@@ -783,16 +901,24 @@ void OMXClock::AddTimespecs(struct timespec &time, long millisecs)
 
 double OMXClock::GetPTS() 
 { 
-  Lock();
-  double pts = m_iCurrentPts;
-  UnLock();
+  double pts;
+  unsigned int seq;
+
+  do
+  {
+    seq = ReadBegin();
+    pts = m_iCurrentPts;
+  } while (ReadRetry(seq));
+
   return pts;
 }
 
 void OMXClock::SetPTS(double pts) 
 { 
   Lock();
+  WriteBegin();
   m_iCurrentPts = pts; 
+  WriteEnd();
   UnLock();
 };
 
@@ -834,6 +960,9 @@ bool OMXClock::HDMIClockSync(bool lock /* = true */)
 
 int64_t OMXClock::CurrentHostCounter(void)
 {
+  if(m_timesource)
+    return m_timesource->Now();
+
   struct timespec now;
   clock_gettime(CLOCK_MONOTONIC, &now);
   return( ((int64_t)now.tv_sec * 1000000000L) + now.tv_nsec );
@@ -857,11 +986,7 @@ void OMXClock::AddTimeSpecNano(struct timespec &time, uint64_t nanoseconds)
 
 void OMXClock::OMXSleep(unsigned int dwMilliSeconds)
 {
-  struct timespec req;
-  req.tv_sec = dwMilliSeconds / 1000;
-  req.tv_nsec = (dwMilliSeconds % 1000) * 1000000;
-
-  while ( nanosleep(&req, &req) == -1 && errno == EINTR && (req.tv_nsec > 0 || req.tv_sec > 0));
+  COMXTimer::WaitUntil(COMXTimer::Deadline(dwMilliSeconds));
 }
 
 int OMXClock::GetRefreshRate(double* interval)
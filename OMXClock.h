@@ -22,10 +22,10 @@
 #ifndef _AVCLOCK_H_
 #define _AVCLOCK_H_
 
-#include "DllAvFormat.h"
-
 #include "OMXCore.h"
 
+class IOMXTimeSource;
+
 #define AV_SYNC_THRESHOLD 0.01
 #define AV_NOSYNC_THRESHOLD 10.0
 #define SAMPLE_CORRECTION_PERCENT_MAX 10
@@ -91,10 +91,21 @@ protected:
   double            m_maxspeedadjust;
   bool              m_speedadjust;
   static bool       m_ismasterclock;
+  static IOMXTimeSource *m_timesource;
   double            m_fps;
+  // sequence count over the software clock state, m_iCurrentPts and the
+  // cached media time. Writers hold m_lock and make it odd while they update,
+  // readers copy the state and retry when the count moved instead of locking
+  volatile unsigned int m_seq;
+  double            m_media_time;
+  int64_t           m_media_host; //host time m_media_time was read, 0 when stale
+  void              WriteBegin();
+  void              WriteEnd();
+  unsigned int      ReadBegin();
+  bool              ReadRetry(unsigned int seq);
+  void              InvalidateMediaTime();
 private:
   COMXCoreComponent m_omx_clock;
-  DllAvFormat       m_dllAvFormat;
 public:
   OMXClock();
   ~OMXClock();
@@ -127,6 +138,7 @@ public:
   bool OMXReset(bool lock = true);
   double OMXWallTime(bool lock = true);
   double OMXMediaTime(bool lock = true);
+  double OMXMediaTimeCached(unsigned int max_age_ms = 20);
   bool OMXPause(bool lock = true);
   bool OMXResume(bool lock = true);
   bool OMXUpdateClock(double pts, bool lock = true);
@@ -151,6 +163,10 @@ public:
   bool HasAudio() { return m_has_audio; };
   static void AddTimeSpecNano(struct timespec &time, uint64_t nanoseconds);
   static void OMXSleep(unsigned int dwMilliSeconds);
+  // host time and sleeps come from source instead of the system while set,
+  // install it before the first OMXClock is constructed
+  static void SetTimeSource(IOMXTimeSource *source) { m_timesource = source; };
+  static IOMXTimeSource *GetTimeSource()           { return m_timesource;  };
 
   int     GetRefreshRate(double* interval = NULL);
   void    SetRefreshRate(double fps) { m_fps = fps; };
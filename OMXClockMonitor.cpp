@@ -0,0 +1,300 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "OMXClockMonitor.h"
+#include "OMXTimer.h"
+#include "OMXReader.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "utils/log.h"
+
+// a jump of the media time against host time larger than this is a pause or seek
+#define CLOCK_MONITOR_STEP  0.5
+// fewer samples or a shorter span than this give no drift
+#define CLOCK_MONITOR_MIN_SAMPLES 10
+#define CLOCK_MONITOR_MIN_SPAN    5.0
+
+enum
+{
+  CLOCK_MONITOR_MEDIA,
+  CLOCK_MONITOR_CLOCK,
+  CLOCK_MONITOR_AUDIO,
+  CLOCK_MONITOR_VIDEO,
+};
+
+OMXClockMonitor::OMXClockMonitor()
+{
+  m_av_clock    = NULL;
+  m_interval    = 500;
+  m_wake_fd     = -1;
+  m_dump        = NULL;
+  m_head        = 0;
+  m_count       = 0;
+  m_media_drift = 0.0;
+  m_clock_drift = 0.0;
+  m_audio_drift = 0.0;
+  m_video_drift = 0.0;
+}
+
+OMXClockMonitor::~OMXClockMonitor()
+{
+  Close();
+}
+
+bool OMXClockMonitor::Open(OMXClock *av_clock, unsigned int interval_ms, const char *dump_file)
+{
+  if(!av_clock || Running())
+    return false;
+
+  m_av_clock    = av_clock;
+  m_interval    = interval_ms ? interval_ms : 500;
+  m_head        = 0;
+  m_count       = 0;
+  m_media_drift = 0.0;
+  m_clock_drift = 0.0;
+  m_audio_drift = 0.0;
+  m_video_drift = 0.0;
+
+  m_wake_fd = eventfd(0, EFD_CLOEXEC);
+  if(m_wake_fd < 0)
+  {
+    CLog::Log(LOGERROR, "OMXClockMonitor::Open can not create wake up event\n");
+    return false;
+  }
+
+  if(dump_file)
+  {
+    m_dump = fopen(dump_file, "w");
+    if(!m_dump)
+    {
+      CLog::Log(LOGERROR, "OMXClockMonitor::Open can not open %s\n", dump_file);
+    }
+    else
+    {
+      setvbuf(m_dump, NULL, _IOLBF, 0);
+      fprintf(m_dump, "# host clock media audio video fps media_ppm clock_ppm audio_ppm video_ppm\n");
+    }
+  }
+
+  Create();
+
+  return true;
+}
+
+void OMXClockMonitor::Close()
+{
+  if(Running())
+  {
+    uint64_t wake = 1;
+    m_bStop = true;
+    if(write(m_wake_fd, &wake, sizeof(wake)) < 0)
+      CLog::Log(LOGERROR, "OMXClockMonitor::Close can not wake up the monitor\n");
+    StopThread();
+  }
+
+  if(m_wake_fd >= 0)
+    close(m_wake_fd);
+  m_wake_fd = -1;
+
+  if(m_dump)
+    fclose(m_dump);
+  m_dump = NULL;
+
+  m_av_clock = NULL;
+}
+
+void OMXClockMonitor::Process()
+{
+  int64_t deadline = OMXClock::CurrentHostCounter();
+
+  while(!m_bStop)
+  {
+    deadline += (int64_t)m_interval * 1000000;
+    if(COMXTimer::WaitUntil(deadline, m_wake_fd))
+      break;
+
+    /* a stalled thread catches up instead of sampling in a burst */
+    if(deadline < OMXClock::CurrentHostCounter())
+      deadline = OMXClock::CurrentHostCounter();
+
+    Sample();
+  }
+}
+
+void OMXClockMonitor::Sample()
+{
+  OMXClockSample sample;
+
+  /* only normal playback says anything about drift, the ring restarts on return */
+  if(m_av_clock->OMXIsPaused() || m_av_clock->OMXPlaySpeed() != OMX_PLAYSPEED_NORMAL)
+    return;
+
+  double audio  = m_av_clock->GetAudioClock();
+  double video  = m_av_clock->GetVideoClock();
+  double fps    = 0.0;
+
+  sample.host   = (double)OMXClock::CurrentHostCounter() / OMXClock::CurrentHostFrequency();
+  sample.media  = m_av_clock->OMXMediaTime() / DVD_TIME_BASE;
+  sample.clock  = m_av_clock->GetClock() / DVD_TIME_BASE;
+  sample.audio  = audio == DVD_NOPTS_VALUE ? DVD_NOPTS_VALUE : audio / DVD_TIME_BASE;
+  sample.video  = video == DVD_NOPTS_VALUE ? DVD_NOPTS_VALUE : video / DVD_TIME_BASE;
+  if(m_av_clock->GetRefreshRate(&fps) <= 0)
+    fps = 0.0;
+  sample.fps    = fps;
+
+  Lock();
+
+  if(m_count)
+  {
+    OMXClockSample &last = m_ring[(m_head + CLOCK_MONITOR_SAMPLES - 1) % CLOCK_MONITOR_SAMPLES];
+    if(fabs((sample.media - sample.host) - (last.media - last.host)) > CLOCK_MONITOR_STEP)
+    {
+      m_count = 0;
+      if(m_dump)
+        fprintf(m_dump, "# media time stepped by %.3f s, restarting\n",
+                (sample.media - sample.host) - (last.media - last.host));
+    }
+  }
+
+  m_ring[m_head] = sample;
+  m_head = (m_head + 1) % CLOCK_MONITOR_SAMPLES;
+  if(m_count < CLOCK_MONITOR_SAMPLES)
+    m_count++;
+
+  UpdateDrift();
+
+  UnLock();
+
+  if(m_dump)
+  {
+    fprintf(m_dump, "%.6f %.6f %.6f %.6f %.6f %.3f %+.1f %+.1f %+.1f %+.1f\n",
+            sample.host, sample.clock, sample.media,
+            sample.audio == DVD_NOPTS_VALUE ? 0.0 : sample.audio,
+            sample.video == DVD_NOPTS_VALUE ? 0.0 : sample.video,
+            sample.fps, m_media_drift, m_clock_drift, m_audio_drift, m_video_drift);
+  }
+}
+
+/* called with the lock held */
+void OMXClockMonitor::UpdateDrift()
+{
+  m_media_drift = Slope(CLOCK_MONITOR_MEDIA) * 1e6;
+  m_clock_drift = Slope(CLOCK_MONITOR_CLOCK) * 1e6;
+  m_audio_drift = Slope(CLOCK_MONITOR_AUDIO) * 1e6;
+  m_video_drift = Slope(CLOCK_MONITOR_VIDEO) * 1e6;
+}
+
+/* least squares slope of the difference between a clock and its reference
+   against host time. Sums are taken relative to the oldest sample so the
+   absolute host time does not eat the precision */
+double OMXClockMonitor::Slope(int clock)
+{
+  double sx = 0.0, sy = 0.0, sxx = 0.0, sxy = 0.0;
+  double x0 = 0.0, y0 = 0.0, first = 0.0, last = 0.0;
+  unsigned int n = 0;
+
+  for(unsigned int i = 0; i < m_count; i++)
+  {
+    OMXClockSample &s = m_ring[(m_head + CLOCK_MONITOR_SAMPLES - m_count + i) % CLOCK_MONITOR_SAMPLES];
+    double y;
+
+    switch(clock)
+    {
+      case CLOCK_MONITOR_MEDIA:
+        y = s.media - s.host;
+        break;
+      case CLOCK_MONITOR_CLOCK:
+        y = s.clock - s.media;
+        break;
+      case CLOCK_MONITOR_AUDIO:
+        if(s.audio == DVD_NOPTS_VALUE)
+          continue;
+        y = s.audio - s.media;
+        break;
+      default:
+        if(s.video == DVD_NOPTS_VALUE)
+          continue;
+        y = s.video - s.media;
+        break;
+    }
+
+    if(!n)
+    {
+      x0    = s.host;
+      y0    = y;
+      first = s.host;
+    }
+    last = s.host;
+
+    double x = s.host - x0;
+    y -= y0;
+
+    sx  += x;
+    sy  += y;
+    sxx += x * x;
+    sxy += x * y;
+    n++;
+  }
+
+  if(n < CLOCK_MONITOR_MIN_SAMPLES || last - first < CLOCK_MONITOR_MIN_SPAN)
+    return 0.0;
+
+  double d = n * sxx - sx * sx;
+  if(d <= 0.0)
+    return 0.0;
+
+  return (n * sxy - sx * sy) / d;
+}
+
+double OMXClockMonitor::GetMediaDrift()
+{
+  return m_media_drift;
+}
+
+double OMXClockMonitor::GetClockDrift()
+{
+  return m_clock_drift;
+}
+
+double OMXClockMonitor::GetAudioDrift()
+{
+  return m_audio_drift;
+}
+
+double OMXClockMonitor::GetVideoDrift()
+{
+  return m_video_drift;
+}
+
+unsigned int OMXClockMonitor::GetSamples()
+{
+  return m_count;
+}
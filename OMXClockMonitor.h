@@ -0,0 +1,79 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _OMX_CLOCKMONITOR_H_
+#define _OMX_CLOCKMONITOR_H_
+
+#include "OMXThread.h"
+#include "OMXClock.h"
+
+#include <stdio.h>
+
+#define CLOCK_MONITOR_SAMPLES 1200
+
+// all times in seconds, audio and video are DVD_NOPTS_VALUE without a clock
+typedef struct OMXClockSample
+{
+  double  host;   // OMXClock host counter
+  double  clock;  // software clock, SystemToPlaying
+  double  media;  // IL clock media time
+  double  audio;  // last audio pts handed to SetAudioClock
+  double  video;  // last video pts handed to SetVideoClock
+  double  fps;    // refresh rate estimate from GetRefreshRate
+} OMXClockSample;
+
+// Samples the clocks of an OMXClock on its own thread and keeps the last
+// CLOCK_MONITOR_SAMPLES in a ring. Drift rates are the least squares slope
+// of one clock against another over the ring, in ppm. Pauses, seeks and
+// speed changes step the media time, the ring restarts when that happens.
+class OMXClockMonitor : public OMXThread
+{
+public:
+  OMXClockMonitor();
+  ~OMXClockMonitor();
+  // dump_file gets a line per sample with the drift rates so far, may be NULL
+  bool Open(OMXClock *av_clock, unsigned int interval_ms, const char *dump_file = NULL);
+  void Close();
+  void Process();
+
+  double GetMediaDrift(); // IL media time against host time
+  double GetClockDrift(); // software clock against IL media time
+  double GetAudioDrift(); // audio clock against IL media time
+  double GetVideoDrift(); // video clock against IL media time
+  unsigned int GetSamples();
+private:
+  void   Sample();
+  void   UpdateDrift();
+  double Slope(int clock);
+
+  OMXClock        *m_av_clock;
+  unsigned int    m_interval;
+  int             m_wake_fd;
+  FILE            *m_dump;
+  OMXClockSample  m_ring[CLOCK_MONITOR_SAMPLES];
+  unsigned int    m_head;
+  unsigned int    m_count;
+  double          m_media_drift;
+  double          m_clock_drift;
+  double          m_audio_drift;
+  double          m_video_drift;
+};
+#endif
@@ -32,6 +32,7 @@
 #include "utils/log.h"
 
 #include "OMXClock.h"
+#include "OMXILTrace.h"
 
 #ifdef _LINUX
 #include "XMemUtils.h"
@@ -112,7 +113,9 @@ OMX_ERRORTYPE COMXCoreTunel::Flush()
   OMX_ERRORTYPE omx_err = OMX_ErrorNone;
   if(m_src_component->GetComponent())
   {
+    int64_t trace = COMXILTrace::Begin();
     omx_err = OMX_SendCommand(m_src_component->GetComponent(), OMX_CommandFlush, m_src_port, NULL);
+    COMXILTrace::End(trace, m_src_component->GetName(), OMXIL_CALL_SEND_COMMAND, OMX_CommandFlush, m_src_port, omx_err);
     if(omx_err != OMX_ErrorNone && omx_err != OMX_ErrorSameState)
     {
       CLog::Log(LOGERROR, "COMXCoreComponent::Flush - Error flush  port %d on component %s omx_err(0x%08x)", 
@@ -122,7 +125,9 @@ OMX_ERRORTYPE COMXCoreTunel::Flush()
 
   if(m_dst_component->GetComponent())
   {
+    int64_t trace = COMXILTrace::Begin();
     omx_err = OMX_SendCommand(m_dst_component->GetComponent(), OMX_CommandFlush, m_dst_port, NULL);
+    COMXILTrace::End(trace, m_dst_component->GetName(), OMXIL_CALL_SEND_COMMAND, OMX_CommandFlush, m_dst_port, omx_err);
     if(omx_err != OMX_ErrorNone && omx_err != OMX_ErrorSameState)
     {
       CLog::Log(LOGERROR, "COMXCoreComponent::Flush - Error flush port %d on component %s omx_err(0x%08x)", 
@@ -178,7 +183,9 @@ OMX_ERRORTYPE COMXCoreTunel::Deestablish(bool noWait)
 
   if(m_src_component->GetComponent())
   {
+    int64_t trace = COMXILTrace::Begin();
     omx_err = m_DllOMX->OMX_SetupTunnel(m_src_component->GetComponent(), m_src_port, NULL, 0);
+    COMXILTrace::End(trace, m_src_component->GetName(), OMXIL_CALL_REMOVE_TUNNEL, m_src_port, m_dst_port, omx_err);
     if(omx_err != OMX_ErrorNone && omx_err != OMX_ErrorIncorrectStateOperation) 
     {
       CLog::Log(LOGERROR, "COMXCoreComponent::Deestablish - could not unset tunnel on comp src %s port %d omx_err(0x%08x)\n", 
@@ -188,7 +195,9 @@ OMX_ERRORTYPE COMXCoreTunel::Deestablish(bool noWait)
 
   if(m_dst_component->GetComponent())
   {
+    int64_t trace = COMXILTrace::Begin();
     omx_err = m_DllOMX->OMX_SetupTunnel(m_dst_component->GetComponent(), m_dst_port, NULL, 0);
+    COMXILTrace::End(trace, m_dst_component->GetName(), OMXIL_CALL_REMOVE_TUNNEL, m_dst_port, 0, omx_err);
     if(omx_err != OMX_ErrorNone && omx_err != OMX_ErrorIncorrectStateOperation) 
     {
       CLog::Log(LOGERROR, "COMXCoreComponent::Deestablish - could not unset tunnel on comp dst %s port %d omx_err(0x%08x)\n", 
@@ -261,7 +270,14 @@ OMX_ERRORTYPE COMXCoreTunel::Establish(bool portSettingsChanged)
 
   if(m_src_component->GetComponent() && m_dst_component->GetComponent())
   {
+    int64_t trace = COMXILTrace::Begin();
     omx_err = m_DllOMX->OMX_SetupTunnel(m_src_component->GetComponent(), m_src_port, m_dst_component->GetComponent(), m_dst_port);
+    if(trace)
+    {
+      std::string dst = m_dst_component->GetName();
+      COMXILTrace::End(trace, m_src_component->GetName() + ">" + dst.substr(dst.rfind('.') + 1),
+                       OMXIL_CALL_SETUP_TUNNEL, m_src_port, m_dst_port, omx_err);
+    }
     if(omx_err != OMX_ErrorNone) 
     {
       CLog::Log(LOGERROR, "COMXCoreComponent::Establish - could not setup tunnel src %s port %d dst %s port %d omx_err(0x%08x)\n", 
@@ -369,18 +385,16 @@ COMXCoreComponent::COMXCoreComponent()
 
   CustomDecoderFillBufferDoneHandler = NULL;
   CustomDecoderEmptyBufferDoneHandler = NULL;
+  CustomDecoderEventHandler = NULL;
+  m_custom_event_data = NULL;
 
   m_eos                 = false;
+  m_omx_event_seq       = 0;
 
   m_exit = false;
   m_DllOMXOpen = false;
 
-  pthread_mutex_init(&m_omx_input_mutex, NULL);
-  pthread_mutex_init(&m_omx_output_mutex, NULL);
   pthread_mutex_init(&m_omx_event_mutex, NULL);
-  pthread_cond_init(&m_input_buffer_cond, NULL);
-  pthread_cond_init(&m_output_buffer_cond, NULL);
-  pthread_cond_init(&m_omx_event_cond, NULL);
 
   m_omx_input_use_buffers  = false;
   m_omx_output_use_buffers = false;
@@ -395,12 +409,7 @@ COMXCoreComponent::~COMXCoreComponent()
 {
   Deinitialize();
 
-  pthread_mutex_destroy(&m_omx_input_mutex);
-  pthread_mutex_destroy(&m_omx_output_mutex);
   pthread_mutex_destroy(&m_omx_event_mutex);
-  pthread_cond_destroy(&m_input_buffer_cond);
-  pthread_cond_destroy(&m_output_buffer_cond);
-  pthread_cond_destroy(&m_omx_event_cond);
 
   pthread_mutex_destroy(&m_lock);
   sem_destroy(&m_omx_fill_buffer_done);
@@ -425,7 +434,13 @@ OMX_ERRORTYPE COMXCoreComponent::EmptyThisBuffer(OMX_BUFFERHEADERTYPE *omx_buffe
   if(!m_handle || !omx_buffer)
     return OMX_ErrorUndefined;
 
+  // the buffer may be back and refilled before the call returns
+  OMX_U32 length = omx_buffer->nFilledLen;
+  OMX_U32 flags  = omx_buffer->nFlags;
+
+  int64_t trace = COMXILTrace::Begin();
   omx_err = OMX_EmptyThisBuffer(m_handle, omx_buffer);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_EMPTY_BUFFER, length, flags, omx_err);
   if (omx_err != OMX_ErrorNone)
   {
     CLog::Log(LOGERROR, "COMXCoreComponent::EmptyThisBuffer component(%s) - failed with result(0x%x)\n", 
@@ -442,7 +457,9 @@ OMX_ERRORTYPE COMXCoreComponent::FillThisBuffer(OMX_BUFFERHEADERTYPE *omx_buffer
   if(!m_handle || !omx_buffer)
     return OMX_ErrorUndefined;
 
+  int64_t trace = COMXILTrace::Begin();
   omx_err = OMX_FillThisBuffer(m_handle, omx_buffer);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_FILL_BUFFER, 0, 0, omx_err);
   if (omx_err != OMX_ErrorNone)
   {
     CLog::Log(LOGERROR, "COMXCoreComponent::FillThisBuffer component(%s) - failed with result(0x%x)\n", 
@@ -483,13 +500,13 @@ unsigned int COMXCoreComponent::GetOutputBufferSize()
 
 unsigned int COMXCoreComponent::GetInputBufferSpace()
 {
-  int free = m_omx_input_avaliable.size() * m_input_buffer_size;
+  int free = m_omx_input_avaliable.Size() * m_input_buffer_size;
   return free;
 }
 
 unsigned int COMXCoreComponent::GetOutputBufferSpace()
 {
-  int free = m_omx_output_available.size() * m_output_buffer_size;
+  int free = m_omx_output_available.Size() * m_output_buffer_size;
   return free;
 }
 
@@ -505,7 +522,9 @@ void COMXCoreComponent::FlushInput()
 
   OMX_ERRORTYPE omx_err = OMX_ErrorNone;
 
+  int64_t trace = COMXILTrace::Begin();
   omx_err = OMX_SendCommand(m_handle, OMX_CommandFlush, m_input_port, NULL);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_SEND_COMMAND, OMX_CommandFlush, m_input_port, omx_err);
 
   if(omx_err != OMX_ErrorNone)
   {
@@ -523,7 +542,9 @@ void COMXCoreComponent::FlushOutput()
 
   OMX_ERRORTYPE omx_err = OMX_ErrorNone;
 
+  int64_t trace = COMXILTrace::Begin();
   omx_err = OMX_SendCommand(m_handle, OMX_CommandFlush, m_output_port, NULL);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_SEND_COMMAND, OMX_CommandFlush, m_output_port, omx_err);
 
   if(omx_err != OMX_ErrorNone)
   {
@@ -540,32 +561,37 @@ OMX_BUFFERHEADERTYPE *COMXCoreComponent::GetInputBuffer(long timeout)
 {
   OMX_BUFFERHEADERTYPE *omx_input_buffer = NULL;
 
-  if(!m_handle)
+  if(!m_handle || m_flush_input)
     return NULL;
 
-  pthread_mutex_lock(&m_omx_input_mutex);
-  struct timespec endtime;
-  clock_gettime(CLOCK_REALTIME, &endtime);
-  add_timespecs(endtime, timeout);
-  while (1 && !m_flush_input)
-  {
-    if(!m_omx_input_avaliable.empty())
-    {
-      omx_input_buffer = m_omx_input_avaliable.front();
-      m_omx_input_avaliable.pop();
-      break;
-    }
+  omx_input_buffer = m_omx_input_avaliable.Pop(timeout, &m_flush_input);
+  if(!omx_input_buffer && !m_flush_input)
+    CLog::Log(LOGERROR, "COMXCoreComponent::GetInputBuffer %s wait event timeout\n", m_componentName.c_str());
 
-    int retcode = pthread_cond_timedwait(&m_input_buffer_cond, &m_omx_input_mutex, &endtime);
-    if (retcode != 0) {
-      CLog::Log(LOGERROR, "COMXCoreComponent::GetInputBuffer %s wait event timeout\n", m_componentName.c_str());
-      break;
-    }
-  }
-  pthread_mutex_unlock(&m_omx_input_mutex);
   return omx_input_buffer;
 }
 
+// a free input buffer if there is one right now, for callers that have a fallback
+OMX_BUFFERHEADERTYPE *COMXCoreComponent::PollInputBuffer()
+{
+  if(!m_handle || m_flush_input)
+    return NULL;
+
+  return m_omx_input_avaliable.Pop();
+}
+
+// takes back an input buffer from GetInputBuffer() that is not going to be submitted
+void COMXCoreComponent::ReturnInputBuffer(OMX_BUFFERHEADERTYPE *omx_buffer)
+{
+  if(!omx_buffer)
+    return;
+
+  omx_buffer->nFilledLen  = 0;
+  omx_buffer->nOffset     = 0;
+  omx_buffer->nFlags      = 0;
+  m_omx_input_avaliable.Push(omx_buffer);
+}
+
 OMX_BUFFERHEADERTYPE *COMXCoreComponent::GetOutputBuffer()
 {
   OMX_BUFFERHEADERTYPE *omx_output_buffer = NULL;
@@ -573,15 +599,8 @@ OMX_BUFFERHEADERTYPE *COMXCoreComponent::GetOutputBuffer()
   if(!m_handle)
     return NULL;
 
-  pthread_mutex_lock(&m_omx_output_mutex);
-
-  if(!m_omx_output_available.empty())
-  {
-    omx_output_buffer = m_omx_output_available.front();
-    m_omx_output_available.pop();
-  }
+  omx_output_buffer = m_omx_output_available.Pop();
 
-  pthread_mutex_unlock(&m_omx_output_mutex);
   return omx_output_buffer;
 }
 
@@ -602,7 +621,8 @@ OMX_ERRORTYPE COMXCoreComponent::AllocInputBuffers(bool use_buffers /* = false *
   if(omx_err != OMX_ErrorNone)
     return omx_err;
 
-  if(GetState() != OMX_StateIdle)
+  // a running component takes the buffers of a port being enabled as they come
+  if(GetState() != OMX_StateIdle && GetState() != OMX_StateExecuting && GetState() != OMX_StatePause)
   {
     if(GetState() != OMX_StateLoaded)
       SetStateForComponent(OMX_StateLoaded);
@@ -622,6 +642,9 @@ OMX_ERRORTYPE COMXCoreComponent::AllocInputBuffers(bool use_buffers /* = false *
             m_componentName.c_str(), GetInputPort(), portFormat.nBufferCountMin,
             portFormat.nBufferCountActual, portFormat.nBufferSize, portFormat.nBufferAlignment);
 
+  m_omx_input_avaliable.Reset(portFormat.nBufferCountActual);
+
+  int64_t trace = COMXILTrace::Begin();
   for (size_t i = 0; i < portFormat.nBufferCountActual; i++)
   {
     OMX_BUFFERHEADERTYPE *buffer = NULL;
@@ -644,6 +667,7 @@ OMX_ERRORTYPE COMXCoreComponent::AllocInputBuffers(bool use_buffers /* = false *
       if(m_omx_input_use_buffers && data)
         _aligned_free(data);
 
+      COMXILTrace::End(trace, m_componentName, OMXIL_CALL_ALLOC_BUFFERS, m_input_port, i, omx_err);
       return omx_err;
     }
     buffer->nInputPortIndex = m_input_port;
@@ -651,9 +675,11 @@ OMX_ERRORTYPE COMXCoreComponent::AllocInputBuffers(bool use_buffers /* = false *
     buffer->nOffset         = 0;
     buffer->pAppPrivate     = (void*)i;  
     m_omx_input_buffers.push_back(buffer);
-    m_omx_input_avaliable.push(buffer);
+    m_omx_input_avaliable.Push(buffer);
   }
 
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_ALLOC_BUFFERS, m_input_port, portFormat.nBufferCountActual, omx_err);
+
   omx_err = WaitForCommand(OMX_CommandPortEnable, m_input_port);
 
   m_flush_input = false;
@@ -698,6 +724,9 @@ OMX_ERRORTYPE COMXCoreComponent::AllocOutputBuffers(bool use_buffers /* = false
             m_componentName.c_str(), m_output_port, portFormat.nBufferCountMin,
             portFormat.nBufferCountActual, portFormat.nBufferSize, portFormat.nBufferAlignment);
 
+  m_omx_output_available.Reset(portFormat.nBufferCountActual);
+
+  int64_t trace = COMXILTrace::Begin();
   for (size_t i = 0; i < portFormat.nBufferCountActual; i++)
   {
     OMX_BUFFERHEADERTYPE *buffer = NULL;
@@ -720,6 +749,7 @@ OMX_ERRORTYPE COMXCoreComponent::AllocOutputBuffers(bool use_buffers /* = false
       if(m_omx_output_use_buffers && data)
        _aligned_free(data);
 
+      COMXILTrace::End(trace, m_componentName, OMXIL_CALL_ALLOC_BUFFERS, m_output_port, i, omx_err);
       return omx_err;
     }
     buffer->nOutputPortIndex = m_output_port;
@@ -727,9 +757,11 @@ OMX_ERRORTYPE COMXCoreComponent::AllocOutputBuffers(bool use_buffers /* = false
     buffer->nOffset          = 0;
     buffer->pAppPrivate      = (void*)i;
     m_omx_output_buffers.push_back(buffer);
-    m_omx_output_available.push(buffer);
+    m_omx_output_available.Push(buffer);
   }
 
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_ALLOC_BUFFERS, m_output_port, portFormat.nBufferCountActual, omx_err);
+
   omx_err = WaitForCommand(OMX_CommandPortEnable, m_output_port);
 
   m_flush_output = false;
@@ -748,12 +780,11 @@ OMX_ERRORTYPE COMXCoreComponent::FreeInputBuffers(bool wait)
     return OMX_ErrorNone;
 
   m_flush_input = true;
-
-  pthread_mutex_lock(&m_omx_input_mutex);
-  pthread_cond_broadcast(&m_input_buffer_cond);
+  m_omx_input_avaliable.Wake();
 
   omx_err = DisablePort(m_input_port, false);
 
+  int64_t trace = COMXILTrace::Begin();
   for (size_t i = 0; i < m_omx_input_buffers.size(); i++)
   {
     uint8_t *buf = m_omx_input_buffers[i]->pBuffer;
@@ -769,20 +800,21 @@ OMX_ERRORTYPE COMXCoreComponent::FreeInputBuffers(bool wait)
     }
   }
 
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_FREE_BUFFERS, m_input_port, m_omx_input_buffers.size(), omx_err);
+
   WaitForCommand(OMX_CommandPortDisable, m_input_port);
-  assert(m_omx_input_buffers.size() == m_omx_input_avaliable.size());
+  assert(m_omx_input_buffers.size() == m_omx_input_avaliable.Size());
 
-  m_omx_input_buffers.clear();
+  CLog::Log(LOGDEBUG, "COMXCoreComponent::FreeInputBuffers component(%s) - waited %.1fms for input buffers %llu times\n",
+            m_componentName.c_str(), GetInputWaitTime(), (unsigned long long)m_omx_input_avaliable.GetWaitCount());
 
-  while (!m_omx_input_avaliable.empty())
-    m_omx_input_avaliable.pop();
+  m_omx_input_buffers.clear();
+  m_omx_input_avaliable.Reset(0);
 
   m_input_alignment     = 0;
   m_input_buffer_size   = 0;
   m_input_buffer_count  = 0;
 
-  pthread_mutex_unlock(&m_omx_input_mutex);
-
   return omx_err;
 }
 
@@ -797,12 +829,11 @@ OMX_ERRORTYPE COMXCoreComponent::FreeOutputBuffers(bool wait)
     return OMX_ErrorNone;
 
   m_flush_output = true;
-
-  pthread_mutex_lock(&m_omx_output_mutex);
-  pthread_cond_broadcast(&m_output_buffer_cond);
+  m_omx_output_available.Wake();
 
   omx_err = DisablePort(m_output_port, false);
 
+  int64_t trace = COMXILTrace::Begin();
   for (size_t i = 0; i < m_omx_output_buffers.size(); i++)
   {
     uint8_t *buf = m_omx_output_buffers[i]->pBuffer;
@@ -818,20 +849,18 @@ OMX_ERRORTYPE COMXCoreComponent::FreeOutputBuffers(bool wait)
     }
   }
 
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_FREE_BUFFERS, m_output_port, m_omx_output_buffers.size(), omx_err);
+
   WaitForCommand(OMX_CommandPortDisable, m_output_port);
-  assert(m_omx_output_buffers.size() == m_omx_output_available.size());
+  assert(m_omx_output_buffers.size() == m_omx_output_available.Size());
 
   m_omx_output_buffers.clear();
-
-  while (!m_omx_output_available.empty())
-    m_omx_output_available.pop();
+  m_omx_output_available.Reset(0);
 
   m_output_alignment    = 0;
   m_output_buffer_size  = 0;
   m_output_buffer_count = 0;
 
-  pthread_mutex_unlock(&m_omx_output_mutex);
-
   return omx_err;
 }
 
@@ -877,7 +906,9 @@ OMX_ERRORTYPE COMXCoreComponent::DisableAllPorts()
             continue;
         }
 
+        int64_t trace = COMXILTrace::Begin();
         omx_err = OMX_SendCommand(m_handle, OMX_CommandPortDisable, ports.nStartPortNumber+j, NULL);
+        COMXILTrace::End(trace, m_componentName, OMXIL_CALL_SEND_COMMAND, OMX_CommandPortDisable, ports.nStartPortNumber+j, omx_err);
         if(omx_err != OMX_ErrorNone)
         {
           CLog::Log(LOGERROR, "COMXCoreComponent::DisableAllPorts - Error disable port %d on component %s omx_err(0x%08x)", 
@@ -898,19 +929,28 @@ OMX_ERRORTYPE COMXCoreComponent::DisableAllPorts()
   return OMX_ErrorNone;
 }
 
+// called with m_omx_event_mutex held
 void COMXCoreComponent::Remove(OMX_EVENTTYPE eEvent, OMX_U32 nData1, OMX_U32 nData2)
 {
-  for (std::vector<omx_event>::iterator it = m_omx_events.begin(); it != m_omx_events.end(); ) 
-  {
-    omx_event event = *it;
+  omx_event event;
 
-    if(event.eEvent == eEvent && event.nData1 == nData1 && event.nData2 == nData2) 
-    {
-      it = m_omx_events.erase(it);
-      continue;
-    }
-    ++it;
+  event.eEvent      = eEvent;
+  event.nData1      = nData1;
+  event.nData2      = nData2;
+
+  std::unordered_map<omx_event, uint64_t, omx_event_hash, omx_event_equal>::iterator it = m_omx_event_index.find(event);
+  if(it == m_omx_event_index.end())
+    return;
+
+  std::map<OMX_EVENTTYPE, std::map<uint64_t, omx_event> >::iterator type = m_omx_events.find(eEvent);
+  if(type != m_omx_events.end())
+  {
+    type->second.erase(it->second);
+    if(type->second.empty())
+      m_omx_events.erase(type);
   }
+
+  m_omx_event_index.erase(it);
 }
 
 OMX_ERRORTYPE COMXCoreComponent::AddEvent(OMX_EVENTTYPE eEvent, OMX_U32 nData1, OMX_U32 nData2)
@@ -923,9 +963,37 @@ OMX_ERRORTYPE COMXCoreComponent::AddEvent(OMX_EVENTTYPE eEvent, OMX_U32 nData1,
 
   pthread_mutex_lock(&m_omx_event_mutex);
   Remove(eEvent, nData1, nData2);
-  m_omx_events.push_back(event);
-  // this allows (all) blocked tasks to be awoken
-  pthread_cond_broadcast(&m_omx_event_cond);
+
+  uint64_t seq = ++m_omx_event_seq;
+  m_omx_events[eEvent][seq] = event;
+  m_omx_event_index[event]  = seq;
+
+  // an error ends every wait, anything else only the waits it matches
+  if(eEvent == OMX_EventError)
+  {
+    std::unordered_multimap<omx_event, omx_event_waiter *, omx_event_hash, omx_event_equal>::iterator command;
+    std::multimap<OMX_EVENTTYPE, omx_event_waiter *>::iterator waiter;
+
+    for(command = m_omx_command_waiters.begin(); command != m_omx_command_waiters.end(); ++command)
+      pthread_cond_signal(&command->second->cond);
+    for(waiter = m_omx_event_waiters.begin(); waiter != m_omx_event_waiters.end(); ++waiter)
+      pthread_cond_signal(&waiter->second->cond);
+  }
+  else
+  {
+    std::pair<std::unordered_multimap<omx_event, omx_event_waiter *, omx_event_hash, omx_event_equal>::iterator,
+              std::unordered_multimap<omx_event, omx_event_waiter *, omx_event_hash, omx_event_equal>::iterator> commands;
+    std::pair<std::multimap<OMX_EVENTTYPE, omx_event_waiter *>::iterator,
+              std::multimap<OMX_EVENTTYPE, omx_event_waiter *>::iterator> waiters;
+
+    commands = m_omx_command_waiters.equal_range(event);
+    for(; commands.first != commands.second; ++commands.first)
+      pthread_cond_signal(&commands.first->second->cond);
+
+    waiters = m_omx_event_waiters.equal_range(eEvent);
+    for(; waiters.first != waiters.second; ++waiters.first)
+      pthread_cond_signal(&waiters.first->second->cond);
+  }
   pthread_mutex_unlock(&m_omx_event_mutex);
 
 #ifdef OMX_DEBUG_EVENTS
@@ -936,138 +1004,176 @@ OMX_ERRORTYPE COMXCoreComponent::AddEvent(OMX_EVENTTYPE eEvent, OMX_U32 nData1,
   return OMX_ErrorNone;
 }
 
-// timeout in milliseconds
-OMX_ERRORTYPE COMXCoreComponent::WaitForEvent(OMX_EVENTTYPE eventType, long timeout)
+// called with m_omx_event_mutex held. Takes the event waited for or a pending
+// error, whichever arrived first. Without exact any event of the type will do
+bool COMXCoreComponent::TakeEvent(const omx_event &want, bool exact, OMX_ERRORTYPE &omx_err)
 {
+  const omx_event *match = NULL;
+  uint64_t match_seq = 0;
+
+  if(exact)
+  {
+    std::unordered_map<omx_event, uint64_t, omx_event_hash, omx_event_equal>::iterator it = m_omx_event_index.find(want);
+    if(it != m_omx_event_index.end())
+    {
+      match     = &it->first;
+      match_seq = it->second;
+    }
+  }
+  else
+  {
+    std::map<OMX_EVENTTYPE, std::map<uint64_t, omx_event> >::iterator type = m_omx_events.find(want.eEvent);
+    if(type != m_omx_events.end() && !type->second.empty())
+    {
+      match     = &type->second.begin()->second;
+      match_seq = type->second.begin()->first;
+    }
+  }
+
+  std::map<OMX_EVENTTYPE, std::map<uint64_t, omx_event> >::iterator errors = m_omx_events.find(OMX_EventError);
+  if(errors != m_omx_events.end() && !errors->second.empty() &&
+     (!match || errors->second.begin()->first < match_seq))
+  {
+    omx_event event = errors->second.begin()->second;
+
+    if(event.nData1 == (OMX_U32)OMX_ErrorSameState && event.nData2 == 1)
+      omx_err = OMX_ErrorNone;
+    else
+      omx_err = (OMX_ERRORTYPE)event.nData1;
+
+    Remove(event.eEvent, event.nData1, event.nData2);
+    return true;
+  }
+
+  if(!match)
+    return false;
+
+  omx_event event = *match;
+
 #ifdef OMX_DEBUG_EVENTS
-  CLog::Log(LOGDEBUG, "COMXCoreComponent::WaitForEvent %s wait event 0x%08x\n",
-      m_componentName.c_str(), (int)eventType);
+  CLog::Log(LOGDEBUG, "COMXCoreComponent::TakeEvent %s remove event event.eEvent 0x%08x event.nData1 0x%08x event.nData2 %d\n",
+      m_componentName.c_str(), (int)event.eEvent, (int)event.nData1, (int)event.nData2);
 #endif
 
+  Remove(event.eEvent, event.nData1, event.nData2);
+  omx_err = OMX_ErrorNone;
+  return true;
+}
+
+// timeout in milliseconds, returns OMX_ErrorMax when it passed
+OMX_ERRORTYPE COMXCoreComponent::WaitFor(const omx_event &want, bool exact, long timeout)
+{
+  OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+  omx_event_waiter waiter;
+  bool found;
+
   pthread_mutex_lock(&m_omx_event_mutex);
+
+  if(TakeEvent(want, exact, omx_err))
+  {
+    pthread_mutex_unlock(&m_omx_event_mutex);
+    return omx_err;
+  }
+
   struct timespec endtime;
   clock_gettime(CLOCK_REALTIME, &endtime);
   add_timespecs(endtime, timeout);
-  while(true) 
-  {
-    for (std::vector<omx_event>::iterator it = m_omx_events.begin(); it != m_omx_events.end(); it++) 
-    {
-      omx_event event = *it;
 
-#ifdef OMX_DEBUG_EVENTS
-      CLog::Log(LOGDEBUG, "COMXCoreComponent::WaitForEvent %s inlist event event.eEvent 0x%08x event.nData1 0x%08x event.nData2 %d\n",
-          m_componentName.c_str(), (int)event.eEvent, (int)event.nData1, (int)event.nData2);
-#endif
+  pthread_cond_init(&waiter.cond, NULL);
+  if(exact)
+    m_omx_command_waiters.insert(std::make_pair(want, &waiter));
+  else
+    m_omx_event_waiters.insert(std::make_pair(want.eEvent, &waiter));
 
+  while(!(found = TakeEvent(want, exact, omx_err)))
+  {
+    if(pthread_cond_timedwait(&waiter.cond, &m_omx_event_mutex, &endtime) != 0)
+    {
+      found = TakeEvent(want, exact, omx_err);
+      break;
+    }
+  }
 
-      if(event.eEvent == OMX_EventError && event.nData1 == (OMX_U32)OMX_ErrorSameState && event.nData2 == 1)
-      {
-#ifdef OMX_DEBUG_EVENTS
-        CLog::Log(LOGDEBUG, "COMXCoreComponent::WaitForEvent %s remove event event.eEvent 0x%08x event.nData1 0x%08x event.nData2 %d\n",
-          m_componentName.c_str(), (int)event.eEvent, (int)event.nData1, (int)event.nData2);
-#endif
-        m_omx_events.erase(it);
-        pthread_mutex_unlock(&m_omx_event_mutex);
-        return OMX_ErrorNone;
-      }
-      else if(event.eEvent == OMX_EventError) 
-      {
-        m_omx_events.erase(it);
-        pthread_mutex_unlock(&m_omx_event_mutex);
-        return (OMX_ERRORTYPE)event.nData1;
-      }
-      else if(event.eEvent == eventType) 
+  // inserts may rehash the command waiters, look ourselves up again
+  if(exact)
+  {
+    std::pair<std::unordered_multimap<omx_event, omx_event_waiter *, omx_event_hash, omx_event_equal>::iterator,
+              std::unordered_multimap<omx_event, omx_event_waiter *, omx_event_hash, omx_event_equal>::iterator> range;
+    for(range = m_omx_command_waiters.equal_range(want); range.first != range.second; ++range.first)
+    {
+      if(range.first->second == &waiter)
       {
-#ifdef OMX_DEBUG_EVENTS
-        CLog::Log(LOGDEBUG, "COMXCoreComponent::WaitForEvent %s remove event event.eEvent 0x%08x event.nData1 0x%08x event.nData2 %d\n",
-          m_componentName.c_str(), (int)event.eEvent, (int)event.nData1, (int)event.nData2);
-#endif
-
-        m_omx_events.erase(it);
-        pthread_mutex_unlock(&m_omx_event_mutex);
-        return OMX_ErrorNone;
+        m_omx_command_waiters.erase(range.first);
+        break;
       }
     }
-
-    int retcode = pthread_cond_timedwait(&m_omx_event_cond, &m_omx_event_mutex, &endtime);
-    if (retcode != 0) 
+  }
+  else
+  {
+    std::pair<std::multimap<OMX_EVENTTYPE, omx_event_waiter *>::iterator,
+              std::multimap<OMX_EVENTTYPE, omx_event_waiter *>::iterator> range;
+    for(range = m_omx_event_waiters.equal_range(want.eEvent); range.first != range.second; ++range.first)
     {
-      if (timeout > 0)
-        CLog::Log(LOGERROR, "COMXCoreComponent::WaitForEvent %s wait event 0x%08x timeout %ld\n",
-                            m_componentName.c_str(), (int)eventType, timeout);
-      pthread_mutex_unlock(&m_omx_event_mutex);
-      return OMX_ErrorMax;
+      if(range.first->second == &waiter)
+      {
+        m_omx_event_waiters.erase(range.first);
+        break;
+      }
     }
   }
+
   pthread_mutex_unlock(&m_omx_event_mutex);
-  return OMX_ErrorNone;
+  pthread_cond_destroy(&waiter.cond);
+
+  return found ? omx_err : OMX_ErrorMax;
 }
 
 // timeout in milliseconds
-OMX_ERRORTYPE COMXCoreComponent::WaitForCommand(OMX_U32 command, OMX_U32 nData2, long timeout)
+OMX_ERRORTYPE COMXCoreComponent::WaitForEvent(OMX_EVENTTYPE eventType, long timeout)
 {
 #ifdef OMX_DEBUG_EVENTS
-  CLog::Log(LOGDEBUG, "COMXCoreComponent::WaitForCommand %s wait event.eEvent 0x%08x event.command 0x%08x event.nData2 %d\n", 
-      m_componentName.c_str(), (int)OMX_EventCmdComplete, (int)command, (int)nData2);
+  CLog::Log(LOGDEBUG, "COMXCoreComponent::WaitForEvent %s wait event 0x%08x\n",
+      m_componentName.c_str(), (int)eventType);
 #endif
 
-  pthread_mutex_lock(&m_omx_event_mutex);
-  struct timespec endtime;
-  clock_gettime(CLOCK_REALTIME, &endtime);
-  add_timespecs(endtime, timeout);
-  while(true) 
-  {
-    for (std::vector<omx_event>::iterator it = m_omx_events.begin(); it != m_omx_events.end(); it++) 
-    {
-      omx_event event = *it;
+  omx_event want;
 
-#ifdef OMX_DEBUG_EVENTS
-      CLog::Log(LOGDEBUG, "COMXCoreComponent::WaitForCommand %s inlist event event.eEvent 0x%08x event.nData1 0x%08x event.nData2 %d\n",
-          m_componentName.c_str(), (int)event.eEvent, (int)event.nData1, (int)event.nData2);
-#endif
-      if(event.eEvent == OMX_EventError && event.nData1 == (OMX_U32)OMX_ErrorSameState && event.nData2 == 1)
-      {
-#ifdef OMX_DEBUG_EVENTS
-        CLog::Log(LOGDEBUG, "COMXCoreComponent::WaitForCommand %s remove event event.eEvent 0x%08x event.nData1 0x%08x event.nData2 %d\n",
-          m_componentName.c_str(), (int)event.eEvent, (int)event.nData1, (int)event.nData2);
-#endif
+  want.eEvent = eventType;
+  want.nData1 = 0;
+  want.nData2 = 0;
 
-        m_omx_events.erase(it);
-        pthread_mutex_unlock(&m_omx_event_mutex);
-        return OMX_ErrorNone;
-      } 
-      else if(event.eEvent == OMX_EventError) 
-      {
-        m_omx_events.erase(it);
-        pthread_mutex_unlock(&m_omx_event_mutex);
-        return (OMX_ERRORTYPE)event.nData1;
-      } 
-      else if(event.eEvent == OMX_EventCmdComplete && event.nData1 == command && event.nData2 == nData2) 
-      {
+  int64_t trace = COMXILTrace::Begin();
+  OMX_ERRORTYPE omx_err = WaitFor(want, false, timeout);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_WAIT_EVENT, eventType, 0, omx_err);
+  if(omx_err == OMX_ErrorMax && timeout > 0)
+    CLog::Log(LOGERROR, "COMXCoreComponent::WaitForEvent %s wait event 0x%08x timeout %ld\n",
+                        m_componentName.c_str(), (int)eventType, timeout);
 
+  return omx_err;
+}
+
+// timeout in milliseconds
+OMX_ERRORTYPE COMXCoreComponent::WaitForCommand(OMX_U32 command, OMX_U32 nData2, long timeout)
+{
 #ifdef OMX_DEBUG_EVENTS
-        CLog::Log(LOGDEBUG, "COMXCoreComponent::WaitForCommand %s remove event event.eEvent 0x%08x event.nData1 0x%08x event.nData2 %d\n",
-          m_componentName.c_str(), (int)event.eEvent, (int)event.nData1, (int)event.nData2);
+  CLog::Log(LOGDEBUG, "COMXCoreComponent::WaitForCommand %s wait event.eEvent 0x%08x event.command 0x%08x event.nData2 %d\n", 
+      m_componentName.c_str(), (int)OMX_EventCmdComplete, (int)command, (int)nData2);
 #endif
 
-        m_omx_events.erase(it);
-        pthread_mutex_unlock(&m_omx_event_mutex);
-        return OMX_ErrorNone;
-      }
-    }
+  omx_event want;
 
-    int retcode = pthread_cond_timedwait(&m_omx_event_cond, &m_omx_event_mutex, &endtime);
-    if (retcode != 0) {
-      if (timeout > 0)
-        CLog::Log(LOGERROR, "COMXCoreComponent::WaitForCommand %s wait timeout event.eEvent 0x%08x event.command 0x%08x event.nData2 %d\n", 
-          m_componentName.c_str(), (int)OMX_EventCmdComplete, (int)command, (int)nData2);
-      
-      pthread_mutex_unlock(&m_omx_event_mutex);
-      return OMX_ErrorMax;
-    }
-  }
-  pthread_mutex_unlock(&m_omx_event_mutex);
-  return OMX_ErrorNone;
+  want.eEvent = OMX_EventCmdComplete;
+  want.nData1 = command;
+  want.nData2 = nData2;
+
+  int64_t trace = COMXILTrace::Begin();
+  OMX_ERRORTYPE omx_err = WaitFor(want, true, timeout);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_WAIT_COMMAND, command, nData2, omx_err);
+  if(omx_err == OMX_ErrorMax && timeout > 0)
+    CLog::Log(LOGERROR, "COMXCoreComponent::WaitForCommand %s wait timeout event.eEvent 0x%08x event.command 0x%08x event.nData2 %d\n", 
+      m_componentName.c_str(), (int)OMX_EventCmdComplete, (int)command, (int)nData2);
+
+  return omx_err;
 }
 
 OMX_ERRORTYPE COMXCoreComponent::SetStateForComponent(OMX_STATETYPE state)
@@ -1075,6 +1181,7 @@ OMX_ERRORTYPE COMXCoreComponent::SetStateForComponent(OMX_STATETYPE state)
   Lock();
   
   OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+  int64_t trace = COMXILTrace::Begin();
   OMX_STATETYPE state_actual = OMX_StateMax;
 
   if(!m_handle)
@@ -1086,6 +1193,7 @@ OMX_ERRORTYPE COMXCoreComponent::SetStateForComponent(OMX_STATETYPE state)
   OMX_GetState(m_handle, &state_actual);
   if(state == state_actual)
   {
+    COMXILTrace::End(trace, m_componentName, OMXIL_CALL_SET_STATE, state, 0, OMX_ErrorNone);
     UnLock();
     return OMX_ErrorNone;
   }
@@ -1110,11 +1218,14 @@ OMX_ERRORTYPE COMXCoreComponent::SetStateForComponent(OMX_STATETYPE state)
     {
       CLog::Log(LOGERROR, "COMXCoreComponent::SetStateForComponent - %s ignore OMX_ErrorSameState\n", 
         m_componentName.c_str());
+      COMXILTrace::End(trace, m_componentName, OMXIL_CALL_SET_STATE, state, 0, OMX_ErrorNone);
       UnLock();
       return OMX_ErrorNone;
     }
   }
 
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_SET_STATE, state, 0, omx_err);
+
   UnLock();
 
   return omx_err;
@@ -1144,7 +1255,9 @@ OMX_ERRORTYPE COMXCoreComponent::SetParameter(OMX_INDEXTYPE paramIndex, OMX_PTR
 
   OMX_ERRORTYPE omx_err;
 
+  int64_t trace = COMXILTrace::Begin();
   omx_err = OMX_SetParameter(m_handle, paramIndex, paramStruct);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_SET_PARAMETER, paramIndex, 0, omx_err);
   if(omx_err != OMX_ErrorNone) 
   {
     CLog::Log(LOGERROR, "COMXCoreComponent::SetParameter - %s failed with omx_err(0x%x)\n", 
@@ -1162,7 +1275,9 @@ OMX_ERRORTYPE COMXCoreComponent::GetParameter(OMX_INDEXTYPE paramIndex, OMX_PTR
 
   OMX_ERRORTYPE omx_err;
 
+  int64_t trace = COMXILTrace::Begin();
   omx_err = OMX_GetParameter(m_handle, paramIndex, paramStruct);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_GET_PARAMETER, paramIndex, 0, omx_err);
   if(omx_err != OMX_ErrorNone) 
   {
     CLog::Log(LOGERROR, "COMXCoreComponent::GetParameter - %s failed with omx_err(0x%x)\n", 
@@ -1180,7 +1295,9 @@ OMX_ERRORTYPE COMXCoreComponent::SetConfig(OMX_INDEXTYPE configIndex, OMX_PTR co
 
   OMX_ERRORTYPE omx_err;
 
+  int64_t trace = COMXILTrace::Begin();
   omx_err = OMX_SetConfig(m_handle, configIndex, configStruct);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_SET_CONFIG, configIndex, 0, omx_err);
   if(omx_err != OMX_ErrorNone) 
   {
     CLog::Log(LOGERROR, "COMXCoreComponent::SetConfig - %s failed with omx_err(0x%x)\n", 
@@ -1198,7 +1315,9 @@ OMX_ERRORTYPE COMXCoreComponent::GetConfig(OMX_INDEXTYPE configIndex, OMX_PTR co
 
   OMX_ERRORTYPE omx_err;
 
+  int64_t trace = COMXILTrace::Begin();
   omx_err = OMX_GetConfig(m_handle, configIndex, configStruct);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_GET_CONFIG, configIndex, 0, omx_err);
   if(omx_err != OMX_ErrorNone) 
   {
     CLog::Log(LOGERROR, "COMXCoreComponent::GetConfig - %s failed with omx_err(0x%x)\n", 
@@ -1216,7 +1335,9 @@ OMX_ERRORTYPE COMXCoreComponent::SendCommand(OMX_COMMANDTYPE cmd, OMX_U32 cmdPar
 
   OMX_ERRORTYPE omx_err;
 
+  int64_t trace = COMXILTrace::Begin();
   omx_err = OMX_SendCommand(m_handle, cmd, cmdParam, cmdParamData);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_SEND_COMMAND, cmd, cmdParam, omx_err);
   if(omx_err != OMX_ErrorNone) 
   {
     CLog::Log(LOGERROR, "COMXCoreComponent::SendCommand - %s failed with omx_err(0x%x)\n", 
@@ -1233,6 +1354,7 @@ OMX_ERRORTYPE COMXCoreComponent::EnablePort(unsigned int port,  bool wait)
   Lock();
 
   OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+  int64_t trace = COMXILTrace::Begin();
 
   OMX_PARAM_PORTDEFINITIONTYPE portFormat;
   OMX_INIT_STRUCTURE(portFormat);
@@ -1253,6 +1375,7 @@ OMX_ERRORTYPE COMXCoreComponent::EnablePort(unsigned int port,  bool wait)
       CLog::Log(LOGERROR, "COMXCoreComponent::EnablePort - Error enable port %d on component %s omx_err(0x%08x)", 
           port, m_componentName.c_str(), (int)omx_err);
       {
+        COMXILTrace::End(trace, m_componentName, OMXIL_CALL_ENABLE_PORT, port, 0, omx_err);
         UnLock();
         return omx_err;
       }
@@ -1264,6 +1387,8 @@ OMX_ERRORTYPE COMXCoreComponent::EnablePort(unsigned int port,  bool wait)
     }
   }
 
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_ENABLE_PORT, port, 0, omx_err);
+
   UnLock();
 
   return omx_err;
@@ -1274,6 +1399,7 @@ OMX_ERRORTYPE COMXCoreComponent::DisablePort(unsigned int port, bool wait)
   Lock();
 
   OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+  int64_t trace = COMXILTrace::Begin();
 
   OMX_PARAM_PORTDEFINITIONTYPE portFormat;
   OMX_INIT_STRUCTURE(portFormat);
@@ -1294,6 +1420,7 @@ OMX_ERRORTYPE COMXCoreComponent::DisablePort(unsigned int port, bool wait)
       CLog::Log(LOGERROR, "COMXCoreComponent::DIsablePort - Error disable port %d on component %s omx_err(0x%08x)", 
           port, m_componentName.c_str(), (int)omx_err);
       {
+        COMXILTrace::End(trace, m_componentName, OMXIL_CALL_DISABLE_PORT, port, 0, omx_err);
         UnLock();
         return omx_err;
       }
@@ -1305,6 +1432,8 @@ OMX_ERRORTYPE COMXCoreComponent::DisablePort(unsigned int port, bool wait)
     }
   }
 
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_DISABLE_PORT, port, 0, omx_err);
+
   UnLock();
 
   return omx_err;
@@ -1344,7 +1473,9 @@ bool COMXCoreComponent::Initialize( const std::string &component_name, OMX_INDEX
   m_callbacks.FillBufferDone  = &COMXCoreComponent::DecoderFillBufferDoneCallback;
 
   // Get video component handle setting up callbacks, component is in loaded state on return.
+  int64_t trace = COMXILTrace::Begin();
   omx_err = m_DllOMX->OMX_GetHandle(&m_handle, (char*)component_name.c_str(), this, &m_callbacks);
+  COMXILTrace::End(trace, m_componentName, OMXIL_CALL_GET_HANDLE, 0, 0, omx_err);
   if (omx_err != OMX_ErrorNone)
   {
     CLog::Log(LOGERROR, "COMXCoreComponent::Initialize - could not get component handle for %s omx_err(0x%08x)\n", 
@@ -1421,7 +1552,9 @@ bool COMXCoreComponent::Deinitialize()
     if(GetState() != OMX_StateLoaded)
       SetStateForComponent(OMX_StateLoaded);
 
+    int64_t trace = COMXILTrace::Begin();
     omx_err = m_DllOMX->OMX_FreeHandle(m_handle);
+    COMXILTrace::End(trace, m_componentName, OMXIL_CALL_FREE_HANDLE, 0, 0, omx_err);
     if (omx_err != OMX_ErrorNone)
     {
       CLog::Log(LOGERROR, "COMXCoreComponent::Deinitialize - failed to free handle for component %s omx_err(0x%08x)", 
@@ -1438,6 +1571,8 @@ bool COMXCoreComponent::Deinitialize()
 
   CustomDecoderFillBufferDoneHandler = NULL;
   CustomDecoderEmptyBufferDoneHandler = NULL;
+  CustomDecoderEventHandler = NULL;
+  m_custom_event_data = NULL;
 
   m_DllOMX->Unload();
 
@@ -1506,13 +1641,8 @@ OMX_ERRORTYPE COMXCoreComponent::DecoderEmptyBufferDone(OMX_HANDLETYPE hComponen
 
   COMXCoreComponent *ctx = static_cast<COMXCoreComponent*>(pAppData);
 
-  pthread_mutex_lock(&ctx->m_omx_input_mutex);
-  ctx->m_omx_input_avaliable.push(pBuffer);
-
-  // this allows (all) blocked tasks to be awoken
-  pthread_cond_broadcast(&ctx->m_input_buffer_cond);
-
-  pthread_mutex_unlock(&ctx->m_omx_input_mutex);
+  // wakes a GetInputBuffer() blocked on the empty list
+  ctx->m_omx_input_avaliable.Push(pBuffer);
 
   return OMX_ErrorNone;
 }
@@ -1524,13 +1654,7 @@ OMX_ERRORTYPE COMXCoreComponent::DecoderFillBufferDone(OMX_HANDLETYPE hComponent
   
   COMXCoreComponent *ctx = static_cast<COMXCoreComponent*>(pAppData);
 
-  pthread_mutex_lock(&ctx->m_omx_output_mutex);
-  ctx->m_omx_output_available.push(pBuffer);
-
-  // this allows (all) blocked tasks to be awoken
-  pthread_cond_broadcast(&ctx->m_output_buffer_cond);
-
-  pthread_mutex_unlock(&ctx->m_omx_output_mutex);
+  ctx->m_omx_output_available.Push(pBuffer);
 
   sem_post(&ctx->m_omx_fill_buffer_done);
 
@@ -1558,6 +1682,9 @@ OMX_ERRORTYPE COMXCoreComponent::DecoderEventHandler(
 
   AddEvent(eEvent, nData1, nData2);
 
+  if(ctx->CustomDecoderEventHandler)
+    (*(ctx->CustomDecoderEventHandler))(hComponent, ctx->m_custom_event_data, eEvent, nData1, nData2, pEventData);
+
   switch (eEvent)
   {
     case OMX_EventCmdComplete:
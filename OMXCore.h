@@ -22,7 +22,8 @@
 #if defined(HAVE_OMXLIB)
 
 #include <string>
-#include <queue>
+#include <map>
+#include <unordered_map>
 
 // TODO: should this be in configure
 #ifndef OMX_SKIP64BIT
@@ -30,8 +31,10 @@
 #endif
 
 #include "DllOMX.h"
+#include "OMXBufferList.h"
 
 #include <semaphore.h>
+#include <string.h>
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 // debug spew defines
@@ -48,8 +51,6 @@
   (a).nVersion.s.nRevision = OMX_VERSION_REVISION; \
   (a).nVersion.s.nStep = OMX_VERSION_STEP
 
-#include "DllAvFormat.h"
-
 #define OMX_MAX_PORTS 10
 
 typedef struct omx_event {
@@ -58,6 +59,27 @@ typedef struct omx_event {
   OMX_U32 nData2;
 } omx_event;
 
+struct omx_event_hash
+{
+  size_t operator()(const omx_event &e) const
+  {
+    return ((size_t)e.eEvent * 31 + e.nData1) * 31 + e.nData2;
+  }
+};
+
+struct omx_event_equal
+{
+  bool operator()(const omx_event &a, const omx_event &b) const
+  {
+    return a.eEvent == b.eEvent && a.nData1 == b.nData1 && a.nData2 == b.nData2;
+  }
+};
+
+// a thread blocked in WaitForEvent or WaitForCommand, woken only by events it can take
+typedef struct omx_event_waiter {
+  pthread_cond_t cond;
+} omx_event_waiter;
+
 class DllLibOMXCore;
 class COMXCore;
 class COMXCoreComponent;
@@ -143,11 +165,16 @@ public:
   unsigned int GetInputBufferSpace();
   unsigned int GetOutputBufferSpace();
 
+  // ms GetInputBuffer() spent blocked for a free buffer
+  double GetInputWaitTime() { return m_omx_input_avaliable.GetWaitTime() / 1e6; };
+
   void FlushAll();
   void FlushInput();
   void FlushOutput();
 
   OMX_BUFFERHEADERTYPE *GetInputBuffer(long timeout=200);
+  OMX_BUFFERHEADERTYPE *PollInputBuffer();
+  void ReturnInputBuffer(OMX_BUFFERHEADERTYPE *omx_buffer);
   OMX_BUFFERHEADERTYPE *GetOutputBuffer();
 
   OMX_ERRORTYPE AllocInputBuffers(bool use_buffers = false);
@@ -160,6 +187,8 @@ public:
 
   void SetCustomDecoderFillBufferDoneHandler(OMX_ERRORTYPE (*p)(OMX_HANDLETYPE, OMX_PTR, OMX_BUFFERHEADERTYPE*)){ CustomDecoderFillBufferDoneHandler = p;};
   void SetCustomDecoderEmptyBufferDoneHandler(OMX_ERRORTYPE (*p)(OMX_HANDLETYPE, OMX_PTR, OMX_BUFFERHEADERTYPE*)){ CustomDecoderEmptyBufferDoneHandler = p;};
+  // called from the IL callback thread after the event was queued, pAppData is the given userdata
+  void SetCustomDecoderEventHandler(OMX_ERRORTYPE (*p)(OMX_HANDLETYPE, OMX_PTR, OMX_EVENTTYPE, OMX_U32, OMX_U32, OMX_PTR), OMX_PTR userdata){ CustomDecoderEventHandler = p; m_custom_event_data = userdata;};
 
 private:
   OMX_HANDLETYPE m_handle;
@@ -168,17 +197,27 @@ private:
   std::string    m_componentName;
   pthread_mutex_t   m_omx_event_mutex;
   pthread_mutex_t   m_lock;
-  std::vector<omx_event> m_omx_events;
+  // pending events by type in arrival order, and the arrival of each by full key.
+  // A key is pending at most once, adding it again moves it to the back
+  std::map<OMX_EVENTTYPE, std::map<uint64_t, omx_event> > m_omx_events;
+  std::unordered_map<omx_event, uint64_t, omx_event_hash, omx_event_equal> m_omx_event_index;
+  uint64_t          m_omx_event_seq;
+  // WaitForCommand waits for a full key, WaitForEvent for any event of a type
+  std::unordered_multimap<omx_event, omx_event_waiter *, omx_event_hash, omx_event_equal> m_omx_command_waiters;
+  std::multimap<OMX_EVENTTYPE, omx_event_waiter *> m_omx_event_waiters;
+  bool          TakeEvent(const omx_event &want, bool exact, OMX_ERRORTYPE &omx_err);
+  OMX_ERRORTYPE WaitFor(const omx_event &want, bool exact, long timeout);
 
   OMX_CALLBACKTYPE  m_callbacks;
 
   //additional event handlers
   OMX_ERRORTYPE (*CustomDecoderFillBufferDoneHandler)(OMX_HANDLETYPE, OMX_PTR, OMX_BUFFERHEADERTYPE*);
   OMX_ERRORTYPE (*CustomDecoderEmptyBufferDoneHandler)(OMX_HANDLETYPE, OMX_PTR, OMX_BUFFERHEADERTYPE*);
+  OMX_ERRORTYPE (*CustomDecoderEventHandler)(OMX_HANDLETYPE, OMX_PTR, OMX_EVENTTYPE, OMX_U32, OMX_U32, OMX_PTR);
+  OMX_PTR       m_custom_event_data;
 
   // OMXCore input buffers (demuxer packets)
-  pthread_mutex_t   m_omx_input_mutex;
-  std::queue<OMX_BUFFERHEADERTYPE*> m_omx_input_avaliable;
+  COMXBufferList    m_omx_input_avaliable;
   std::vector<OMX_BUFFERHEADERTYPE*> m_omx_input_buffers;
   unsigned int  m_input_alignment;
   unsigned int  m_input_buffer_size;
@@ -186,8 +225,7 @@ private:
   bool          m_omx_input_use_buffers;
 
   // OMXCore output buffers (video frames)
-  pthread_mutex_t   m_omx_output_mutex;
-  std::queue<OMX_BUFFERHEADERTYPE*> m_omx_output_available;
+  COMXBufferList    m_omx_output_available;
   std::vector<OMX_BUFFERHEADERTYPE*> m_omx_output_buffers;
   unsigned int  m_output_alignment;
   unsigned int  m_output_buffer_size;
@@ -198,12 +236,9 @@ private:
   bool          m_exit;
   DllOMX        *m_DllOMX;
   bool          m_DllOMXOpen;
-  pthread_cond_t    m_input_buffer_cond;
-  pthread_cond_t    m_output_buffer_cond;
-  pthread_cond_t    m_omx_event_cond;
   bool          m_eos;
-  bool          m_flush_input;
-  bool          m_flush_output;
+  volatile bool m_flush_input;
+  volatile bool m_flush_output;
   void              Lock();
   void              UnLock();
 };
@@ -0,0 +1,274 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "OMXILTrace.h"
+#include "OMXClock.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+volatile bool     COMXILTrace::m_enabled  = false;
+OMXILTraceRecord  *COMXILTrace::m_records = NULL;
+volatile uint64_t COMXILTrace::m_head     = 0;
+
+volatile uint64_t COMXILTrace::m_calls[OMXIL_CALL_COUNT];
+volatile int64_t  COMXILTrace::m_total[OMXIL_CALL_COUNT];
+volatile int64_t  COMXILTrace::m_max[OMXIL_CALL_COUNT];
+volatile uint64_t COMXILTrace::m_buckets[OMXIL_CALL_COUNT][OMXIL_TRACE_BUCKETS];
+
+static const struct
+{
+  const char *name;
+  const char *arg1;
+  const char *arg2;
+} calls[OMXIL_CALL_COUNT] =
+{
+  { "GetHandle",      NULL,     NULL      },
+  { "FreeHandle",     NULL,     NULL      },
+  { "SetParameter",   "index",  NULL      },
+  { "GetParameter",   "index",  NULL      },
+  { "SetConfig",      "index",  NULL      },
+  { "GetConfig",      "index",  NULL      },
+  { "SendCommand",    "cmd",    "param"   },
+  { "SetState",       "state",  NULL      },
+  { "EnablePort",     "port",   NULL      },
+  { "DisablePort",    "port",   NULL      },
+  { "WaitForEvent",   "event",  NULL      },
+  { "WaitForCommand", "cmd",    "data2"   },
+  { "AllocBuffers",   "port",   "count"   },
+  { "FreeBuffers",    "port",   "count"   },
+  { "EmptyBuffer",    "length", "flags"   },
+  { "FillBuffer",     NULL,     NULL      },
+  { "SetupTunnel",    "port",   "dst_port" },
+  { "RemoveTunnel",   "port",   "dst_port" },
+};
+
+static __thread int thread_id = 0;
+
+const char *COMXILTrace::CallName(int call)
+{
+  return call >= 0 && call < OMXIL_CALL_COUNT ? calls[call].name : "unknown";
+}
+
+int64_t COMXILTrace::Now()
+{
+  return OMXClock::CurrentHostCounter();
+}
+
+void COMXILTrace::Enable()
+{
+  if(m_enabled)
+    return;
+
+  m_records = (OMXILTraceRecord *)calloc(OMXIL_TRACE_RECORDS, sizeof(OMXILTraceRecord));
+  if(!m_records)
+    return;
+
+  __sync_synchronize();
+  m_enabled = true;
+}
+
+void COMXILTrace::End(int64_t start, const std::string &component, OMXILCall call,
+                      uint32_t arg1, uint32_t arg2, int result)
+{
+  if(!start || !m_records)
+    return;
+
+  int64_t duration = Now() - start;
+  if(duration < 0)
+    duration = 0;
+
+  int bucket = 0;
+  for(int64_t us = duration / 1000; us && bucket < OMXIL_TRACE_BUCKETS - 1; us >>= 1)
+    bucket++;
+
+  __sync_fetch_and_add(&m_calls[call], 1);
+  __sync_fetch_and_add(&m_total[call], duration);
+  __sync_fetch_and_add(&m_buckets[call][bucket], 1);
+
+  int64_t max = m_max[call];
+  while(duration > max && !__sync_bool_compare_and_swap(&m_max[call], max, duration))
+    max = m_max[call];
+
+  if(!thread_id)
+    thread_id = (int)syscall(SYS_gettid);
+
+  uint64_t n = __sync_fetch_and_add(&m_head, 1);
+  OMXILTraceRecord &record = m_records[n % OMXIL_TRACE_RECORDS];
+
+  // readers skip a record while seq is 0 or changed under them
+  record.seq = 0;
+  __sync_synchronize();
+
+  const char *name = component.c_str();
+  if(!strncmp(name, "OMX.broadcom.", 13))
+    name += 13;
+  strncpy(record.component, name, sizeof(record.component) - 1);
+  record.component[sizeof(record.component) - 1] = '\0';
+  record.call     = call;
+  record.arg1     = arg1;
+  record.arg2     = arg2;
+  record.result   = result;
+  record.tid      = thread_id;
+  record.start    = start;
+  record.duration = duration;
+
+  __sync_synchronize();
+  record.seq = n + 1;
+}
+
+// the records still in the ring that were not being written, oldest first
+static std::vector<OMXILTraceRecord> Snapshot(OMXILTraceRecord *records, uint64_t head)
+{
+  std::vector<OMXILTraceRecord> snapshot;
+  if(!records)
+    return snapshot;
+
+  uint64_t first = head > OMXIL_TRACE_RECORDS ? head - OMXIL_TRACE_RECORDS : 0;
+  snapshot.reserve(head - first);
+
+  for(uint64_t n = first; n < head; n++)
+  {
+    OMXILTraceRecord &record = records[n % OMXIL_TRACE_RECORDS];
+    uint64_t seq = record.seq;
+    __sync_synchronize();
+    OMXILTraceRecord copy = record;
+    __sync_synchronize();
+    if(seq != n + 1 || record.seq != seq)
+      continue;
+    snapshot.push_back(copy);
+  }
+  return snapshot;
+}
+
+bool COMXILTrace::WriteChromeTrace(const char *filename)
+{
+  std::vector<OMXILTraceRecord> records = Snapshot(m_records, m_head);
+
+  FILE *fp = fopen(filename, "w");
+  if(!fp)
+    return false;
+
+  int64_t base = records.empty() ? 0 : records[0].start;
+  for(size_t i = 0; i < records.size(); i++)
+    base = std::min(base, records[i].start);
+
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  for(size_t i = 0; i < records.size(); i++)
+  {
+    const OMXILTraceRecord &record = records[i];
+
+    fprintf(fp, "%s{\"name\":\"%s %s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"component\":\"%s\",\"result\":\"0x%x\"",
+            i ? ",\n" : "", record.component, CallName(record.call), CallName(record.call), record.tid,
+            (record.start - base) / 1000.0, record.duration / 1000.0, record.component, record.result);
+    if(calls[record.call].arg1)
+      fprintf(fp, ",\"%s\":\"0x%x\"", calls[record.call].arg1, record.arg1);
+    if(calls[record.call].arg2)
+      fprintf(fp, ",\"%s\":\"0x%x\"", calls[record.call].arg2, record.arg2);
+    fprintf(fp, "}}");
+  }
+  fprintf(fp, "\n]}\n");
+
+  fclose(fp);
+  return true;
+}
+
+// upper bound in us of the bucket the given fraction of calls falls in
+static int64_t Percentile(volatile uint64_t *buckets, uint64_t calls, double fraction)
+{
+  uint64_t want = (uint64_t)(calls * fraction + 0.5);
+  uint64_t seen = 0;
+  for(int i = 0; i < OMXIL_TRACE_BUCKETS; i++)
+  {
+    seen += buckets[i];
+    if(seen >= want && seen)
+      return 1LL << i;
+  }
+  return 1LL << (OMXIL_TRACE_BUCKETS - 1);
+}
+
+void COMXILTrace::PrintHistograms(FILE *fp)
+{
+  fprintf(fp, "IL call           calls   total ms    mean us  p50 us <=  p99 us <=     max us\n");
+  for(int call = 0; call < OMXIL_CALL_COUNT; call++)
+  {
+    uint64_t n = m_calls[call];
+    if(!n)
+      continue;
+
+    fprintf(fp, "%-16s %6llu %10.2f %10.0f %11lld %11lld %10.0f\n", CallName(call), (unsigned long long)n,
+            m_total[call] / 1e6, m_total[call] / 1e3 / n,
+            (long long)Percentile(m_buckets[call], n, 0.5), (long long)Percentile(m_buckets[call], n, 0.99),
+            m_max[call] / 1e3);
+
+    // calls per power of two us, "<1" holds the ones under 1us
+    fprintf(fp, "  ");
+    for(int i = 0; i < OMXIL_TRACE_BUCKETS; i++)
+    {
+      if(!m_buckets[call][i])
+        continue;
+      if(i == 0)
+        fprintf(fp, " <1:%llu", (unsigned long long)m_buckets[call][i]);
+      else
+        fprintf(fp, " %s%lld:%llu", i == OMXIL_TRACE_BUCKETS - 1 ? ">=" : "<",
+                i == OMXIL_TRACE_BUCKETS - 1 ? 1LL << (i - 1) : 1LL << i,
+                (unsigned long long)m_buckets[call][i]);
+    }
+    fprintf(fp, "\n");
+  }
+
+  // which component calls the time went to
+  std::vector<OMXILTraceRecord> records = Snapshot(m_records, m_head);
+  std::map<std::pair<std::string, int>, std::pair<int64_t, uint64_t> > totals;
+  for(size_t i = 0; i < records.size(); i++)
+  {
+    std::pair<int64_t, uint64_t> &total = totals[std::make_pair(std::string(records[i].component), records[i].call)];
+    total.first  += records[i].duration;
+    total.second++;
+  }
+
+  std::vector<std::pair<int64_t, std::pair<std::string, int> > > order;
+  std::map<std::pair<std::string, int>, std::pair<int64_t, uint64_t> >::iterator it;
+  for(it = totals.begin(); it != totals.end(); ++it)
+    order.push_back(std::make_pair(it->second.first, it->first));
+  std::sort(order.rbegin(), order.rend());
+
+  fprintf(fp, "slowest component calls                   calls   total ms\n");
+  for(size_t i = 0; i < order.size() && i < 15; i++)
+  {
+    std::string name = order[i].second.first + " " + CallName(order[i].second.second);
+    fprintf(fp, "%-41s %6llu %10.2f\n", name.c_str(),
+            (unsigned long long)totals[order[i].second].second, order[i].first / 1e6);
+  }
+}
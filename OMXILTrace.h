@@ -0,0 +1,104 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _OMX_ILTRACE_H_
+#define _OMX_ILTRACE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+
+enum OMXILCall
+{
+  OMXIL_CALL_GET_HANDLE,
+  OMXIL_CALL_FREE_HANDLE,
+  OMXIL_CALL_SET_PARAMETER,
+  OMXIL_CALL_GET_PARAMETER,
+  OMXIL_CALL_SET_CONFIG,
+  OMXIL_CALL_GET_CONFIG,
+  OMXIL_CALL_SEND_COMMAND,
+  OMXIL_CALL_SET_STATE,
+  OMXIL_CALL_ENABLE_PORT,
+  OMXIL_CALL_DISABLE_PORT,
+  OMXIL_CALL_WAIT_EVENT,
+  OMXIL_CALL_WAIT_COMMAND,
+  OMXIL_CALL_ALLOC_BUFFERS,
+  OMXIL_CALL_FREE_BUFFERS,
+  OMXIL_CALL_EMPTY_BUFFER,
+  OMXIL_CALL_FILL_BUFFER,
+  OMXIL_CALL_SETUP_TUNNEL,
+  OMXIL_CALL_REMOVE_TUNNEL,
+  OMXIL_CALL_COUNT,
+};
+
+#define OMXIL_TRACE_BUCKETS 21  // log2 of the duration in us, the last one takes the rest
+#define OMXIL_TRACE_RECORDS 65536
+
+typedef struct OMXILTraceRecord
+{
+  volatile uint64_t seq;  // 0 while the record is written
+  char              component[40]; // without the OMX.broadcom. prefix
+  int               call;
+  uint32_t          arg1;
+  uint32_t          arg2;
+  int               result;
+  int               tid;
+  int64_t           start;    // ns
+  int64_t           duration; // ns
+} OMXILTraceRecord;
+
+// Times the IL calls COMXCoreComponent makes, for --il_trace. Calls are
+// recorded into a ring without taking a lock and counted into a duration
+// histogram per call. Begin() costs one load while tracing is off.
+//
+//   int64_t trace = COMXILTrace::Begin();
+//   omx_err = OMX_SetParameter(m_handle, paramIndex, paramStruct);
+//   COMXILTrace::End(trace, m_componentName, OMXIL_CALL_SET_PARAMETER, paramIndex, 0, omx_err);
+class COMXILTrace
+{
+public:
+  static void Enable();
+  static bool IsEnabled() { return m_enabled; };
+
+  static int64_t Begin() { return m_enabled ? Now() : 0; };
+  static void    End(int64_t start, const std::string &component, OMXILCall call,
+                     uint32_t arg1, uint32_t arg2, int result);
+
+  // the calls still in the ring as chrome://tracing events
+  static bool WriteChromeTrace(const char *filename);
+  // histogram per call and the component calls that took longest in total
+  static void PrintHistograms(FILE *fp);
+
+  static const char *CallName(int call);
+private:
+  static int64_t Now();
+
+  static volatile bool      m_enabled;
+  static OMXILTraceRecord   *m_records;
+  static volatile uint64_t  m_head;
+
+  static volatile uint64_t  m_calls[OMXIL_CALL_COUNT];
+  static volatile int64_t   m_total[OMXIL_CALL_COUNT];
+  static volatile int64_t   m_max[OMXIL_CALL_COUNT];
+  static volatile uint64_t  m_buckets[OMXIL_CALL_COUNT][OMXIL_TRACE_BUCKETS];
+};
+#endif
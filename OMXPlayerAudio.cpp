@@ -28,6 +28,8 @@
 #include "OMXPlayerAudio.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #ifndef STANDALONE
@@ -41,6 +43,15 @@
 #include "settings/Settings.h"
 #endif
 
+//resampler clock correction, errors in seconds
+#define RESAMPLE_MAX_CORRECTION 0.005
+#define RESAMPLE_MAX_ERROR      DVD_MSEC_TO_TIME(50)
+#define RESAMPLE_INTEGRAL       200.0
+#define RESAMPLE_PROPORTIONAL   20.0
+#define RESAMPLE_PROPREF        0.01
+#define RESAMPLE_PROPDIVMIN     2.0
+#define RESAMPLE_PROPDIVMAX     40.0
+
 OMXPlayerAudio::OMXPlayerAudio()
 {
   m_open          = false;
@@ -58,11 +69,28 @@ OMXPlayerAudio::OMXPlayerAudio()
   m_initialVolume = 0;
   m_max_data_size = 3 * 1024 * 1024;
   m_fifo_size     = 2.0f;
+  m_ring_head     = 0;
+  m_ring_tail     = 0;
+  m_flush_count   = 0;
+  m_submit_running = false;
+  m_decode_pts    = DVD_NOPTS_VALUE;
+  m_pack          = false;
+  m_error         = 0;
+  m_correction    = 0;
+  m_discontinuities = 0;
+  m_preopen       = false;
+  m_switch_start  = 0;
+  m_switch_mode   = "";
+  m_switch_gap    = 0;
+  memset(m_ring, 0, sizeof(m_ring));
 
   pthread_cond_init(&m_packet_cond, NULL);
   pthread_cond_init(&m_audio_cond, NULL);
+  pthread_cond_init(&m_ring_cond, NULL);
   pthread_mutex_init(&m_lock, NULL);
   pthread_mutex_init(&m_lock_decoder, NULL);
+  pthread_mutex_init(&m_lock_codec, NULL);
+  pthread_mutex_init(&m_ring_lock, NULL);
 }
 
 OMXPlayerAudio::~OMXPlayerAudio()
@@ -71,8 +99,11 @@ OMXPlayerAudio::~OMXPlayerAudio()
 
   pthread_cond_destroy(&m_audio_cond);
   pthread_cond_destroy(&m_packet_cond);
+  pthread_cond_destroy(&m_ring_cond);
   pthread_mutex_destroy(&m_lock);
   pthread_mutex_destroy(&m_lock_decoder);
+  pthread_mutex_destroy(&m_lock_codec);
+  pthread_mutex_destroy(&m_ring_lock);
 }
 
 void OMXPlayerAudio::Lock()
@@ -99,9 +130,22 @@ void OMXPlayerAudio::UnLockDecoder()
     pthread_mutex_unlock(&m_lock_decoder);
 }
 
+void OMXPlayerAudio::LockCodec()
+{
+  if(m_use_thread)
+    pthread_mutex_lock(&m_lock_codec);
+}
+
+void OMXPlayerAudio::UnLockCodec()
+{
+  if(m_use_thread)
+    pthread_mutex_unlock(&m_lock_codec);
+}
+
 bool OMXPlayerAudio::Open(COMXStreamInfo &hints, OMXClock *av_clock, OMXReader *omx_reader,
                           std::string device, bool passthrough, long initialVolume, bool hw_decode,
-                          bool boost_on_downmix, bool use_thread, float queue_size, float fifo_size)
+                          bool boost_on_downmix, bool use_thread, float queue_size, float fifo_size,
+                          bool preopen)
 {
   if(ThreadHandle())
     Close();
@@ -130,6 +174,12 @@ bool OMXPlayerAudio::Open(COMXStreamInfo &hints, OMXClock *av_clock, OMXReader *
   m_pChannelMap = NULL;
   m_speed       = DVD_PLAYSPEED_NORMAL;
   m_initialVolume = initialVolume;
+  m_ring_head   = 0;
+  m_ring_tail   = 0;
+  m_decode_pts  = DVD_NOPTS_VALUE;
+  m_preopen     = preopen;
+  m_switch_start = 0;
+  m_switch_gap  = 0;
   if (queue_size != 0.0)
     m_max_data_size = queue_size * 1024 * 1024;
   if (fifo_size != 0.0)
@@ -139,15 +189,22 @@ bool OMXPlayerAudio::Open(COMXStreamInfo &hints, OMXClock *av_clock, OMXReader *
   m_errorbuff = 0;
   m_errorcount = 0;
   m_integral = 0;
+  m_correction = 0;
+  m_discontinuities = 0;
   m_skipdupcount = 0;
   m_prevskipped = false;
   m_syncclock = true;
+  m_resampler.SetRatio(1.0);
+  m_resampler.Flush();
   m_errortime = m_av_clock->CurrentHostCounter();
 
   m_freq = m_av_clock->CurrentHostFrequency();
 
   m_av_clock->SetMasterClock(false);
 
+  int audio_index = m_omx_reader->GetAudioIndex();
+  m_stream_id = audio_index >= 0 ? m_omx_reader->GetStreamId(OMXSTREAM_AUDIO, audio_index) : -1;
+
   m_player_error = OpenAudioCodec();
   if(!m_player_error)
   {
@@ -162,8 +219,19 @@ bool OMXPlayerAudio::Open(COMXStreamInfo &hints, OMXClock *av_clock, OMXReader *
     return false;
   }
 
+  if(m_preopen)
+    PreOpenCodecs();
+
   if(m_use_thread)
+  {
+    if(pthread_create(&m_submit_thread, NULL, &OMXPlayerAudio::SubmitThread, this) != 0)
+    {
+      Close();
+      return false;
+    }
+    m_submit_running = true;
     Create();
+  }
 
   m_open        = true;
 
@@ -186,8 +254,20 @@ bool OMXPlayerAudio::Close()
     StopThread();
   }
 
+  if(m_submit_running)
+  {
+    pthread_mutex_lock(&m_ring_lock);
+    pthread_cond_broadcast(&m_ring_cond);
+    pthread_mutex_unlock(&m_ring_lock);
+
+    pthread_join(m_submit_thread, NULL);
+    m_submit_running = false;
+  }
+
+  FreeRing();
   CloseDecoder();
   CloseAudioCodec();
+  ClosePreOpened();
 
   m_open          = false;
   m_stream_id     = -1;
@@ -215,6 +295,8 @@ void OMXPlayerAudio::HandleSyncError(double duration, double pts)
     if(m_speed == DVD_PLAYSPEED_NORMAL)
       printf("OMXPlayerAudio:: Discontinuity - was:%f, should be:%f, error:%f\n", clock, clock+error, error);
     */
+    if(!m_syncclock)
+      m_discontinuities++;
 
     m_errorbuff = 0;
     m_errorcount = 0;
@@ -231,12 +313,17 @@ void OMXPlayerAudio::HandleSyncError(double duration, double pts)
     m_errorbuff = 0;
     m_errorcount = 0;
     m_integral = 0;
+    m_correction = 0;
+    m_resampler.SetRatio(1.0);
     m_skipdupcount = 0;
     m_error = 0;
     m_errortime = m_av_clock->CurrentHostCounter();
     return;
   }
 
+  m_errorbuff += error;
+  m_errorcount++;
+
   //check if measured error for 1 second
   now = m_av_clock->CurrentHostCounter();
   if ((now - m_errortime) >= m_freq)
@@ -247,6 +334,24 @@ void OMXPlayerAudio::HandleSyncError(double duration, double pts)
     m_errorbuff = 0;
     m_errorcount = 0;
 
+    //decoded PCM is resampled to follow the clock, only big errors are corrected by a jump
+    if (!m_passthrough && !m_hw_decode)
+    {
+      if (fabs(m_error) > RESAMPLE_MAX_ERROR)
+      {
+        m_av_clock->Discontinuity(clock+m_error);
+        m_discontinuities++;
+      }
+      else
+      {
+        UpdateResampleRatio();
+      }
+
+      CLog::Log(LOGDEBUG, "OMXPlayerAudio::HandleSyncError - error:%.2fms correction:%.0fppm integral:%.0fppm discontinuities:%u\n",
+                m_error / 1000.0, m_correction * 1e6, m_integral * 1e6, m_discontinuities);
+      return;
+    }
+
 /*
     if (m_synctype == SYNC_DISCON)
     {
@@ -273,6 +378,7 @@ void OMXPlayerAudio::HandleSyncError(double duration, double pts)
       if (fabs(error) > limit - 0.001)
       {
         m_av_clock->Discontinuity(clock+error);
+        m_discontinuities++;
         /*
         if(m_speed == DVD_PLAYSPEED_NORMAL)
           CLog::Log(LOGDEBUG, "CDVDPlayerAudio:: Discontinuity - was:%f, should be:%f, error:%f", clock, clock+error, error);
@@ -300,6 +406,46 @@ void OMXPlayerAudio::HandleSyncError(double duration, double pts)
 */
 }
 
+/* PI controller on the averaged error, the integral learns the steady drift
+   between the audio clock and the system clock */
+void OMXPlayerAudio::UpdateResampleRatio()
+{
+  double error = m_error / DVD_TIME_BASE;
+
+  //reset the integral on big errors, failsafe
+  if (fabs(m_error) > DVD_TIME_BASE)
+    m_integral = 0;
+  else if (fabs(m_error) > DVD_MSEC_TO_TIME(5))
+    m_integral += error / RESAMPLE_INTEGRAL;
+
+  if (m_integral > RESAMPLE_MAX_CORRECTION)
+    m_integral = RESAMPLE_MAX_CORRECTION;
+  else if (m_integral < -RESAMPLE_MAX_CORRECTION)
+    m_integral = -RESAMPLE_MAX_CORRECTION;
+
+  //on big errors use more proportional
+  double proportional = 0.0;
+  if (error != 0.0)
+  {
+    double proportionaldiv = RESAMPLE_PROPORTIONAL * (RESAMPLE_PROPREF / fabs(error));
+    if (proportionaldiv < RESAMPLE_PROPDIVMIN)
+      proportionaldiv = RESAMPLE_PROPDIVMIN;
+    else if (proportionaldiv > RESAMPLE_PROPDIVMAX)
+      proportionaldiv = RESAMPLE_PROPDIVMAX;
+
+    proportional = error / proportionaldiv;
+  }
+
+  m_correction = proportional + m_integral;
+  if (m_correction > RESAMPLE_MAX_CORRECTION)
+    m_correction = RESAMPLE_MAX_CORRECTION;
+  else if (m_correction < -RESAMPLE_MAX_CORRECTION)
+    m_correction = -RESAMPLE_MAX_CORRECTION;
+
+  //audio ahead of the clock is stretched, behind it is squeezed
+  m_resampler.SetRatio(1.0 + m_correction);
+}
+
 bool OMXPlayerAudio::Decode(OMXPacket *pkt)
 {
   if(!pkt)
@@ -317,112 +463,288 @@ bool OMXPlayerAudio::Decode(OMXPacket *pkt)
   unsigned int old_bitrate = m_hints.bitrate;
   unsigned int new_bitrate = pkt->hints.bitrate;
 
-  /* only check bitrate changes on CODEC_ID_DTS, CODEC_ID_AC3, CODEC_ID_EAC3 */
-  if(m_hints.codec != CODEC_ID_DTS && m_hints.codec != CODEC_ID_AC3 && m_hints.codec != CODEC_ID_EAC3)
+  /* only check bitrate changes on CODEC_ID_DTS, CODEC_ID_AC3, CODEC_ID_EAC3.
+     Packed bursts keep their format whatever the bitrate or channels are */
+  if(m_pack || (m_hints.codec != CODEC_ID_DTS && m_hints.codec != CODEC_ID_AC3 && m_hints.codec != CODEC_ID_EAC3))
   {
     new_bitrate = old_bitrate = 0;
   }
 
-  /* audio codec changed. reinit device and decoder */
-  if(m_hints.codec         != pkt->hints.codec ||
-     m_hints.channels      != channels ||
-     m_hints.samplerate    != pkt->hints.samplerate ||
-     old_bitrate           != new_bitrate ||
-     m_hints.bitspersample != pkt->hints.bitspersample)
+  if(m_pack)
+    channels = m_hints.channels;
+
+  /* audio stream or codec changed. swap the decoder if the output stays the
+     same, otherwise reinit device and decoder */
+  bool changed = m_stream_id           != pkt->stream_index ||
+                 m_hints.codec         != pkt->hints.codec ||
+                 m_hints.channels      != channels ||
+                 m_hints.samplerate    != pkt->hints.samplerate ||
+                 old_bitrate           != new_bitrate ||
+                 m_hints.bitspersample != pkt->hints.bitspersample;
+
+  if(changed)
+    m_switch_start = OMXClock::CurrentHostCounter();
+
+  if(changed && SwapCodec(pkt))
   {
+    m_switch_mode = "decoder swapped";
+  }
+  else if(changed)
+  {
+    m_switch_mode = "output reopened";
+
     printf("C : %d %d %d %d %d\n", m_hints.codec, m_hints.channels, m_hints.samplerate, m_hints.bitrate, m_hints.bitspersample);
     printf("N : %d %d %d %d %d\n", pkt->hints.codec, channels, pkt->hints.samplerate, pkt->hints.bitrate, pkt->hints.bitspersample);
 
+    /* let the submit thread play out what was decoded with the old settings */
+    if(m_use_thread && !WaitRing(0))
+      return true;
+
+    LockDecoder();
+
     m_av_clock->OMXPause();
 
     CloseDecoder();
     CloseAudioCodec();
 
-    m_hints = pkt->hints;
+    m_stream_id = pkt->stream_index;
+    m_hints     = pkt->hints;
 
     m_player_error = OpenAudioCodec();
-    if(!m_player_error)
-      return false;
+    if(m_player_error)
+      m_player_error = OpenDecoder();
 
-    m_player_error = OpenDecoder();
     if(!m_player_error)
+    {
+      UnLockDecoder();
       return false;
+    }
 
     m_av_clock->OMXStateExecute();
     m_av_clock->OMXReset();
     m_av_clock->OMXResume();
 
+    UnLockDecoder();
   }
 
-  if(!((int)m_decoder->GetSpace() > pkt->size))
-    OMXClock::OMXSleep(10);
-
-  if((int)m_decoder->GetSpace() > pkt->size)
+  /* without threads the packet is submitted right away, wait for room */
+  if(!m_use_thread)
   {
-    if(pkt->dts != DVD_NOPTS_VALUE)
-      m_iCurrentPts = pkt->dts;
+    if(!((int)m_decoder->GetSpace() > pkt->size))
+      OMXClock::OMXSleep(10);
 
-    m_av_clock->SetPTS(m_iCurrentPts);
+    if(!((int)m_decoder->GetSpace() > pkt->size))
+      return false;
+  }
 
-    const uint8_t *data_dec = pkt->data;
-    int            data_len = pkt->size;
+  if(pkt->dts != DVD_NOPTS_VALUE)
+    m_decode_pts = pkt->dts;
 
-    if(!m_passthrough && !m_hw_decode)
+  const uint8_t *data_dec = pkt->data;
+  int            data_len = pkt->size;
+
+  if(!m_passthrough && !m_hw_decode)
+  {
+    while(data_len > 0)
     {
-      while(data_len > 0)
+      int len = m_pAudioCodec->Decode((BYTE *)data_dec, data_len);
+      if( (len < 0) || (len >  data_len) )
       {
-        int len = m_pAudioCodec->Decode((BYTE *)data_dec, data_len);
-        if( (len < 0) || (len >  data_len) )
-        {
-          m_pAudioCodec->Reset();
-          break;
-        }
-
-        data_dec+= len;
-        data_len -= len;
+        m_pAudioCodec->Reset();
+        break;
+      }
 
-        uint8_t *decoded;
-        int decoded_size = m_pAudioCodec->GetData(&decoded);
+      data_dec+= len;
+      data_len -= len;
 
-        if(decoded_size <=0)
-          continue;
+      uint8_t *decoded;
+      int decoded_size = m_pAudioCodec->GetData(&decoded);
 
-        int ret = 0;
+      if(decoded_size <=0)
+        continue;
 
-        if(m_bMpeg)
-          ret = m_decoder->AddPackets(decoded, decoded_size, DVD_NOPTS_VALUE, DVD_NOPTS_VALUE);
-        else
-          ret = m_decoder->AddPackets(decoded, decoded_size, m_iCurrentPts, m_iCurrentPts);
+      int n = (m_hints.channels * 32 * m_hints.samplerate)>>3;
+      double duration = n > 0 ? ((double)decoded_size * DVD_TIME_BASE) / n : 0.0;
 
-        if(ret != decoded_size)
-        {
-          printf("error ret %d decoded_size %d\n", ret, decoded_size);
-        }
+      /* dropped by a flush */
+      if(!Output(decoded, decoded_size, m_decode_pts, duration))
+        break;
 
-        int n = (m_hints.channels * 32 * m_hints.samplerate)>>3;
-        if (n > 0 && m_iCurrentPts != DVD_NOPTS_VALUE)
-          m_iCurrentPts += ((double)decoded_size * DVD_TIME_BASE) / n;
+      SwitchDone();
 
-        HandleSyncError((((double)decoded_size * DVD_TIME_BASE) / n), m_iCurrentPts);
-      }
+      if (m_decode_pts != DVD_NOPTS_VALUE)
+        m_decode_pts += duration;
     }
-    else
+  }
+  else if(m_pack)
+  {
+    unsigned int size = m_packer.Pack(pkt->data, pkt->size);
+    if(size)
     {
-      if(m_bMpeg)
-        m_decoder->AddPackets(pkt->data, pkt->size, DVD_NOPTS_VALUE, DVD_NOPTS_VALUE);
-      else
-        m_decoder->AddPackets(pkt->data, pkt->size, m_iCurrentPts, m_iCurrentPts);
+      double duration = (double)m_packer.GetOutputFrames() * DVD_TIME_BASE / m_packer.GetOutputRate(m_hints.samplerate);
+
+      if(!Output(m_packer.GetOutput(), size, m_decode_pts, duration))
+        return true;
+
+      SwitchDone();
 
-      HandleSyncError(0, m_iCurrentPts);
+      if (m_decode_pts != DVD_NOPTS_VALUE)
+        m_decode_pts += duration;
     }
+  }
+  else
+  {
+    if(Output(pkt->data, pkt->size, m_decode_pts, 0.0))
+      SwitchDone();
+  }
+
+  return true;
+}
 
-    m_av_clock->SetAudioClock(m_iCurrentPts);
+/* hands decoded data on to the submit thread, or submits it directly when
+   running without threads. Returns false when a flush or close dropped it. */
+bool OMXPlayerAudio::Output(const uint8_t *data, int size, double pts, double duration)
+{
+  /* the submit thread must not ask the codec, a track switch may replace it */
+  int channels = (!m_passthrough && !m_hw_decode && m_pAudioCodec) ? m_pAudioCodec->GetChannels() : 0;
+
+  if(!m_use_thread)
+  {
+    Submit(data, size, channels, pts, duration);
     return true;
   }
+
+  if(GetRingLevel() >= AUDIO_RING_SIZE && !WaitRing(AUDIO_RING_SIZE - 1))
+    return false;
+
+  OMXDecodedAudio *frame = &m_ring[m_ring_head % AUDIO_RING_SIZE];
+  if(frame->alloc < size)
+  {
+    uint8_t *data_new = (uint8_t *)realloc(frame->data, size);
+    if(!data_new)
+      return false;
+    frame->data  = data_new;
+    frame->alloc = size;
+  }
+
+  memcpy(frame->data, data, size);
+  frame->size     = size;
+  frame->channels = channels;
+  frame->pts      = pts;
+  frame->duration = duration;
+
+  /* the entry has to be visible before the submit thread sees the new head */
+  __sync_synchronize();
+  m_ring_head++;
+
+  pthread_mutex_lock(&m_ring_lock);
+  pthread_cond_broadcast(&m_ring_cond);
+  pthread_mutex_unlock(&m_ring_lock);
+
+  return true;
+}
+
+/* waits until the ring holds at most level entries. The codec lock is
+   dropped meanwhile so a flush can get in, returns false if one did. */
+bool OMXPlayerAudio::WaitRing(unsigned int level)
+{
+  unsigned int flush_count = m_flush_count;
+
+  UnLockCodec();
+  pthread_mutex_lock(&m_ring_lock);
+  while(GetRingLevel() > level && !m_bAbort && flush_count == m_flush_count)
+    pthread_cond_wait(&m_ring_cond, &m_ring_lock);
+  pthread_mutex_unlock(&m_ring_lock);
+  LockCodec();
+
+  return !m_bAbort && flush_count == m_flush_count;
+}
+
+void OMXPlayerAudio::Submit(const uint8_t *data, int size, int channels, double pts, double duration)
+{
+  m_av_clock->SetPTS(pts);
+
+  if(channels)
+    size = m_resampler.Resample(data, size, channels, &data);
+
+  int ret = 0;
+
+  if(m_bMpeg)
+    ret = m_decoder->AddPackets(data, size, DVD_NOPTS_VALUE, DVD_NOPTS_VALUE);
   else
+    ret = m_decoder->AddPackets(data, size, pts, pts);
+
+  if(ret != size)
   {
-    return false;
+    printf("error ret %d decoded_size %d\n", ret, size);
   }
+
+  m_iCurrentPts = pts != DVD_NOPTS_VALUE ? pts + duration : DVD_NOPTS_VALUE;
+
+  HandleSyncError(duration, m_iCurrentPts);
+
+  m_av_clock->SetAudioClock(m_iCurrentPts);
+}
+
+void *OMXPlayerAudio::SubmitThread(void *arg)
+{
+  OMXPlayerAudio *player = static_cast<OMXPlayerAudio*>(arg);
+  player->ProcessSubmit();
+  return NULL;
+}
+
+void OMXPlayerAudio::ProcessSubmit()
+{
+  while(!m_bAbort)
+  {
+    pthread_mutex_lock(&m_ring_lock);
+    while(m_ring_head == m_ring_tail && !m_bAbort)
+      pthread_cond_wait(&m_ring_cond, &m_ring_lock);
+    pthread_mutex_unlock(&m_ring_lock);
+
+    if(m_bAbort)
+      break;
+
+    bool full = false;
+
+    LockDecoder();
+    if(m_ring_head != m_ring_tail && m_decoder)
+    {
+      __sync_synchronize();
+      OMXDecodedAudio *frame = &m_ring[m_ring_tail % AUDIO_RING_SIZE];
+
+      if((int)m_decoder->GetSpace() > frame->size)
+      {
+        Submit(frame->data, frame->size, frame->channels, frame->pts, frame->duration);
+
+        m_ring_tail++;
+        pthread_mutex_lock(&m_ring_lock);
+        pthread_cond_broadcast(&m_ring_cond);
+        pthread_mutex_unlock(&m_ring_lock);
+      }
+      else
+      {
+        full = true;
+      }
+    }
+    UnLockDecoder();
+
+    if(full)
+      OMXClock::OMXSleep(10);
+  }
+}
+
+void OMXPlayerAudio::FreeRing()
+{
+  for(int i = 0; i < AUDIO_RING_SIZE; i++)
+  {
+    free(m_ring[i].data);
+    m_ring[i].data  = NULL;
+    m_ring[i].alloc = 0;
+    m_ring[i].size  = 0;
+  }
+  m_ring_head = 0;
+  m_ring_tail = 0;
 }
 
 void OMXPlayerAudio::Process()
@@ -454,7 +776,7 @@ void OMXPlayerAudio::Process()
     }
     UnLock();
     
-    LockDecoder();
+    LockCodec();
     if(m_flush && omx_pkt)
     {
       OMXReader::FreePacket(omx_pkt);
@@ -466,7 +788,7 @@ void OMXPlayerAudio::Process()
       OMXReader::FreePacket(omx_pkt);
       omx_pkt = NULL;
     }
-    UnLockDecoder();
+    UnLockCodec();
   }
 
   if(omx_pkt)
@@ -476,6 +798,7 @@ void OMXPlayerAudio::Process()
 void OMXPlayerAudio::Flush()
 {
   Lock();
+  LockCodec();
   LockDecoder();
   m_flush = true;
   while (!m_packets.empty())
@@ -485,11 +808,22 @@ void OMXPlayerAudio::Flush()
     OMXReader::FreePacket(pkt);
   }
   m_iCurrentPts = DVD_NOPTS_VALUE;
+  m_decode_pts  = DVD_NOPTS_VALUE;
   m_cached_size = 0;
+  m_bitrate.Reset();
+  /* drop the decoded audio, the submit thread is not inside an entry while we hold the decoder */
+  m_ring_tail = m_ring_head;
+  m_flush_count++;
+  pthread_mutex_lock(&m_ring_lock);
+  pthread_cond_broadcast(&m_ring_cond);
+  pthread_mutex_unlock(&m_ring_lock);
   if(m_decoder)
     m_decoder->Flush();
+  m_resampler.Flush();
+  m_packer.Reset();
   m_syncclock = true;
   UnLockDecoder();
+  UnLockCodec();
   UnLock();
 }
 
@@ -505,6 +839,7 @@ bool OMXPlayerAudio::AddPacket(OMXPacket *pkt)
 
   if((m_cached_size + pkt->size) < m_max_data_size)
   {
+    m_bitrate.Add(pkt);
     Lock();
     m_cached_size += pkt->size;
     m_packets.push_back(pkt);
@@ -518,13 +853,9 @@ bool OMXPlayerAudio::AddPacket(OMXPacket *pkt)
 
 bool OMXPlayerAudio::OpenAudioCodec()
 {
-  m_pAudioCodec = new COMXAudioCodecOMX();
-
-  if(!m_pAudioCodec->Open(m_hints))
-  {
-    delete m_pAudioCodec; m_pAudioCodec = NULL;
+  m_pAudioCodec = TakeCodec(m_stream_id, m_hints);
+  if(!m_pAudioCodec)
     return false;
-  }
 
   m_pChannelMap = m_pAudioCodec->GetChannelMap();
   return true;
@@ -532,9 +863,164 @@ bool OMXPlayerAudio::OpenAudioCodec()
 
 void OMXPlayerAudio::CloseAudioCodec()
 {
-  if(m_pAudioCodec)
-    delete m_pAudioCodec;
+  ReleaseCodec(m_stream_id, m_pAudioCodec, m_hints);
   m_pAudioCodec = NULL;
+  m_pChannelMap = NULL;
+}
+
+/* hands out the warm decoder of a stream if it was opened for the same
+   format, otherwise opens a new one */
+COMXAudioCodecOMX *OMXPlayerAudio::TakeCodec(int stream_id, COMXStreamInfo &hints)
+{
+  COMXAudioCodecOMX *codec = NULL;
+  std::map<int, OMXWarmCodec>::iterator it = m_warm_codecs.find(stream_id);
+
+  if(it != m_warm_codecs.end())
+  {
+    COMXStreamInfo &warm = it->second.hints;
+
+    if(warm.codec == hints.codec && warm.channels == hints.channels &&
+       warm.samplerate == hints.samplerate && warm.extrasize == hints.extrasize &&
+       (!hints.extrasize || memcmp(warm.extradata, hints.extradata, hints.extrasize) == 0))
+      codec = it->second.codec;
+    else
+      delete it->second.codec;
+
+    m_warm_codecs.erase(it);
+  }
+
+  if(!codec)
+  {
+    codec = new COMXAudioCodecOMX();
+    if(!codec->Open(hints))
+    {
+      delete codec;
+      codec = NULL;
+    }
+  }
+
+  return codec;
+}
+
+/* with --audio_preopen a decoder that is switched away from stays open, reset
+   so nothing of the old position is decoded when switching back */
+void OMXPlayerAudio::ReleaseCodec(int stream_id, COMXAudioCodecOMX *codec, COMXStreamInfo &hints)
+{
+  if(!codec)
+    return;
+
+  if(!m_preopen || stream_id < 0 || m_warm_codecs.count(stream_id))
+  {
+    delete codec;
+    return;
+  }
+
+  codec->Reset();
+
+  OMXWarmCodec warm;
+  warm.codec = codec;
+  warm.hints = hints;
+  m_warm_codecs[stream_id] = warm;
+}
+
+void OMXPlayerAudio::PreOpenCodecs()
+{
+  int64_t start = OMXClock::CurrentHostCounter();
+
+  for(int i = 0; i < m_omx_reader->AudioStreamCount(); i++)
+  {
+    COMXStreamInfo hints;
+    int stream_id = m_omx_reader->GetStreamId(OMXSTREAM_AUDIO, i);
+
+    if(stream_id < 0 || stream_id == m_stream_id || m_warm_codecs.count(stream_id))
+      continue;
+    if(!m_omx_reader->GetHints(OMXSTREAM_AUDIO, i, hints))
+      continue;
+
+    COMXAudioCodecOMX *codec = new COMXAudioCodecOMX();
+    if(!codec->Open(hints))
+    {
+      CLog::Log(LOGWARNING, "OMXPlayerAudio::PreOpenCodecs - could not open decoder for stream %d", stream_id);
+      delete codec;
+      continue;
+    }
+
+    OMXWarmCodec warm;
+    warm.codec = codec;
+    warm.hints = hints;
+    m_warm_codecs[stream_id] = warm;
+  }
+
+  CLog::Log(LOGDEBUG, "OMXPlayerAudio::PreOpenCodecs - %d decoders opened in %.1f ms",
+            (int)m_warm_codecs.size(), (double)(OMXClock::CurrentHostCounter() - start) * 1000.0 / m_freq);
+}
+
+void OMXPlayerAudio::ClosePreOpened()
+{
+  std::map<int, OMXWarmCodec>::iterator it;
+  for(it = m_warm_codecs.begin(); it != m_warm_codecs.end(); ++it)
+    delete it->second.codec;
+  m_warm_codecs.clear();
+}
+
+/* switches decoders at a packet boundary when the PCM handed to the sink
+   keeps its format. The sink, its fifo and the clock keep running, so the
+   old stream plays out what was decoded and the new one follows on */
+bool OMXPlayerAudio::SwapCodec(OMXPacket *pkt)
+{
+  COMXStreamInfo &hints = pkt->hints;
+
+  if(m_passthrough || m_hw_decode || m_pack || !m_pChannelMap)
+    return false;
+  if(m_use_passthrough && IsPassthrough(hints))
+    return false;
+  if(m_use_hw_decode && m_device.compare(0, 4, "omx:") == 0 && COMXAudio::HWDecode(hints.codec))
+    return false;
+  if(hints.channels != m_hints.channels || hints.samplerate != m_hints.samplerate)
+    return false;
+
+  COMXAudioCodecOMX *codec = TakeCodec(pkt->stream_index, hints);
+  if(!codec)
+    return false;
+
+  /* the sink remaps with the layout it was opened with */
+  enum PCMChannels *map = codec->GetChannelMap();
+  int ch = 0;
+  while(map && m_pChannelMap[ch] != PCM_INVALID && map[ch] == m_pChannelMap[ch])
+    ch++;
+
+  if(!map || map[ch] != m_pChannelMap[ch])
+  {
+    ReleaseCodec(pkt->stream_index, codec, hints);
+    return false;
+  }
+
+  /* the submit thread reads the hints and stream state while it holds the decoder */
+  LockDecoder();
+
+  ReleaseCodec(m_stream_id, m_pAudioCodec, m_hints);
+
+  m_pAudioCodec = codec;
+  m_pChannelMap = map;
+  m_stream_id   = pkt->stream_index;
+  m_hints       = hints;
+  m_codec_name  = m_omx_reader->GetCodecName(OMXSTREAM_AUDIO);
+
+  UnLockDecoder();
+
+  return true;
+}
+
+/* first output after a switch, report how long the stream had nothing to play */
+void OMXPlayerAudio::SwitchDone()
+{
+  if(!m_switch_start)
+    return;
+
+  m_switch_gap   = (double)(OMXClock::CurrentHostCounter() - m_switch_start) * 1000.0 / m_freq;
+  m_switch_start = 0;
+
+  printf("Audio switch to stream %d (%s) took %.1f ms\n", m_stream_id, m_switch_mode, m_switch_gap);
 }
 
 IAudioRenderer::EEncoded OMXPlayerAudio::IsPassthrough(COMXStreamInfo hints)
@@ -595,24 +1081,63 @@ IAudioRenderer::EEncoded OMXPlayerAudio::IsPassthrough(COMXStreamInfo hints)
 #endif
 }
 
+/* "omx:<output>" renders through the IL, "null" and "null:fast" throw the
+   audio away in realtime or as fast as it comes, "wav:<file>" writes it out */
+IOMXAudioSink *OMXPlayerAudio::CreateSink(std::string &device)
+{
+  if(m_device == "null" || m_device == "null:fast")
+  {
+    device = "";
+    return new COMXNullAudio(m_device == "null");
+  }
+
+  if(m_device.compare(0, 4, "wav:") == 0)
+  {
+    device = m_device.substr(4);
+    return new COMXWavAudio();
+  }
+
+  device = m_device.compare(0, 4, "omx:") == 0 ? m_device.substr(4) : m_device;
+  return new COMXAudio();
+}
+
 bool OMXPlayerAudio::OpenDecoder()
 {
   bool bAudioRenderOpen = false;
+  bool software_sink = m_device.compare(0, 4, "omx:") != 0;
+  std::string device;
 
-  m_decoder = new COMXAudio();
+  m_decoder = CreateSink(device);
   m_decoder->SetClock(m_av_clock);
 
   if(m_use_passthrough)
     m_passthrough = IsPassthrough(m_hints);
 
-  if(!m_passthrough && m_use_hw_decode)
+  /* software sinks only take PCM, passthrough goes to them as IEC 61937 bursts */
+  m_pack = false;
+  if(m_passthrough && software_sink)
+  {
+    bool dtshd = m_hints.profile == FF_PROFILE_DTS_HD_MA || m_hints.profile == FF_PROFILE_DTS_HD_HRA;
+    m_pack = m_packer.Open(m_passthrough, dtshd);
+    if(!m_pack)
+      m_passthrough = IAudioRenderer::ENCODED_NONE;
+  }
+
+  if(!m_passthrough && m_use_hw_decode && !software_sink)
     m_hw_decode = COMXAudio::HWDecode(m_hints.codec);
 
-  if(m_passthrough || m_use_hw_decode)
+  if(m_pack)
+  {
+    /* the bursts have to reach the receiver untouched, keep the volume at 0dB */
+    bAudioRenderOpen = m_decoder->Initialize(NULL, device, 2, NULL, 2, m_packer.GetOutputRate(m_hints.samplerate), 16,
+                                             false, false, false, IAudioRenderer::ENCODED_NONE,
+                                             0, m_fifo_size);
+  }
+  else if(m_passthrough || (m_use_hw_decode && !software_sink))
   {
     if(m_passthrough)
       m_hw_decode = false;
-    bAudioRenderOpen = m_decoder->Initialize(NULL, m_device.substr(4), m_pChannelMap,
+    bAudioRenderOpen = m_decoder->Initialize(NULL, device, m_pChannelMap,
                                              m_hints, m_av_clock, m_passthrough,
                                              m_hw_decode, m_boost_on_downmix, m_initialVolume, m_fifo_size);
   }
@@ -620,7 +1145,7 @@ bool OMXPlayerAudio::OpenDecoder()
   {
     unsigned int downmix_channels = m_hints.channels;
 
-    bAudioRenderOpen = m_decoder->Initialize(NULL, m_device.substr(4), m_hints.channels, m_pChannelMap,
+    bAudioRenderOpen = m_decoder->Initialize(NULL, device, m_hints.channels, m_pChannelMap,
                                              downmix_channels, m_hints.samplerate, m_passthrough ? 16:32,
                                              false, m_boost_on_downmix, false, m_passthrough, m_initialVolume, m_fifo_size);
   }
@@ -635,7 +1160,12 @@ bool OMXPlayerAudio::OpenDecoder()
   }
   else
   {
-    if(m_passthrough)
+    if(m_pack)
+    {
+      printf("Audio codec %s passthrough (IEC 61937 at %u Hz) channels %d samplerate %d bitspersample %d\n",
+        m_codec_name.c_str(), m_packer.GetOutputRate(m_hints.samplerate), m_hints.channels, m_hints.samplerate, m_hints.bitspersample);
+    }
+    else if(m_passthrough)
     {
       printf("Audio codec %s passthrough channels %d samplerate %d bitspersample %d\n",
         m_codec_name.c_str(), m_hints.channels, m_hints.samplerate, m_hints.bitspersample);
@@ -699,6 +1229,9 @@ void OMXPlayerAudio::WaitCompletion()
     OMXClock::OMXSleep(50);
   }
 
+  while(GetRingLevel() > 0 && m_submit_running)
+    OMXClock::OMXSleep(50);
+
   m_decoder->WaitCompletion();
 }
 
@@ -719,7 +1252,8 @@ void OMXPlayerAudio::DoAudioWork()
 
 void OMXPlayerAudio::SetCurrentVolume(long nVolume)
 {
-  if(m_decoder) m_decoder->SetCurrentVolume(nVolume);
+  /* a software sink would scale the bursts it is given in place of PCM */
+  if(m_decoder && !m_pack) m_decoder->SetCurrentVolume(nVolume);
 }
 
 long OMXPlayerAudio::GetCurrentVolume()
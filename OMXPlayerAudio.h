@@ -32,8 +32,11 @@
 #include "OMXReader.h"
 #include "OMXClock.h"
 #include "OMXStreamInfo.h"
+#include "OMXQueueSizer.h"
 #include "OMXAudio.h"
 #include "OMXAudioCodecOMX.h"
+#include "OMXPlayerResampler.h"
+#include "IEC61937Packer.h"
 #ifdef STANDALONE
 #include "OMXThread.h"
 #else
@@ -41,11 +44,32 @@
 #endif
 
 #include <deque>
+#include <map>
 #include <string>
 #include <sys/types.h>
 
 using namespace std;
 
+#define AUDIO_RING_SIZE 32
+
+// decoded audio on its way from the decode thread to the submit thread
+typedef struct OMXDecodedAudio
+{
+  uint8_t *data;
+  int     size;
+  int     alloc;
+  int     channels;   // of the decoder that produced it, 0 for undecoded data
+  double  pts;
+  double  duration;
+} OMXDecodedAudio;
+
+// decoder kept open for an audio stream that is not playing right now
+typedef struct OMXWarmCodec
+{
+  COMXAudioCodecOMX *codec;
+  COMXStreamInfo    hints;
+} OMXWarmCodec;
+
 #ifdef STANDALONE
 class OMXPlayerAudio : public OMXThread
 #else
@@ -66,9 +90,10 @@ protected:
   pthread_cond_t            m_audio_cond;
   pthread_mutex_t           m_lock;
   pthread_mutex_t           m_lock_decoder;
+  pthread_mutex_t           m_lock_codec;
   OMXClock                  *m_av_clock;
   OMXReader                 *m_omx_reader;
-  COMXAudio                 *m_decoder;
+  IOMXAudioSink             *m_decoder;
   std::string               m_codec_name;
   std::string               m_device;
   bool                      m_use_passthrough;
@@ -83,6 +108,7 @@ protected:
   enum PCMChannels          *m_pChannelMap;
   unsigned int              m_cached_size;
   unsigned int              m_max_data_size;
+  OMXStreamBitrate          m_bitrate;
   float                     m_fifo_size;
   COMXAudioCodecOMX         *m_pAudioCodec;
   int                       m_speed;
@@ -93,27 +119,67 @@ protected:
   int64_t m_freq;
 
   void   HandleSyncError(double duration, double pts);
+  void   UpdateResampleRatio();
   double m_errorbuff; //place to store average errors
   int    m_errorcount;//number of errors stored
   bool   m_syncclock;
 
   bool   m_player_error;
 
+  // single producer (decode) / single consumer (submit) ring, the indices
+  // hand entries over, m_ring_lock is only taken to sleep on m_ring_cond
+  OMXDecodedAudio           m_ring[AUDIO_RING_SIZE];
+  volatile unsigned int     m_ring_head;
+  volatile unsigned int     m_ring_tail;
+  volatile unsigned int     m_flush_count;
+  pthread_mutex_t           m_ring_lock;
+  pthread_cond_t            m_ring_cond;
+  pthread_t                 m_submit_thread;
+  bool                      m_submit_running;
+  double                    m_decode_pts;
+
   double m_integral; //integral correction for resampler
+  double m_correction; //current resampler correction, ratio - 1
+  unsigned int m_discontinuities; //clock discontinuities issued
   int    m_skipdupcount; //counter for skip/duplicate synctype
   bool   m_prevskipped;
+  COMXPlayerResampler m_resampler;
+  CIEC61937Packer     m_packer;
+  bool                m_pack; //passthrough packed into PCM for a software sink
+
+  // decoders of the other audio streams by stream id, filled with --audio_preopen
+  std::map<int, OMXWarmCodec> m_warm_codecs;
+  bool                m_preopen;
+  int64_t             m_switch_start; //host time the pending stream switch started, 0 if none
+  const char          *m_switch_mode;
+  double              m_switch_gap;   //ms from the last switch to its first output
 
   void Lock();
   void UnLock();
   void LockDecoder();
   void UnLockDecoder();
+  void LockCodec();
+  void UnLockCodec();
+  bool WaitRing(unsigned int level);
+  bool Output(const uint8_t *data, int size, double pts, double duration);
+  void Submit(const uint8_t *data, int size, int channels, double pts, double duration);
+  static void *SubmitThread(void *arg);
+  void ProcessSubmit();
+  void FreeRing();
+  COMXAudioCodecOMX *TakeCodec(int stream_id, COMXStreamInfo &hints);
+  void ReleaseCodec(int stream_id, COMXAudioCodecOMX *codec, COMXStreamInfo &hints);
+  void PreOpenCodecs();
+  void ClosePreOpened();
+  bool SwapCodec(OMXPacket *pkt);
+  void SwitchDone();
 private:
 public:
   OMXPlayerAudio();
   ~OMXPlayerAudio();
   bool Open(COMXStreamInfo &hints, OMXClock *av_clock, OMXReader *omx_reader,
             std::string device, bool passthrough, long initialVolume, bool hw_decode,
-            bool boost_on_downmix, bool use_thread, float queue_size, float fifo_size);
+            bool boost_on_downmix, bool use_thread, float queue_size, float fifo_size,
+            bool preopen = false);
   bool Close();
   bool Decode(OMXPacket *pkt);
   void Process();
@@ -122,6 +188,7 @@ public:
   bool OpenAudioCodec();
   void CloseAudioCodec();      
   IAudioRenderer::EEncoded IsPassthrough(COMXStreamInfo hints);
+  IOMXAudioSink *CreateSink(std::string &device);
   bool OpenDecoder();
   bool CloseDecoder();
   double GetDelay();
@@ -131,7 +198,15 @@ public:
   void WaitCompletion();
   unsigned int GetCached() { return m_cached_size; };
   unsigned int GetMaxCached() { return m_max_data_size; };
+  void SetMaxCached(unsigned int size) { m_max_data_size = size; };
+  double GetBitrate() { return m_bitrate.GetBitrate(); };
   unsigned int GetLevel() { return m_max_data_size ? 100 * m_cached_size / m_max_data_size : 0; };
+  unsigned int GetRingLevel() { return m_ring_head - m_ring_tail; };
+  unsigned int GetSubmitCount() { return m_decoder ? m_decoder->GetSubmitCount() : 0; };
+  double GetSyncError() { return m_error; };
+  double GetClockCorrection() { return m_correction; };
+  unsigned int GetDiscontinuities() { return m_discontinuities; };
+  double GetSwitchGap() { return m_switch_gap; };
   void  RegisterAudioCallback(IAudioCallback* pCallback);
   void  UnRegisterAudioCallback();
   void  DoAudioWork();
@@ -0,0 +1,129 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "OMXPlayerResampler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+COMXPlayerResampler::COMXPlayerResampler()
+{
+  m_ratio       = 1.0;
+  m_pos         = 0.0;
+  m_channels    = 0;
+  m_last        = NULL;
+  m_buffer      = NULL;
+  m_buffer_size = 0;
+}
+
+COMXPlayerResampler::~COMXPlayerResampler()
+{
+  free(m_last);
+  free(m_buffer);
+}
+
+void COMXPlayerResampler::Flush()
+{
+  m_pos = 0.0;
+  if(m_last)
+    memset(m_last, 0, m_channels * sizeof(float));
+}
+
+int COMXPlayerResampler::Resample(const uint8_t *in, int size, int channels, const uint8_t **out)
+{
+  *out = in;
+
+  if(channels <= 0)
+    return size;
+
+  int samples = size / (channels * sizeof(float));
+
+  /* nothing in progress and no correction, hand the data on untouched */
+  if((m_ratio == 1.0 && m_pos == 0.0) || samples < 2)
+    return size;
+
+  if(channels != m_channels)
+  {
+    float *last = (float *)realloc(m_last, channels * sizeof(float));
+    if(!last)
+      return size;
+    m_last     = last;
+    m_channels = channels;
+    Flush();
+  }
+
+  int max_out = (int)((samples - m_pos) * m_ratio) + 2;
+  int needed  = max_out * channels * sizeof(float);
+  if(m_buffer_size < needed)
+  {
+    uint8_t *buffer = (uint8_t *)realloc(m_buffer, needed);
+    if(!buffer)
+      return size;
+    m_buffer      = buffer;
+    m_buffer_size = needed;
+  }
+
+  double step   = 1.0 / m_ratio;
+  int    out_samples = 0;
+
+  for(int ch = 0; ch < channels; ch++)
+  {
+    const float *src = (const float *)in + ch * samples;
+    float       *dst = (float *)m_buffer + ch * max_out;
+    double       pos = m_pos;
+    int          n   = 0;
+
+    /* position -1 is the last sample of the previous packet */
+    while(pos < samples - 1 && n < max_out)
+    {
+      int   i    = (int)floor(pos);
+      float frac = (float)(pos - i);
+      float s0   = i < 0 ? m_last[ch] : src[i];
+      float s1   = src[i + 1];
+
+      dst[n++] = s0 + (s1 - s0) * frac;
+      pos += step;
+    }
+
+    m_last[ch]  = src[samples - 1];
+    out_samples = n;
+
+    if(ch == channels - 1)
+      m_pos = pos - samples;
+  }
+
+  /* planes were written max_out apart, close the gaps */
+  if(out_samples != max_out)
+  {
+    for(int ch = 1; ch < channels; ch++)
+      memmove((float *)m_buffer + ch * out_samples, (float *)m_buffer + ch * max_out, out_samples * sizeof(float));
+  }
+
+  *out = m_buffer;
+  return out_samples * channels * sizeof(float);
+}
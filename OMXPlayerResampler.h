@@ -0,0 +1,51 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _OMX_PLAYERRESAMPLER_H_
+#define _OMX_PLAYERRESAMPLER_H_
+
+#include <stdint.h>
+
+// Linear interpolating resampler for planar float PCM, used to stretch or
+// squeeze the audio by a fraction of a percent so it follows the clock.
+// The fractional position and last sample of each channel carry over
+// between calls so packets are joined without clicks.
+class COMXPlayerResampler
+{
+public:
+  COMXPlayerResampler();
+  ~COMXPlayerResampler();
+  // ratio of output to input samples
+  void   SetRatio(double ratio) { m_ratio = ratio; };
+  double GetRatio()             { return m_ratio; };
+  void   Flush();
+  // returns the size of the resampled data in *out, which stays valid
+  // until the next call. Data is passed through while nothing is to be done.
+  int    Resample(const uint8_t *in, int size, int channels, const uint8_t **out);
+private:
+  double  m_ratio;
+  double  m_pos;
+  int     m_channels;
+  float   *m_last;
+  uint8_t *m_buffer;
+  int     m_buffer_size;
+};
+#endif
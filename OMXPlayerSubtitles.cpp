@@ -19,6 +19,7 @@
 #include "OMXPlayerSubtitles.h"
 #include "OMXOverlayText.h"
 #include "SubtitleRenderer.h"
+#include "OMXStartup.h"
 #include "utils/Enforce.h"
 #include "utils/ScopeExit.h"
 #include "utils/Clamp.h"
@@ -149,6 +150,7 @@ RenderLoop(const string& font_path,
            unsigned int lines,
            OMXClock* clock)
 {
+  int64_t startup = COMXStartup::Begin();
   SubtitleRenderer renderer(1,
                             font_path,
                             font_size,
@@ -157,6 +159,7 @@ RenderLoop(const string& font_path,
                             0xDD,
                             0x80,
                             lines);
+  COMXStartup::End("subtitle_font", startup);
 
   vector<Subtitle> subtitles;
 
@@ -170,7 +173,7 @@ RenderLoop(const string& font_path,
 
   auto GetCurrentTime = [&]
   {
-    return static_cast<int>(clock->OMXMediaTime()/1000) - delay;
+    return static_cast<int>(clock->OMXMediaTimeCached()/1000) - delay;
   };
 
   auto TryPrepare = [&](int time)
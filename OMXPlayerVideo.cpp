@@ -57,8 +57,11 @@ OMXPlayerVideo::OMXPlayerVideo()
   m_speed         = DVD_PLAYSPEED_NORMAL;
   m_iSubtitleDelay = 0;
   m_pSubtitleCodec = NULL;
+  m_flush_time    = 0;
+  m_seek_latency  = 0;
   m_max_data_size = 10 * 1024 * 1024;
   m_fifo_size     = (float)80*1024*60 / (1024*1024);
+  m_zero_copy     = false;
 
   pthread_cond_init(&m_packet_cond, NULL);
   pthread_cond_init(&m_picture_cond, NULL);
@@ -115,7 +118,7 @@ void OMXPlayerVideo::UnLockSubtitles()
 }
 
 bool OMXPlayerVideo::Open(COMXStreamInfo &hints, OMXClock *av_clock, const CRect& DestRect, bool deinterlace, bool mpeg, bool hdmi_clock_sync, bool use_thread,
-                             float display_aspect, float queue_size, float fifo_size)
+                             float display_aspect, float queue_size, float fifo_size, bool zero_copy)
 {
   if (!m_dllAvUtil.Load() || !m_dllAvCodec.Load() || !m_dllAvFormat.Load() || !av_clock)
     return false;
@@ -144,7 +147,10 @@ bool OMXPlayerVideo::Open(COMXStreamInfo &hints, OMXClock *av_clock, const CRect
   m_speed       = DVD_PLAYSPEED_NORMAL;
   m_iSubtitleDelay = 0;
   m_pSubtitleCodec = NULL;
+  m_flush_time  = 0;
+  m_seek_latency = 0;
   m_DestRect    = DestRect;
+  m_zero_copy   = zero_copy;
   if (queue_size != 0.0)
     m_max_data_size = queue_size * 1024 * 1024;
   if (fifo_size != 0.0)
@@ -196,6 +202,7 @@ bool OMXPlayerVideo::Close()
   m_syncclock     = true;
   m_speed         = DVD_PLAYSPEED_NORMAL;
   m_pSubtitleCodec = NULL;
+  m_flush_time    = 0;
 
   return true;
 }
@@ -213,6 +220,14 @@ void OMXPlayerVideo::Output(double pts)
     m_syncclock = false;
   }
 
+  if(m_flush_time)
+  {
+    m_seek_latency = (double)(OMXClock::CurrentHostCounter() - m_flush_time) * 1000.0 / OMXClock::CurrentHostFrequency();
+    m_flush_time = 0;
+    CLog::Log(LOGDEBUG, "OMXPlayerVideo::Output first frame after flush in %.2f ms\n", m_seek_latency);
+    printf("Seek : first frame after %.2f ms\n", m_seek_latency);
+  }
+
   double iSleepTime, iClockSleep, iFrameSleep, iPlayingClock, iCurrentClock, iFrameDuration;
   iPlayingClock = m_av_clock->GetClock(iCurrentClock, false); // snapshot current clock
   iClockSleep = pts - iPlayingClock; //sleep calculated by pts to clock comparison
@@ -289,7 +304,10 @@ bool OMXPlayerVideo::Decode(OMXPacket *pkt)
 
   bool ret = false;
 
-  if(!((unsigned long)m_decoder->GetFreeSpace() > pkt->size))
+  // a packet read into a decoder input buffer brings its own space
+  bool fits = pkt->omx_buffer || (unsigned long)m_decoder->GetFreeSpace() > pkt->size;
+
+  if(!fits)
     OMXClock::OMXSleep(10);
 
   if (pkt->dts == DVD_NOPTS_VALUE && pkt->pts == DVD_NOPTS_VALUE)
@@ -370,12 +388,12 @@ bool OMXPlayerVideo::Decode(OMXPacket *pkt)
 
     ret = true;
   }
-  else if((unsigned long)m_decoder->GetFreeSpace() > pkt->size)
+  else if(fits)
   {
     if(m_bMpeg)
-      m_decoder->Decode(pkt->data, pkt->size, DVD_NOPTS_VALUE, DVD_NOPTS_VALUE);
+      m_decoder->Decode(pkt, DVD_NOPTS_VALUE, DVD_NOPTS_VALUE);
     else
-      m_decoder->Decode(pkt->data, pkt->size, m_pts, m_pts);
+      m_decoder->Decode(pkt, m_pts, m_pts);
 
     m_av_clock->SetVideoClock(m_pts);
 
@@ -486,8 +504,16 @@ void OMXPlayerVideo::Flush()
   }
   m_iCurrentPts = DVD_NOPTS_VALUE;
   m_cached_size = 0;
+  m_bitrate.Reset();
   if(m_decoder)
+  {
     m_decoder->Reset();
+    // the input port is empty now, a safe point to apply SetFifoSize()
+    m_decoder->ResizeInputFifo(m_fifo_size);
+    m_flush_time = OMXClock::CurrentHostCounter();
+  }
+  if(m_av_clock)
+    m_FlipTimeStamp = m_av_clock->GetAbsoluteClock();
   m_syncclock = true;
   UnLockDecoder();
   FlushSubtitles();
@@ -506,6 +532,7 @@ bool OMXPlayerVideo::AddPacket(OMXPacket *pkt)
 
   if((m_cached_size + pkt->size) < m_max_data_size)
   {
+    m_bitrate.Add(pkt);
     Lock();
     m_cached_size += pkt->size;
     m_packets.push_back(pkt);
@@ -550,6 +577,18 @@ bool OMXPlayerVideo::OpenDecoder()
   return true;
 }
 
+// OMXReader allocator for video packets, see OMXReader::SetVideoPacketAllocator.
+// It runs on the reader thread, which is the one opening and closing the decoder
+bool OMXPlayerVideo::AllocPacketData(void *userdata, OMXPacket *pkt, int size)
+{
+  OMXPlayerVideo *player = static_cast<OMXPlayerVideo*>(userdata);
+
+  if(!player->m_zero_copy || !player->m_decoder)
+    return false;
+
+  return player->m_decoder->AllocPacketData(pkt, size);
+}
+
 bool OMXPlayerVideo::CloseDecoder()
 {
   if(m_decoder)
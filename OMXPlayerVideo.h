@@ -30,6 +30,7 @@
 #include "OMXReader.h"
 #include "OMXClock.h"
 #include "OMXStreamInfo.h"
+#include "OMXQueueSizer.h"
 #include "OMXVideo.h"
 #ifdef STANDALONE
 #include "OMXThread.h"
@@ -85,7 +86,9 @@ protected:
   bool                      m_flush;
   unsigned int              m_cached_size;
   unsigned int              m_max_data_size;
+  OMXStreamBitrate          m_bitrate;
   float                     m_fifo_size;
+  bool                      m_zero_copy;
   bool                      m_hdmi_clock_sync;
   double                    m_iVideoDelay;
   double                    m_pts;
@@ -94,6 +97,8 @@ protected:
   double                    m_FlipTimeStamp; // time stamp of last flippage. used to play at a forced framerate
   double                    m_iSubtitleDelay;
   COMXOverlayCodec          *m_pSubtitleCodec;
+  int64_t                   m_flush_time;     // host counter of the last flush, 0 when no seek is pending
+  double                    m_seek_latency;   // ms from the last flush to the first frame after it
 
   void Lock();
   void UnLock();
@@ -106,7 +111,7 @@ public:
   OMXPlayerVideo();
   ~OMXPlayerVideo();
   bool Open(COMXStreamInfo &hints, OMXClock *av_clock, const CRect& DestRect, bool deinterlace, bool mpeg, bool hdmi_clock_sync, bool use_thread,
-                   float display_aspect, float queue_size, float fifo_size);
+                   float display_aspect, float queue_size, float fifo_size, bool zero_copy = false);
   bool Close();
   void Output(double pts);
   bool Decode(OMXPacket *pkt);
@@ -122,10 +127,17 @@ public:
   double GetFPS() { return m_fps; };
   unsigned int GetCached() { return m_cached_size; };
   unsigned int GetMaxCached() { return m_max_data_size; };
+  void SetMaxCached(unsigned int size) { m_max_data_size = size; };
+  // takes effect on the next Flush()
+  void SetFifoSize(float fifo_size) { m_fifo_size = fifo_size; };
+  double GetBitrate() { return m_bitrate.GetBitrate(); };
   unsigned int GetLevel() { return m_max_data_size ? 100 * m_cached_size / m_max_data_size : 0; };
   void  WaitCompletion();
   void SetDelay(double delay) { m_iVideoDelay = delay; }
   double GetDelay() { return m_iVideoDelay; }
+  double GetSeekLatency() { return m_seek_latency; };
+  unsigned int GetBytesCopied() { return m_decoder ? m_decoder->GetBytesCopied() : 0; };
+  static bool AllocPacketData(void *userdata, OMXPacket *pkt, int size);
   void SetSpeed(int iSpeed);
   double GetSubtitleDelay()                                { return m_iSubtitleDelay; }
   void SetSubtitleDelay(double delay)                      { m_iSubtitleDelay = delay; }
@@ -0,0 +1,186 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "OMXQueueSizer.h"
+#include "utils/log.h"
+
+#include <algorithm>
+
+#ifdef CLASSNAME
+#undef CLASSNAME
+#endif
+#define CLASSNAME "OMXQueueSizer"
+
+#define QUEUE_MIN_VIDEO     (1024 * 1024)
+#define QUEUE_MIN_AUDIO     (128 * 1024)
+// default video fifo is 80 buffers of 60k
+#define FIFO_MIN_VIDEO      ((float)80*1024*60 / (1024*1024))
+#define FIFO_MAX_VIDEO      8.0f
+
+OMXStreamBitrate::OMXStreamBitrate()
+{
+  m_bitrate = 0.0;
+  Reset();
+}
+
+void OMXStreamBitrate::Reset()
+{
+  m_start = DVD_NOPTS_VALUE;
+  m_bytes = 0;
+}
+
+void OMXStreamBitrate::Add(OMXPacket *pkt)
+{
+  if(!pkt)
+    return;
+
+  double pts = pkt->dts != DVD_NOPTS_VALUE ? pkt->dts : pkt->pts;
+  if(pts == DVD_NOPTS_VALUE)
+  {
+    // count it against the current window anyway
+    m_bytes += pkt->size;
+    return;
+  }
+
+  if(m_start == DVD_NOPTS_VALUE || pts < m_start)
+  {
+    m_start = pts;
+    m_bytes = 0;
+  }
+
+  m_bytes += pkt->size;
+
+  // average over windows of at least a second, smooth across windows
+  double span = pts - m_start;
+  if(span >= DVD_TIME_BASE)
+  {
+    double bitrate = (double)m_bytes * 8.0 * DVD_TIME_BASE / span;
+    m_bitrate = m_bitrate > 0.0 ? 0.75 * m_bitrate + 0.25 * bitrate : bitrate;
+    m_start = pts;
+    m_bytes = 0;
+  }
+}
+
+OMXQueueSizer::OMXQueueSizer()
+{
+  m_budget        = 13 * 1024 * 1024;
+  m_target        = 5.0;
+  m_has_video     = false;
+  m_has_audio     = false;
+  m_video_fixed   = 0;
+  m_audio_fixed   = 0;
+  m_video_size    = 0;
+  m_audio_size    = 0;
+  m_video_bitrate = 0.0;
+}
+
+void OMXQueueSizer::SetFixed(unsigned int video_size, unsigned int audio_size)
+{
+  m_video_fixed = video_size;
+  m_audio_fixed = audio_size;
+}
+
+void OMXQueueSizer::SetStreams(bool has_video, unsigned int video_size, bool has_audio, unsigned int audio_size)
+{
+  m_has_video   = has_video;
+  m_has_audio   = has_audio;
+  m_video_size  = has_video ? video_size : 0;
+  m_audio_size  = has_audio ? audio_size : 0;
+}
+
+static unsigned int WantedSize(double bitrate, double target, unsigned int minimum, unsigned int current)
+{
+  // keep what we have until the stream has been measured
+  if(bitrate <= 0.0)
+    return current;
+
+  double size = bitrate / 8.0 * target;
+  if(size < minimum)
+    return minimum;
+  return (unsigned int)size;
+}
+
+static bool SizeChanged(unsigned int a, unsigned int b)
+{
+  unsigned int diff = a > b ? a - b : b - a;
+  return diff > b / 10;
+}
+
+bool OMXQueueSizer::Update(double video_bitrate, double audio_bitrate)
+{
+  if(m_budget == 0)
+    return false;
+
+  m_video_bitrate = video_bitrate;
+
+  unsigned int video = 0;
+  unsigned int audio = 0;
+
+  if(m_has_video)
+    video = m_video_fixed ? m_video_fixed : WantedSize(video_bitrate, m_target, QUEUE_MIN_VIDEO, m_video_size);
+  if(m_has_audio)
+    audio = m_audio_fixed ? m_audio_fixed : WantedSize(audio_bitrate, m_target, QUEUE_MIN_AUDIO, m_audio_size);
+
+  // over budget, shrink the adaptive queues so they hold the same duration
+  if((uint64_t)video + audio > m_budget)
+  {
+    unsigned int fixed      = (m_video_fixed ? video : 0) + (m_audio_fixed ? audio : 0);
+    unsigned int available  = m_budget > fixed ? m_budget - fixed : 0;
+    uint64_t     adaptive   = (m_video_fixed ? 0 : video) + (m_audio_fixed ? 0 : audio);
+
+    if(adaptive > available)
+    {
+      if(m_has_video && !m_video_fixed)
+        video = std::max((unsigned int)((uint64_t)video * available / adaptive), (unsigned int)QUEUE_MIN_VIDEO);
+      if(m_has_audio && !m_audio_fixed)
+        audio = std::max((unsigned int)((uint64_t)audio * available / adaptive), (unsigned int)QUEUE_MIN_AUDIO);
+    }
+  }
+
+  if(!SizeChanged(video, m_video_size) && !SizeChanged(audio, m_audio_size))
+    return false;
+
+  CLog::Log(LOGDEBUG, "%s::%s - video %.0f kbit/s queue %u -> %u, audio %.0f kbit/s queue %u -> %u\n",
+      CLASSNAME, __func__, video_bitrate / 1000.0, m_video_size, video, audio_bitrate / 1000.0, m_audio_size, audio);
+
+  m_video_size = video;
+  m_audio_size = audio;
+
+  return true;
+}
+
+float OMXQueueSizer::GetVideoFifo()
+{
+  float fifo = m_video_bitrate / 8.0 / (1024 * 1024);
+
+  if(fifo < FIFO_MIN_VIDEO)
+    fifo = FIFO_MIN_VIDEO;
+  if(fifo > FIFO_MAX_VIDEO)
+    fifo = FIFO_MAX_VIDEO;
+
+  return fifo;
+}
@@ -0,0 +1,72 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _OMX_QUEUESIZER_H_
+#define _OMX_QUEUESIZER_H_
+
+#include "OMXReader.h"
+#include "OMXClock.h"
+
+// Measures the bitrate of a stream from the timestamps of its demuxed packets.
+class OMXStreamBitrate
+{
+public:
+  OMXStreamBitrate();
+  void   Reset();
+  void   Add(OMXPacket *pkt);
+  double GetBitrate() { return m_bitrate; };
+private:
+  double        m_start;
+  unsigned int  m_bytes;
+  double        m_bitrate;
+};
+
+// Sizes the audio and video packet queues so that each holds the same
+// duration of media, bounded by a memory budget shared by both.
+class OMXQueueSizer
+{
+public:
+  OMXQueueSizer();
+  void SetBudget(unsigned int bytes) { m_budget = bytes; };
+  void SetTarget(double seconds)     { m_target = seconds; };
+  // sizes passed here are not adapted, zero means adaptive
+  void SetFixed(unsigned int video_size, unsigned int audio_size);
+  void SetStreams(bool has_video, unsigned int video_size, bool has_audio, unsigned int audio_size);
+  // returns true when the queue sizes changed
+  bool Update(double video_bitrate, double audio_bitrate);
+  unsigned int GetVideoSize() { return m_video_size; };
+  unsigned int GetAudioSize() { return m_audio_size; };
+  // video decoder fifo in MB that holds a second of video, applied on the next decoder open
+  float GetVideoFifo();
+  unsigned int GetBudget() { return m_budget; };
+  double GetTarget() { return m_target; };
+private:
+  unsigned int  m_budget;
+  double        m_target;
+  bool          m_has_video;
+  bool          m_has_audio;
+  unsigned int  m_video_fixed;
+  unsigned int  m_audio_fixed;
+  unsigned int  m_video_size;
+  unsigned int  m_audio_size;
+  double        m_video_bitrate;
+};
+#endif
@@ -27,6 +27,8 @@
 
 #include "OMXReader.h"
 #include "OMXClock.h"
+#include "OMXCore.h"
+#include "OMXStartup.h"
 
 #include <stdio.h>
 #include <unistd.h>
@@ -60,6 +62,8 @@ OMXReader::OMXReader()
   m_eof           = false;
   m_chapter_count = 0;
   m_iCurrentPts   = DVD_NOPTS_VALUE;
+  m_video_alloc   = NULL;
+  m_video_alloc_data = NULL;
 
   for(int i = 0; i < MAX_STREAMS; i++)
     m_streams[i].extradata = NULL;
@@ -131,6 +135,8 @@ bool OMXReader::Open(std::string filename, bool dump_format)
   m_dllAvFormat.avformat_network_init();
   m_dllAvUtil.av_log_set_level(dump_format ? AV_LOG_INFO:AV_LOG_QUIET);
 
+  int64_t startup = COMXStartup::Begin();
+
   int           result    = -1;
   AVInputFormat *iformat  = NULL;
   unsigned char *buffer   = NULL;
@@ -201,6 +207,8 @@ bool OMXReader::Open(std::string filename, bool dump_format)
     }
   }
 
+  COMXStartup::End("reader_probe", startup);
+
   // set the interrupt callback, appeared in libavformat 53.15.0
   m_pFormatContext->interrupt_callback = int_cb;
 
@@ -220,12 +228,14 @@ bool OMXReader::Open(std::string filename, bool dump_format)
     m_pFormatContext->max_analyze_duration = 0;
 #endif
 
+  startup = COMXStartup::Begin();
   result = m_dllAvFormat.avformat_find_stream_info(m_pFormatContext, NULL);
   if(result < 0)
   {
     Close();
     return false;
   }
+  COMXStartup::End("reader_stream_info", startup);
 
   if(!GetStreams())
   {
@@ -506,7 +516,26 @@ OMXPacket *OMXReader::Read()
     pkt.pts = AV_NOPTS_VALUE;
   }
 
-  m_omx_pkt = AllocPacket(pkt.size);
+  if(m_video_alloc && IsActive(OMXSTREAM_VIDEO, pkt.stream_index))
+  {
+    m_omx_pkt = (OMXPacket *)malloc(sizeof(OMXPacket));
+    if(m_omx_pkt)
+    {
+      memset(m_omx_pkt, 0, sizeof(OMXPacket));
+      m_omx_pkt->dts  = DVD_NOPTS_VALUE;
+      m_omx_pkt->pts  = DVD_NOPTS_VALUE;
+      m_omx_pkt->now  = DVD_NOPTS_VALUE;
+      m_omx_pkt->duration = DVD_NOPTS_VALUE;
+      if(!m_video_alloc(m_video_alloc_data, m_omx_pkt, pkt.size))
+      {
+        free(m_omx_pkt);
+        m_omx_pkt = NULL;
+      }
+    }
+  }
+
+  if(!m_omx_pkt)
+    m_omx_pkt = AllocPacket(pkt.size);
   /* oom error allocation av packet */
   if(!m_omx_pkt)
   {
@@ -867,7 +896,7 @@ bool OMXReader::GetHints(OMXStreamType type, unsigned int index, COMXStreamInfo
 {
   for(unsigned int i = 0; i < MAX_STREAMS; i++)
   {
-    if(m_streams[i].type == type && m_streams[i].index == i)
+    if(m_streams[i].type == type && m_streams[i].index == index)
     {
       hints = m_streams[i].hints;
       return true;
@@ -877,6 +906,17 @@ bool OMXReader::GetHints(OMXStreamType type, unsigned int index, COMXStreamInfo
   return false;
 }
 
+int OMXReader::GetStreamId(OMXStreamType type, unsigned int index)
+{
+  for(unsigned int i = 0; i < MAX_STREAMS; i++)
+  {
+    if(m_streams[i].type == type && m_streams[i].index == index)
+      return m_streams[i].id;
+  }
+
+  return -1;
+}
+
 bool OMXReader::GetHints(OMXStreamType type, COMXStreamInfo &hints)
 {
   bool ret = false;
@@ -920,7 +960,9 @@ void OMXReader::FreePacket(OMXPacket *pkt)
 {
   if(pkt)
   {
-    if(pkt->data)
+    if(pkt->omx_buffer)
+      pkt->omx_owner->ReturnInputBuffer(pkt->omx_buffer);
+    else if(pkt->data)
       free(pkt->data);
     free(pkt);
   }
@@ -70,6 +70,8 @@ typedef struct OMXChapter
 } OMXChapter;
 
 class OMXReader;
+class COMXCoreComponent;
+struct OMX_BUFFERHEADERTYPE;
 
 typedef struct OMXPacket
 {
@@ -82,6 +84,9 @@ typedef struct OMXPacket
   int       stream_index;
   COMXStreamInfo hints;
   enum AVMediaType codec_type;
+  // set when data lies in an input buffer of omx_owner, FreePacket gives it back
+  OMX_BUFFERHEADERTYPE *omx_buffer;
+  COMXCoreComponent    *omx_owner;
 } OMXPacket;
 
 enum OMXStreamType
@@ -142,6 +147,8 @@ protected:
   void UnLock();
   bool SetActiveStreamInternal(OMXStreamType type, unsigned int index);
   bool                      m_seek;
+  bool                      (*m_video_alloc)(void *, OMXPacket *, int);
+  void                      *m_video_alloc_data;
 private:
 public:
   OMXReader();
@@ -161,6 +168,7 @@ public:
   bool GetHints(AVStream *stream, COMXStreamInfo *hints);
   bool GetHints(OMXStreamType type, unsigned int index, COMXStreamInfo &hints);
   bool GetHints(OMXStreamType type, COMXStreamInfo &hints);
+  int  GetStreamId(OMXStreamType type, unsigned int index);
   bool IsEof();
   int  AudioStreamCount() { return m_audio_count; };
   int  VideoStreamCount() { return m_video_count; };
@@ -170,6 +178,9 @@ public:
   OMXChapter GetChapter(unsigned int chapter) { return m_chapters[(chapter > MAX_OMX_CHAPTERS) ? MAX_OMX_CHAPTERS : chapter]; };
   static void FreePacket(OMXPacket *pkt);
   static OMXPacket *AllocPacket(int size);
+  // packets of the active video stream are read into what alloc hands out.
+  // It runs on the thread calling Read() and returns false to fall back to AllocPacket
+  void SetVideoPacketAllocator(bool (*alloc)(void *, OMXPacket *, int), void *userdata) { m_video_alloc = alloc; m_video_alloc_data = userdata; };
   void SetSpeed(int iSpeed);
   void UpdateCurrentPTS();
   double ConvertTimestamp(int64_t pts, int den, int num);
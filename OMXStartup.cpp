@@ -0,0 +1,175 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "OMXStartup.h"
+#include "OMXClock.h"
+
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <algorithm>
+
+int64_t           COMXStartup::m_start        = 0;
+volatile int64_t  COMXStartup::m_events[OMXSTARTUP_EVENT_COUNT];
+double            COMXStartup::m_pts[OMXSTARTUP_EVENT_COUNT];
+OMXStartupPhase   COMXStartup::m_phases[OMXSTARTUP_PHASES];
+int               COMXStartup::m_phase_count  = 0;
+pthread_mutex_t   COMXStartup::m_lock         = PTHREAD_MUTEX_INITIALIZER;
+
+static const char *events[OMXSTARTUP_EVENT_COUNT] =
+{
+  "first_video_submitted",
+  "first_video_decoded",
+  "first_video_presented",
+  "first_audio_submitted",
+};
+
+const char *COMXStartup::EventName(int event)
+{
+  return event >= 0 && event < OMXSTARTUP_EVENT_COUNT ? events[event] : "unknown";
+}
+
+void COMXStartup::Start()
+{
+  m_start = OMXClock::CurrentHostCounter();
+}
+
+int64_t COMXStartup::Begin()
+{
+  return OMXClock::CurrentHostCounter();
+}
+
+void COMXStartup::End(const char *name, int64_t start)
+{
+  int64_t now = OMXClock::CurrentHostCounter();
+
+  pthread_mutex_lock(&m_lock);
+  if(m_phase_count < OMXSTARTUP_PHASES)
+  {
+    OMXStartupPhase &phase = m_phases[m_phase_count++];
+    phase.name  = name;
+    phase.tid   = syscall(SYS_gettid);
+    phase.start = start - m_start;
+    phase.end   = now - m_start;
+  }
+  pthread_mutex_unlock(&m_lock);
+}
+
+void COMXStartup::Event(OMXStartupEvent event, double pts)
+{
+  // called for every packet, only the first one takes the lock
+  if(m_events[event])
+    return;
+
+  pthread_mutex_lock(&m_lock);
+  if(!m_events[event])
+  {
+    m_pts[event] = pts;
+    __sync_synchronize();
+    m_events[event] = OMXClock::CurrentHostCounter();
+  }
+  pthread_mutex_unlock(&m_lock);
+}
+
+double COMXStartup::GetEventPts(OMXStartupEvent event)
+{
+  if(!m_events[event])
+    return 0.0;
+  __sync_synchronize();
+  return m_pts[event];
+}
+
+double COMXStartup::GetFirstFrame()
+{
+  int64_t first = m_events[OMXSTARTUP_VIDEO_PRESENTED];
+  if(!first && !m_events[OMXSTARTUP_VIDEO_SUBMITTED])
+    first = m_events[OMXSTARTUP_AUDIO_SUBMITTED];
+  return first ? (first - m_start) / 1e6 : -1.0;
+}
+
+static bool PhaseBefore(const OMXStartupPhase &a, const OMXStartupPhase &b)
+{
+  return a.start < b.start;
+}
+
+void COMXStartup::Print(FILE *fp)
+{
+  pthread_mutex_lock(&m_lock);
+  OMXStartupPhase phases[OMXSTARTUP_PHASES];
+  int count = m_phase_count;
+  std::copy(m_phases, m_phases + count, phases);
+  pthread_mutex_unlock(&m_lock);
+
+  std::stable_sort(phases, phases + count, PhaseBefore);
+
+  fprintf(fp, "startup                    start      end  duration\n");
+  for(int i = 0; i < count; i++)
+  {
+    fprintf(fp, "  %-22s %8.1f %8.1f %8.1fms\n", phases[i].name,
+            phases[i].start / 1e6, phases[i].end / 1e6, (phases[i].end - phases[i].start) / 1e6);
+  }
+  for(int i = 0; i < OMXSTARTUP_EVENT_COUNT; i++)
+  {
+    if(m_events[i])
+      fprintf(fp, "  %-22s %8.1f\n", events[i], (m_events[i] - m_start) / 1e6);
+  }
+  if(GetFirstFrame() >= 0.0)
+    fprintf(fp, "time to first frame %.1fms\n", GetFirstFrame());
+}
+
+bool COMXStartup::WriteJSON(const char *filename)
+{
+  FILE *fp = fopen(filename, "w");
+  if(!fp)
+    return false;
+
+  pthread_mutex_lock(&m_lock);
+  fprintf(fp, "{\"phases\":[");
+  for(int i = 0; i < m_phase_count; i++)
+  {
+    fprintf(fp, "%s\n  {\"name\":\"%s\",\"tid\":%d,\"start_ms\":%.3f,\"end_ms\":%.3f}", i ? "," : "",
+            m_phases[i].name, m_phases[i].tid, m_phases[i].start / 1e6, m_phases[i].end / 1e6);
+  }
+  pthread_mutex_unlock(&m_lock);
+
+  fprintf(fp, "\n],\"events\":{");
+  for(int i = 0; i < OMXSTARTUP_EVENT_COUNT; i++)
+  {
+    if(m_events[i])
+      fprintf(fp, "%s\n  \"%s\":%.3f", i ? "," : "", events[i], (m_events[i] - m_start) / 1e6);
+    else
+      fprintf(fp, "%s\n  \"%s\":null", i ? "," : "", events[i]);
+  }
+  fprintf(fp, "\n},\"first_frame_ms\":");
+  if(GetFirstFrame() >= 0.0)
+    fprintf(fp, "%.3f}\n", GetFirstFrame());
+  else
+    fprintf(fp, "null}\n");
+
+  fclose(fp);
+  return true;
+}
@@ -0,0 +1,84 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _OMX_STARTUP_H_
+#define _OMX_STARTUP_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+enum OMXStartupEvent
+{
+  OMXSTARTUP_VIDEO_SUBMITTED,   // first packet handed to the video decoder
+  OMXSTARTUP_VIDEO_DECODED,     // the decoder reported the format of its first picture
+  OMXSTARTUP_VIDEO_PRESENTED,   // media time reached the first video packet
+  OMXSTARTUP_AUDIO_SUBMITTED,   // first buffer handed to the audio decoder
+  OMXSTARTUP_EVENT_COUNT,
+};
+
+#define OMXSTARTUP_PHASES 32
+
+typedef struct OMXStartupPhase
+{
+  const char  *name;
+  int         tid;
+  int64_t     start;  // ns since Start()
+  int64_t     end;
+} OMXStartupPhase;
+
+// Timeline of the startup, for --stats and --startup_log. Phases are
+// spans stamped by whichever thread runs them, so the audio and video
+// bring-up show up side by side; events keep only their first occurrence.
+//
+//   int64_t startup = COMXStartup::Begin();
+//   m_omx_reader.Open(...);
+//   COMXStartup::End("reader_open", startup);
+class COMXStartup
+{
+public:
+  // zero of the timeline, first thing in main()
+  static void    Start();
+  static int64_t Begin();
+  static void    End(const char *name, int64_t start);
+
+  // pts in DVD_TIME_BASE units, kept with the first occurrence
+  static void    Event(OMXStartupEvent event, double pts = 0.0);
+  static bool    HasEvent(OMXStartupEvent event) { return m_events[event] != 0; };
+  static double  GetEventPts(OMXStartupEvent event);
+
+  // ms from Start() to the first presented video frame, or the first
+  // audio buffer without video, negative until it happened
+  static double  GetFirstFrame();
+
+  static void    Print(FILE *fp);
+  static bool    WriteJSON(const char *filename);
+
+  static const char *EventName(int event);
+private:
+  static int64_t          m_start;
+  static volatile int64_t m_events[OMXSTARTUP_EVENT_COUNT];  // host counter, 0 until it happened
+  static double           m_pts[OMXSTARTUP_EVENT_COUNT];
+  static OMXStartupPhase  m_phases[OMXSTARTUP_PHASES];
+  static int              m_phase_count;
+  static pthread_mutex_t  m_lock;
+};
+#endif
@@ -23,27 +23,123 @@
 //#include "DVDSubtitleStream.h"
 #include "linux/PlatformDefs.h"
 #include "OMXOverlayText.h"
-#include "utils/RegExp.h"
+
+#include <string.h>
 
 #include <boost/algorithm/string.hpp>
 
 COMXSubtitleTagSami::~COMXSubtitleTagSami()
 {
-  delete m_tags;
-  delete m_tagOptions;
 }
 
 bool COMXSubtitleTagSami::Init()
 {
-  m_tags = new CRegExp(true);
-  if (!m_tags->RegComp("(<[^>]*>|\\{[^\\}]*\\})"))
-    return false;
+  return true;
+}
 
-  m_tagOptions = new CRegExp(true);
-  if (!m_tagOptions->RegComp("([a-z]+)[ \t]*=[ \t]*(?:[\"'])?([^\"'> ]+)(?:[\"'])?(?:>)?"))
-    return false;
+// Start of the first <...> or {...} at or after pos, -1 if there is none.
+// Matches what the regex (<[^>]*>|\{[^\}]*\}) found, stopping at a NUL
+int COMXSubtitleTagSami::FindTag(const std::string &line, int pos, int &length)
+{
+  const char *str = line.c_str();
+  int size = strlen(str);
+  // once an opener has no closer after it, none of the later ones has
+  bool angle = true;
+  bool brace = true;
 
-  return true;
+  for(int i = pos; i < size && (angle || brace); i++)
+  {
+    char close;
+    if(str[i] == '<' && angle)
+      close = '>';
+    else if(str[i] == '{' && brace)
+      close = '}';
+    else
+      continue;
+
+    const char *end = (const char *)memchr(str + i + 1, close, size - i - 1);
+    if(end)
+    {
+      length = end - (str + i) + 1;
+      return i;
+    }
+
+    if(close == '>')
+      angle = false;
+    else
+      brace = false;
+  }
+  return -1;
+}
+
+static bool IsNameChar(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool IsValueChar(char c)
+{
+  return c != '"' && c != '\'' && c != '>' && c != ' ';
+}
+
+// Start of the first name=value option at or after pos, -1 if there is none.
+// Follows the regex ([a-z]+)[ \t]*=[ \t]*(?:["'])?([^"'> ]+)(?:["'])?(?:>)?
+// including where it backtracks into the blanks after the =
+int COMXSubtitleTagSami::FindOption(const std::string &tag, int pos, std::string &name, std::string &value)
+{
+  int size = tag.size();
+  int i = pos;
+
+  while(i < size)
+  {
+    if(!IsNameChar(tag[i]))
+    {
+      i++;
+      continue;
+    }
+
+    // a shorter name would be followed by a letter, so only the longest can match
+    int name_end = i;
+    while(name_end < size && IsNameChar(tag[name_end]))
+      name_end++;
+
+    int p = name_end;
+    while(p < size && (tag[p] == ' ' || tag[p] == '\t'))
+      p++;
+
+    if(p < size && tag[p] == '=')
+    {
+      int blank_start = p + 1;
+      int blank_end = blank_start;
+      while(blank_end < size && (tag[blank_end] == ' ' || tag[blank_end] == '\t'))
+        blank_end++;
+
+      int value_start = -1;
+      if(blank_end < size && (tag[blank_end] == '"' || tag[blank_end] == '\'') &&
+         blank_end + 1 < size && IsValueChar(tag[blank_end + 1]))
+        value_start = blank_end + 1;
+      // giving back blanks, only a tab may start the value
+      for(int c = blank_end; value_start < 0 && c >= blank_start; c--)
+      {
+        if(c < size && IsValueChar(tag[c]))
+          value_start = c;
+      }
+
+      if(value_start >= 0)
+      {
+        int value_end = value_start;
+        while(value_end < size && IsValueChar(tag[value_end]))
+          value_end++;
+
+        name.assign(tag, i, name_end - i);
+        value.assign(tag, value_start, value_end - value_start);
+        return i;
+      }
+    }
+
+    i = name_end;
+  }
+  return -1;
 }
 
 void COMXSubtitleTagSami::ConvertLine(COMXOverlayText* pOverlay, const char* line, int len, const char* lang)
@@ -55,10 +151,13 @@ void COMXSubtitleTagSami::ConvertLine(COMXOverlayText* pOverlay, const char* lin
 
   int pos = 0;
   int del_start = 0;
-  while ((pos=m_tags->RegFind(strUTF8.c_str(), pos)) >= 0)
+  int tagLength = 0;
+  std::string tagOptionName;
+  std::string tagOptionValue;
+  while ((pos=FindTag(strUTF8, pos, tagLength)) >= 0)
   {
     // Parse Tags
-    std::string fullTag = m_tags->GetMatch(0);
+    std::string fullTag = strUTF8.substr(pos, tagLength);
     boost::algorithm::to_lower(fullTag);
     strUTF8.erase(pos, fullTag.length());
     if (fullTag == "<b>" || fullTag == "{\\b1}")
@@ -95,7 +194,6 @@ void COMXSubtitleTagSami::ConvertLine(COMXOverlayText* pOverlay, const char* lin
     {
       m_flag[FLAG_COLOR] = true;
       std::string tempColorTag = "[COLOR FF";
-      std::string tagOptionValue;
       if (fullTag.substr(0, 5) == "{\\c&h")
          tagOptionValue = fullTag.substr(5,6);
       else
@@ -110,10 +208,8 @@ void COMXSubtitleTagSami::ConvertLine(COMXOverlayText* pOverlay, const char* lin
     else if (fullTag.substr(0,5) == "<font")
     {
       int pos2 = 5;
-      while ((pos2 = m_tagOptions->RegFind(fullTag.c_str(), pos2)) >= 0)
+      while ((pos2 = FindOption(fullTag, pos2, tagOptionName, tagOptionValue)) >= 0)
       {
-        std::string tagOptionName = m_tagOptions->GetMatch(1);
-        std::string tagOptionValue = m_tagOptions->GetMatch(2);
         pos2 += tagOptionName.length() + tagOptionValue.length();
         if (tagOptionName == "color")
         {
@@ -150,10 +246,8 @@ void COMXSubtitleTagSami::ConvertLine(COMXOverlayText* pOverlay, const char* lin
     else if (lang && (fullTag.substr(0,3) == "<p "))
     {
       int pos2 = 3;
-      while ((pos2 = m_tagOptions->RegFind(fullTag.c_str(), pos2)) >= 0)
+      while ((pos2 = FindOption(fullTag, pos2, tagOptionName, tagOptionValue)) >= 0)
       {
-        std::string tagOptionName = m_tagOptions->GetMatch(1);
-        std::string tagOptionValue = m_tagOptions->GetMatch(2);
         pos2 += tagOptionName.length() + tagOptionValue.length();
         if (tagOptionName == "class")
         {
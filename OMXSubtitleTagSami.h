@@ -32,15 +32,12 @@
 
 class COMXOverlayText;
 class CDVDSubtitleStream;
-class CRegExp;
 
 class COMXSubtitleTagSami
 {
 public:
   COMXSubtitleTagSami()
   {
-    m_tags = NULL;
-    m_tagOptions = NULL;
     m_flag[FLAG_BOLD] = false;
     m_flag[FLAG_ITALIC] = false;
     m_flag[FLAG_COLOR] = false;
@@ -63,8 +60,10 @@ public:
   std::vector<SLangclass> m_Langclass;
 
 private:
-  CRegExp *m_tags;
-  CRegExp *m_tagOptions;
+  // hand written scanners for the two patterns the tags used to be matched with
+  static int FindTag(const std::string &line, int pos, int &length);
+  static int FindOption(const std::string &tag, int pos, std::string &name, std::string &value);
+
   bool m_flag[4];
 };
 
@@ -0,0 +1,203 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "OMXTimeSource.h"
+
+#include <stdarg.h>
+
+COMXVirtualTimeSource::COMXVirtualTimeSource(int64_t start)
+{
+  m_now      = start;
+  m_advances = 0;
+  m_sleeping = 0;
+  m_trace    = NULL;
+
+  pthread_mutex_init(&m_lock, NULL);
+  pthread_cond_init(&m_cond, NULL);
+}
+
+COMXVirtualTimeSource::~COMXVirtualTimeSource()
+{
+  CloseTrace();
+
+  pthread_cond_destroy(&m_cond);
+  pthread_mutex_destroy(&m_lock);
+}
+
+int64_t COMXVirtualTimeSource::Now()
+{
+  pthread_mutex_lock(&m_lock);
+  int64_t now = m_now;
+  pthread_mutex_unlock(&m_lock);
+  return now;
+}
+
+void COMXVirtualTimeSource::Sleep(int64_t ns)
+{
+  Sleeper sleeper;
+
+  pthread_mutex_lock(&m_lock);
+
+  sleeper.deadline   = m_now + (ns > 0 ? ns : 0);
+  sleeper.registered = m_threads.count(pthread_self()) != 0;
+  sleeper.awake      = false;
+
+  m_sleepers.push_back(&sleeper);
+  if(sleeper.registered)
+    m_sleeping++;
+
+  WriteTrace(Name(), "sleep %lld", (long long)(ns / 1000));
+
+  Advance();
+
+  while(!sleeper.awake)
+    pthread_cond_wait(&m_cond, &m_lock);
+
+  pthread_mutex_unlock(&m_lock);
+}
+
+/* called with m_lock held whenever a thread went to sleep or left. Moves time
+   on while every registered thread sleeps, waking one of them per step */
+void COMXVirtualTimeSource::Advance()
+{
+  bool woken = false;
+
+  while(!m_sleepers.empty() && m_sleeping == m_threads.size())
+  {
+    std::list<Sleeper *>::iterator it;
+    Sleeper *next = NULL;
+
+    for(it = m_sleepers.begin(); it != m_sleepers.end(); ++it)
+    {
+      if(!next || (*it)->deadline < next->deadline)
+        next = *it;
+    }
+
+    if(next->deadline > m_now)
+    {
+      m_now = next->deadline;
+      m_advances++;
+    }
+
+    /* everything unregistered that is due, but only the earliest registered */
+    Sleeper *first = NULL;
+    for(it = m_sleepers.begin(); it != m_sleepers.end(); ++it)
+    {
+      if((*it)->registered && (*it)->deadline <= m_now && (!first || (*it)->deadline < first->deadline))
+        first = *it;
+    }
+
+    for(it = m_sleepers.begin(); it != m_sleepers.end();)
+    {
+      Sleeper *sleeper = *it;
+
+      if(sleeper->deadline > m_now || (sleeper->registered && sleeper != first))
+      {
+        ++it;
+        continue;
+      }
+
+      if(sleeper->registered)
+        m_sleeping--;
+      sleeper->awake = true;
+      it = m_sleepers.erase(it);
+      woken = true;
+    }
+  }
+
+  if(woken)
+    pthread_cond_broadcast(&m_cond);
+}
+
+void COMXVirtualTimeSource::Register(const char *name)
+{
+  pthread_mutex_lock(&m_lock);
+  m_threads[pthread_self()] = name ? name : "";
+  pthread_mutex_unlock(&m_lock);
+}
+
+void COMXVirtualTimeSource::Unregister()
+{
+  pthread_mutex_lock(&m_lock);
+  m_threads.erase(pthread_self());
+  Advance();
+  pthread_mutex_unlock(&m_lock);
+}
+
+bool COMXVirtualTimeSource::OpenTrace(const char *filename)
+{
+  CloseTrace();
+
+  pthread_mutex_lock(&m_lock);
+  m_trace = fopen(filename, "w");
+  pthread_mutex_unlock(&m_lock);
+
+  return m_trace != NULL;
+}
+
+void COMXVirtualTimeSource::CloseTrace()
+{
+  pthread_mutex_lock(&m_lock);
+  if(m_trace)
+    fclose(m_trace);
+  m_trace = NULL;
+  pthread_mutex_unlock(&m_lock);
+}
+
+void COMXVirtualTimeSource::Trace(const char *fmt, ...)
+{
+  char line[256];
+  va_list args;
+
+  va_start(args, fmt);
+  vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+
+  pthread_mutex_lock(&m_lock);
+  WriteTrace(Name(), "%s", line);
+  pthread_mutex_unlock(&m_lock);
+}
+
+const char *COMXVirtualTimeSource::Name()
+{
+  std::map<pthread_t, std::string>::iterator it = m_threads.find(pthread_self());
+  return it != m_threads.end() ? it->second.c_str() : "-";
+}
+
+void COMXVirtualTimeSource::WriteTrace(const char *name, const char *fmt, ...)
+{
+  if(!m_trace)
+    return;
+
+  va_list args;
+
+  fprintf(m_trace, "%lld %s ", (long long)(m_now / 1000), name);
+  va_start(args, fmt);
+  vfprintf(m_trace, fmt, args);
+  va_end(args);
+  fputc('\n', m_trace);
+}
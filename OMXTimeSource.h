@@ -0,0 +1,91 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _OMX_TIMESOURCE_H_
+#define _OMX_TIMESOURCE_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <list>
+#include <map>
+#include <string>
+
+// Where OMXClock gets host time and sleeps from, in nanoseconds.
+// Without one installed OMXClock uses CLOCK_MONOTONIC and nanosleep.
+class IOMXTimeSource
+{
+public:
+  virtual ~IOMXTimeSource() {};
+  virtual int64_t Now() = 0;
+  virtual void    Sleep(int64_t ns) = 0;
+};
+
+// Simulated time for running the player threads faster than realtime.
+// Time stands still while any registered thread is running and jumps to
+// the earliest deadline once all of them sleep. Registered threads are
+// woken one at a time, earliest deadline first and in the order they went
+// to sleep for equal deadlines, so a run only depends on what the threads
+// do and not on how fast the host is. Only register threads that block in
+// Sleep(), one waiting on a condition counts as running and stops time.
+class COMXVirtualTimeSource : public IOMXTimeSource
+{
+public:
+  COMXVirtualTimeSource(int64_t start = 1000000000LL);
+  ~COMXVirtualTimeSource();
+
+  int64_t Now();
+  void    Sleep(int64_t ns);
+
+  // threads that must be asleep before time moves, the name goes in the trace.
+  // Register all of them before the first one sleeps or time runs ahead
+  void Register(const char *name);
+  void Unregister();
+
+  // one line per sleep and wake with the virtual time in us
+  bool OpenTrace(const char *filename);
+  void CloseTrace();
+  void Trace(const char *fmt, ...);
+
+  int64_t GetAdvances() { return m_advances; };
+private:
+  typedef struct Sleeper
+  {
+    int64_t   deadline;
+    bool      registered;
+    bool      awake;
+  } Sleeper;
+
+  void Advance();
+  const char *Name();
+  void WriteTrace(const char *name, const char *fmt, ...);
+
+  pthread_mutex_t                   m_lock;
+  pthread_cond_t                    m_cond;
+  int64_t                           m_now;
+  int64_t                           m_advances;
+  std::list<Sleeper *>              m_sleepers;
+  std::map<pthread_t, std::string>  m_threads;
+  unsigned int                      m_sleeping;
+  FILE                              *m_trace;
+};
+#endif
@@ -0,0 +1,144 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#if (defined HAVE_CONFIG_H) && (!defined WIN32)
+  #include "config.h"
+#elif defined(_WIN32)
+#include "system.h"
+#endif
+
+#include "OMXTimer.h"
+#include "OMXClock.h"
+#include "OMXTimeSource.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+volatile uint64_t COMXTimer::m_wakeups       = 0;
+volatile uint64_t COMXTimer::m_timer_wakeups = 0;
+volatile int64_t  COMXTimer::m_overshoot     = 0;
+volatile int64_t  COMXTimer::m_overshoot_max = 0;
+
+/* one timer per thread for waits that also watch a descriptor */
+static __thread int timer_fd = -1;
+
+static inline struct timespec ToTimespec(int64_t ns)
+{
+  struct timespec ts;
+  ts.tv_sec  = ns / 1000000000LL;
+  ts.tv_nsec = ns % 1000000000LL;
+  return ts;
+}
+
+int64_t COMXTimer::Deadline(unsigned int ms)
+{
+  return OMXClock::CurrentHostCounter() + (int64_t)ms * 1000000LL;
+}
+
+void COMXTimer::Account(int64_t deadline, bool timer)
+{
+  __sync_fetch_and_add(&m_wakeups, 1);
+  if(!timer)
+    return;
+
+  int64_t late = OMXClock::CurrentHostCounter() - deadline;
+  if(late < 0)
+    late = 0;
+
+  __sync_fetch_and_add(&m_timer_wakeups, 1);
+  __sync_fetch_and_add(&m_overshoot, late);
+
+  int64_t max = m_overshoot_max;
+  while(late > max && !__sync_bool_compare_and_swap(&m_overshoot_max, max, late))
+    max = m_overshoot_max;
+}
+
+bool COMXTimer::WaitUntil(int64_t deadline, int fd)
+{
+  IOMXTimeSource *source = OMXClock::GetTimeSource();
+  if(source)
+  {
+    source->Sleep(deadline - source->Now());
+    return false;
+  }
+
+  if(fd < 0)
+  {
+    struct timespec ts = ToTimespec(deadline);
+    while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+    Account(deadline, true);
+    return false;
+  }
+
+  if(timer_fd < 0)
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+
+  struct itimerspec its;
+  its.it_interval.tv_sec  = 0;
+  its.it_interval.tv_nsec = 0;
+  its.it_value            = ToTimespec(deadline);
+  /* a zero it_value would disarm the timer */
+  if(its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+    its.it_value.tv_nsec = 1;
+
+  if(timer_fd < 0 || timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, NULL) != 0)
+  {
+    /* no timer, fall back to a relative poll timeout */
+    int64_t left = deadline - OMXClock::CurrentHostCounter();
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int ret = poll(&pfd, 1, left > 0 ? (int)(left / 1000000) : 0);
+    Account(deadline, ret == 0);
+    return ret > 0;
+  }
+
+  struct pollfd pfd[2];
+  pfd[0].fd      = fd;
+  pfd[0].events  = POLLIN;
+  pfd[0].revents = 0;
+  pfd[1].fd      = timer_fd;
+  pfd[1].events  = POLLIN;
+  pfd[1].revents = 0;
+
+  int ret = poll(pfd, 2, -1);
+
+  bool event = ret > 0 && (pfd[0].revents & (POLLIN | POLLHUP | POLLERR));
+  bool timer = ret > 0 && (pfd[1].revents & POLLIN);
+
+  if(timer)
+  {
+    uint64_t expirations;
+    if(read(timer_fd, &expirations, sizeof(expirations)) < 0)
+      expirations = 0;
+  }
+  else
+  {
+    /* disarm so a stale expiry does not end the next wait early */
+    its.it_value.tv_sec  = 0;
+    its.it_value.tv_nsec = 0;
+    timerfd_settime(timer_fd, 0, &its, NULL);
+  }
+
+  Account(deadline, timer && !event);
+  return event;
+}
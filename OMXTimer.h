@@ -0,0 +1,51 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _OMX_TIMER_H_
+#define _OMX_TIMER_H_
+
+#include <stdint.h>
+
+// Sleeps to absolute deadlines in OMXClock host time (ns), so a loop that
+// waits for the same deadline again after a spurious wake does not drift.
+// Every wake is counted, and how late timer wakes were, for --stats.
+class COMXTimer
+{
+public:
+  // the host time ms milliseconds from now
+  static int64_t Deadline(unsigned int ms);
+  // sleep until deadline, or until fd is readable when one is given.
+  // Returns true when fd woke us, a signal also ends the wait early
+  static bool WaitUntil(int64_t deadline, int fd = -1);
+
+  static uint64_t GetWakeups()       { return m_wakeups; };
+  static uint64_t GetTimerWakeups()  { return m_timer_wakeups; };
+  static int64_t  GetOvershoot()     { return m_overshoot; };     // ns, summed over timer wakes
+  static int64_t  GetMaxOvershoot()  { return m_overshoot_max; }; // ns
+private:
+  static void Account(int64_t deadline, bool timer);
+
+  static volatile uint64_t m_wakeups;
+  static volatile uint64_t m_timer_wakeups;
+  static volatile int64_t  m_overshoot;
+  static volatile int64_t  m_overshoot_max;
+};
+#endif
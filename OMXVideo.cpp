@@ -26,6 +26,8 @@
 #endif
 
 #include "OMXVideo.h"
+#include "OMXBringUp.h"
+#include "OMXStartup.h"
 
 #include "OMXStreamInfo.h"
 #include "utils/log.h"
@@ -78,18 +80,36 @@ COMXVideo::COMXVideo()
   m_Pause             = false;
   m_setStartTime      = true;
   m_setStartTimeText  = true;
+  m_send_config       = false;
+  m_bytes_copied      = 0;
   m_extradata         = NULL;
   m_extrasize         = 0;
   m_video_codec_name  = "";
   m_deinterlace       = false;
   m_hdmi_clock_sync   = false;
   m_first_text        = true;
+  m_reconfig_state    = RECONFIG_IDLE;
+  m_reconfig_again    = false;
+  m_reconfig_exit     = false;
+  m_reconfig_running  = false;
+  m_reconfig_time     = 0;
+  m_reconfig_count    = 0;
+
+  pthread_mutex_init(&m_reconfig_lock, NULL);
+  pthread_mutex_init(&m_reconfig_busy, NULL);
+  pthread_cond_init(&m_reconfig_cond, NULL);
 }
 
 COMXVideo::~COMXVideo()
 {
   if (m_is_open)
     Close();
+
+  StopReconfig();
+
+  pthread_cond_destroy(&m_reconfig_cond);
+  pthread_mutex_destroy(&m_reconfig_busy);
+  pthread_mutex_destroy(&m_reconfig_lock);
 }
 
 bool COMXVideo::SendDecoderConfig()
@@ -159,6 +179,7 @@ bool COMXVideo::Open(COMXStreamInfo &hints, OMXClock *clock, const CRect &DestRe
   m_decoded_height = hints.height;
 
   m_hdmi_clock_sync = hdmi_clock_sync;
+  m_bytes_copied    = 0;
 
   if(!m_decoded_width || !m_decoded_height)
     return false;
@@ -287,31 +308,37 @@ bool COMXVideo::Open(COMXStreamInfo &hints, OMXClock *clock, const CRect &DestRe
     m_deinterlace = false;
   }
 
-  std::string componentName = "";
-
-  componentName = decoder_name;
-  if(!m_omx_decoder.Initialize(componentName, OMX_IndexParamVideoInit))
-    return false;
-
-  componentName = "OMX.broadcom.video_render";
-  if(!m_omx_render.Initialize(componentName, OMX_IndexParamVideoInit))
-    return false;
-
-  componentName = "OMX.broadcom.video_scheduler";
-  if(!m_omx_sched.Initialize(componentName, OMX_IndexParamVideoInit))
-    return false;
+  COMXBringUp bring_up("COMXVideo::Open");
 
+  // the components are independent until they get tunneled
+  bring_up.Run([this, decoder_name]()
+  {
+    return m_omx_decoder.Initialize(decoder_name, OMX_IndexParamVideoInit);
+  });
+  bring_up.Run([this]()
+  {
+    return m_omx_render.Initialize("OMX.broadcom.video_render", OMX_IndexParamVideoInit);
+  });
+  bring_up.Run([this]()
+  {
+    return m_omx_sched.Initialize("OMX.broadcom.video_scheduler", OMX_IndexParamVideoInit);
+  });
   if(m_deinterlace)
   {
-    componentName = "OMX.broadcom.image_fx";
-    if(!m_omx_image_fx.Initialize(componentName, OMX_IndexParamImageInit))
-      return false;
+    bring_up.Run([this]()
+    {
+      return m_omx_image_fx.Initialize("OMX.broadcom.image_fx", OMX_IndexParamImageInit);
+    });
   }
-
-  componentName = "OMX.broadcom.text_scheduler";
-  if(!m_omx_text.Initialize(componentName, OMX_IndexParamOtherInit))
+  bring_up.Run([this]()
+  {
+    return m_omx_text.Initialize("OMX.broadcom.text_scheduler", OMX_IndexParamOtherInit);
+  });
+  if(!bring_up.Join("init"))
     return false;
 
+  m_omx_decoder.SetCustomDecoderEventHandler(&COMXVideo::DecoderEventHandler, this);
+
   if(clock == NULL)
     return false;
 
@@ -338,118 +365,23 @@ bool COMXVideo::Open(COMXStreamInfo &hints, OMXClock *clock, const CRect &DestRe
   m_omx_tunnel_clock.Initialize(m_omx_clock, m_omx_clock->GetInputPort() + 1, &m_omx_sched, m_omx_sched.GetOutputPort() + 1);
   m_omx_tunnel_text.Initialize(m_omx_clock, m_omx_clock->GetInputPort() + 2, &m_omx_text, m_omx_text.GetInputPort() + 2);
 
-  omx_err = m_omx_tunnel_clock.Establish(false);
-  if(omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open m_omx_tunnel_clock.Establish\n");
-    return false;
-  }
-
-  omx_err = m_omx_decoder.SetStateForComponent(OMX_StateIdle);
-  if (omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open m_omx_decoder.SetStateForComponent\n");
-    return false;
-  }
-
-  OMX_VIDEO_PARAM_PORTFORMATTYPE formatType;
-  OMX_INIT_STRUCTURE(formatType);
-  formatType.nPortIndex = m_omx_decoder.GetInputPort();
-  formatType.eCompressionFormat = m_codingType;
-
-  if (hints.fpsscale > 0 && hints.fpsrate > 0)
-  {
-    formatType.xFramerate = (long long)(1<<16)*hints.fpsrate / hints.fpsscale;
-  }
-  else
-  {
-    formatType.xFramerate = 25 * (1<<16);
-  }
-
-  omx_err = m_omx_decoder.SetParameter(OMX_IndexParamVideoPortFormat, &formatType);
-  if(omx_err != OMX_ErrorNone)
-    return false;
-  
-  OMX_PARAM_PORTDEFINITIONTYPE portParam;
-  OMX_INIT_STRUCTURE(portParam);
-  portParam.nPortIndex = m_omx_decoder.GetInputPort();
-
-  omx_err = m_omx_decoder.GetParameter(OMX_IndexParamPortDefinition, &portParam);
-  if(omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
-    return false;
-  }
-
-  portParam.nPortIndex = m_omx_decoder.GetInputPort();
-  portParam.nBufferCountActual = fifo_size ? fifo_size * 1024 * 1024 / portParam.nBufferSize : 80;
-
-  portParam.format.video.nFrameWidth  = m_decoded_width;
-  portParam.format.video.nFrameHeight = m_decoded_height;
-
-  omx_err = m_omx_decoder.SetParameter(OMX_IndexParamPortDefinition, &portParam);
-  if(omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
-    return false;
-  }
-
-  OMX_PARAM_BRCMVIDEODECODEERRORCONCEALMENTTYPE concanParam;
-  OMX_INIT_STRUCTURE(concanParam);
-  concanParam.bStartWithValidFrame = OMX_FALSE;
-
-  omx_err = m_omx_decoder.SetParameter(OMX_IndexParamBrcmVideoDecodeErrorConcealment, &concanParam);
-  if(omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open error OMX_IndexParamBrcmVideoDecodeErrorConcealment omx_err(0x%08x)\n", omx_err);
-    return false;
-  }
-
-  if (m_deinterlace)
+  // the clock tunnel, the decoder input and the text ports only touch
+  // their own components, render is configured meanwhile
+  bring_up.Run([this]()
   {
-    // the deinterlace component requires 3 additional video buffers in addition to the DPB (this is normally 2).
-    OMX_PARAM_U32TYPE extra_buffers;
-    OMX_INIT_STRUCTURE(extra_buffers);
-    extra_buffers.nU32 = 3;
-
-    omx_err = m_omx_decoder.SetParameter(OMX_IndexParamBrcmExtraBuffers, &extra_buffers);
-    if(omx_err != OMX_ErrorNone)
-    {
-      CLog::Log(LOGERROR, "COMXVideo::Open error OMX_IndexParamBrcmExtraBuffers omx_err(0x%08x)\n", omx_err);
-      return false;
-    }
-  }
-
-  // broadcom omx entension:
-  // When enabled, the timestamp fifo mode will change the way incoming timestamps are associated with output images.
-  // In this mode the incoming timestamps get used without re-ordering on output images.
-  if(hints.ptsinvalid)
+    bool established = m_omx_tunnel_clock.Establish(false) == OMX_ErrorNone;
+    if(!established)
+      CLog::Log(LOGERROR, "COMXVideo::Open m_omx_tunnel_clock.Establish\n");
+    return established;
+  });
+  bring_up.Run([this, &hints, fifo_size]()
   {
-    OMX_CONFIG_BOOLEANTYPE timeStampMode;
-    OMX_INIT_STRUCTURE(timeStampMode);
-    timeStampMode.bEnabled = OMX_TRUE;
-    omx_err = m_omx_decoder.SetParameter((OMX_INDEXTYPE)OMX_IndexParamBrcmVideoTimestampFifo, &timeStampMode);
-    if (omx_err != OMX_ErrorNone)
-    {
-      CLog::Log(LOGERROR, "COMXVideo::Open OMX_IndexParamBrcmVideoTimestampFifo error (0%08x)\n", omx_err);
-      return false;
-    }
-  }
-
-  if(NaluFormatStartCodes(hints.codec, m_extradata, m_extrasize))
+    return SetupDecoder(hints, fifo_size);
+  });
+  bring_up.Run([this]()
   {
-    OMX_NALSTREAMFORMATTYPE nalStreamFormat;
-    OMX_INIT_STRUCTURE(nalStreamFormat);
-    nalStreamFormat.nPortIndex = m_omx_decoder.GetInputPort();
-    nalStreamFormat.eNaluFormat = OMX_NaluFormatStartCodes;
-
-    omx_err = m_omx_decoder.SetParameter((OMX_INDEXTYPE)OMX_IndexParamNalStreamFormatSelect, &nalStreamFormat);
-    if (omx_err != OMX_ErrorNone)
-    {
-      CLog::Log(LOGERROR, "COMXVideo::Open OMX_IndexParamNalStreamFormatSelect error (0%08x)\n", omx_err);
-      return false;
-    }
-  }
+    return SetupText();
+  });
 
   if(m_hdmi_clock_sync)
   {
@@ -473,70 +405,8 @@ bool COMXVideo::Open(COMXStreamInfo &hints, OMXClock *clock, const CRect &DestRe
   }
   SetVideoRect(m_src_rect, m_dst_rect);
 
-  // Alloc buffers for the omx intput port.
-  omx_err = m_omx_decoder.AllocInputBuffers();
-  if (omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open AllocOMXInputBuffers error (0%08x)\n", omx_err);
-    return false;
-  }
-
-  OMX_INIT_STRUCTURE(portParam);
-  portParam.nPortIndex = m_omx_text.GetInputPort();
-
-  omx_err = m_omx_text.GetParameter(OMX_IndexParamPortDefinition, &portParam);
-  if(omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
-    return false;
-  }
-
-  portParam.nBufferCountActual  = 100;
-  portParam.nBufferSize         = MAX_TEXT_LENGTH;
-
-  omx_err = m_omx_text.SetParameter(OMX_IndexParamPortDefinition, &portParam);
-  if(omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
-    return false;
-  }
-
-  omx_err = m_omx_text.AllocInputBuffers();
-  if (omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open AllocOMXInputBuffers\n");
-    return false;
-  }
-
-  OMX_INIT_STRUCTURE(portParam);
-  portParam.nPortIndex = m_omx_text.GetOutputPort();
-
-  omx_err = m_omx_text.GetParameter(OMX_IndexParamPortDefinition, &portParam);
-  if(omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
-    return false;
-  }
-
-  portParam.eDir = OMX_DirOutput;
-  portParam.format.other.eFormat = OMX_OTHER_FormatText;
-  portParam.format.other.eFormat = OMX_OTHER_FormatText;
-  portParam.nBufferCountActual  = 1;
-  portParam.nBufferSize         = MAX_TEXT_LENGTH;
-
-  omx_err = m_omx_text.SetParameter(OMX_IndexParamPortDefinition, &portParam);
-  if(omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
-    return false;
-  }
-
-  omx_err = m_omx_text.AllocOutputBuffers();
-  if (omx_err != OMX_ErrorNone)
-  {
-    CLog::Log(LOGERROR, "COMXVideo::Open AllocOutputBuffers\n");
+  if(!bring_up.Join("setup"))
     return false;
-  }
 
   omx_err = m_omx_tunnel_decoder.Establish(false);
   if(omx_err != OMX_ErrorNone)
@@ -633,6 +503,11 @@ bool COMXVideo::Open(COMXStreamInfo &hints, OMXClock *clock, const CRect &DestRe
     return false;
   }
 
+  bring_up.Mark("tunnels");
+
+  if(!StartReconfig())
+    return false;
+
   if(!SendDecoderConfig())
     return false;
 
@@ -640,6 +515,7 @@ bool COMXVideo::Open(COMXStreamInfo &hints, OMXClock *clock, const CRect &DestRe
   m_drop_state        = false;
   m_setStartTime      = true;
   m_setStartTimeText  = true;
+  m_send_config       = false;
 
   float fAspect = (float)hints.aspect / (float)m_decoded_width * (float)m_decoded_height; 
   float par = hints.aspect ? fAspect/display_aspect : 0.0f;
@@ -722,59 +598,255 @@ bool COMXVideo::Open(COMXStreamInfo &hints, OMXClock *clock, const CRect &DestRe
     m_deinterlace, m_hdmi_clock_sync);
 
   m_first_text    = true;
+
+  bring_up.Mark("config");
+  bring_up.Log();
+
   return true;
 }
 
-void COMXVideo::Close()
+bool COMXVideo::SetupDecoder(COMXStreamInfo &hints, float fifo_size)
 {
-  m_omx_tunnel_decoder.Flush();
-  if(m_deinterlace)
-    m_omx_tunnel_image_fx.Flush();
-  m_omx_tunnel_clock.Flush();
-  m_omx_tunnel_sched.Flush();
-  m_omx_tunnel_text.Flush();
+  OMX_ERRORTYPE omx_err   = OMX_ErrorNone;
 
-  m_omx_tunnel_clock.Deestablish();
-  m_omx_tunnel_decoder.Deestablish();
-  if(m_deinterlace)
-    m_omx_tunnel_image_fx.Deestablish();
-  m_omx_tunnel_sched.Deestablish();
-  m_omx_tunnel_text.Deestablish();
+  omx_err = m_omx_decoder.SetStateForComponent(OMX_StateIdle);
+  if (omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::SetupDecoder m_omx_decoder.SetStateForComponent\n");
+    return false;
+  }
 
-  m_omx_decoder.FlushInput();
+  OMX_VIDEO_PARAM_PORTFORMATTYPE formatType;
+  OMX_INIT_STRUCTURE(formatType);
+  formatType.nPortIndex = m_omx_decoder.GetInputPort();
+  formatType.eCompressionFormat = m_codingType;
 
-  m_omx_sched.Deinitialize();
-  if(m_deinterlace)
-    m_omx_image_fx.Deinitialize();
-  m_omx_decoder.Deinitialize();
-  m_omx_render.Deinitialize();
-  m_omx_text.Deinitialize();
+  if (hints.fpsscale > 0 && hints.fpsrate > 0)
+  {
+    formatType.xFramerate = (long long)(1<<16)*hints.fpsrate / hints.fpsscale;
+  }
+  else
+  {
+    formatType.xFramerate = 25 * (1<<16);
+  }
 
-  m_is_open       = false;
+  omx_err = m_omx_decoder.SetParameter(OMX_IndexParamVideoPortFormat, &formatType);
+  if(omx_err != OMX_ErrorNone)
+    return false;
+  
+  OMX_PARAM_PORTDEFINITIONTYPE portParam;
+  OMX_INIT_STRUCTURE(portParam);
+  portParam.nPortIndex = m_omx_decoder.GetInputPort();
 
-  if(m_extradata)
-    free(m_extradata);
-  m_extradata = NULL;
-  m_extrasize = 0;
+  omx_err = m_omx_decoder.GetParameter(OMX_IndexParamPortDefinition, &portParam);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::SetupDecoder error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
+    return false;
+  }
 
-  m_video_codec_name  = "";
-  m_deinterlace       = false;
-  m_first_text        = true;
-  m_setStartTime      = true;
-  m_setStartTimeText  = true;
-}
+  portParam.nPortIndex = m_omx_decoder.GetInputPort();
+  portParam.nBufferCountActual = fifo_size ? fifo_size * 1024 * 1024 / portParam.nBufferSize : 80;
 
-void COMXVideo::SetDropState(bool bDrop)
-{
-  m_drop_state = bDrop;
-}
+  portParam.format.video.nFrameWidth  = m_decoded_width;
+  portParam.format.video.nFrameHeight = m_decoded_height;
 
-unsigned int COMXVideo::GetFreeSpace()
-{
-  return m_omx_decoder.GetInputBufferSpace();
-}
+  omx_err = m_omx_decoder.SetParameter(OMX_IndexParamPortDefinition, &portParam);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::SetupDecoder error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
+    return false;
+  }
 
-unsigned int COMXVideo::GetSize()
+  OMX_PARAM_BRCMVIDEODECODEERRORCONCEALMENTTYPE concanParam;
+  OMX_INIT_STRUCTURE(concanParam);
+  concanParam.bStartWithValidFrame = OMX_FALSE;
+
+  omx_err = m_omx_decoder.SetParameter(OMX_IndexParamBrcmVideoDecodeErrorConcealment, &concanParam);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::SetupDecoder error OMX_IndexParamBrcmVideoDecodeErrorConcealment omx_err(0x%08x)\n", omx_err);
+    return false;
+  }
+
+  if (m_deinterlace)
+  {
+    // the deinterlace component requires 3 additional video buffers in addition to the DPB (this is normally 2).
+    OMX_PARAM_U32TYPE extra_buffers;
+    OMX_INIT_STRUCTURE(extra_buffers);
+    extra_buffers.nU32 = 3;
+
+    omx_err = m_omx_decoder.SetParameter(OMX_IndexParamBrcmExtraBuffers, &extra_buffers);
+    if(omx_err != OMX_ErrorNone)
+    {
+      CLog::Log(LOGERROR, "COMXVideo::SetupDecoder error OMX_IndexParamBrcmExtraBuffers omx_err(0x%08x)\n", omx_err);
+      return false;
+    }
+  }
+
+  // broadcom omx entension:
+  // When enabled, the timestamp fifo mode will change the way incoming timestamps are associated with output images.
+  // In this mode the incoming timestamps get used without re-ordering on output images.
+  if(hints.ptsinvalid)
+  {
+    OMX_CONFIG_BOOLEANTYPE timeStampMode;
+    OMX_INIT_STRUCTURE(timeStampMode);
+    timeStampMode.bEnabled = OMX_TRUE;
+    omx_err = m_omx_decoder.SetParameter((OMX_INDEXTYPE)OMX_IndexParamBrcmVideoTimestampFifo, &timeStampMode);
+    if (omx_err != OMX_ErrorNone)
+    {
+      CLog::Log(LOGERROR, "COMXVideo::SetupDecoder OMX_IndexParamBrcmVideoTimestampFifo error (0%08x)\n", omx_err);
+      return false;
+    }
+  }
+
+  if(NaluFormatStartCodes(hints.codec, m_extradata, m_extrasize))
+  {
+    OMX_NALSTREAMFORMATTYPE nalStreamFormat;
+    OMX_INIT_STRUCTURE(nalStreamFormat);
+    nalStreamFormat.nPortIndex = m_omx_decoder.GetInputPort();
+    nalStreamFormat.eNaluFormat = OMX_NaluFormatStartCodes;
+
+    omx_err = m_omx_decoder.SetParameter((OMX_INDEXTYPE)OMX_IndexParamNalStreamFormatSelect, &nalStreamFormat);
+    if (omx_err != OMX_ErrorNone)
+    {
+      CLog::Log(LOGERROR, "COMXVideo::SetupDecoder OMX_IndexParamNalStreamFormatSelect error (0%08x)\n", omx_err);
+      return false;
+    }
+  }
+
+  // Alloc buffers for the omx intput port.
+  omx_err = m_omx_decoder.AllocInputBuffers();
+  if (omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::SetupDecoder AllocOMXInputBuffers error (0%08x)\n", omx_err);
+    return false;
+  }
+
+  return true;
+}
+
+bool COMXVideo::SetupText()
+{
+  OMX_ERRORTYPE omx_err   = OMX_ErrorNone;
+
+  OMX_PARAM_PORTDEFINITIONTYPE portParam;
+  OMX_INIT_STRUCTURE(portParam);
+  portParam.nPortIndex = m_omx_text.GetInputPort();
+
+  omx_err = m_omx_text.GetParameter(OMX_IndexParamPortDefinition, &portParam);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::SetupText error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
+    return false;
+  }
+
+  portParam.nBufferCountActual  = 100;
+  portParam.nBufferSize         = MAX_TEXT_LENGTH;
+
+  omx_err = m_omx_text.SetParameter(OMX_IndexParamPortDefinition, &portParam);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::SetupText error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
+    return false;
+  }
+
+  omx_err = m_omx_text.AllocInputBuffers();
+  if (omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::SetupText AllocOMXInputBuffers\n");
+    return false;
+  }
+
+  OMX_INIT_STRUCTURE(portParam);
+  portParam.nPortIndex = m_omx_text.GetOutputPort();
+
+  omx_err = m_omx_text.GetParameter(OMX_IndexParamPortDefinition, &portParam);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::SetupText error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
+    return false;
+  }
+
+  portParam.eDir = OMX_DirOutput;
+  portParam.format.other.eFormat = OMX_OTHER_FormatText;
+  portParam.format.other.eFormat = OMX_OTHER_FormatText;
+  portParam.nBufferCountActual  = 1;
+  portParam.nBufferSize         = MAX_TEXT_LENGTH;
+
+  omx_err = m_omx_text.SetParameter(OMX_IndexParamPortDefinition, &portParam);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::SetupText error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
+    return false;
+  }
+
+  omx_err = m_omx_text.AllocOutputBuffers();
+  if (omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::SetupText AllocOutputBuffers\n");
+    return false;
+  }
+
+  return true;
+}
+
+void COMXVideo::Close()
+{
+  StopReconfig();
+
+  CLog::Log(LOGDEBUG, "%s::%s - %u port reconfigurations took %.2f ms\n",
+      CLASSNAME, __func__, m_reconfig_count, m_reconfig_time);
+
+  m_omx_tunnel_decoder.Flush();
+  if(m_deinterlace)
+    m_omx_tunnel_image_fx.Flush();
+  m_omx_tunnel_clock.Flush();
+  m_omx_tunnel_sched.Flush();
+  m_omx_tunnel_text.Flush();
+
+  m_omx_tunnel_clock.Deestablish();
+  m_omx_tunnel_decoder.Deestablish();
+  if(m_deinterlace)
+    m_omx_tunnel_image_fx.Deestablish();
+  m_omx_tunnel_sched.Deestablish();
+  m_omx_tunnel_text.Deestablish();
+
+  m_omx_decoder.FlushInput();
+
+  m_omx_sched.Deinitialize();
+  if(m_deinterlace)
+    m_omx_image_fx.Deinitialize();
+  m_omx_decoder.Deinitialize();
+  m_omx_render.Deinitialize();
+  m_omx_text.Deinitialize();
+
+  m_is_open       = false;
+
+  if(m_extradata)
+    free(m_extradata);
+  m_extradata = NULL;
+  m_extrasize = 0;
+
+  m_video_codec_name  = "";
+  m_deinterlace       = false;
+  m_first_text        = true;
+  m_setStartTime      = true;
+  m_setStartTimeText  = true;
+  m_send_config       = false;
+}
+
+void COMXVideo::SetDropState(bool bDrop)
+{
+  m_drop_state = bDrop;
+}
+
+unsigned int COMXVideo::GetFreeSpace()
+{
+  return m_omx_decoder.GetInputBufferSpace();
+}
+
+unsigned int COMXVideo::GetSize()
 {
   return m_omx_decoder.GetInputBufferSize();
 }
@@ -887,6 +959,51 @@ int COMXVideo::DecodeText(uint8_t *pData, int iSize, double dts, double pts)
 }
 
 int COMXVideo::Decode(uint8_t *pData, int iSize, double dts, double pts)
+{
+  return DecodeData(pData, iSize, dts, pts, NULL);
+}
+
+// A packet read into one of our input buffers by AllocPacketData() is
+// submitted in that buffer, it only leaves the header behind in pkt.
+int COMXVideo::Decode(OMXPacket *pkt, double dts, double pts)
+{
+  if(!pkt)
+    return false;
+
+  return DecodeData(pkt->data, pkt->size, dts, pts, pkt);
+}
+
+// Takes a free input buffer for the reader to demux a packet of size bytes
+// into, which saves copying it in Decode. Half of the buffers are left for
+// the copy path, the codec config and packets too large for one buffer.
+bool COMXVideo::AllocPacketData(OMXPacket *pkt, int size)
+{
+  if(!m_is_open || !pkt || size < 0)
+    return false;
+
+  if(m_omx_decoder.GetInputBufferSpace() * 2 <= m_omx_decoder.GetInputBufferSize())
+    return false;
+
+  OMX_BUFFERHEADERTYPE *omx_buffer = m_omx_decoder.PollInputBuffer();
+  if(!omx_buffer)
+    return false;
+
+  if((unsigned int)size + FF_INPUT_BUFFER_PADDING_SIZE > omx_buffer->nAllocLen)
+  {
+    m_omx_decoder.ReturnInputBuffer(omx_buffer);
+    return false;
+  }
+
+  memset(omx_buffer->pBuffer + size, 0, FF_INPUT_BUFFER_PADDING_SIZE);
+  pkt->data       = omx_buffer->pBuffer;
+  pkt->size       = size;
+  pkt->omx_buffer = omx_buffer;
+  pkt->omx_owner  = &m_omx_decoder;
+
+  return true;
+}
+
+int COMXVideo::DecodeData(uint8_t *pData, int iSize, double dts, double pts, OMXPacket *pkt)
 {
   OMX_ERRORTYPE omx_err;
 
@@ -895,10 +1012,29 @@ int COMXVideo::Decode(uint8_t *pData, int iSize, double dts, double pts)
     unsigned int demuxer_bytes = (unsigned int)iSize;
     uint8_t *demuxer_content = pData;
 
+    // the decoder input was flushed by Reset, hand it the codec config again
+    if(m_send_config)
+    {
+      m_send_config = false;
+      if(!SendDecoderConfig())
+        return false;
+    }
+
     while(demuxer_bytes)
     {
-      // 500ms timeout
-      OMX_BUFFERHEADERTYPE *omx_buffer = m_omx_decoder.GetInputBuffer(500);
+      OMX_BUFFERHEADERTYPE *omx_buffer = NULL;
+      if(pkt && pkt->omx_buffer && pkt->omx_owner == &m_omx_decoder)
+      {
+        // the payload already is in this buffer, it goes to the decoder as is
+        omx_buffer      = pkt->omx_buffer;
+        pkt->omx_buffer = NULL;
+        pkt->data       = NULL;
+      }
+      else
+      {
+        // 500ms timeout
+        omx_buffer = m_omx_decoder.GetInputBuffer(500);
+      }
       if(omx_buffer == NULL)
       {
         CLog::Log(LOGERROR, "OMXVideo::Decode timeout\n");
@@ -932,7 +1068,11 @@ int COMXVideo::Decode(uint8_t *pData, int iSize, double dts, double pts)
       omx_buffer->nTimeStamp = ToOMXTime(val);
 
       omx_buffer->nFilledLen = (demuxer_bytes > omx_buffer->nAllocLen) ? omx_buffer->nAllocLen : demuxer_bytes;
-      memcpy(omx_buffer->pBuffer, demuxer_content, omx_buffer->nFilledLen);
+      if(omx_buffer->pBuffer != demuxer_content)
+      {
+        memcpy(omx_buffer->pBuffer, demuxer_content, omx_buffer->nFilledLen);
+        m_bytes_copied += omx_buffer->nFilledLen;
+      }
 
       demuxer_bytes -= omx_buffer->nFilledLen;
       demuxer_content += omx_buffer->nFilledLen;
@@ -946,6 +1086,7 @@ int COMXVideo::Decode(uint8_t *pData, int iSize, double dts, double pts)
         omx_err = m_omx_decoder.EmptyThisBuffer(omx_buffer);
         if (omx_err == OMX_ErrorNone)
         {
+          COMXStartup::Event(OMXSTARTUP_VIDEO_SUBMITTED, (double)val);
           break;
         }
         else
@@ -957,78 +1098,10 @@ int COMXVideo::Decode(uint8_t *pData, int iSize, double dts, double pts)
         {
           CLog::Log(LOGERROR, "%s::%s - OMX_EmptyThisBuffer() finaly failed\n", CLASSNAME, __func__);
           printf("%s::%s - OMX_EmptyThisBuffer() finaly failed\n", CLASSNAME, __func__);
+          m_omx_decoder.ReturnInputBuffer(omx_buffer);
           return false;
         }
       }
-
-      omx_err = m_omx_decoder.WaitForEvent(OMX_EventPortSettingsChanged, 0);
-      if (omx_err == OMX_ErrorNone)
-      {
-        OMX_PARAM_PORTDEFINITIONTYPE port_image;
-        OMX_INIT_STRUCTURE(port_image);
-        port_image.nPortIndex = m_omx_decoder.GetOutputPort();
-        omx_err = m_omx_decoder.GetParameter(OMX_IndexParamPortDefinition, &port_image);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "%s::%s - error m_omx_decoder.GetParameter(OMX_IndexParamPortDefinition) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
-        }
-        // reset scaling rectangle
-        SetVideoRect(m_src_rect, m_dst_rect);
-
-        m_omx_decoder.DisablePort(m_omx_decoder.GetOutputPort(), true);
-        m_omx_sched.DisablePort(m_omx_sched.GetInputPort(), true);
-
-        OMX_CONFIG_INTERLACETYPE interlace;
-        OMX_INIT_STRUCTURE(interlace);
-        interlace.nPortIndex = m_omx_decoder.GetOutputPort();
-        omx_err = m_omx_decoder.GetConfig(OMX_IndexConfigCommonInterlace, &interlace);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "%s::%s - error m_omx_decoder.GetConfig(OMX_IndexConfigCommonInterlace) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
-        }
-
-        if (m_deinterlace)
-        {
-          m_omx_image_fx.DisablePort(m_omx_image_fx.GetInputPort(), true);
-          port_image.nPortIndex = m_omx_image_fx.GetInputPort();
-          omx_err = m_omx_image_fx.SetParameter(OMX_IndexParamPortDefinition, &port_image);
-          if(omx_err != OMX_ErrorNone)
-          {
-            CLog::Log(LOGERROR, "%s::%s - error m_omx_image_fx.SetParameter(OMX_IndexParamPortDefinition) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
-          }
-          omx_err = m_omx_decoder.WaitForEvent(OMX_EventPortSettingsChanged);
-          if(omx_err != OMX_ErrorNone)
-          {
-             CLog::Log(LOGERROR, "%s::%s - error m_omx_decoder.WaitForEvent(OMX_EventPortSettingsChanged) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
-          }
-          port_image.nPortIndex = m_omx_image_fx.GetOutputPort();
-          omx_err = m_omx_image_fx.GetParameter(OMX_IndexParamPortDefinition, &port_image);
-          if(omx_err != OMX_ErrorNone)
-          {
-            CLog::Log(LOGERROR, "%s::%s - error m_omx_image_fx.GetParameter(OMX_IndexParamPortDefinition) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
-          }
-          m_omx_image_fx.EnablePort(m_omx_image_fx.GetInputPort(), true);
-
-          m_omx_image_fx.DisablePort(m_omx_image_fx.GetOutputPort(), true);
-        }
-        port_image.nPortIndex = m_omx_sched.GetInputPort();
-        omx_err = m_omx_sched.SetParameter(OMX_IndexParamPortDefinition, &port_image);
-        if(omx_err != OMX_ErrorNone)
-        {
-          CLog::Log(LOGERROR, "%s::%s - error m_omx_sched.SetParameter(OMX_IndexParamPortDefinition) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
-        }
-        omx_err = m_omx_sched.WaitForEvent(OMX_EventPortSettingsChanged);
-        if(omx_err != OMX_ErrorNone)
-        {
-           CLog::Log(LOGERROR, "%s::%s - error m_omx_sched.WaitForEvent(OMX_EventPortSettingsChanged) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
-        }
-        if (m_deinterlace)
-        {
-          m_omx_image_fx.EnablePort(m_omx_image_fx.GetOutputPort(), true);
-        }
-        m_omx_decoder.EnablePort(m_omx_decoder.GetOutputPort(), true);
-        m_omx_sched.EnablePort(m_omx_sched.GetInputPort(), true);
-      }
     }
 
     return true;
@@ -1038,15 +1111,247 @@ int COMXVideo::Decode(uint8_t *pData, int iSize, double dts, double pts)
   return false;
 }
 
+// Flush the whole pipeline while leaving the components in Executing, so a
+// seek does not need to tear down and rebuild the tunnels.
 void COMXVideo::Reset(void)
 {
+  if(!m_is_open)
+    return;
+
+  // don't flush the tunnels while their ports are being reconfigured
+  pthread_mutex_lock(&m_reconfig_busy);
   m_omx_text.FlushAll();
   m_omx_tunnel_text.Flush();
   m_omx_decoder.FlushInput();
   m_omx_tunnel_decoder.Flush();
+  if(m_deinterlace)
+    m_omx_tunnel_image_fx.Flush();
+  m_omx_tunnel_sched.Flush();
+  pthread_mutex_unlock(&m_reconfig_busy);
+
+  m_setStartTime      = true;
+  m_setStartTimeText  = true;
+  m_send_config       = (m_extrasize > 0 && m_extradata != NULL);
+}
+
+// Gives the decoder input port the number of buffers for fifo_size MB. Only
+// right after Reset() with every input buffer back, so nothing is queued in
+// the port. Returns false when the buffers are still out, the caller tries
+// again on its next flush.
+bool COMXVideo::ResizeInputFifo(float fifo_size)
+{
+  if(!m_is_open || fifo_size <= 0.0f)
+    return false;
+
+  OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+  OMX_PARAM_PORTDEFINITIONTYPE portParam;
+  OMX_INIT_STRUCTURE(portParam);
+  portParam.nPortIndex = m_omx_decoder.GetInputPort();
+
+  omx_err = m_omx_decoder.GetParameter(OMX_IndexParamPortDefinition, &portParam);
+  if(omx_err != OMX_ErrorNone || !portParam.nBufferSize)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::ResizeInputFifo error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
+    return false;
+  }
+
+  unsigned int count = fifo_size * 1024 * 1024 / portParam.nBufferSize;
+  if(count < portParam.nBufferCountMin)
+    count = portParam.nBufferCountMin;
+  if(count == portParam.nBufferCountActual)
+    return true;
+
+  if(m_omx_decoder.GetInputBufferSpace() != m_omx_decoder.GetInputBufferSize())
+    return false;
+
+  CLog::Log(LOGDEBUG, "COMXVideo::ResizeInputFifo %lu -> %u buffers of %lu\n",
+            portParam.nBufferCountActual, count, portParam.nBufferSize);
+
+  omx_err = m_omx_decoder.FreeInputBuffers(true);
+  if(omx_err != OMX_ErrorNone)
+    CLog::Log(LOGERROR, "COMXVideo::ResizeInputFifo FreeInputBuffers error (0%08x)\n", omx_err);
+
+  portParam.nBufferCountActual = count;
+  omx_err = m_omx_decoder.SetParameter(OMX_IndexParamPortDefinition, &portParam);
+  if(omx_err != OMX_ErrorNone)
+    CLog::Log(LOGERROR, "COMXVideo::ResizeInputFifo error OMX_IndexParamPortDefinition omx_err(0x%08x)\n", omx_err);
+
+  // with the old count if the new one was refused
+  omx_err = m_omx_decoder.AllocInputBuffers();
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "COMXVideo::ResizeInputFifo AllocOMXInputBuffers error (0%08x)\n", omx_err);
+    return false;
+  }
+
+  return true;
+}
+
+// Port settings changes are handled off the decode thread. The IL callback
+// thread only flags them, the reconfiguration thread does the blocking work
+// while Decode keeps feeding the decoder input port.
+OMX_ERRORTYPE COMXVideo::DecoderEventHandler(OMX_HANDLETYPE hComponent, OMX_PTR pAppData,
+  OMX_EVENTTYPE eEvent, OMX_U32 nData1, OMX_U32 nData2, OMX_PTR pEventData)
+{
+  COMXVideo *ctx = static_cast<COMXVideo*>(pAppData);
+
+  if(!ctx || eEvent != OMX_EventPortSettingsChanged || nData1 != ctx->m_omx_decoder.GetOutputPort())
+    return OMX_ErrorNone;
+
+  pthread_mutex_lock(&ctx->m_reconfig_lock);
+  if(ctx->m_reconfig_state == RECONFIG_RUNNING)
+    ctx->m_reconfig_again = true;
+  else
+    ctx->m_reconfig_state = RECONFIG_PENDING;
+  pthread_cond_broadcast(&ctx->m_reconfig_cond);
+  pthread_mutex_unlock(&ctx->m_reconfig_lock);
+
+  return OMX_ErrorNone;
+}
+
+void *COMXVideo::ReconfigThread(void *arg)
+{
+  COMXVideo *ctx = static_cast<COMXVideo*>(arg);
+
+  pthread_mutex_lock(&ctx->m_reconfig_lock);
+  while(true)
+  {
+    while(ctx->m_reconfig_state != RECONFIG_PENDING && !ctx->m_reconfig_exit)
+      pthread_cond_wait(&ctx->m_reconfig_cond, &ctx->m_reconfig_lock);
+
+    if(ctx->m_reconfig_exit)
+      break;
+
+    ctx->m_reconfig_state = RECONFIG_RUNNING;
+    ctx->m_reconfig_again = false;
+    pthread_mutex_unlock(&ctx->m_reconfig_lock);
+
+    int64_t start = OMXClock::CurrentHostCounter();
+    pthread_mutex_lock(&ctx->m_reconfig_busy);
+    ctx->PortSettingsChanged();
+    pthread_mutex_unlock(&ctx->m_reconfig_busy);
+    COMXStartup::Event(OMXSTARTUP_VIDEO_DECODED);
+    double elapsed = (double)(OMXClock::CurrentHostCounter() - start) * 1000.0 / OMXClock::CurrentHostFrequency();
+
+    pthread_mutex_lock(&ctx->m_reconfig_lock);
+    ctx->m_reconfig_time += elapsed;
+    ctx->m_reconfig_count++;
+    ctx->m_reconfig_state = ctx->m_reconfig_again ? RECONFIG_PENDING : RECONFIG_IDLE;
+
+    CLog::Log(LOGDEBUG, "%s::%s - port reconfiguration %u took %.2f ms\n", CLASSNAME, __func__, ctx->m_reconfig_count, elapsed);
+  }
+  pthread_mutex_unlock(&ctx->m_reconfig_lock);
+
+  return NULL;
+}
+
+bool COMXVideo::StartReconfig()
+{
+  if(m_reconfig_running)
+    return true;
+
+  m_reconfig_exit   = false;
+  m_reconfig_time   = 0;
+  m_reconfig_count  = 0;
+
+  if(pthread_create(&m_reconfig_thread, NULL, &COMXVideo::ReconfigThread, this) != 0)
+  {
+    CLog::Log(LOGERROR, "%s::%s - failed to create reconfiguration thread\n", CLASSNAME, __func__);
+    return false;
+  }
+
+  m_reconfig_running = true;
+  return true;
+}
 
-  //m_setStartTime      = true;
-  //m_setStartTimeText  = true;
+void COMXVideo::StopReconfig()
+{
+  if(!m_reconfig_running)
+    return;
+
+  pthread_mutex_lock(&m_reconfig_lock);
+  m_reconfig_exit = true;
+  pthread_cond_broadcast(&m_reconfig_cond);
+  pthread_mutex_unlock(&m_reconfig_lock);
+
+  pthread_join(m_reconfig_thread, NULL);
+
+  m_reconfig_running  = false;
+  m_reconfig_state    = RECONFIG_IDLE;
+  m_reconfig_again    = false;
+}
+
+void COMXVideo::PortSettingsChanged()
+{
+  OMX_ERRORTYPE omx_err;
+
+  // the handler got us here, drop the event queued on the decoder as well
+  m_omx_decoder.WaitForEvent(OMX_EventPortSettingsChanged, 0);
+
+  OMX_PARAM_PORTDEFINITIONTYPE port_image;
+  OMX_INIT_STRUCTURE(port_image);
+  port_image.nPortIndex = m_omx_decoder.GetOutputPort();
+  omx_err = m_omx_decoder.GetParameter(OMX_IndexParamPortDefinition, &port_image);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "%s::%s - error m_omx_decoder.GetParameter(OMX_IndexParamPortDefinition) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
+  }
+  // reset scaling rectangle
+  SetVideoRect(m_src_rect, m_dst_rect);
+
+  m_omx_decoder.DisablePort(m_omx_decoder.GetOutputPort(), true);
+  m_omx_sched.DisablePort(m_omx_sched.GetInputPort(), true);
+
+  OMX_CONFIG_INTERLACETYPE interlace;
+  OMX_INIT_STRUCTURE(interlace);
+  interlace.nPortIndex = m_omx_decoder.GetOutputPort();
+  omx_err = m_omx_decoder.GetConfig(OMX_IndexConfigCommonInterlace, &interlace);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "%s::%s - error m_omx_decoder.GetConfig(OMX_IndexConfigCommonInterlace) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
+  }
+
+  if (m_deinterlace)
+  {
+    m_omx_image_fx.DisablePort(m_omx_image_fx.GetInputPort(), true);
+    port_image.nPortIndex = m_omx_image_fx.GetInputPort();
+    omx_err = m_omx_image_fx.SetParameter(OMX_IndexParamPortDefinition, &port_image);
+    if(omx_err != OMX_ErrorNone)
+    {
+      CLog::Log(LOGERROR, "%s::%s - error m_omx_image_fx.SetParameter(OMX_IndexParamPortDefinition) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
+    }
+    omx_err = m_omx_image_fx.WaitForEvent(OMX_EventPortSettingsChanged);
+    if(omx_err != OMX_ErrorNone)
+    {
+       CLog::Log(LOGERROR, "%s::%s - error m_omx_image_fx.WaitForEvent(OMX_EventPortSettingsChanged) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
+    }
+    port_image.nPortIndex = m_omx_image_fx.GetOutputPort();
+    omx_err = m_omx_image_fx.GetParameter(OMX_IndexParamPortDefinition, &port_image);
+    if(omx_err != OMX_ErrorNone)
+    {
+      CLog::Log(LOGERROR, "%s::%s - error m_omx_image_fx.GetParameter(OMX_IndexParamPortDefinition) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
+    }
+    m_omx_image_fx.EnablePort(m_omx_image_fx.GetInputPort(), true);
+
+    m_omx_image_fx.DisablePort(m_omx_image_fx.GetOutputPort(), true);
+  }
+  port_image.nPortIndex = m_omx_sched.GetInputPort();
+  omx_err = m_omx_sched.SetParameter(OMX_IndexParamPortDefinition, &port_image);
+  if(omx_err != OMX_ErrorNone)
+  {
+    CLog::Log(LOGERROR, "%s::%s - error m_omx_sched.SetParameter(OMX_IndexParamPortDefinition) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
+  }
+  omx_err = m_omx_sched.WaitForEvent(OMX_EventPortSettingsChanged);
+  if(omx_err != OMX_ErrorNone)
+  {
+     CLog::Log(LOGERROR, "%s::%s - error m_omx_sched.WaitForEvent(OMX_EventPortSettingsChanged) omx_err(0x%08x)\n", CLASSNAME, __func__, omx_err);
+  }
+  if (m_deinterlace)
+  {
+    m_omx_image_fx.EnablePort(m_omx_image_fx.GetOutputPort(), true);
+  }
+  m_omx_decoder.EnablePort(m_omx_decoder.GetOutputPort(), true);
+  m_omx_sched.EnablePort(m_omx_sched.GetInputPort(), true);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////
@@ -53,6 +53,9 @@ public:
   OMXPacket *GetText();
   int  DecodeText(uint8_t *pData, int iSize, double dts, double pts);
   int  Decode(uint8_t *pData, int iSize, double dts, double pts);
+  int  Decode(OMXPacket *pkt, double dts, double pts);
+  bool AllocPacketData(OMXPacket *pkt, int size);
+  bool ResizeInputFifo(float fifo_size);
   void Reset(void);
   void SetDropState(bool bDrop);
   bool Pause();
@@ -61,7 +64,29 @@ public:
   void SetVideoRect(const CRect& SrcRect, const CRect& DestRect);
   int GetInputBufferSize();
   void WaitCompletion();
+  unsigned int GetBytesCopied() { return m_bytes_copied; };
+  unsigned int GetReconfigCount() { return m_reconfig_count; };
+  double GetReconfigTime() { return m_reconfig_time; };
 protected:
+  int  DecodeData(uint8_t *pData, int iSize, double dts, double pts, OMXPacket *pkt);
+  // steps of Open() that run next to each other
+  bool SetupDecoder(COMXStreamInfo &hints, float fifo_size);
+  bool SetupText();
+
+  static OMX_ERRORTYPE DecoderEventHandler(OMX_HANDLETYPE hComponent, OMX_PTR pAppData,
+    OMX_EVENTTYPE eEvent, OMX_U32 nData1, OMX_U32 nData2, OMX_PTR pEventData);
+  static void *ReconfigThread(void *arg);
+  bool StartReconfig();
+  void StopReconfig();
+  void PortSettingsChanged();
+
+  enum ReconfigState
+  {
+    RECONFIG_IDLE,
+    RECONFIG_PENDING,
+    RECONFIG_RUNNING
+  };
+
   // Video format
   bool              m_drop_state;
   unsigned int      m_decoded_width;
@@ -87,6 +112,8 @@ protected:
   bool              m_Pause;
   bool              m_setStartTime;
   bool              m_setStartTimeText;
+  bool              m_send_config;
+  unsigned int      m_bytes_copied;
 
   uint8_t           *m_extradata;
   int               m_extrasize;
@@ -98,6 +125,18 @@ protected:
   bool              m_first_text;
   CRect             m_dst_rect;
   CRect             m_src_rect;
+
+  // port settings changed reconfiguration
+  pthread_t         m_reconfig_thread;
+  pthread_mutex_t   m_reconfig_lock;
+  pthread_mutex_t   m_reconfig_busy;
+  pthread_cond_t    m_reconfig_cond;
+  ReconfigState     m_reconfig_state;
+  bool              m_reconfig_again;
+  bool              m_reconfig_exit;
+  bool              m_reconfig_running;
+  double            m_reconfig_time;  // ms
+  unsigned int      m_reconfig_count;
 };
 
 #endif
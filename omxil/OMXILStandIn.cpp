@@ -0,0 +1,1377 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include "OMXILStandIn.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+// internal command, sends PortSettingsChanged for the port in param
+#define OMXIL_COMMAND_SETTINGS  0x7F000001
+
+// how long the clock waits for the ports in its mask once the first one
+// reported a start time. Ports nothing is sent to never report
+#define OMXIL_START_TIMEOUT     100000
+
+#define OMXIL_INIT_STRUCTURE(a) \
+  memset(&(a), 0, sizeof(a)); \
+  (a).nSize = sizeof(a); \
+  (a).nVersion.s.nVersionMajor = OMX_VERSION_MAJOR; \
+  (a).nVersion.s.nVersionMinor = OMX_VERSION_MINOR; \
+  (a).nVersion.s.nRevision = OMX_VERSION_REVISION; \
+  (a).nVersion.s.nStep = OMX_VERSION_STEP
+
+static inline int64_t FromTicks(OMX_TICKS ticks)
+{
+#ifdef OMX_SKIP64BIT
+  return (int64_t)(((uint64_t)ticks.nHighPart << 32) | ticks.nLowPart);
+#else
+  return ticks;
+#endif
+}
+
+static inline OMX_TICKS ToTicks(int64_t value)
+{
+#ifdef OMX_SKIP64BIT
+  OMX_TICKS ticks;
+  ticks.nLowPart  = (OMX_U32)value;
+  ticks.nHighPart = (OMX_U32)((uint64_t)value >> 32);
+  return ticks;
+#else
+  return value;
+#endif
+}
+
+COMXILComponent::COMXILComponent(const std::string &name, OMXILKind kind)
+{
+  m_name              = name;
+  m_kind              = kind;
+  m_app               = NULL;
+  m_state             = OMX_StateLoaded;
+  m_latency           = 0;
+  m_busy_until        = 0;
+  m_settings_on_data  = false;
+  m_settings_sent     = false;
+  m_running           = false;
+  m_exit              = false;
+
+  m_clock_state       = OMX_TIME_ClockStateStopped;
+  m_media_base        = 0;
+  m_host_base         = 0;
+  m_scale             = 1 << 16;
+  m_wait_mask         = 0;
+  m_reported          = 0;
+  m_start_time        = 0;
+  m_first_report      = 0;
+
+  memset(&m_callbacks, 0, sizeof(m_callbacks));
+  OMXIL_INIT_STRUCTURE(m_pcm);
+
+  memset(&m_handle, 0, sizeof(m_handle));
+  m_handle.nSize              = sizeof(m_handle);
+  m_handle.nVersion.nVersion  = 0;
+  m_handle.nVersion.s.nVersionMajor = OMX_VERSION_MAJOR;
+  m_handle.nVersion.s.nVersionMinor = OMX_VERSION_MINOR;
+  m_handle.pComponentPrivate  = this;
+
+  pthread_mutex_init(&m_lock, NULL);
+
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&m_cond, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+COMXILComponent::~COMXILComponent()
+{
+  pthread_mutex_lock(&m_lock);
+  m_exit = true;
+  pthread_cond_broadcast(&m_cond);
+  pthread_mutex_unlock(&m_lock);
+
+  if(m_running)
+    pthread_join(m_thread, NULL);
+
+  std::map<OMX_U32, OMXILPort>::iterator it;
+  for(it = m_ports.begin(); it != m_ports.end(); ++it)
+  {
+    for(size_t i = 0; i < it->second.buffers.size(); i++)
+    {
+      OMX_BUFFERHEADERTYPE *header = it->second.buffers[i];
+      if(header->pPlatformPrivate)
+        free(header->pBuffer);
+      delete header;
+    }
+  }
+
+  pthread_cond_destroy(&m_cond);
+  pthread_mutex_destroy(&m_lock);
+}
+
+void COMXILComponent::AddPort(OMX_U32 index, OMX_DIRTYPE dir, OMX_PORTDOMAINTYPE domain, OMX_U32 count, OMX_U32 size, bool clock)
+{
+  OMXILPort &port = m_ports[index];
+
+  OMXIL_INIT_STRUCTURE(port.def);
+  port.def.nPortIndex         = index;
+  port.def.eDir               = dir;
+  port.def.eDomain            = domain;
+  port.def.nBufferCountActual = count;
+  port.def.nBufferCountMin    = count;
+  port.def.nBufferSize        = size;
+  port.def.nBufferAlignment   = 16;
+  port.def.bEnabled           = OMX_TRUE;
+  port.def.bPopulated         = OMX_FALSE;
+  port.peer                   = NULL;
+  port.peer_port              = 0;
+  port.clock                  = clock;
+}
+
+void COMXILComponent::SetBufferCount(OMX_U32 count)
+{
+  OMXILPort *port = DataPort(OMX_DirInput);
+  if(!port || !count)
+    return;
+
+  port->def.nBufferCountActual  = count;
+  port->def.nBufferCountMin     = count;
+}
+
+bool COMXILComponent::Start()
+{
+  if(pthread_create(&m_thread, NULL, &COMXILComponent::Run, this) != 0)
+    return false;
+
+  m_running = true;
+  return true;
+}
+
+COMXILComponent *COMXILComponent::FromHandle(OMX_HANDLETYPE handle)
+{
+  return handle ? (COMXILComponent *)((OMX_COMPONENTTYPE *)handle)->pComponentPrivate : NULL;
+}
+
+int64_t COMXILComponent::Now()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+OMXILPort *COMXILComponent::FindPort(OMX_U32 index)
+{
+  std::map<OMX_U32, OMXILPort>::iterator it = m_ports.find(index);
+  return it == m_ports.end() ? NULL : &it->second;
+}
+
+OMXILPort *COMXILComponent::DataPort(OMX_DIRTYPE dir)
+{
+  std::map<OMX_U32, OMXILPort>::iterator it;
+  for(it = m_ports.begin(); it != m_ports.end(); ++it)
+  {
+    if(it->second.def.eDir == dir && !it->second.clock)
+      return &it->second;
+  }
+  return NULL;
+}
+
+OMXILPort *COMXILComponent::ClockPort()
+{
+  std::map<OMX_U32, OMXILPort>::iterator it;
+  for(it = m_ports.begin(); it != m_ports.end(); ++it)
+  {
+    if(it->second.clock)
+      return &it->second;
+  }
+  return NULL;
+}
+
+// callbacks run without the lock held, the app calls straight back in from them
+void COMXILComponent::Event(OMX_EVENTTYPE event, OMX_U32 data1, OMX_U32 data2)
+{
+  if(!m_callbacks.EventHandler)
+    return;
+
+  pthread_mutex_unlock(&m_lock);
+  m_callbacks.EventHandler(&m_handle, m_app, event, data1, data2, NULL);
+  pthread_mutex_lock(&m_lock);
+}
+
+void COMXILComponent::EmptyDone(OMX_BUFFERHEADERTYPE *header)
+{
+  if(!m_callbacks.EmptyBufferDone)
+    return;
+
+  pthread_mutex_unlock(&m_lock);
+  m_callbacks.EmptyBufferDone(&m_handle, m_app, header);
+  pthread_mutex_lock(&m_lock);
+}
+
+void COMXILComponent::FillDone(OMX_BUFFERHEADERTYPE *header)
+{
+  if(!m_callbacks.FillBufferDone)
+    return;
+
+  pthread_mutex_unlock(&m_lock);
+  m_callbacks.FillBufferDone(&m_handle, m_app, header);
+  pthread_mutex_lock(&m_lock);
+}
+
+void COMXILComponent::ReturnBuffers(OMXILPort &port)
+{
+  std::deque<OMXILFrame> queue;
+  queue.swap(port.queue);
+
+  if(&port == DataPort(OMX_DirInput))
+    m_busy_until = 0;
+
+  while(!queue.empty())
+  {
+    OMX_BUFFERHEADERTYPE *header = queue.front().header;
+    queue.pop_front();
+
+    if(!header)
+      continue;
+
+    header->nFilledLen = 0;
+    if(port.def.eDir == OMX_DirInput)
+      EmptyDone(header);
+    else
+      FillDone(header);
+  }
+}
+
+OMX_ERRORTYPE COMXILComponent::SendCommand(OMX_COMMANDTYPE cmd, OMX_U32 param)
+{
+  OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+
+  pthread_mutex_lock(&m_lock);
+
+  switch(cmd)
+  {
+    case OMX_CommandStateSet:
+      if(param < OMX_StateLoaded || param > OMX_StateWaitForResources)
+        omx_err = OMX_ErrorBadParameter;
+      break;
+    case OMX_CommandFlush:
+    case OMX_CommandPortDisable:
+    case OMX_CommandPortEnable:
+      if(param != OMX_ALL && !FindPort(param))
+        omx_err = OMX_ErrorBadPortIndex;
+      break;
+    default:
+      omx_err = OMX_ErrorNotImplemented;
+      break;
+  }
+
+  if(omx_err == OMX_ErrorNone)
+  {
+    OMXILCommand command = { (OMX_U32)cmd, param };
+    m_commands.push_back(command);
+    pthread_cond_broadcast(&m_cond);
+  }
+
+  pthread_mutex_unlock(&m_lock);
+
+  return omx_err;
+}
+
+void COMXILComponent::Execute(const OMXILCommand &command)
+{
+  if(command.cmd == OMXIL_COMMAND_SETTINGS)
+  {
+    Event(OMX_EventPortSettingsChanged, command.param, 0);
+    return;
+  }
+
+  if(command.cmd == OMX_CommandStateSet)
+  {
+    OMX_STATETYPE state = (OMX_STATETYPE)command.param;
+
+    if(state == m_state)
+    {
+      Event(OMX_EventError, (OMX_U32)OMX_ErrorSameState, 0);
+      return;
+    }
+
+    if(state == OMX_StateIdle || state == OMX_StateLoaded)
+    {
+      std::map<OMX_U32, OMXILPort>::iterator it;
+      for(it = m_ports.begin(); it != m_ports.end(); ++it)
+        ReturnBuffers(it->second);
+    }
+
+    if(state == OMX_StateLoaded)
+      m_settings_sent = false;
+
+    m_state = state;
+    pthread_cond_broadcast(&m_cond);
+    Event(OMX_EventCmdComplete, OMX_CommandStateSet, state);
+    return;
+  }
+
+  std::vector<OMX_U32> ports;
+  if(command.param == OMX_ALL)
+  {
+    std::map<OMX_U32, OMXILPort>::iterator it;
+    for(it = m_ports.begin(); it != m_ports.end(); ++it)
+      ports.push_back(it->first);
+  }
+  else
+  {
+    ports.push_back(command.param);
+  }
+
+  for(size_t i = 0; i < ports.size(); i++)
+  {
+    OMXILPort *port = FindPort(ports[i]);
+    if(!port)
+      continue;
+
+    if(command.cmd == OMX_CommandPortEnable)
+    {
+      port->def.bEnabled = OMX_TRUE;
+    }
+    else
+    {
+      if(command.cmd == OMX_CommandPortDisable)
+        port->def.bEnabled = OMX_FALSE;
+      ReturnBuffers(*port);
+    }
+
+    Event(OMX_EventCmdComplete, command.cmd, ports[i]);
+  }
+}
+
+// moves the frame at the head of the input on, false when it has to wait.
+// wait is set when something other than a command or new buffer ends the wait
+bool COMXILComponent::Step(int64_t &wait)
+{
+  if(m_state != OMX_StateExecuting)
+    return false;
+
+  OMXILPort *in   = DataPort(OMX_DirInput);
+  OMXILPort *out  = DataPort(OMX_DirOutput);
+
+  if(!in || in->queue.empty())
+    return false;
+
+  OMXILFrame &frame = in->queue.front();
+
+  if(m_settings_on_data && out && !m_settings_sent)
+  {
+    m_settings_sent = true;
+    Event(OMX_EventPortSettingsChanged, out->def.nPortIndex, 0);
+    return true;
+  }
+
+  // the app reconfigures the output after a settings change
+  if(out && !out->def.bEnabled)
+    return false;
+
+  OMXILPort *clock_port = ClockPort();
+  if(clock_port && clock_port->peer && clock_port->def.bEnabled && !(frame.flags & OMX_BUFFERFLAG_TIME_UNKNOWN))
+  {
+    if(frame.flags & OMX_BUFFERFLAG_STARTTIME)
+    {
+      frame.flags &= ~OMX_BUFFERFLAG_STARTTIME;
+      COMXILComponent *clock  = clock_port->peer;
+      OMX_U32 clock_peer      = clock_port->peer_port;
+      int64_t timestamp       = frame.timestamp;
+
+      pthread_mutex_unlock(&m_lock);
+      clock->ReportStart(clock_peer, timestamp);
+      pthread_mutex_lock(&m_lock);
+      return true;
+    }
+
+    bool running;
+    int scale;
+    int64_t media = clock_port->peer->MediaTime(&running, &scale);
+
+    if(!running || scale <= 0)
+    {
+      wait = 10000;
+      return false;
+    }
+    if(frame.timestamp > media)
+    {
+      wait = std::min((frame.timestamp - media) * 65536 / scale, (int64_t)10000);
+      return false;
+    }
+  }
+
+  int64_t now = Now();
+  if(m_latency > 0)
+  {
+    if(!m_busy_until)
+      m_busy_until = now + m_latency;
+    if(now < m_busy_until)
+    {
+      wait = m_busy_until - now;
+      return false;
+    }
+  }
+
+  OMXILFrame done = frame;
+
+  if(out)
+  {
+    if(out->peer)
+    {
+      OMXILFrame next = done;
+      next.header = NULL;
+
+      COMXILComponent *peer = out->peer;
+      OMX_U32 peer_port     = out->peer_port;
+
+      pthread_mutex_unlock(&m_lock);
+      bool delivered = peer->Deliver(peer_port, next);
+      pthread_mutex_lock(&m_lock);
+
+      if(!delivered)
+      {
+        wait = 2000;
+        return false;
+      }
+    }
+    else
+    {
+      // wait for FillThisBuffer
+      if(out->queue.empty())
+        return false;
+
+      OMX_BUFFERHEADERTYPE *fill = out->queue.front().header;
+      out->queue.pop_front();
+
+      fill->nOffset     = 0;
+      fill->nFilledLen  = std::min(done.length, fill->nAllocLen);
+      fill->nFlags      = done.flags;
+      fill->nTimeStamp  = ToTicks(done.timestamp);
+
+      in->queue.pop_front();
+      m_busy_until = 0;
+
+      FillDone(fill);
+      if(done.header)
+        EmptyDone(done.header);
+      return true;
+    }
+  }
+
+  // a flush while the lock was dropped may have taken the frame already
+  if(in->queue.empty() || in->queue.front().header != done.header)
+    return true;
+
+  in->queue.pop_front();
+  m_busy_until = 0;
+
+  if(done.header)
+  {
+    done.header->nFilledLen = 0;
+    EmptyDone(done.header);
+  }
+
+  if(!out && (done.flags & OMX_BUFFERFLAG_EOS))
+    Event(OMX_EventBufferFlag, in->def.nPortIndex, done.flags);
+
+  return true;
+}
+
+void *COMXILComponent::Run(void *arg)
+{
+  ((COMXILComponent *)arg)->Process();
+  return NULL;
+}
+
+void COMXILComponent::Process()
+{
+  pthread_mutex_lock(&m_lock);
+
+  while(!m_exit)
+  {
+    if(!m_commands.empty())
+    {
+      OMXILCommand command = m_commands.front();
+      m_commands.pop_front();
+      Execute(command);
+      continue;
+    }
+
+    int64_t wait = 0;
+    if(Step(wait))
+      continue;
+
+    if(wait > 0)
+    {
+      int64_t deadline = Now() + wait;
+      struct timespec ts;
+      ts.tv_sec   = deadline / 1000000LL;
+      ts.tv_nsec  = (deadline % 1000000LL) * 1000;
+      pthread_cond_timedwait(&m_cond, &m_lock, &ts);
+    }
+    else
+    {
+      pthread_cond_wait(&m_cond, &m_lock);
+    }
+  }
+
+  pthread_mutex_unlock(&m_lock);
+}
+
+bool COMXILComponent::Deliver(OMX_U32 index, const OMXILFrame &frame)
+{
+  pthread_mutex_lock(&m_lock);
+
+  OMXILPort *port = FindPort(index);
+  if(!port || !port->def.bEnabled || port->queue.size() >= port->def.nBufferCountActual)
+  {
+    pthread_mutex_unlock(&m_lock);
+    return false;
+  }
+
+  port->queue.push_back(frame);
+  pthread_cond_broadcast(&m_cond);
+
+  pthread_mutex_unlock(&m_lock);
+  return true;
+}
+
+OMX_ERRORTYPE COMXILComponent::EmptyThisBuffer(OMX_BUFFERHEADERTYPE *header)
+{
+  if(!header)
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&m_lock);
+
+  OMXILPort *port = FindPort(header->nInputPortIndex);
+  if(!port || port->def.eDir != OMX_DirInput)
+  {
+    pthread_mutex_unlock(&m_lock);
+    return OMX_ErrorBadPortIndex;
+  }
+  if(!port->def.bEnabled)
+  {
+    pthread_mutex_unlock(&m_lock);
+    return OMX_ErrorIncorrectStateOperation;
+  }
+
+  OMXILFrame frame = { header, header->nFlags, FromTicks(header->nTimeStamp), header->nFilledLen };
+  port->queue.push_back(frame);
+  pthread_cond_broadcast(&m_cond);
+
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE COMXILComponent::FillThisBuffer(OMX_BUFFERHEADERTYPE *header)
+{
+  if(!header)
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&m_lock);
+
+  OMXILPort *port = FindPort(header->nOutputPortIndex);
+  if(!port || port->def.eDir != OMX_DirOutput)
+  {
+    pthread_mutex_unlock(&m_lock);
+    return OMX_ErrorBadPortIndex;
+  }
+  if(!port->def.bEnabled)
+  {
+    pthread_mutex_unlock(&m_lock);
+    return OMX_ErrorIncorrectStateOperation;
+  }
+
+  OMXILFrame frame = { header, 0, 0, 0 };
+  port->queue.push_back(frame);
+  pthread_cond_broadcast(&m_cond);
+
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE COMXILComponent::UseBuffer(OMX_BUFFERHEADERTYPE **header, OMX_U32 index, OMX_PTR app, OMX_U32 size, OMX_U8 *data)
+{
+  if(!header)
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&m_lock);
+
+  OMXILPort *port = FindPort(index);
+  if(!port)
+  {
+    pthread_mutex_unlock(&m_lock);
+    return OMX_ErrorBadPortIndex;
+  }
+
+  OMX_BUFFERHEADERTYPE *buffer = new OMX_BUFFERHEADERTYPE;
+  OMXIL_INIT_STRUCTURE(*buffer);
+
+  // pPlatformPrivate marks memory allocated here
+  if(data)
+  {
+    buffer->pBuffer = data;
+  }
+  else
+  {
+    buffer->pBuffer           = (OMX_U8 *)malloc(size ? size : 1);
+    buffer->pPlatformPrivate  = buffer->pBuffer;
+  }
+
+  buffer->nAllocLen     = size;
+  buffer->pAppPrivate   = app;
+  if(port->def.eDir == OMX_DirInput)
+    buffer->nInputPortIndex   = index;
+  else
+    buffer->nOutputPortIndex  = index;
+
+  port->buffers.push_back(buffer);
+  port->def.bPopulated = port->buffers.size() >= port->def.nBufferCountActual ? OMX_TRUE : OMX_FALSE;
+
+  *header = buffer;
+
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE COMXILComponent::FreeBuffer(OMX_U32 index, OMX_BUFFERHEADERTYPE *header)
+{
+  pthread_mutex_lock(&m_lock);
+
+  OMXILPort *port = FindPort(index);
+  if(!port)
+  {
+    pthread_mutex_unlock(&m_lock);
+    return OMX_ErrorBadPortIndex;
+  }
+
+  std::vector<OMX_BUFFERHEADERTYPE *>::iterator it = std::find(port->buffers.begin(), port->buffers.end(), header);
+  if(it == port->buffers.end())
+  {
+    pthread_mutex_unlock(&m_lock);
+    return OMX_ErrorBadParameter;
+  }
+  port->buffers.erase(it);
+  port->def.bPopulated = OMX_FALSE;
+
+  // a buffer still queued would be handed back after it is gone
+  std::deque<OMXILFrame>::iterator frame = port->queue.begin();
+  while(frame != port->queue.end())
+  {
+    if(frame->header == header)
+      frame = port->queue.erase(frame);
+    else
+      ++frame;
+  }
+
+  if(header->pPlatformPrivate)
+    free(header->pBuffer);
+  delete header;
+
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE COMXILComponent::GetState(OMX_STATETYPE *state)
+{
+  if(!state)
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&m_lock);
+  *state = m_state;
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE COMXILComponent::SetCallbacks(OMX_CALLBACKTYPE *callbacks, OMX_PTR app)
+{
+  if(!callbacks)
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&m_lock);
+  m_callbacks = *callbacks;
+  m_app       = app;
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE COMXILComponent::SetTunnel(OMX_U32 index, COMXILComponent *peer, OMX_U32 peer_port)
+{
+  pthread_mutex_lock(&m_lock);
+
+  OMXILPort *port = FindPort(index);
+  if(!port)
+  {
+    pthread_mutex_unlock(&m_lock);
+    return OMX_ErrorBadPortIndex;
+  }
+
+  port->peer      = peer;
+  port->peer_port = peer ? peer_port : 0;
+
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+// the port a structure is for sits after nSize and nVersion in all of them
+static std::pair<OMX_U32, OMX_U32> StoreKey(OMX_INDEXTYPE index, OMX_PTR data)
+{
+  OMX_U32 *words = (OMX_U32 *)data;
+  return std::make_pair((OMX_U32)index, words[0] >= 3 * sizeof(OMX_U32) ? words[2] : 0);
+}
+
+OMX_ERRORTYPE COMXILComponent::GetParameter(OMX_INDEXTYPE index, OMX_PTR data)
+{
+  if(!data)
+    return OMX_ErrorBadParameter;
+
+  OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+
+  pthread_mutex_lock(&m_lock);
+
+  switch((int)index)
+  {
+    case OMX_IndexParamAudioInit:
+    case OMX_IndexParamImageInit:
+    case OMX_IndexParamVideoInit:
+    case OMX_IndexParamOtherInit:
+    {
+      OMX_PORTDOMAINTYPE domain = OMX_PortDomainOther;
+      if(index == OMX_IndexParamAudioInit)
+        domain = OMX_PortDomainAudio;
+      else if(index == OMX_IndexParamImageInit)
+        domain = OMX_PortDomainImage;
+      else if(index == OMX_IndexParamVideoInit)
+        domain = OMX_PortDomainVideo;
+
+      OMX_PORT_PARAM_TYPE *ports = (OMX_PORT_PARAM_TYPE *)data;
+      ports->nPorts           = 0;
+      ports->nStartPortNumber = 0;
+
+      std::map<OMX_U32, OMXILPort>::iterator it;
+      for(it = m_ports.begin(); it != m_ports.end(); ++it)
+      {
+        if(it->second.def.eDomain != domain)
+          continue;
+        if(!ports->nPorts)
+          ports->nStartPortNumber = it->first;
+        ports->nPorts++;
+      }
+      break;
+    }
+    case OMX_IndexParamPortDefinition:
+    {
+      OMX_PARAM_PORTDEFINITIONTYPE *def = (OMX_PARAM_PORTDEFINITIONTYPE *)data;
+      OMXILPort *port = FindPort(def->nPortIndex);
+      if(!port)
+      {
+        omx_err = OMX_ErrorBadPortIndex;
+        break;
+      }
+      *def = port->def;
+      break;
+    }
+    default:
+    {
+      std::map<std::pair<OMX_U32, OMX_U32>, std::vector<uint8_t> >::iterator it = m_store.find(StoreKey(index, data));
+      if(it != m_store.end())
+        memcpy(data, &it->second[0], std::min((size_t)*(OMX_U32 *)data, it->second.size()));
+      break;
+    }
+  }
+
+  pthread_mutex_unlock(&m_lock);
+  return omx_err;
+}
+
+OMX_ERRORTYPE COMXILComponent::SetParameter(OMX_INDEXTYPE index, OMX_PTR data)
+{
+  if(!data)
+    return OMX_ErrorBadParameter;
+
+  OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+
+  pthread_mutex_lock(&m_lock);
+
+  switch((int)index)
+  {
+    case OMX_IndexParamPortDefinition:
+    {
+      OMX_PARAM_PORTDEFINITIONTYPE *def = (OMX_PARAM_PORTDEFINITIONTYPE *)data;
+      OMXILPort *port = FindPort(def->nPortIndex);
+      if(!port)
+      {
+        omx_err = OMX_ErrorBadPortIndex;
+        break;
+      }
+      // a tunneled port keeps at least its own depth, the definition
+      // usually comes from the other end of the tunnel
+      if(port->peer)
+      {
+        port->def.nBufferCountActual = std::max(def->nBufferCountActual, port->def.nBufferCountMin);
+      }
+      else if(def->nBufferCountActual < port->def.nBufferCountMin)
+      {
+        omx_err = OMX_ErrorBadParameter;
+        break;
+      }
+      else
+      {
+        port->def.nBufferCountActual = def->nBufferCountActual;
+      }
+      if(def->nBufferSize)
+        port->def.nBufferSize = def->nBufferSize;
+      port->def.format = def->format;
+
+      // the output follows the new input format and says so
+      OMXILPort *out = DataPort(OMX_DirOutput);
+      if(m_kind == OMXIL_FILTER && port->def.eDir == OMX_DirInput && !port->clock && out)
+      {
+        out->def.format = def->format;
+        OMXILCommand command = { OMXIL_COMMAND_SETTINGS, out->def.nPortIndex };
+        m_commands.push_back(command);
+        pthread_cond_broadcast(&m_cond);
+      }
+      break;
+    }
+    default:
+    {
+      if((int)index == OMX_IndexParamAudioPcm)
+        memcpy(&m_pcm, data, std::min((size_t)*(OMX_U32 *)data, sizeof(m_pcm)));
+
+      std::vector<uint8_t> &value = m_store[StoreKey(index, data)];
+      value.assign((uint8_t *)data, (uint8_t *)data + *(OMX_U32 *)data);
+      break;
+    }
+  }
+
+  pthread_mutex_unlock(&m_lock);
+  return omx_err;
+}
+
+int64_t COMXILComponent::CurrentMedia(int64_t now)
+{
+  if(m_clock_state == OMX_TIME_ClockStateWaitingForStartTime && m_reported &&
+     now - m_first_report >= OMXIL_START_TIMEOUT)
+  {
+    m_clock_state = OMX_TIME_ClockStateRunning;
+    m_media_base  = m_start_time;
+    m_host_base   = now;
+  }
+
+  if(m_clock_state != OMX_TIME_ClockStateRunning)
+    return m_media_base;
+
+  return m_media_base + (now - m_host_base) * m_scale / 65536;
+}
+
+int64_t COMXILComponent::MediaTime(bool *running, int *scale)
+{
+  pthread_mutex_lock(&m_lock);
+
+  int64_t media = CurrentMedia(Now());
+  if(running)
+    *running = m_clock_state == OMX_TIME_ClockStateRunning;
+  if(scale)
+    *scale = m_scale;
+
+  pthread_mutex_unlock(&m_lock);
+  return media;
+}
+
+void COMXILComponent::ReportStart(OMX_U32 port, int64_t timestamp)
+{
+  pthread_mutex_lock(&m_lock);
+
+  if(m_clock_state == OMX_TIME_ClockStateWaitingForStartTime && !m_ports.empty())
+  {
+    OMX_U32 bit = 1 << (port - m_ports.begin()->first);
+
+    if(!m_reported)
+    {
+      m_start_time    = timestamp;
+      m_first_report  = Now();
+    }
+    else if(timestamp < m_start_time)
+    {
+      m_start_time    = timestamp;
+    }
+
+    m_reported |= bit;
+
+    // start at the earliest start time once every port in the mask reported
+    if((m_reported & m_wait_mask) == m_wait_mask)
+    {
+      m_clock_state = OMX_TIME_ClockStateRunning;
+      m_media_base  = m_start_time;
+      m_host_base   = Now();
+    }
+  }
+
+  pthread_mutex_unlock(&m_lock);
+}
+
+OMX_ERRORTYPE COMXILComponent::GetConfig(OMX_INDEXTYPE index, OMX_PTR data)
+{
+  if(!data)
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&m_lock);
+
+  int64_t now = Now();
+  bool handled = true;
+
+  if(m_kind == OMXIL_CLOCK && index == OMX_IndexConfigTimeClockState)
+  {
+    OMX_TIME_CONFIG_CLOCKSTATETYPE *clock = (OMX_TIME_CONFIG_CLOCKSTATETYPE *)data;
+    CurrentMedia(now);
+    clock->eState     = m_clock_state;
+    clock->nStartTime = ToTicks(m_start_time);
+    clock->nWaitMask  = m_wait_mask;
+  }
+  else if(m_kind == OMXIL_CLOCK && index == OMX_IndexConfigTimeCurrentMediaTime)
+  {
+    ((OMX_TIME_CONFIG_TIMESTAMPTYPE *)data)->nTimestamp = ToTicks(CurrentMedia(now));
+  }
+  else if(m_kind == OMXIL_CLOCK && index == OMX_IndexConfigTimeCurrentWallTime)
+  {
+    ((OMX_TIME_CONFIG_TIMESTAMPTYPE *)data)->nTimestamp = ToTicks(now);
+  }
+  else if(m_kind == OMXIL_CLOCK && index == OMX_IndexConfigTimeScale)
+  {
+    ((OMX_TIME_CONFIG_SCALETYPE *)data)->xScale = m_scale;
+  }
+  else if((int)index == OMX_IndexConfigAudioRenderingLatency)
+  {
+    // samples queued on the input
+    OMXILPort *in = DataPort(OMX_DirInput);
+    OMX_U32 bytes = 0;
+    if(in)
+    {
+      for(size_t i = 0; i < in->queue.size(); i++)
+        bytes += in->queue[i].length;
+    }
+    OMX_U32 frame_bytes = m_pcm.nChannels * m_pcm.nBitPerSample / 8;
+    ((OMX_PARAM_U32TYPE *)data)->nU32 = frame_bytes ? bytes / frame_bytes : 0;
+  }
+  else
+  {
+    handled = false;
+  }
+
+  if(!handled)
+  {
+    std::map<std::pair<OMX_U32, OMX_U32>, std::vector<uint8_t> >::iterator it = m_store.find(StoreKey(index, data));
+    if(it != m_store.end())
+      memcpy(data, &it->second[0], std::min((size_t)*(OMX_U32 *)data, it->second.size()));
+  }
+
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE COMXILComponent::SetConfig(OMX_INDEXTYPE index, OMX_PTR data)
+{
+  if(!data)
+    return OMX_ErrorBadParameter;
+
+  pthread_mutex_lock(&m_lock);
+
+  int64_t now = Now();
+
+  if(m_kind == OMXIL_CLOCK && index == OMX_IndexConfigTimeClockState)
+  {
+    OMX_TIME_CONFIG_CLOCKSTATETYPE *clock = (OMX_TIME_CONFIG_CLOCKSTATETYPE *)data;
+
+    m_media_base = CurrentMedia(now);
+    m_host_base  = now;
+
+    switch(clock->eState)
+    {
+      case OMX_TIME_ClockStateRunning:
+        m_media_base  = FromTicks(clock->nStartTime);
+        break;
+      case OMX_TIME_ClockStateWaitingForStartTime:
+        m_wait_mask   = clock->nWaitMask;
+        m_reported    = 0;
+        break;
+      default:
+        break;
+    }
+    m_clock_state = clock->eState;
+  }
+  else if(m_kind == OMXIL_CLOCK && index == OMX_IndexConfigTimeScale)
+  {
+    m_media_base  = CurrentMedia(now);
+    m_host_base   = now;
+    m_scale       = ((OMX_TIME_CONFIG_SCALETYPE *)data)->xScale;
+  }
+  else
+  {
+    std::vector<uint8_t> &value = m_store[StoreKey(index, data)];
+    value.assign((uint8_t *)data, (uint8_t *)data + *(OMX_U32 *)data);
+  }
+
+  pthread_mutex_unlock(&m_lock);
+  return OMX_ErrorNone;
+}
+
+/* OMX_COMPONENTTYPE entry points */
+
+static OMX_ERRORTYPE ILGetComponentVersion(OMX_HANDLETYPE handle, OMX_STRING name, OMX_VERSIONTYPE *component_version,
+                                           OMX_VERSIONTYPE *spec_version, OMX_UUIDTYPE *uuid)
+{
+  COMXILComponent *component = COMXILComponent::FromHandle(handle);
+  if(!component)
+    return OMX_ErrorInvalidComponent;
+
+  if(name)
+    strncpy(name, component->GetName().c_str(), OMX_MAX_STRINGNAME_SIZE - 1);
+  if(component_version)
+    component_version->nVersion = 0;
+  if(spec_version)
+  {
+    spec_version->s.nVersionMajor = OMX_VERSION_MAJOR;
+    spec_version->s.nVersionMinor = OMX_VERSION_MINOR;
+    spec_version->s.nRevision     = OMX_VERSION_REVISION;
+    spec_version->s.nStep         = OMX_VERSION_STEP;
+  }
+  if(uuid)
+    memset(uuid, 0, sizeof(*uuid));
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE ILSendCommand(OMX_HANDLETYPE handle, OMX_COMMANDTYPE cmd, OMX_U32 param, OMX_PTR data)
+{
+  return COMXILComponent::FromHandle(handle)->SendCommand(cmd, param);
+}
+
+static OMX_ERRORTYPE ILGetParameter(OMX_HANDLETYPE handle, OMX_INDEXTYPE index, OMX_PTR data)
+{
+  return COMXILComponent::FromHandle(handle)->GetParameter(index, data);
+}
+
+static OMX_ERRORTYPE ILSetParameter(OMX_HANDLETYPE handle, OMX_INDEXTYPE index, OMX_PTR data)
+{
+  return COMXILComponent::FromHandle(handle)->SetParameter(index, data);
+}
+
+static OMX_ERRORTYPE ILGetConfig(OMX_HANDLETYPE handle, OMX_INDEXTYPE index, OMX_PTR data)
+{
+  return COMXILComponent::FromHandle(handle)->GetConfig(index, data);
+}
+
+static OMX_ERRORTYPE ILSetConfig(OMX_HANDLETYPE handle, OMX_INDEXTYPE index, OMX_PTR data)
+{
+  return COMXILComponent::FromHandle(handle)->SetConfig(index, data);
+}
+
+static OMX_ERRORTYPE ILGetExtensionIndex(OMX_HANDLETYPE handle, OMX_STRING name, OMX_INDEXTYPE *index)
+{
+  return OMX_ErrorUnsupportedIndex;
+}
+
+static OMX_ERRORTYPE ILGetState(OMX_HANDLETYPE handle, OMX_STATETYPE *state)
+{
+  return COMXILComponent::FromHandle(handle)->GetState(state);
+}
+
+static OMX_ERRORTYPE ILComponentTunnelRequest(OMX_HANDLETYPE handle, OMX_U32 port, OMX_HANDLETYPE peer,
+                                              OMX_U32 peer_port, OMX_TUNNELSETUPTYPE *setup)
+{
+  // OMX_SetupTunnel connects both ends itself
+  return OMX_ErrorNotImplemented;
+}
+
+static OMX_ERRORTYPE ILUseBuffer(OMX_HANDLETYPE handle, OMX_BUFFERHEADERTYPE **header, OMX_U32 port,
+                                 OMX_PTR app, OMX_U32 size, OMX_U8 *data)
+{
+  if(!data)
+    return OMX_ErrorBadParameter;
+  return COMXILComponent::FromHandle(handle)->UseBuffer(header, port, app, size, data);
+}
+
+static OMX_ERRORTYPE ILAllocateBuffer(OMX_HANDLETYPE handle, OMX_BUFFERHEADERTYPE **header, OMX_U32 port,
+                                      OMX_PTR app, OMX_U32 size)
+{
+  return COMXILComponent::FromHandle(handle)->UseBuffer(header, port, app, size, NULL);
+}
+
+static OMX_ERRORTYPE ILFreeBuffer(OMX_HANDLETYPE handle, OMX_U32 port, OMX_BUFFERHEADERTYPE *header)
+{
+  return COMXILComponent::FromHandle(handle)->FreeBuffer(port, header);
+}
+
+static OMX_ERRORTYPE ILEmptyThisBuffer(OMX_HANDLETYPE handle, OMX_BUFFERHEADERTYPE *header)
+{
+  return COMXILComponent::FromHandle(handle)->EmptyThisBuffer(header);
+}
+
+static OMX_ERRORTYPE ILFillThisBuffer(OMX_HANDLETYPE handle, OMX_BUFFERHEADERTYPE *header)
+{
+  return COMXILComponent::FromHandle(handle)->FillThisBuffer(header);
+}
+
+static OMX_ERRORTYPE ILSetCallbacks(OMX_HANDLETYPE handle, OMX_CALLBACKTYPE *callbacks, OMX_PTR app)
+{
+  return COMXILComponent::FromHandle(handle)->SetCallbacks(callbacks, app);
+}
+
+static OMX_ERRORTYPE ILComponentDeInit(OMX_HANDLETYPE handle)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE ILUseEGLImage(OMX_HANDLETYPE handle, OMX_BUFFERHEADERTYPE **header, OMX_U32 port,
+                                   OMX_PTR app, void *image)
+{
+  // there is no GPU to render into
+  return OMX_ErrorNotImplemented;
+}
+
+static OMX_ERRORTYPE ILComponentRoleEnum(OMX_HANDLETYPE handle, OMX_U8 *role, OMX_U32 index)
+{
+  return OMX_ErrorNoMore;
+}
+
+/* component table */
+
+typedef struct OMXILPortInfo
+{
+  OMX_U32             index;
+  OMX_DIRTYPE         dir;
+  OMX_PORTDOMAINTYPE  domain;
+  OMX_U32             count;
+  OMX_U32             size;
+  bool                clock;
+} OMXILPortInfo;
+
+typedef struct OMXILComponentInfo
+{
+  const char          *name;
+  OMXILKind           kind;
+  bool                settings_on_data;
+  OMXILPortInfo       ports[7];   // up to the first with a count of 0
+} OMXILComponentInfo;
+
+static const OMXILComponentInfo components[] =
+{
+  { "OMX.broadcom.video_decode", OMXIL_DECODER, true,
+    { { 130, OMX_DirInput,  OMX_PortDomainVideo, 20, 81920,   false },
+      { 131, OMX_DirOutput, OMX_PortDomainVideo, 1,  3133440, false } } },
+  { "OMX.broadcom.audio_decode", OMXIL_DECODER, false,
+    { { 120, OMX_DirInput,  OMX_PortDomainAudio, 16, 16384,   false },
+      { 121, OMX_DirOutput, OMX_PortDomainAudio, 16, 16384,   false } } },
+  { "OMX.broadcom.audio_mixer", OMXIL_FILTER, false,
+    { { 230, OMX_DirOutput, OMX_PortDomainAudio, 4,  8192,    false },
+      { 231, OMX_DirInput,  OMX_PortDomainAudio, 4,  8192,    false },
+      { 232, OMX_DirInput,  OMX_PortDomainOther, 1,  0,       true  } } },
+  { "OMX.broadcom.audio_render", OMXIL_SINK, false,
+    { { 100, OMX_DirInput,  OMX_PortDomainAudio, 16, 2048,    false },
+      { 101, OMX_DirInput,  OMX_PortDomainOther, 1,  0,       true  } } },
+  { "OMX.broadcom.video_scheduler", OMXIL_FILTER, false,
+    { { 10,  OMX_DirInput,  OMX_PortDomainVideo, 4,  0,       false },
+      { 11,  OMX_DirOutput, OMX_PortDomainVideo, 1,  0,       false },
+      { 12,  OMX_DirInput,  OMX_PortDomainOther, 1,  0,       true  } } },
+  { "OMX.broadcom.video_render", OMXIL_SINK, false,
+    { { 90,  OMX_DirInput,  OMX_PortDomainVideo, 4,  0,       false } } },
+  { "OMX.broadcom.image_fx", OMXIL_FILTER, false,
+    { { 190, OMX_DirInput,  OMX_PortDomainImage, 4,  0,       false },
+      { 191, OMX_DirOutput, OMX_PortDomainImage, 1,  0,       false } } },
+  { "OMX.broadcom.text_scheduler", OMXIL_FILTER, false,
+    { { 150, OMX_DirInput,  OMX_PortDomainOther, 4,  4096,    false },
+      { 151, OMX_DirOutput, OMX_PortDomainOther, 4,  4096,    false },
+      { 152, OMX_DirInput,  OMX_PortDomainOther, 1,  0,       true  } } },
+  { "OMX.broadcom.clock", OMXIL_CLOCK, false,
+    { { 80,  OMX_DirOutput, OMX_PortDomainOther, 1,  0,       false },
+      { 81,  OMX_DirOutput, OMX_PortDomainOther, 1,  0,       false },
+      { 82,  OMX_DirOutput, OMX_PortDomainOther, 1,  0,       false },
+      { 83,  OMX_DirOutput, OMX_PortDomainOther, 1,  0,       false },
+      { 84,  OMX_DirOutput, OMX_PortDomainOther, 1,  0,       false },
+      { 85,  OMX_DirOutput, OMX_PortDomainOther, 1,  0,       false } } },
+};
+
+#define OMXIL_COMPONENTS (sizeof(components) / sizeof(components[0]))
+
+// value for the component in a "video_decode=4000,audio_render=1000" list
+static int64_t ConfigValue(const char *env, const char *component, int64_t value)
+{
+  const char *list = getenv(env);
+  if(!list)
+    return value;
+
+  const char *name = component;
+  if(!strncmp(name, "OMX.broadcom.", 13))
+    name += 13;
+
+  size_t len = strlen(name);
+  const char *p = list;
+  while(*p)
+  {
+    if(!strncmp(p, name, len) && p[len] == '=')
+      return strtoll(p + len + 1, NULL, 0);
+
+    p = strchr(p, ',');
+    if(!p)
+      break;
+    p++;
+  }
+  return value;
+}
+
+/* core entry points */
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_Init(void)
+{
+  return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_Deinit(void)
+{
+  return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_ComponentNameEnum(OMX_STRING name, OMX_U32 length, OMX_U32 index)
+{
+  if(!name)
+    return OMX_ErrorBadParameter;
+  if(index >= OMXIL_COMPONENTS)
+    return OMX_ErrorNoMore;
+
+  strncpy(name, components[index].name, length);
+  if(length)
+    name[length - 1] = '\0';
+  return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_GetHandle(OMX_HANDLETYPE *handle, OMX_STRING name,
+                                                 OMX_PTR app, OMX_CALLBACKTYPE *callbacks)
+{
+  if(!handle || !name)
+    return OMX_ErrorBadParameter;
+
+  const OMXILComponentInfo *info = NULL;
+  for(size_t i = 0; i < OMXIL_COMPONENTS; i++)
+  {
+    if(!strcmp(components[i].name, name))
+      info = &components[i];
+  }
+  if(!info)
+  {
+    fprintf(stderr, "OMX_GetHandle - no stand-in for %s\n", name);
+    return OMX_ErrorComponentNotFound;
+  }
+
+  COMXILComponent *component = new COMXILComponent(info->name, info->kind);
+
+  for(int i = 0; i < 7 && info->ports[i].count; i++)
+  {
+    const OMXILPortInfo &port = info->ports[i];
+    component->AddPort(port.index, port.dir, port.domain, port.count, port.size, port.clock);
+  }
+
+  component->SetSettingsOnData(info->settings_on_data);
+  component->SetLatency(ConfigValue("OMXIL_LATENCY", info->name, 0));
+  component->SetBufferCount(ConfigValue("OMXIL_BUFFERS", info->name, 0));
+  if(callbacks)
+    component->SetCallbacks(callbacks, app);
+
+  OMX_COMPONENTTYPE *type = component->GetHandle();
+  type->GetComponentVersion     = ILGetComponentVersion;
+  type->SendCommand             = ILSendCommand;
+  type->GetParameter            = ILGetParameter;
+  type->SetParameter            = ILSetParameter;
+  type->GetConfig               = ILGetConfig;
+  type->SetConfig               = ILSetConfig;
+  type->GetExtensionIndex       = ILGetExtensionIndex;
+  type->GetState                = ILGetState;
+  type->ComponentTunnelRequest  = ILComponentTunnelRequest;
+  type->UseBuffer               = ILUseBuffer;
+  type->AllocateBuffer          = ILAllocateBuffer;
+  type->FreeBuffer              = ILFreeBuffer;
+  type->EmptyThisBuffer         = ILEmptyThisBuffer;
+  type->FillThisBuffer          = ILFillThisBuffer;
+  type->SetCallbacks            = ILSetCallbacks;
+  type->ComponentDeInit         = ILComponentDeInit;
+  type->UseEGLImage             = ILUseEGLImage;
+  type->ComponentRoleEnum       = ILComponentRoleEnum;
+
+  if(!component->Start())
+  {
+    delete component;
+    return OMX_ErrorInsufficientResources;
+  }
+
+  *handle = type;
+  return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_FreeHandle(OMX_HANDLETYPE handle)
+{
+  COMXILComponent *component = COMXILComponent::FromHandle(handle);
+  if(!component)
+    return OMX_ErrorBadParameter;
+
+  delete component;
+  return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_SetupTunnel(OMX_HANDLETYPE output, OMX_U32 output_port,
+                                                   OMX_HANDLETYPE input, OMX_U32 input_port)
+{
+  COMXILComponent *out  = COMXILComponent::FromHandle(output);
+  COMXILComponent *in   = COMXILComponent::FromHandle(input);
+
+  if(!out && !in)
+    return OMX_ErrorBadParameter;
+
+  OMX_ERRORTYPE omx_err = OMX_ErrorNone;
+
+  // a NULL peer tears down the tunnel on the port given
+  if(out)
+    omx_err = out->SetTunnel(output_port, in, input_port);
+  if(omx_err == OMX_ErrorNone && in)
+    omx_err = in->SetTunnel(input_port, out, output_port);
+
+  return omx_err;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_GetComponentsOfRole(OMX_STRING role, OMX_U32 *count, OMX_U8 **names)
+{
+  if(!count)
+    return OMX_ErrorBadParameter;
+  *count = 0;
+  return OMX_ErrorNone;
+}
+
+OMX_API OMX_ERRORTYPE OMX_APIENTRY OMX_GetRolesOfComponent(OMX_STRING name, OMX_U32 *count, OMX_U8 **roles)
+{
+  if(!count)
+    return OMX_ErrorBadParameter;
+  *count = 0;
+  return OMX_ErrorNone;
+}
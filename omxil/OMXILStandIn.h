@@ -0,0 +1,167 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef _OMXIL_STANDIN_H_
+#define _OMXIL_STANDIN_H_
+
+// A software OpenMAX IL core with the Broadcom components omxplayer uses.
+// Built as libopenmaxil.so it loads in place of the firmware library, so
+// the OMX classes can run on a host without a GPU. Nothing is decoded or
+// shown: buffers move through the components and tunnels with the port
+// numbers, commands, events and clock behaviour of the real ones, taking
+// a configurable processing time per buffer.
+//
+// OMXIL_LATENCY="video_decode=4000,audio_render=1000"  us per buffer
+// OMXIL_BUFFERS="video_decode=20,video_scheduler=4"   input port depth
+
+#include <IL/OMX_Core.h>
+#include <IL/OMX_Component.h>
+#include <IL/OMX_Index.h>
+#include <IL/OMX_Broadcom.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+class COMXILComponent;
+
+enum OMXILKind
+{
+  OMXIL_DECODER,  // app buffers in, output tunneled or to app buffers
+  OMXIL_FILTER,   // tunnel in, tunnel out, new input settings show up on the output
+  OMXIL_SINK,     // consumes its input and reports end of stream
+  OMXIL_CLOCK,
+};
+
+// a buffer waiting on a port. Tunneled buffers have no header, only what
+// the sender filled in
+typedef struct OMXILFrame
+{
+  OMX_BUFFERHEADERTYPE  *header;
+  OMX_U32               flags;
+  int64_t               timestamp;  // us
+  OMX_U32               length;
+} OMXILFrame;
+
+typedef struct OMXILPort
+{
+  OMX_PARAM_PORTDEFINITIONTYPE        def;
+  std::vector<OMX_BUFFERHEADERTYPE *> buffers;  // allocated on this port
+  std::deque<OMXILFrame>              queue;    // input: to process, output: app buffers to fill
+  COMXILComponent                     *peer;
+  OMX_U32                             peer_port;
+  bool                                clock;    // takes the media time from a clock port
+} OMXILPort;
+
+typedef struct OMXILCommand
+{
+  OMX_U32   cmd;
+  OMX_U32   param;
+} OMXILCommand;
+
+class COMXILComponent
+{
+public:
+  COMXILComponent(const std::string &name, OMXILKind kind);
+  ~COMXILComponent();
+
+  // port index, direction and domain, the first data input and output are what the component works on
+  void AddPort(OMX_U32 index, OMX_DIRTYPE dir, OMX_PORTDOMAINTYPE domain, OMX_U32 count, OMX_U32 size, bool clock = false);
+  void SetLatency(int64_t us)          { m_latency = us; };
+  void SetSettingsOnData(bool enable)  { m_settings_on_data = enable; };
+  void SetBufferCount(OMX_U32 count);
+  bool Start();
+
+  OMX_COMPONENTTYPE *GetHandle()  { return &m_handle; };
+  const std::string &GetName()    { return m_name; };
+  static COMXILComponent *FromHandle(OMX_HANDLETYPE handle);
+
+  OMX_ERRORTYPE SendCommand(OMX_COMMANDTYPE cmd, OMX_U32 param);
+  OMX_ERRORTYPE GetParameter(OMX_INDEXTYPE index, OMX_PTR data);
+  OMX_ERRORTYPE SetParameter(OMX_INDEXTYPE index, OMX_PTR data);
+  OMX_ERRORTYPE GetConfig(OMX_INDEXTYPE index, OMX_PTR data);
+  OMX_ERRORTYPE SetConfig(OMX_INDEXTYPE index, OMX_PTR data);
+  OMX_ERRORTYPE GetState(OMX_STATETYPE *state);
+  OMX_ERRORTYPE UseBuffer(OMX_BUFFERHEADERTYPE **header, OMX_U32 port, OMX_PTR app, OMX_U32 size, OMX_U8 *data);
+  OMX_ERRORTYPE FreeBuffer(OMX_U32 port, OMX_BUFFERHEADERTYPE *header);
+  OMX_ERRORTYPE EmptyThisBuffer(OMX_BUFFERHEADERTYPE *header);
+  OMX_ERRORTYPE FillThisBuffer(OMX_BUFFERHEADERTYPE *header);
+  OMX_ERRORTYPE SetCallbacks(OMX_CALLBACKTYPE *callbacks, OMX_PTR app);
+  OMX_ERRORTYPE SetTunnel(OMX_U32 port, COMXILComponent *peer, OMX_U32 peer_port);
+
+  // a tunneled frame from peer, false while the port is full or disabled
+  bool Deliver(OMX_U32 port, const OMXILFrame &frame);
+
+  // clock component, media time in us
+  int64_t MediaTime(bool *running, int *scale);
+  void    ReportStart(OMX_U32 port, int64_t timestamp);
+
+  static int64_t Now();
+private:
+  static void *Run(void *arg);
+  void Process();
+  void Execute(const OMXILCommand &command);
+  bool Step(int64_t &wait);
+  void ReturnBuffers(OMXILPort &port);
+  void Event(OMX_EVENTTYPE event, OMX_U32 data1, OMX_U32 data2);
+  void EmptyDone(OMX_BUFFERHEADERTYPE *header);
+  void FillDone(OMX_BUFFERHEADERTYPE *header);
+  OMXILPort *FindPort(OMX_U32 index);
+  OMXILPort *DataPort(OMX_DIRTYPE dir);
+  OMXILPort *ClockPort();
+  int64_t CurrentMedia(int64_t now);
+
+  std::string                   m_name;
+  OMXILKind                     m_kind;
+  OMX_COMPONENTTYPE             m_handle;
+  OMX_CALLBACKTYPE              m_callbacks;
+  OMX_PTR                       m_app;
+  OMX_STATETYPE                 m_state;
+  std::map<OMX_U32, OMXILPort>  m_ports;
+  std::deque<OMXILCommand>      m_commands;
+  // parameters and configs nothing here interprets, read back as they were set
+  std::map<std::pair<OMX_U32, OMX_U32>, std::vector<uint8_t> > m_store;
+  OMX_AUDIO_PARAM_PCMMODETYPE   m_pcm;
+  int64_t                       m_latency;
+  int64_t                       m_busy_until;
+  bool                          m_settings_on_data;
+  bool                          m_settings_sent;
+  pthread_mutex_t               m_lock;
+  pthread_cond_t                m_cond;
+  pthread_t                     m_thread;
+  bool                          m_running;
+  bool                          m_exit;
+
+  // clock component
+  OMX_TIME_CLOCKSTATE           m_clock_state;
+  int64_t                       m_media_base;
+  int64_t                       m_host_base;
+  int                           m_scale;        // Q16
+  OMX_U32                       m_wait_mask;
+  OMX_U32                       m_reported;
+  int64_t                       m_start_time;
+  int64_t                       m_first_report;
+};
+#endif
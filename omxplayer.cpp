@@ -49,11 +49,16 @@ extern "C" {
 #include "OMXAudioCodecOMX.h"
 #include "utils/PCMRemap.h"
 #include "OMXClock.h"
+#include "OMXTimer.h"
+#include "OMXClockMonitor.h"
+#include "OMXILTrace.h"
+#include "OMXStartup.h"
 #include "OMXAudio.h"
 #include "OMXReader.h"
 #include "OMXPlayerVideo.h"
 #include "OMXPlayerAudio.h"
 #include "OMXPlayerSubtitles.h"
+#include "OMXQueueSizer.h"
 #include "DllOMX.h"
 #include "Srt.h"
 
@@ -94,6 +99,7 @@ DllBcmHost        m_BcmHost;
 OMXPlayerVideo    m_player_video;
 OMXPlayerAudio    m_player_audio;
 OMXPlayerSubtitles  m_player_subtitles;
+OMXClockMonitor   m_clock_monitor;
 int               m_tv_show_info        = 0;
 bool              m_has_video           = false;
 bool              m_has_audio           = false;
@@ -101,6 +107,8 @@ bool              m_has_subtitle        = false;
 float             m_display_aspect      = 0.0f;
 bool              m_boost_on_downmix    = false;
 bool              m_gen_log             = false;
+bool              m_zero_copy           = false;
+bool              m_audio_preopen       = false;
 
 enum{ERROR=-1,SUCCESS,ONEBYTE};
 
@@ -141,9 +149,9 @@ void print_usage()
   printf("         -k / --keys                    print key bindings\n");
 //  printf("         -a / --alang language          audio language        : e.g. ger\n");
   printf("         -n / --aidx  index             audio stream index    : e.g. 1\n");
-  printf("         -o / --adev  device            audio out device      : e.g. hdmi/local\n");
+  printf("         -o / --adev  device            audio out device      : e.g. hdmi/local/null/null:fast/wav:file.wav\n");
   printf("         -i / --info                    dump stream format and exit\n");
-  printf("         -s / --stats                   pts and buffer stats\n");
+  printf("         -s / --stats                   pts and buffer stats, startup timeline on exit\n");
   printf("         -p / --passthrough             audio passthrough\n");
   printf("         -d / --deinterlace             deinterlacing\n");
   printf("         -w / --hw                      hw audio decoding\n");
@@ -169,6 +177,15 @@ void print_usage()
   printf("              --video_fifo  n           Size of video output fifo in MB\n");
   printf("              --audio_queue n           Size of audio input queue in MB\n");
   printf("              --video_queue n           Size of video input queue in MB\n");
+  printf("              --zero_copy               hand demuxed video to the decoder without copying\n");
+  printf("              --queue_budget n          Memory shared by the audio and video input queues in MB\n");
+  printf("                                        (default: 13, 0 disables adaptive queue sizing)\n");
+  printf("              --queue_time n            Seconds of media the input queues try to hold (default: 5)\n");
+  printf("              --audio_preopen           keep decoders of all audio streams open for instant switching\n");
+  printf("              --clock_log file          write a sample of all clocks and their drift every 500ms to file\n");
+  printf("              --il_trace file           time all OMX IL calls, write them to file as a chrome://tracing\n");
+  printf("                                        JSON and print a latency histogram per call on exit\n");
+  printf("              --startup_log file        write the startup phases and time to first frame to file as JSON\n");
 }
 
 void print_keybindings()
@@ -270,6 +287,13 @@ void FlushStreams(double pts)
 //  if(m_av_clock)
 //    m_av_clock->OMXPause();
 
+  // the packet may hold a video decoder input buffer, which the flush may resize
+  if(m_omx_pkt)
+  {
+    m_omx_reader.FreePacket(m_omx_pkt);
+    m_omx_pkt = NULL;
+  }
+
   if(m_has_video)
     m_player_video.Flush();
 
@@ -279,12 +303,6 @@ void FlushStreams(double pts)
   if(m_has_subtitle)
     m_player_subtitles.Flush(pts);
 
-  if(m_omx_pkt)
-  {
-    m_omx_reader.FreePacket(m_omx_pkt);
-    m_omx_pkt = NULL;
-  }
-
   if(pts != DVD_NOPTS_VALUE)
     m_av_clock->OMXUpdateClock(pts);
 
@@ -443,6 +461,8 @@ bool IsURL(const std::string& str)
 
 int main(int argc, char *argv[])
 {
+  COMXStartup::Start();
+
   signal(SIGSEGV, sig_handler);
   signal(SIGABRT, sig_handler);
   signal(SIGFPE, sig_handler);
@@ -482,6 +502,14 @@ int main(int argc, char *argv[])
   float video_fifo_size = 0.0;
   float audio_queue_size = 0.0;
   float video_queue_size = 0.0;
+  float queue_budget = -1.0; // negative means use default
+  float queue_time = 0.0;
+  std::string clock_log;
+  std::string il_trace;
+  std::string startup_log;
+  int64_t startup = 0;
+  OMXQueueSizer queue_sizer;
+  int64_t queue_update_time = 0;
   bool has_buffered = false;
   TV_DISPLAY_STATE_T   tv_state;
 
@@ -496,6 +524,13 @@ int main(int argc, char *argv[])
   const int video_fifo_opt  = 0x108;
   const int audio_queue_opt = 0x109;
   const int video_queue_opt = 0x10a;
+  const int zero_copy_opt   = 0x10b;
+  const int queue_budget_opt = 0x10c;
+  const int queue_time_opt  = 0x10d;
+  const int audio_preopen_opt = 0x10e;
+  const int clock_log_opt   = 0x10f;
+  const int il_trace_opt    = 0x110;
+  const int startup_log_opt = 0x111;
   const int boost_on_downmix_opt = 0x200;
 
   struct option longopts[] = {
@@ -526,6 +561,13 @@ int main(int argc, char *argv[])
     { "video_fifo",   required_argument,  NULL,          video_fifo_opt },
     { "audio_queue",  required_argument,  NULL,          audio_queue_opt },
     { "video_queue",  required_argument,  NULL,          video_queue_opt },
+    { "zero_copy",    no_argument,        NULL,          zero_copy_opt },
+    { "queue_budget", required_argument,  NULL,          queue_budget_opt },
+    { "queue_time",   required_argument,  NULL,          queue_time_opt },
+    { "audio_preopen", no_argument,       NULL,          audio_preopen_opt },
+    { "clock_log",    required_argument,  NULL,          clock_log_opt },
+    { "il_trace",     required_argument,  NULL,          il_trace_opt },
+    { "startup_log",  required_argument,  NULL,          startup_log_opt },
     { "boost-on-downmix", no_argument,    NULL,          boost_on_downmix_opt },
     { 0, 0, 0, 0 }
   };
@@ -574,12 +616,16 @@ int main(int argc, char *argv[])
         break;
       case 'o':
         deviceString = optarg;
-        if(deviceString != "local" && deviceString != "hdmi")
+        if(deviceString == "local" || deviceString == "hdmi")
+        {
+          deviceString = "omx:" + deviceString;
+        }
+        else if(deviceString != "null" && deviceString != "null:fast" &&
+                deviceString.compare(0, 4, "wav:") != 0)
         {
           print_usage();
           return 0;
         }
-        deviceString = "omx:" + deviceString;
         break;
       case 'i':
         m_dump_format = true;
@@ -641,6 +687,27 @@ int main(int argc, char *argv[])
       case video_queue_opt:
 	video_queue_size = atof(optarg);
         break;
+      case zero_copy_opt:
+        m_zero_copy = true;
+        break;
+      case queue_budget_opt:
+	queue_budget = atof(optarg);
+        break;
+      case queue_time_opt:
+	queue_time = atof(optarg);
+        break;
+      case audio_preopen_opt:
+        m_audio_preopen = true;
+        break;
+      case clock_log_opt:
+        clock_log = optarg;
+        break;
+      case il_trace_opt:
+        il_trace = optarg;
+        break;
+      case startup_log_opt:
+        startup_log = optarg;
+        break;
       case 0:
         break;
       case 'h':
@@ -711,15 +778,22 @@ int main(int argc, char *argv[])
     CLog::SetLogLevel(LOG_LEVEL_NONE);
   }
 
+  if(!il_trace.empty())
+    COMXILTrace::Enable();
+
+  startup = COMXStartup::Begin();
   g_RBP.Initialize();
   g_OMX.Initialize();
+  COMXStartup::End("omx_init", startup);
 
   m_av_clock = new OMXClock();
 
   m_thread_player = true;
 
+  startup = COMXStartup::Begin();
   if(!m_omx_reader.Open(m_filename.c_str(), m_dump_format))
     goto do_exit;
+  COMXStartup::End("reader_open", startup);
 
   if(m_dump_format)
     goto do_exit;
@@ -743,11 +817,16 @@ int main(int argc, char *argv[])
   if (m_refresh && !m_no_hdmi_clock_sync)
     m_hdmi_clock_sync = true;
 
+  startup = COMXStartup::Begin();
   if(!m_av_clock->OMXInitialize(m_has_video, m_has_audio))
     goto do_exit;
 
   if(m_hdmi_clock_sync && !m_av_clock->HDMIClockSync())
       goto do_exit;
+  COMXStartup::End("clock_init", startup);
+
+  if(m_stats || !clock_log.empty())
+    m_clock_monitor.Open(m_av_clock, 500, clock_log.empty() ? NULL : clock_log.c_str());
 
   m_omx_reader.GetHints(OMXSTREAM_AUDIO, m_hints_audio);
   m_omx_reader.GetHints(OMXSTREAM_VIDEO, m_hints_video);
@@ -760,7 +839,9 @@ int main(int argc, char *argv[])
     memset(&tv_state, 0, sizeof(TV_DISPLAY_STATE_T));
     m_BcmHost.vc_tv_get_display_state(&tv_state);
 
+    startup = COMXStartup::Begin();
     SetVideoMode(m_hints_video.width, m_hints_video.height, m_hints_video.fpsrate, m_hints_video.fpsscale, m_3d);
+    COMXStartup::End("video_mode", startup);
   }
   // get display aspect
   TV_DISPLAY_STATE_T current_tv_state;
@@ -778,13 +859,50 @@ int main(int argc, char *argv[])
   // seek on start
   if (m_seek_pos !=0 && m_omx_reader.CanSeek()) {
         printf("Seeking start of video to %i seconds\n", m_seek_pos);
+        startup = COMXStartup::Begin();
         m_omx_reader.SeekTime(m_seek_pos * 1000.0f, 0, &startpts);  // from seconds to DVD_TIME_BASE
+        COMXStartup::End("start_seek", startup);
   }
   
+  m_omx_reader.GetHints(OMXSTREAM_AUDIO, m_hints_audio);
+
+  if (deviceString == "")
+  {
+    if (m_BcmHost.vc_tv_hdmi_audio_supported(EDID_AudioFormat_ePCM, 2, EDID_AudioSampleRate_e44KHz, EDID_AudioSampleSize_16bit ) == 0)
+      deviceString = "omx:hdmi";
+    else
+      deviceString = "omx:local";
+  }
+
+  if ((m_hints_audio.codec == CODEC_ID_AC3 || m_hints_audio.codec == CODEC_ID_EAC3) &&
+      m_BcmHost.vc_tv_hdmi_audio_supported(EDID_AudioFormat_eAC3, 2, EDID_AudioSampleRate_e44KHz, EDID_AudioSampleSize_16bit ) != 0)
+    m_passthrough = false;
+  if (m_hints_audio.codec == CODEC_ID_DTS &&
+      m_BcmHost.vc_tv_hdmi_audio_supported(EDID_AudioFormat_eDTS, 2, EDID_AudioSampleRate_e44KHz, EDID_AudioSampleSize_16bit ) != 0)
+    m_passthrough = false;
+
+  // one graph at a time, both set up tunnels on the shared clock
+  startup = COMXStartup::Begin();
   if(m_has_video && !m_player_video.Open(m_hints_video, m_av_clock, DestRect, m_Deinterlace,  m_bMpeg,
-                                         m_hdmi_clock_sync, m_thread_player, m_display_aspect, video_queue_size, video_fifo_size))
+                                         m_hdmi_clock_sync, m_thread_player, m_display_aspect, video_queue_size, video_fifo_size, m_zero_copy))
+    goto do_exit;
+  if(m_has_video)
+    COMXStartup::End("video_open", startup);
+
+  startup = COMXStartup::Begin();
+  if(m_has_audio && !m_player_audio.Open(m_hints_audio, m_av_clock, &m_omx_reader, deviceString,
+                                         m_passthrough, m_initialVolume, m_use_hw_audio,
+                                         m_boost_on_downmix, m_thread_player, audio_queue_size, audio_fifo_size,
+                                         m_audio_preopen))
     goto do_exit;
+  if(m_has_audio)
+    COMXStartup::End("audio_open", startup);
+
+  // read video packets straight into the decoder input buffers
+  if(m_has_video && m_zero_copy)
+    m_omx_reader.SetVideoPacketAllocator(OMXPlayerVideo::AllocPacketData, &m_player_video);
 
+  startup = COMXStartup::Begin();
   {
     std::vector<Subtitle> external_subtitles;
     if(m_has_external_subtitles &&
@@ -819,29 +937,17 @@ int main(int argc, char *argv[])
 
     if(m_subtitle_index == -1 && !m_has_external_subtitles)
       m_player_subtitles.SetVisible(false);
-  }
 
-  m_omx_reader.GetHints(OMXSTREAM_AUDIO, m_hints_audio);
-
-  if (deviceString == "")
-  {
-    if (m_BcmHost.vc_tv_hdmi_audio_supported(EDID_AudioFormat_ePCM, 2, EDID_AudioSampleRate_e44KHz, EDID_AudioSampleSize_16bit ) == 0)
-      deviceString = "omx:hdmi";
-    else
-      deviceString = "omx:local";
+    COMXStartup::End("subtitles_open", startup);
   }
 
-  if ((m_hints_audio.codec == CODEC_ID_AC3 || m_hints_audio.codec == CODEC_ID_EAC3) &&
-      m_BcmHost.vc_tv_hdmi_audio_supported(EDID_AudioFormat_eAC3, 2, EDID_AudioSampleRate_e44KHz, EDID_AudioSampleSize_16bit ) != 0)
-    m_passthrough = false;
-  if (m_hints_audio.codec == CODEC_ID_DTS &&
-      m_BcmHost.vc_tv_hdmi_audio_supported(EDID_AudioFormat_eDTS, 2, EDID_AudioSampleRate_e44KHz, EDID_AudioSampleSize_16bit ) != 0)
-    m_passthrough = false;
-
-  if(m_has_audio && !m_player_audio.Open(m_hints_audio, m_av_clock, &m_omx_reader, deviceString, 
-                                         m_passthrough, m_initialVolume, m_use_hw_audio,
-                                         m_boost_on_downmix, m_thread_player, audio_queue_size, audio_fifo_size))
-    goto do_exit;
+  // explicit queue sizes are kept, the others follow the measured bitrate
+  if(queue_budget >= 0.0)
+    queue_sizer.SetBudget(queue_budget * 1024 * 1024);
+  if(queue_time > 0.0)
+    queue_sizer.SetTarget(queue_time);
+  queue_sizer.SetFixed(video_queue_size * 1024 * 1024, audio_queue_size * 1024 * 1024);
+  queue_sizer.SetStreams(m_has_video, m_player_video.GetMaxCached(), m_has_audio, m_player_audio.GetMaxCached());
 
   m_av_clock->SetSpeed(DVD_PLAYSPEED_NORMAL);
   m_av_clock->OMXStart(0.0);
@@ -1019,7 +1125,8 @@ int main(int argc, char *argv[])
 
     if(m_Pause)
     {
-      OMXClock::OMXSleep(2);
+      // nothing to do until a key arrives, a closed stdin stays readable so only wait on the timer then
+      COMXTimer::WaitUntil(COMXTimer::Deadline(1000), feof(stdin) ? -1 : STDIN_FILENO);
       continue;
     }
 
@@ -1046,17 +1153,27 @@ int main(int argc, char *argv[])
       if(m_omx_reader.SeekTime(seek_pos, seek_flags, &startpts))
         FlushStreams(startpts);
 
-      m_player_video.Close();
-      if(m_has_video && !m_player_video.Open(m_hints_video, m_av_clock, DestRect, m_Deinterlace, m_bMpeg,
-                                         m_hdmi_clock_sync, m_thread_player, m_display_aspect, video_queue_size, video_fifo_size))
-        goto do_exit;
-
+      // the video pipeline was flushed in place by FlushStreams and stays in Executing
       m_av_clock->OMXStart(startpts);
       
       if(m_has_subtitle)
         m_player_subtitles.Resume();
     }
 
+    if(queue_sizer.GetBudget() && OMXClock::CurrentHostCounter() - queue_update_time > OMXClock::CurrentHostFrequency())
+    {
+      queue_update_time = OMXClock::CurrentHostCounter();
+      if(queue_sizer.Update(m_player_video.GetBitrate(), m_player_audio.GetBitrate()))
+      {
+        if(m_has_video)
+          m_player_video.SetMaxCached(queue_sizer.GetVideoSize());
+        if(m_has_audio)
+          m_player_audio.SetMaxCached(queue_sizer.GetAudioSize());
+        if(m_has_video && video_fifo_size == 0.0)
+          m_player_video.SetFifoSize(queue_sizer.GetVideoFifo());
+      }
+    }
+
     /* player got in an error state */
     if(m_player_audio.Error())
     {
@@ -1064,14 +1181,57 @@ int main(int argc, char *argv[])
       goto do_exit;
     }
 
+    // the first frame is on screen once the running clock reaches it
+    if(m_has_video && !COMXStartup::HasEvent(OMXSTARTUP_VIDEO_PRESENTED) &&
+       COMXStartup::HasEvent(OMXSTARTUP_VIDEO_SUBMITTED) && !m_av_clock->OMXIsPaused() &&
+       m_av_clock->OMXMediaTimeCached() >= COMXStartup::GetEventPts(OMXSTARTUP_VIDEO_SUBMITTED))
+      COMXStartup::Event(OMXSTARTUP_VIDEO_PRESENTED);
+
     if(m_stats)
     {
       static int count;
+      static int64_t last_stats_time;
+      static unsigned int last_copied;
+      static unsigned int last_submits;
+      static uint64_t last_wakeups, last_timer_wakeups;
+      static int64_t last_overshoot;
       if ((count++ & 15) == 0)
-         printf("V : %8.02f %8d %8d A : %8.02f %8.02f/%8.02f Cv : %8d Ca : %8d                            \r",
-             m_av_clock->OMXMediaTime(), m_player_video.GetDecoderBufferSize(), m_player_video.GetDecoderFreeSpace(),
-             m_player_audio.GetCurrentPTS() / DVD_TIME_BASE - m_av_clock->OMXMediaTime() * 1e-6, m_player_audio.GetDelay(), m_player_audio.GetCacheTotal(),
-             m_player_video.GetCached(), m_player_audio.GetCached());
+      {
+        int64_t now = OMXClock::CurrentHostCounter();
+        unsigned int copied = m_player_video.GetBytesCopied();
+        unsigned int submits = m_player_audio.GetSubmitCount();
+        double copy_rate = 0.0;
+        double submit_rate = 0.0;
+        uint64_t wakeups = COMXTimer::GetWakeups();
+        uint64_t timer_wakeups = COMXTimer::GetTimerWakeups();
+        int64_t overshoot = COMXTimer::GetOvershoot();
+        double wakeup_rate = 0.0;
+        double overshoot_avg = 0.0;
+        if(last_stats_time && now > last_stats_time)
+        {
+          copy_rate = (double)(copied - last_copied) * OMXClock::CurrentHostFrequency() / (now - last_stats_time) / 1024.0;
+          // the count restarts when the audio decoder is reopened
+          if(submits >= last_submits)
+            submit_rate = (double)(submits - last_submits) * OMXClock::CurrentHostFrequency() / (now - last_stats_time);
+          wakeup_rate = (double)(wakeups - last_wakeups) * OMXClock::CurrentHostFrequency() / (now - last_stats_time);
+          if(timer_wakeups > last_timer_wakeups)
+            overshoot_avg = (double)(overshoot - last_overshoot) / (timer_wakeups - last_timer_wakeups) / 1000.0;
+        }
+        last_stats_time    = now;
+        last_copied        = copied;
+        last_submits       = submits;
+        last_wakeups       = wakeups;
+        last_timer_wakeups = timer_wakeups;
+        last_overshoot     = overshoot;
+
+        printf("V : %8.02f %8d %8d A : %8.02f %8.02f/%8.02f Cv : %8d Ca : %8d Ar : %2u Ab : %4.0f/s Ae : %+6.1fms Ac : %+5.0fppm Mc : %6.0fkB/s Tw : %5.0f/s To : %5.0fus Dm : %+5.0fppm Da : %+5.0fppm Dv : %+5.0fppm                  \r",
+             m_av_clock->OMXMediaTimeCached(), m_player_video.GetDecoderBufferSize(), m_player_video.GetDecoderFreeSpace(),
+             m_player_audio.GetCurrentPTS() / DVD_TIME_BASE - m_av_clock->OMXMediaTimeCached() * 1e-6, m_player_audio.GetDelay(), m_player_audio.GetCacheTotal(),
+             m_player_video.GetCached(), m_player_audio.GetCached(), m_player_audio.GetRingLevel(), submit_rate,
+             m_player_audio.GetSyncError() / 1000.0, m_player_audio.GetClockCorrection() * 1e6, copy_rate,
+             wakeup_rate, overshoot_avg,
+             m_clock_monitor.GetMediaDrift(), m_clock_monitor.GetAudioDrift(), m_clock_monitor.GetVideoDrift());
+      }
     }
 
     if(m_omx_reader.IsEof() && !m_omx_pkt)
@@ -1188,18 +1348,21 @@ do_exit:
   m_av_clock->OMXStop();
   m_av_clock->OMXStateIdle();
 
-  m_player_subtitles.Close();
-  m_player_video.Close();
-  m_player_audio.Close();
-
+  // the packet may hold a video decoder input buffer, give it back first
   if(m_omx_pkt)
   {
     m_omx_reader.FreePacket(m_omx_pkt);
     m_omx_pkt = NULL;
   }
+  m_omx_reader.SetVideoPacketAllocator(NULL, NULL);
+
+  m_player_subtitles.Close();
+  m_player_video.Close();
+  m_player_audio.Close();
 
   m_omx_reader.Close();
 
+  m_clock_monitor.Close();
   m_av_clock->Deinitialize();
   if (m_av_clock)
     delete m_av_clock;
@@ -1209,6 +1372,18 @@ do_exit:
   g_OMX.Deinitialize();
   g_RBP.Deinitialize();
 
+  if(!il_trace.empty())
+  {
+    COMXILTrace::PrintHistograms(stdout);
+    if(!COMXILTrace::WriteChromeTrace(il_trace.c_str()))
+      printf("could not write IL trace to %s\n", il_trace.c_str());
+  }
+
+  if(m_stats)
+    COMXStartup::Print(stdout);
+  if(!startup_log.empty() && !COMXStartup::WriteJSON(startup_log.c_str()))
+    printf("could not write startup log to %s\n", startup_log.c_str());
+
   printf("have a nice day ;)\n");
   return 1;
 }
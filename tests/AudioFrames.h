@@ -0,0 +1,160 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#ifndef _AUDIO_FRAMES_H_
+#define _AUDIO_FRAMES_H_
+
+// AC3, E-AC3, DTS and DTS-HD frames for the host tests, built field by field
+// after the bitstream specs (ATSC A/52 and ETSI TS 102 114), with valid CRCs
+// where the format has them.
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+typedef std::vector<uint8_t> Bytes;
+
+static inline uint16_t Crc16(const uint8_t *data, unsigned int size)
+{
+  uint16_t crc = 0;
+  while(size--)
+  {
+    crc ^= *data++ << 8;
+    for(int bit = 0; bit < 8; bit++)
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x8005 : crc << 1;
+  }
+  return crc;
+}
+
+static inline void Fill(uint8_t *p, unsigned int size, unsigned int seed)
+{
+  // a payload without sync words in it
+  for(unsigned int i = 0; i < size; i++)
+    p[i] = 0x20 + (i * 7 + seed) % 0x40;
+}
+
+// AC3 at 48kHz, frmsizecod picks the bitrate. crc1 covers the first 5/8 of
+// the frame, crc2 all of it
+static inline Bytes AC3Frame(uint8_t frmsizecod, unsigned int seed)
+{
+  static const unsigned int kbps[] = {32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 576, 640};
+  unsigned int words = kbps[frmsizecod >> 1] * 2;
+  Bytes f(words * 2);
+
+  Fill(&f[0], f.size(), seed);
+  f[0] = 0x0B;
+  f[1] = 0x77;
+  f[4] = (0 << 6) | frmsizecod;   // fscod 48kHz
+  f[5] = (8 << 3) | 0;            // bsid 8, bsmod 0
+
+  unsigned int crc1_size = ((words >> 1) + (words >> 3)) * 2;
+  for(unsigned int crc1 = 0; crc1 < 0x10000; crc1++)
+  {
+    f[2] = crc1 >> 8;
+    f[3] = crc1 & 0xFF;
+    if(Crc16(&f[2], crc1_size - 2) == 0)
+      break;
+  }
+
+  uint16_t crc2 = Crc16(&f[2], f.size() - 4);
+  f[f.size() - 2] = crc2 >> 8;
+  f[f.size() - 1] = crc2 & 0xFF;
+  return f;
+}
+
+// E-AC3 independent substream. fscod2 is numblkscod, or with fscod 3 the
+// code of the rate that is halved
+static inline Bytes EAC3Frame(unsigned int words, uint8_t fscod, uint8_t fscod2, unsigned int seed)
+{
+  Bytes f(words * 2);
+
+  Fill(&f[0], f.size(), seed);
+  f[0] = 0x0B;
+  f[1] = 0x77;
+  f[2] = (0 << 6) | (0 << 3) | ((words - 1) >> 8);  // strmtyp, substreamid, frmsiz
+  f[3] = (words - 1) & 0xFF;
+  f[4] = (fscod << 6) | (fscod2 << 4) | (7 << 1) | 0;  // numblkscod or fscod2, acmod 3/2, lfeon
+  f[5] = 16 << 3;                 // bsid 16
+
+  uint16_t crc = Crc16(&f[2], f.size() - 4);
+  f[f.size() - 2] = crc >> 8;
+  f[f.size() - 1] = crc & 0xFF;
+  return f;
+}
+
+// DTS core frame, 16 bit words big endian
+static inline Bytes DTSFrame(unsigned int size, unsigned int blocks, uint8_t sfreq, unsigned int seed)
+{
+  Bytes f(size);
+
+  Fill(&f[0], f.size(), seed);
+  f[0] = 0x7F;
+  f[1] = 0xFE;
+  f[2] = 0x80;
+  f[3] = 0x01;
+  // FTYPE 1, SHORT 31, CPF 0, NBLKS, FSIZE, AMODE 9, SFREQ, RATE
+  unsigned int nblks = blocks - 1;
+  unsigned int fsize = size - 1;
+  f[4] = 0x80 | (31 << 2) | (nblks >> 6);
+  f[5] = ((nblks & 0x3F) << 2) | (fsize >> 12);
+  f[6] = (fsize >> 4) & 0xFF;
+  f[7] = ((fsize & 0xF) << 4) | (9 >> 2);
+  f[8] = ((9 & 3) << 6) | (sfreq << 2) | 0;
+  f[9] = 0;
+  return f;
+}
+
+// a DTS-HD extension substream header following a core frame
+static inline Bytes DTSHDSubstream(unsigned int size)
+{
+  Bytes f(size, 0x11);
+  f[0] = 0x64;
+  f[1] = 0x58;
+  f[2] = 0x20;
+  f[3] = 0x25;
+  return f;
+}
+
+static inline Bytes SwapWords(const Bytes &in)
+{
+  Bytes out(in);
+  for(size_t i = 0; i + 1 < out.size(); i += 2)
+  {
+    out[i]     = in[i + 1];
+    out[i + 1] = in[i];
+  }
+  return out;
+}
+
+static inline void Append(Bytes &to, const Bytes &from)
+{
+  to.insert(to.end(), from.begin(), from.end());
+}
+
+static inline Bytes Garbage(unsigned int size)
+{
+  Bytes g(size);
+  Fill(&g[0], size, 3);
+  return g;
+}
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// CAudioSyncParser over AC3, E-AC3, DTS and DTS-HD streams built by
+// AudioFrames.h.
+
+#include "AudioSyncParser.h"
+#include "OMXTest.h"
+#include "AudioFrames.h"
+
+static void TestAC3()
+{
+  CAudioSyncParser parser;
+
+  // a sync word with a broken frame in front of three good ones
+  Bytes broken = AC3Frame(28, 1);
+  broken[100] ^= 0x01;
+
+  Bytes data = Garbage(77);
+  Append(data, broken);
+  unsigned int first = data.size();
+  for(unsigned int i = 0; i < 3; i++)
+    Append(data, AC3Frame(28, i));
+
+  CHECK_EQUAL(parser.SyncAC3(&data[0], data.size()), first);
+  CHECK_EQUAL(parser.GetFrameSize(), 1536);
+  CHECK_EQUAL(parser.GetSampleRate(), 48000);
+  CHECK_EQUAL(parser.GetLastSkipped(), first);
+  CHECK_EQUAL(parser.GetResyncCount(), 1);
+
+  // aligned on a frame, nothing skipped
+  CHECK_EQUAL(parser.SyncAC3(&data[first], data.size() - first), 0);
+  CHECK_EQUAL(parser.GetLastSkipped(), 0);
+  CHECK_EQUAL(parser.GetTotalSkipped(), first);
+}
+
+static void TestAC3Partial()
+{
+  CAudioSyncParser parser;
+
+  // only the part crc1 covers is there, 960 of 1536 bytes
+  Bytes frame = AC3Frame(28, 5);
+  CHECK_EQUAL(parser.SyncAC3(&frame[0], 1000), 0);
+
+  // a damaged first part is caught by crc1
+  frame[500] ^= 0x80;
+  CHECK_EQUAL(parser.SyncAC3(&frame[0], 1000), 1000);
+
+  // damage after the crc1 part only shows with the whole frame
+  frame = AC3Frame(28, 5);
+  frame[1200] ^= 0x80;
+  CHECK_EQUAL(parser.SyncAC3(&frame[0], 1000), 0);
+  CHECK_EQUAL(parser.SyncAC3(&frame[0], frame.size()), frame.size());
+}
+
+static void TestAC3AcrossCalls()
+{
+  CAudioSyncParser parser;
+
+  Bytes garbage = Garbage(300);
+  CHECK_EQUAL(parser.SyncAC3(&garbage[0], garbage.size()), garbage.size());
+
+  Bytes data = Garbage(20);
+  Append(data, AC3Frame(10, 2));
+  Append(data, AC3Frame(10, 3));
+  CHECK_EQUAL(parser.SyncAC3(&data[0], data.size()), 20);
+  CHECK_EQUAL(parser.GetFrameSize(), 320);
+  CHECK_EQUAL(parser.GetLastSkipped(), 320);
+
+  // a flush drops what was skipped before it
+  CHECK_EQUAL(parser.SyncAC3(&garbage[0], garbage.size()), garbage.size());
+  parser.Reset();
+  CHECK_EQUAL(parser.SyncAC3(&data[0], data.size()), 20);
+  CHECK_EQUAL(parser.GetLastSkipped(), 20);
+}
+
+static void TestEAC3()
+{
+  CAudioSyncParser parser;
+
+  Bytes data = Garbage(33);
+  Append(data, EAC3Frame(768, 0, 3, 1));
+  Append(data, EAC3Frame(768, 0, 3, 2));
+
+  CHECK_EQUAL(parser.SyncAC3(&data[0], data.size()), 33);
+  CHECK_EQUAL(parser.GetFrameSize(), 1536);
+  CHECK_EQUAL(parser.GetSampleRate(), 48000);
+
+  // fscod 3 with fscod2 44.1kHz is the 22.05kHz half rate
+  data = EAC3Frame(512, 3, 1, 4);
+  Append(data, EAC3Frame(512, 3, 1, 5));
+  CHECK_EQUAL(parser.SyncAC3(&data[0], data.size()), 0);
+  CHECK_EQUAL(parser.GetFrameSize(), 1024);
+  CHECK_EQUAL(parser.GetSampleRate(), 22050);
+
+  // fscod2 3 is reserved
+  data = EAC3Frame(512, 3, 3, 4);
+  CHECK_EQUAL(parser.SyncAC3(&data[0], data.size()), data.size());
+}
+
+static void TestDTS()
+{
+  CAudioSyncParser parser;
+
+  // a lone sync word in the garbage has no frame after it
+  Bytes data = Garbage(50);
+  Bytes fake = DTSFrame(1024, 16, 13, 9);
+  fake.resize(40);
+  Append(data, fake);
+  unsigned int first = data.size();
+  Append(data, DTSFrame(1024, 16, 13, 1));
+  Append(data, DTSFrame(1024, 16, 13, 2));
+
+  CHECK_EQUAL(parser.SyncDTS(&data[0], data.size()), first);
+  CHECK_EQUAL(parser.GetFrameSize(), 1024);
+  CHECK_EQUAL(parser.GetSampleRate(), 48000);
+  CHECK_EQUAL(parser.GetDTSBlocks(), 16);
+  CHECK(!parser.Is14Bit());
+  CHECK(parser.IsLittleEndian());
+
+  // the same stream with its 16 bit words swapped
+  Bytes swapped = SwapWords(data);
+  CHECK_EQUAL(parser.SyncDTS(&swapped[0], swapped.size()), first);
+  CHECK_EQUAL(parser.GetFrameSize(), 1024);
+  CHECK_EQUAL(parser.GetSampleRate(), 48000);
+  CHECK_EQUAL(parser.GetDTSBlocks(), 16);
+  CHECK(!parser.IsLittleEndian());
+
+  // 44.1kHz, and a frame size out of range
+  data = DTSFrame(2048, 32, 8, 3);
+  Append(data, DTSFrame(2048, 32, 8, 4));
+  CHECK_EQUAL(parser.SyncDTS(&data[0], data.size()), 0);
+  CHECK_EQUAL(parser.GetSampleRate(), 44100);
+  CHECK_EQUAL(parser.GetDTSBlocks(), 32);
+
+  // the block count has a bit in the byte before
+  data = DTSFrame(4096, 128, 13, 5);
+  Append(data, DTSFrame(4096, 128, 13, 6));
+  CHECK_EQUAL(parser.SyncDTS(&data[0], data.size()), 0);
+  CHECK_EQUAL(parser.GetDTSBlocks(), 128);
+  swapped = SwapWords(data);
+  CHECK_EQUAL(parser.SyncDTS(&swapped[0], swapped.size()), 0);
+  CHECK_EQUAL(parser.GetDTSBlocks(), 128);
+
+  data = DTSFrame(64, 16, 13, 3);
+  Append(data, DTSFrame(64, 16, 13, 4));
+  CHECK_EQUAL(parser.SyncDTS(&data[0], data.size()), data.size());
+}
+
+static void TestDTSHD()
+{
+  CAudioSyncParser parser;
+
+  // core frames each followed by an extension substream
+  Bytes data = Garbage(12);
+  for(unsigned int i = 0; i < 2; i++)
+  {
+    Append(data, DTSFrame(2012, 16, 13, i));
+    Append(data, DTSHDSubstream(3000));
+  }
+
+  CHECK_EQUAL(parser.SyncDTS(&data[0], data.size()), 12);
+  CHECK_EQUAL(parser.GetFrameSize(), 2012);
+  CHECK_EQUAL(parser.GetSampleRate(), 48000);
+
+  // and byte swapped
+  data = Garbage(12);
+  Append(data, SwapWords(DTSFrame(2012, 16, 13, 0)));
+  Append(data, SwapWords(DTSHDSubstream(3000)));
+  CHECK_EQUAL(parser.SyncDTS(&data[0], data.size()), 12);
+  CHECK(!parser.IsLittleEndian());
+}
+
+static void TestDTS14Bit()
+{
+  CAudioSyncParser parser;
+
+  // 14 bit words, the sync spans the first six bytes
+  Bytes data = Garbage(8);
+  const uint8_t header[] = { 0x1F, 0xFF, 0xE8, 0x00, 0x07, 0xF1, 0x03, 0xFF, 0x34, 0x00 };
+  data.insert(data.end(), header, header + sizeof(header));
+  Append(data, Garbage(100));
+
+  CHECK_EQUAL(parser.SyncDTS(&data[0], data.size()), 8);
+  CHECK(parser.Is14Bit());
+  CHECK(parser.IsLittleEndian());
+  CHECK_EQUAL(parser.GetSampleRate(), 48000);
+  CHECK_EQUAL(parser.GetDTSBlocks(), 32);
+
+  Bytes swapped = SwapWords(data);
+  CHECK_EQUAL(parser.SyncDTS(&swapped[0], swapped.size()), 8);
+  CHECK(parser.Is14Bit());
+  CHECK(!parser.IsLittleEndian());
+  CHECK_EQUAL(parser.GetDTSBlocks(), 32);
+}
+
+int main(int argc, char *argv[])
+{
+  TestAC3();
+  TestAC3Partial();
+  TestAC3AcrossCalls();
+  TestEAC3();
+  TestDTS();
+  TestDTSHD();
+  TestDTS14Bit();
+
+  return TestResult("AudioSyncParserTest");
+}
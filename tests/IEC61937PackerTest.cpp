@@ -0,0 +1,226 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// IEC 61937 bursts from CIEC61937Packer for AC3, E-AC3, DTS and DTS-HD, held
+// against the burst layout of IEC 61937 as ffmpeg's spdif muxer writes it:
+// Pa Pb Pc Pd as 16 bit little endian words, the payload in byte swapped
+// 16 bit words, zeros up to the end of the repetition period.
+
+#include "IEC61937Packer.h"
+#include "OMXTest.h"
+#include "AudioFrames.h"
+
+static unsigned int LE16(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+// checks the burst at p and that its payload is data, returns false if not
+static bool CheckBurst(const uint8_t *p, unsigned int burst, unsigned int type, unsigned int length_code,
+                       const Bytes &data)
+{
+  bool ok = true;
+
+  if(LE16(p) != 0xF872 || LE16(p + 2) != 0x4E1F)
+  {
+    printf("no preamble\n");
+    ok = false;
+  }
+  if(LE16(p + 4) != type)
+  {
+    printf("Pc 0x%04x, expected 0x%04x\n", LE16(p + 4), type);
+    ok = false;
+  }
+  if(LE16(p + 6) != length_code)
+  {
+    printf("Pd %u, expected %u\n", LE16(p + 6), length_code);
+    ok = false;
+  }
+
+  Bytes payload(data);
+  if(payload.size() & 1)
+    payload.push_back(0);
+  if(SwapWords(Bytes(p + 8, p + 8 + payload.size())) != payload)
+  {
+    printf("payload differs\n");
+    ok = false;
+  }
+
+  for(unsigned int i = 8 + payload.size(); i < burst; i++)
+    if(p[i])
+    {
+      printf("padding not zero at %u\n", i);
+      ok = false;
+      break;
+    }
+
+  return ok;
+}
+
+static void TestAC3()
+{
+  CIEC61937Packer packer;
+  CHECK(packer.Open(IAudioRenderer::ENCODED_IEC61937_AC3, false));
+  CHECK_EQUAL(packer.GetOutputRate(48000), 48000);
+
+  // a burst per frame, whatever the bitrate is
+  Bytes a = AC3Frame(28, 1);
+  Bytes b = AC3Frame(10, 2);
+  Bytes data = Garbage(40);
+  Append(data, a);
+  Append(data, b);
+
+  CHECK_EQUAL(packer.Pack(&data[0], data.size()), 2 * 6144);
+  CHECK_EQUAL(packer.GetOutputFrames(), 2 * 1536);
+
+  const uint8_t *out = packer.GetOutput();
+  CHECK(CheckBurst(out,        6144, 0x0001, a.size() * 8, a));
+  CHECK(CheckBurst(out + 6144, 6144, 0x0001, b.size() * 8, b));
+
+  // bsmod goes into the data type dependent bits
+  Bytes c = AC3Frame(28, 3);
+  c[5] |= 2;
+  uint16_t crc = Crc16(&c[2], c.size() - 4);
+  c[c.size() - 2] = crc >> 8;
+  c[c.size() - 1] = crc & 0xFF;
+  CHECK_EQUAL(packer.Pack(&c[0], c.size()), 6144);
+  CHECK(CheckBurst(packer.GetOutput(), 6144, 0x0201, c.size() * 8, c));
+
+  // a frame cut short is dropped
+  CHECK_EQUAL(packer.Pack(&a[0], a.size() - 100), 0);
+}
+
+static void TestEAC3()
+{
+  CIEC61937Packer packer;
+  CHECK(packer.Open(IAudioRenderer::ENCODED_IEC61937_EAC3, false));
+  CHECK_EQUAL(packer.GetOutputRate(48000), 192000);
+
+  // six blocks a frame fill a period on their own
+  Bytes a = EAC3Frame(768, 0, 3, 1);
+  CHECK_EQUAL(packer.Pack(&a[0], a.size()), 24576);
+  CHECK_EQUAL(packer.GetOutputFrames(), 6144);
+  CHECK(CheckBurst(packer.GetOutput(), 24576, 0x0015, a.size(), a));
+
+  // one block a frame takes six frames, bursts only come with the sixth
+  Bytes all;
+  for(unsigned int i = 0; i < 6; i++)
+  {
+    Bytes f = EAC3Frame(256, 0, 0, i);
+    CHECK_EQUAL(packer.Pack(&f[0], f.size()), i < 5 ? 0 : 24576);
+    Append(all, f);
+  }
+  CHECK(CheckBurst(packer.GetOutput(), 24576, 0x0015, all.size(), all));
+
+  // a flush drops the frames collected so far
+  Bytes f = EAC3Frame(256, 0, 0, 9);
+  packer.Pack(&f[0], f.size());
+  packer.Reset();
+  for(unsigned int i = 0; i < 5; i++)
+    CHECK_EQUAL(packer.Pack(&f[0], f.size()), 0);
+  CHECK_EQUAL(packer.Pack(&f[0], f.size()), 24576);
+}
+
+static void TestDTS()
+{
+  CIEC61937Packer packer;
+  CHECK(packer.Open(IAudioRenderer::ENCODED_IEC61937_DTS, false));
+  CHECK_EQUAL(packer.GetOutputRate(48000), 48000);
+
+  // 512, 1024 and 2048 samples are burst types 11, 12 and 13
+  const unsigned int blocks[] = { 16, 32, 64 };
+  for(unsigned int i = 0; i < 3; i++)
+  {
+    unsigned int period = blocks[i] * 32;
+    Bytes f = DTSFrame(1006, blocks[i], 13, i);
+    Bytes data(f);
+    Append(data, f);
+
+    CHECK_EQUAL(packer.Pack(&data[0], data.size()), 2 * period * 4);
+    CHECK_EQUAL(packer.GetOutputFrames(), 2 * period);
+    CHECK(CheckBurst(packer.GetOutput(),              period * 4, 11 + i, f.size() * 8, f));
+    CHECK(CheckBurst(packer.GetOutput() + period * 4, period * 4, 11 + i, f.size() * 8, f));
+  }
+
+  // byte swapped input comes out the same
+  Bytes f = DTSFrame(1006, 16, 13, 7);
+  Bytes data(f);
+  Append(data, f);
+  Bytes swapped = SwapWords(data);
+  CHECK_EQUAL(packer.Pack(&swapped[0], swapped.size()), 2 * 2048);
+  CHECK(CheckBurst(packer.GetOutput(), 2048, 11, f.size() * 8, f));
+
+  // a frame as long as the period goes without the preamble
+  f = DTSFrame(2048, 16, 13, 8);
+  data = f;
+  Append(data, f);
+  CHECK_EQUAL(packer.Pack(&data[0], data.size()), 2 * 2048);
+  CHECK(SwapWords(Bytes(packer.GetOutput(), packer.GetOutput() + 2048)) == f);
+}
+
+static void TestDTSHD()
+{
+  CIEC61937Packer packer;
+  CHECK(packer.Open(IAudioRenderer::ENCODED_IEC61937_DTS, true));
+  CHECK_EQUAL(packer.GetOutputRate(48000), 192000);
+
+  // core and extension substream come in one packet
+  Bytes frame = DTSFrame(2012, 16, 13, 1);
+  Append(frame, DTSHDSubstream(3000));
+
+  // 4 x 512 samples is repetition period subtype 2
+  CHECK_EQUAL(packer.Pack(&frame[0], frame.size()), 8192);
+  CHECK_EQUAL(packer.GetOutputFrames(), 2048);
+
+  const uint8_t start[] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFE, 0xFE };
+  Bytes payload(start, start + sizeof(start));
+  payload.push_back(frame.size() >> 8);
+  payload.push_back(frame.size() & 0xFF);
+  Append(payload, frame);
+
+  unsigned int length_code = ((payload.size() + 0x8 + 0xF) & ~0xF) - 0x8;
+  CHECK_EQUAL(length_code & 0xF, 0x8);
+  CHECK(CheckBurst(packer.GetOutput(), 8192, 0x0211, length_code, payload));
+
+  // too big for the period, the core goes alone
+  Bytes big = DTSFrame(2012, 16, 13, 2);
+  Append(big, DTSHDSubstream(7000));
+  CHECK_EQUAL(packer.Pack(&big[0], big.size()), 8192);
+
+  Bytes core(big.begin(), big.begin() + 2012);
+  payload.assign(start, start + sizeof(start));
+  payload.push_back(core.size() >> 8);
+  payload.push_back(core.size() & 0xFF);
+  Append(payload, core);
+  length_code = ((payload.size() + 0x8 + 0xF) & ~0xF) - 0x8;
+  CHECK(CheckBurst(packer.GetOutput(), 8192, 0x0211, length_code, payload));
+}
+
+int main(int argc, char *argv[])
+{
+  TestAC3();
+  TestEAC3();
+  TestDTS();
+  TestDTSHD();
+
+  return TestResult("IEC61937PackerTest");
+}
@@ -0,0 +1,154 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// Readers of OMXClock against a writer, the way the video, audio and
+// subtitle threads read it while the player seeks and changes speed. The
+// clock state is covered by a sequence count: readers never see half of an
+// update and do not hold the writer off. Runs against the IL stand-in so
+// OMXMediaTime() makes real round trips to a clock component.
+
+#include "OMXClock.h"
+#include "OMXTest.h"
+
+#include <pthread.h>
+
+#define READERS     3
+#define RUN_MS      1000
+#define WRITE_MS    1
+
+static const double pts_a = 1.0;
+static const double pts_b = -12345678.9;
+
+typedef struct
+{
+  OMXClock        *clock;
+  volatile bool   *stop;
+  long            reads;
+  long            torn;
+  int64_t         worst;
+} Reader;
+
+static void *ReadClock(void *arg)
+{
+  Reader *r = (Reader *)arg;
+
+  while(!*r->stop)
+  {
+    int64_t start = OMXClock::CurrentHostCounter();
+    r->clock->GetClock();
+    r->clock->GetAbsoluteClock();
+    double pts = r->clock->GetPTS();
+    int64_t took = OMXClock::CurrentHostCounter() - start;
+
+    if(took > r->worst)
+      r->worst = took;
+    if(pts != pts_a && pts != pts_b && pts != DVD_NOPTS_VALUE)
+      r->torn++;
+    r->reads++;
+  }
+
+  return NULL;
+}
+
+static double UsPerCall(int64_t ticks, int calls)
+{
+  return (double)ticks * 1000000.0 / OMXClock::CurrentHostFrequency() / calls;
+}
+
+int main(int argc, char *argv[])
+{
+  COMXCore core;
+  CHECK(core.Initialize());
+
+  OMXClock clock;
+  CHECK(clock.OMXInitialize(true, true));
+  clock.OMXStateExecute();
+  clock.OMXStart(0.0);
+
+  volatile bool stop = false;
+  Reader readers[READERS];
+  pthread_t threads[READERS];
+
+  for(int i = 0; i < READERS; i++)
+  {
+    readers[i].clock = &clock;
+    readers[i].stop  = &stop;
+    readers[i].reads = 0;
+    readers[i].torn  = 0;
+    readers[i].worst = 0;
+    pthread_create(&threads[i], NULL, ReadClock, &readers[i]);
+  }
+
+  // seeks and speed changes at 1 kHz, far more often than playback does
+  int64_t end = OMXClock::CurrentHostCounter() + (int64_t)RUN_MS * OMXClock::CurrentHostFrequency() / 1000;
+  long writes = 0;
+  while(OMXClock::CurrentHostCounter() < end)
+  {
+    clock.Discontinuity(writes * 1000.0);
+    clock.SetPTS(writes & 1 ? pts_a : pts_b);
+    clock.SetSpeed(writes & 2 ? DVD_PLAYSPEED_NORMAL : 2 * DVD_PLAYSPEED_NORMAL);
+    writes++;
+    OMXClock::OMXSleep(WRITE_MS);
+  }
+
+  stop = true;
+
+  long reads = 0, torn = 0;
+  int64_t worst = 0;
+  for(int i = 0; i < READERS; i++)
+  {
+    pthread_join(threads[i], NULL);
+    reads += readers[i].reads;
+    torn  += readers[i].torn;
+    if(readers[i].worst > worst)
+      worst = readers[i].worst;
+  }
+
+  // a cached media time against a round trip to the clock component
+  const int calls = 10000;
+  int64_t start = OMXClock::CurrentHostCounter();
+  for(int i = 0; i < calls; i++)
+    clock.OMXMediaTime();
+  int64_t direct = OMXClock::CurrentHostCounter() - start;
+
+  start = OMXClock::CurrentHostCounter();
+  for(int i = 0; i < calls; i++)
+    clock.OMXMediaTimeCached();
+  int64_t cached = OMXClock::CurrentHostCounter() - start;
+
+  printf("%d readers: %.0f reads/s, worst read %.1f us, %ld torn\n",
+         READERS, reads * 1000.0 / RUN_MS, UsPerCall(worst, 1), torn);
+  printf("1 writer: %ld writes in %d ms\n", writes, RUN_MS);
+  printf("OMXMediaTime %.2f us/call, OMXMediaTimeCached %.3f us/call\n",
+         UsPerCall(direct, calls), UsPerCall(cached, calls));
+
+  CHECK_EQUAL(torn, 0);
+  CHECK(reads > 0);
+  // the sleeps alone allow RUN_MS writes, readers must not take half of them
+  CHECK(writes > RUN_MS / WRITE_MS / 2);
+  CHECK(cached < direct);
+
+  clock.Deinitialize();
+  core.Deinitialize();
+
+  return TestResult("OMXClockSeqlockTest");
+}
@@ -0,0 +1,217 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// The pending event index of COMXCoreComponent. Component events arrive on
+// the IL core's callback thread while several player threads wait for their
+// own command to complete; each waiter must get its event, whatever order
+// the completions come back in, and no other waiter's. Runs against the IL
+// stand-in so the completions come through the real callback path.
+
+#include "OMXCore.h"
+#include "OMXClock.h"
+#include "OMXTest.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#define CLOCK_PORTS   6
+#define CLOCK_ROUNDS  200
+#define WAITERS       32
+#define ROUNDS        500
+
+typedef struct
+{
+  COMXCoreComponent *component;
+  OMX_U32           port;
+  int               rounds;
+  bool              commands;   // disable then enable per round, else enable only
+  volatile int      *done;
+  int               errors;
+  int               timeouts;
+} Waiter;
+
+static void *Wait(void *arg)
+{
+  Waiter *w = (Waiter *)arg;
+
+  for(int r = 0; r < w->rounds; r++)
+  {
+    for(int pass = w->commands ? 0 : 1; pass < 2; pass++)
+    {
+      OMX_U32 command = pass ? OMX_CommandPortEnable : OMX_CommandPortDisable;
+      OMX_ERRORTYPE omx_err = w->component->WaitForCommand(command, w->port, 2000);
+      if(omx_err == OMX_ErrorMax)
+        w->timeouts++;
+      else if(omx_err != OMX_ErrorNone)
+        w->errors++;
+      __sync_fetch_and_add(w->done, 1);
+    }
+  }
+
+  return NULL;
+}
+
+static void StartWaiters(std::vector<Waiter> &waiters, std::vector<pthread_t> &threads)
+{
+  threads.resize(waiters.size());
+  for(size_t i = 0; i < waiters.size(); i++)
+    pthread_create(&threads[i], NULL, Wait, &waiters[i]);
+}
+
+static void JoinWaiters(std::vector<Waiter> &waiters, std::vector<pthread_t> &threads, int &errors, int &timeouts)
+{
+  errors = timeouts = 0;
+  for(size_t i = 0; i < waiters.size(); i++)
+  {
+    pthread_join(threads[i], NULL);
+    errors   += waiters[i].errors;
+    timeouts += waiters[i].timeouts;
+  }
+}
+
+// until every waiter has taken what it was sent, so no completion is sent
+// again while the last one for the same port is still pending
+static void WaitDone(volatile int *done, int count)
+{
+  while(__sync_fetch_and_add(done, 0) < count)
+    OMXClock::OMXSleep(0);
+}
+
+static double Ms(int64_t ticks)
+{
+  return (double)ticks * 1000.0 / OMXClock::CurrentHostFrequency();
+}
+
+int main(int argc, char *argv[])
+{
+  COMXCore core;
+  CHECK(core.Initialize());
+
+  COMXCoreComponent component;
+  CHECK(component.Initialize("OMX.broadcom.clock", OMX_IndexParamOtherInit));
+
+  // an exact key is taken once, a repeat of a pending event is dropped
+  component.AddEvent(OMX_EventCmdComplete, OMX_CommandPortEnable, 5);
+  component.AddEvent(OMX_EventCmdComplete, OMX_CommandPortEnable, 5);
+  CHECK_EQUAL(component.WaitForCommand(OMX_CommandPortEnable, 5, 0), OMX_ErrorNone);
+  CHECK_EQUAL(component.WaitForCommand(OMX_CommandPortEnable, 5, 0), OMX_ErrorMax);
+
+  // an error ends any wait and is taken by it
+  component.AddEvent(OMX_EventError, (OMX_U32)OMX_ErrorTimeout, 0);
+  CHECK_EQUAL(component.WaitForCommand(OMX_CommandPortEnable, 7, 0), OMX_ErrorTimeout);
+  CHECK_EQUAL(component.WaitForCommand(OMX_CommandPortEnable, 7, 0), OMX_ErrorMax);
+
+  // asking for the state the component is in counts as done
+  component.AddEvent(OMX_EventError, (OMX_U32)OMX_ErrorSameState, 1);
+  CHECK_EQUAL(component.WaitForEvent(OMX_EventPortSettingsChanged, 0), OMX_ErrorNone);
+
+  // a wait for a type takes any event of it, oldest first
+  component.AddEvent(OMX_EventPortSettingsChanged, 131, 0);
+  component.AddEvent(OMX_EventPortSettingsChanged, 130, 0);
+  CHECK_EQUAL(component.WaitForEvent(OMX_EventPortSettingsChanged, 0), OMX_ErrorNone);
+  CHECK_EQUAL(component.WaitForEvent(OMX_EventPortSettingsChanged, 0), OMX_ErrorNone);
+  CHECK_EQUAL(component.WaitForEvent(OMX_EventPortSettingsChanged, 0), OMX_ErrorMax);
+
+  // a match that came in before an error wins over it
+  component.AddEvent(OMX_EventCmdComplete, OMX_CommandPortEnable, 9);
+  component.AddEvent(OMX_EventError, (OMX_U32)OMX_ErrorTimeout, 0);
+  CHECK_EQUAL(component.WaitForCommand(OMX_CommandPortEnable, 9, 0), OMX_ErrorNone);
+  CHECK_EQUAL(component.WaitForCommand(OMX_CommandPortEnable, 9, 0), OMX_ErrorTimeout);
+
+  srand(1);
+
+  // one waiter per clock port, the component completes the port commands
+  // sent in a shuffled order each round
+  volatile int done = 0;
+  std::vector<Waiter> waiters(CLOCK_PORTS);
+  std::vector<pthread_t> threads;
+  std::vector<OMX_U32> order;
+  for(int i = 0; i < CLOCK_PORTS; i++)
+  {
+    Waiter w = { &component, (OMX_U32)(80 + i), CLOCK_ROUNDS, true, &done, 0, 0 };
+    waiters[i] = w;
+    order.push_back(w.port);
+  }
+
+  int64_t start = OMXClock::CurrentHostCounter();
+  StartWaiters(waiters, threads);
+  int sent = 0;
+  for(int r = 0; r < CLOCK_ROUNDS; r++)
+  {
+    for(int pass = 0; pass < 2; pass++)
+    {
+      OMX_COMMANDTYPE command = pass ? OMX_CommandPortEnable : OMX_CommandPortDisable;
+      std::random_shuffle(order.begin(), order.end());
+      for(int i = 0; i < CLOCK_PORTS; i++)
+        CHECK_EQUAL(OMX_SendCommand(component.GetComponent(), command, order[i], NULL), OMX_ErrorNone);
+      sent += CLOCK_PORTS;
+      WaitDone(&done, sent);
+    }
+  }
+  int errors, timeouts;
+  JoinWaiters(waiters, threads, errors, timeouts);
+  int64_t took = OMXClock::CurrentHostCounter() - start;
+
+  printf("%d port waiters x %d rounds: %.0f ms, %d errors, %d timeouts\n",
+         CLOCK_PORTS, CLOCK_ROUNDS, Ms(took), errors, timeouts);
+  CHECK_EQUAL(errors, 0);
+  CHECK_EQUAL(timeouts, 0);
+
+  // more waiters than a component has ports, completions added straight
+  // to the index as the callback thread would
+  done = 0;
+  waiters.resize(WAITERS);
+  order.clear();
+  for(int i = 0; i < WAITERS; i++)
+  {
+    Waiter w = { &component, (OMX_U32)(1000 + i), ROUNDS, false, &done, 0, 0 };
+    waiters[i] = w;
+    order.push_back(w.port);
+  }
+
+  start = OMXClock::CurrentHostCounter();
+  StartWaiters(waiters, threads);
+  sent = 0;
+  for(int r = 0; r < ROUNDS; r++)
+  {
+    std::random_shuffle(order.begin(), order.end());
+    for(int i = 0; i < WAITERS; i++)
+      component.AddEvent(OMX_EventCmdComplete, OMX_CommandPortEnable, order[i]);
+    sent += WAITERS;
+    WaitDone(&done, sent);
+  }
+  JoinWaiters(waiters, threads, errors, timeouts);
+  took = OMXClock::CurrentHostCounter() - start;
+
+  printf("%d waiters x %d rounds: %.0f ms, %.1f us per event, %d errors, %d timeouts\n",
+         WAITERS, ROUNDS, Ms(took), Ms(took) * 1000.0 / (WAITERS * ROUNDS), errors, timeouts);
+  CHECK_EQUAL(errors, 0);
+  CHECK_EQUAL(timeouts, 0);
+
+  component.Deinitialize();
+  core.Deinitialize();
+
+  return TestResult("OMXEventTest");
+}
@@ -0,0 +1,170 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// The video pipeline COMXVideo builds, clock, video_decode, video_scheduler
+// and video_render, set up and fed through COMXCoreComponent and
+// COMXCoreTunel against the IL stand-in. Frames are played to the end of
+// stream at the clock's pace, with the decoder's port settings change
+// handled the way COMXVideo::PortSettingsChanged does.
+
+#include "OMXCore.h"
+#include "OMXClock.h"
+#include "OMXTest.h"
+
+#define FRAMES          50
+#define FRAME_US        20000
+#define EOS_TIMEOUT_MS  5000
+
+static COMXCoreComponent decoder;
+static COMXCoreComponent sched;
+static COMXCoreComponent render;
+
+static void PortSettingsChanged()
+{
+  OMX_PARAM_PORTDEFINITIONTYPE port_image;
+  OMX_INIT_STRUCTURE(port_image);
+  port_image.nPortIndex = decoder.GetOutputPort();
+  CHECK_EQUAL(decoder.GetParameter(OMX_IndexParamPortDefinition, &port_image), OMX_ErrorNone);
+
+  CHECK_EQUAL(decoder.DisablePort(decoder.GetOutputPort(), true), OMX_ErrorNone);
+  CHECK_EQUAL(sched.DisablePort(sched.GetInputPort(), true), OMX_ErrorNone);
+
+  port_image.nPortIndex = sched.GetInputPort();
+  CHECK_EQUAL(sched.SetParameter(OMX_IndexParamPortDefinition, &port_image), OMX_ErrorNone);
+  CHECK_EQUAL(sched.WaitForEvent(OMX_EventPortSettingsChanged), OMX_ErrorNone);
+
+  CHECK_EQUAL(decoder.EnablePort(decoder.GetOutputPort(), true), OMX_ErrorNone);
+  CHECK_EQUAL(sched.EnablePort(sched.GetInputPort(), true), OMX_ErrorNone);
+}
+
+int main(int argc, char *argv[])
+{
+  COMXCore core;
+  CHECK(core.Initialize());
+
+  OMXClock clock;
+  CHECK(clock.OMXInitialize(true, false));
+  clock.OMXStateIdle();
+  COMXCoreComponent *omx_clock = clock.GetOMXClock();
+
+  CHECK(decoder.Initialize("OMX.broadcom.video_decode", OMX_IndexParamVideoInit));
+  CHECK(sched.Initialize("OMX.broadcom.video_scheduler", OMX_IndexParamVideoInit));
+  CHECK(render.Initialize("OMX.broadcom.video_render", OMX_IndexParamVideoInit));
+
+  COMXCoreTunel tunnel_decoder;
+  COMXCoreTunel tunnel_sched;
+  COMXCoreTunel tunnel_clock;
+  tunnel_decoder.Initialize(&decoder, decoder.GetOutputPort(), &sched, sched.GetInputPort());
+  tunnel_sched.Initialize(&sched, sched.GetOutputPort(), &render, render.GetInputPort());
+  tunnel_clock.Initialize(omx_clock, omx_clock->GetInputPort() + 1, &sched, sched.GetOutputPort() + 1);
+
+  CHECK_EQUAL(tunnel_clock.Establish(false), OMX_ErrorNone);
+  CHECK_EQUAL(decoder.SetStateForComponent(OMX_StateIdle), OMX_ErrorNone);
+  CHECK_EQUAL(decoder.AllocInputBuffers(), OMX_ErrorNone);
+  CHECK_EQUAL(tunnel_decoder.Establish(false), OMX_ErrorNone);
+  CHECK_EQUAL(decoder.SetStateForComponent(OMX_StateExecuting), OMX_ErrorNone);
+  CHECK_EQUAL(tunnel_sched.Establish(false), OMX_ErrorNone);
+  CHECK_EQUAL(sched.SetStateForComponent(OMX_StateExecuting), OMX_ErrorNone);
+  CHECK_EQUAL(render.SetStateForComponent(OMX_StateExecuting), OMX_ErrorNone);
+
+  unsigned int buffers = decoder.GetInputBufferSize();
+  CHECK(buffers > 0);
+  CHECK_EQUAL(decoder.GetInputBufferSpace(), buffers);
+
+  clock.OMXStart(0.0);
+  clock.OMXStateExecute();
+
+  int64_t start = OMXClock::CurrentHostCounter();
+  int settings = 0;
+  int submitted = 0;
+  for(int n = 0; n <= FRAMES; n++)
+  {
+    OMX_BUFFERHEADERTYPE *omx_buffer = decoder.GetInputBuffer(1000);
+    CHECK(omx_buffer != NULL);
+    if(!omx_buffer)
+      break;
+
+    // the last buffer is an empty one carrying the end of stream, as COMXVideo::SubmitEOS sends it
+    omx_buffer->nOffset     = 0;
+    omx_buffer->nFilledLen  = n < FRAMES ? 1000 : 0;
+    omx_buffer->nTimeStamp  = ToOMXTime((int64_t)n * FRAME_US);
+    omx_buffer->nFlags      = n < FRAMES ? OMX_BUFFERFLAG_ENDOFFRAME : OMX_BUFFERFLAG_EOS;
+    if(n == 0)
+      omx_buffer->nFlags   |= OMX_BUFFERFLAG_STARTTIME;
+
+    CHECK_EQUAL(decoder.EmptyThisBuffer(omx_buffer), OMX_ErrorNone);
+    submitted++;
+
+    if(decoder.WaitForEvent(OMX_EventPortSettingsChanged, 0) == OMX_ErrorNone)
+    {
+      PortSettingsChanged();
+      settings++;
+    }
+  }
+
+  int waited = 0;
+  while(!render.IsEOS() && waited < EOS_TIMEOUT_MS)
+  {
+    if(!settings && decoder.WaitForEvent(OMX_EventPortSettingsChanged, 0) == OMX_ErrorNone)
+    {
+      PortSettingsChanged();
+      settings++;
+    }
+    OMXClock::OMXSleep(10);
+    waited += 10;
+  }
+  double took = (double)(OMXClock::CurrentHostCounter() - start) / OMXClock::CurrentHostFrequency();
+  double media = clock.OMXMediaTime();
+
+  printf("%d frames in %.3f s, media time %.3f s, %d settings changes, %.1f ms waiting for input buffers\n",
+         submitted - 1, took, media / DVD_TIME_BASE, settings, decoder.GetInputWaitTime());
+
+  CHECK(render.IsEOS());
+  CHECK_EQUAL(settings, 1);
+  CHECK_EQUAL(submitted, FRAMES + 1);
+  // the scheduler holds each frame until the clock reaches it
+  CHECK(media >= (double)(FRAMES - 1) * FRAME_US);
+  CHECK(took >= (double)(FRAMES - 1) * FRAME_US / 1e6);
+  CHECK(took < (double)(FRAMES - 1) * FRAME_US / 1e6 + 1.0);
+  CHECK_EQUAL(decoder.GetInputBufferSpace(), buffers);
+
+  clock.OMXStop();
+  clock.OMXStateIdle();
+
+  tunnel_decoder.Flush();
+  tunnel_clock.Flush();
+  tunnel_sched.Flush();
+
+  tunnel_clock.Deestablish();
+  tunnel_decoder.Deestablish();
+  tunnel_sched.Deestablish();
+
+  decoder.FlushInput();
+
+  CHECK(sched.Deinitialize());
+  CHECK(decoder.Deinitialize());
+  CHECK(render.Deinitialize());
+  clock.Deinitialize();
+  core.Deinitialize();
+
+  return TestResult("OMXPipelineTest");
+}
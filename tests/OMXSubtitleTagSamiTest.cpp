@@ -0,0 +1,206 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// COMXSubtitleTagSami against what the CRegExp based version it replaced
+// produced for the same lines, quirks included. Each case runs its lines
+// through one tagger and then CloseTag, the text elements that come out
+// are joined with a | after each.
+
+#include "OMXSubtitleTagSami.h"
+#include "OMXOverlayText.h"
+#include "OMXTest.h"
+
+#include <string>
+
+typedef struct
+{
+  const char  *lines[3];
+  const char  *lang;
+  const char  *expected;
+} SamiCase;
+
+static const SamiCase cases[] =
+{
+  // text only
+  { { "Plain text" }, NULL,
+    "Plain text|" },
+  { { "  padded and trimmed \t" }, NULL,
+    "padded and trimmed|" },
+  { { "" }, NULL,
+    "" },
+
+  // italic is dropped, bold becomes [B]; only the tag itself is lower cased
+  { { "<i>Where are you going?</i>" }, NULL,
+    "Where are you going?|" },
+  { { "<I>Upper case italic</I>" }, NULL,
+    "Upper case italic|" },
+  { { "<i>never closed" }, NULL,
+    "never closed|[/I]|" },
+  { { "</i>closed, never opened" }, NULL,
+    "closed, never opened|" },
+  { { "<b>Bold</b> text" }, NULL,
+    "[B]Bold[/B] text|" },
+  { { "<B>Bold</b> mixed <b>case</B>" }, NULL,
+    "[B]Bold[/B] mixed [B]case[/B]|" },
+  { { "</b>closed, never opened" }, NULL,
+    "closed, never opened|" },
+  { { "<b>never closed" }, NULL,
+    "[B]never closed|[/B]|" },
+  { { "{\\b1}ass bold{\\b0}" }, NULL,
+    "[B]ass bold[/B]|" },
+  { { "{\\i1}ass italic{\\i0}" }, NULL,
+    "ass italic|" },
+  { { "{\\B1}upper case ass{\\I1}" }, NULL,
+    "[B]upper case ass|[/B]|[/I]|" },
+
+  // font colours, # and six hex digits get an FF alpha, names are kept
+  { { "<font color=\"#ff0000\">Red</font>" }, NULL,
+    "[COLOR FFff0000]Red[/COLOR]|" },
+  { { "<FONT COLOR = \"Blue\">Blue</FONT>" }, NULL,
+    "[COLOR blue]Blue[/COLOR]|" },
+  { { "<Font Color=\"#FFFF00\">- Home.</Font><BR>- Now?" }, NULL,
+    "[COLOR FFffff00]- Home.[/COLOR]\n- Now?|" },
+  { { "<font color='00ff00'>bare hex</font>" }, NULL,
+    "[COLOR FF00ff00]bare hex[/COLOR]|" },
+  { { "<font color=ffgg00>six, not hex</font>" }, NULL,
+    "[COLOR ffgg00]six, not hex[/COLOR]|" },
+  { { "<font color=red>name" }, NULL,
+    "[COLOR red]name|[/COLOR]|" },
+  { { "<font face=Arial color=#00FF00 size=3>several options</font>" }, NULL,
+    "[COLOR FF00ff00]several options[/COLOR]|" },
+  { { "<font size=3>no color</font>" }, NULL,
+    "no color|" },
+  { { "<font color=>empty value</font>" }, NULL,
+    "empty value|" },
+  { { "<font color=\"\">empty quotes</font>" }, NULL,
+    "empty quotes|" },
+  { { "<font\tcolor=\t\"#abc\">tabs</font>" }, NULL,
+    "[COLOR FFabc]tabs[/COLOR]|" },
+  { { "<font color=\"#ff0000\" color=\"#00ff00\">twice</font>" }, NULL,
+    "[COLOR FFff0000][COLOR FF00ff00]twice[/COLOR]|" },
+  { { "</font>closed, never opened" }, NULL,
+    "closed, never opened|" },
+
+  // ass colours are BGR
+  { { "{\\c&h0000ff&}ass colour{\\c}" }, NULL,
+    "[COLOR FFff0000]ass colour[/COLOR]|" },
+  { { "{\\1c&hff0000&}primary colour" }, NULL,
+    "[COLOR FF0000ff]primary colour|[/COLOR]|" },
+  { { "{\\C&H00FF00&}upper case colour" }, NULL,
+    "[COLOR FF00ff00]upper case colour|[/COLOR]|" },
+
+  // line breaks
+  { { "Line one<br>Line two" }, NULL,
+    "Line one\nLine two|" },
+  { { "<BR>leading break" }, NULL,
+    "\nleading break|" },
+  { { "trailing break<br>" }, NULL,
+    "trailing break|" },
+  { { "<br>" }, NULL,
+    "" },
+  { { "a\\nb\\Nc" }, NULL,
+    "a\nb\nc|" },
+
+  // malformed and unknown tags
+  { { "<unclosed tag" }, NULL,
+    "<unclosed tag|" },
+  { { "{unclosed brace" }, NULL,
+    "{unclosed brace|" },
+  { { "stray > and } closers" }, NULL,
+    "stray > and } closers|" },
+  { { "<>{}< >empty tags" }, NULL,
+    "empty tags|" },
+  { { "<x a=\"b\">unknown tag</x>" }, NULL,
+    "unknown tag|" },
+  { { "<<i>>nested<</i>>" }, NULL,
+    ">nested>|" },
+  { { "{<i>}mixed{</i>}" }, NULL,
+    "mixed|" },
+
+  // <p class> keeps only the given language, nothing without one
+  { { "<p class=ENCC>english</p><p class=KRCC>korean</p>" }, NULL,
+    "englishkorean|" },
+  { { "<p class=ENCC>english</p><p class=KRCC>korean</p>" }, "encc",
+    "korean|" },
+  { { "<P CLASS='KRCC'>korean</P>after" }, "krcc",
+    "after|" },
+  { { "<p class = frcc>french</p>after" }, "encc",
+    "frenchafter|" },
+  { { "<p class=encc>never closed" }, "encc",
+    "" },
+  { { "<p class=encc>one<p class=encc>two</p>three" }, "encc",
+    "three|" },
+  { { "<p id=x>no class</p>" }, "encc",
+    "no class|" },
+
+  // the state carries over to the next line of the same subtitle
+  { { "<b>first line", "second line</b>" }, NULL,
+    "[B]first line|second line[/B]|" },
+  { { "<font color=red>first", "second</font>" }, NULL,
+    "[COLOR red]first|second[/COLOR]|" },
+  { { "<i>first", "<b>second", "third" }, NULL,
+    "first|[B]second|third|[/B]|[/I]|" },
+  { { "<p class=encc>first", "second</p>" }, "encc",
+    "" },
+};
+
+static std::string Convert(const SamiCase &c)
+{
+  COMXSubtitleTagSami tagger;
+  COMXOverlayText overlay;
+  std::string text;
+
+  if(!tagger.Init())
+    return "Init failed";
+
+  for(int i = 0; i < 3 && c.lines[i]; i++)
+    tagger.ConvertLine(&overlay, c.lines[i], strlen(c.lines[i]), c.lang);
+  tagger.CloseTag(&overlay);
+
+  for(COMXOverlayText::CElement *e = overlay.m_pHead; e; e = e->pNext)
+  {
+    if(e->IsElementType(COMXOverlayText::ELEMENT_TYPE_TEXT))
+      text += ((COMXOverlayText::CElementText *)e)->m_text;
+    text += "|";
+  }
+
+  return text;
+}
+
+int main(int argc, char *argv[])
+{
+  int count = sizeof(cases) / sizeof(cases[0]);
+
+  for(int i = 0; i < count; i++)
+  {
+    std::string text = Convert(cases[i]);
+    if(text != cases[i].expected)
+    {
+      printf("case %d \"%s\": got \"%s\", expected \"%s\"\n", i, cases[i].lines[0], text.c_str(), cases[i].expected);
+      test_failures++;
+    }
+  }
+
+  printf("%d SAMI cases\n", count);
+
+  return TestResult("OMXSubtitleTagSamiTest");
+}
@@ -0,0 +1,72 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#ifndef _OMX_TEST_H_
+#define _OMX_TEST_H_
+
+// Checks for the host tests in this directory. Each test is a program of its
+// own that prints what failed and returns non zero if anything did.
+
+#include <stdio.h>
+#include <math.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) \
+  do { \
+    if(!(cond)) \
+    { \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      test_failures++; \
+    } \
+  } while(0)
+
+#define CHECK_EQUAL(a, b) \
+  do { \
+    long long _a = (long long)(a), _b = (long long)(b); \
+    if(_a != _b) \
+    { \
+      printf("%s:%d: CHECK_EQUAL(%s, %s) failed, %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+      test_failures++; \
+    } \
+  } while(0)
+
+#define CHECK_CLOSE(a, b, tolerance) \
+  do { \
+    double _a = (double)(a), _b = (double)(b); \
+    if(fabs(_a - _b) > (tolerance)) \
+    { \
+      printf("%s:%d: CHECK_CLOSE(%s, %s) failed, %g != %g\n", __FILE__, __LINE__, #a, #b, _a, _b); \
+      test_failures++; \
+    } \
+  } while(0)
+
+static inline int TestResult(const char *name)
+{
+  if(test_failures)
+    printf("%s: %d checks failed\n", name, test_failures);
+  else
+    printf("%s: ok\n", name);
+  return test_failures ? 1 : 0;
+}
+
+#endif
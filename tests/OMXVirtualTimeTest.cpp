@@ -0,0 +1,244 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// The player loops on a COMXVirtualTimeSource: a main thread that polls and
+// pauses, a video thread that shows frames on OMXClock::GetClock() and an
+// audio thread that feeds 10 ms chunks and resyncs the clock, all of them
+// registered. Ten minutes of media run in a fraction of that, the same way
+// every time: two runs leave the same trace. The trace of the first run is
+// kept in the file given as argument.
+
+#include "OMXClock.h"
+#include "OMXTimeSource.h"
+#include "OMXTest.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <string>
+
+#define MEDIA_US        (600 * 1000000.0)
+#define FRAME_US        40000.0
+#define CHUNK_US        10000.0
+#define PAUSE_AT_US     (300 * 1000000.0)
+#define PAUSE_MS        5000
+
+typedef struct
+{
+  COMXVirtualTimeSource *source;
+  OMXClock              *clock;
+  sem_t                 registered;
+  volatile bool         paused;
+  volatile bool         audio_done;
+  volatile bool         video_done;
+  volatile double       audio_pts;
+  long                  frames;
+  long                  late;
+  double                worst_late;
+  long                  resyncs;
+} Run;
+
+static void *Video(void *arg)
+{
+  Run *run = (Run *)arg;
+  run->source->Register("video");
+  sem_post(&run->registered);
+
+  double pts = 0.0;
+  while(pts < MEDIA_US)
+  {
+    double now = run->clock->GetClock();
+    if(now < pts)
+    {
+      OMXClock::OMXSleep((unsigned int)((pts - now) / 1000) + 1);
+      continue;
+    }
+
+    double late = now - pts;
+    if(late > FRAME_US / 2)
+      run->late++;
+    if(late > run->worst_late)
+      run->worst_late = late;
+    if(fmod(pts, 60 * 1000000.0) == 0.0)
+      run->source->Trace("frame %.0f late %.0f", pts, late);
+
+    run->frames++;
+    pts += FRAME_US;
+  }
+
+  run->video_done = true;
+  run->source->Unregister();
+  return NULL;
+}
+
+static void *Audio(void *arg)
+{
+  Run *run = (Run *)arg;
+  run->source->Register("audio");
+  sem_post(&run->registered);
+
+  double pts = 0.0;
+  while(pts < MEDIA_US)
+  {
+    if(!run->paused)
+    {
+      // what OMXPlayerAudio does when the clock drifts away from the audio
+      if(fabs(pts - run->clock->GetClock()) > 100000.0)
+      {
+        run->source->Trace("resync %.0f", pts);
+        run->clock->Discontinuity(pts);
+        run->resyncs++;
+      }
+      pts += CHUNK_US;
+      run->audio_pts = pts;
+    }
+    OMXClock::OMXSleep(CHUNK_US / 1000);
+  }
+
+  run->audio_done = true;
+  run->source->Unregister();
+  return NULL;
+}
+
+static double WallSeconds()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static std::string ReadFile(const char *filename)
+{
+  std::string data;
+  char buf[4096];
+  size_t got;
+
+  FILE *f = fopen(filename, "r");
+  if(!f)
+    return data;
+  while((got = fread(buf, 1, sizeof(buf), f)) > 0)
+    data.append(buf, got);
+  fclose(f);
+  return data;
+}
+
+static void Play(Run *run, const char *trace)
+{
+  COMXVirtualTimeSource source;
+  OMXClock::SetTimeSource(&source);
+
+  OMXClock clock;
+  run->source     = &source;
+  run->clock      = &clock;
+  run->paused     = false;
+  run->audio_done = false;
+  run->video_done = false;
+  run->audio_pts  = 0.0;
+  run->frames     = 0;
+  run->late       = 0;
+  run->worst_late = 0.0;
+  run->resyncs    = 0;
+  sem_init(&run->registered, 0, 0);
+
+  // time stands still while main waits for a thread to register. The sleep
+  // returns once the new thread sleeps too, from then on only one of them
+  // runs at a time and the trace is the same on every run
+  source.Register("main");
+  pthread_t video, audio;
+  pthread_create(&video, NULL, Video, run);
+  sem_wait(&run->registered);
+  OMXClock::OMXSleep(0);
+  pthread_create(&audio, NULL, Audio, run);
+  sem_wait(&run->registered);
+  OMXClock::OMXSleep(0);
+  source.OpenTrace(trace);
+
+  bool paused_once = false;
+  while(!run->audio_done || !run->video_done)
+  {
+    if(!paused_once && run->audio_pts >= PAUSE_AT_US)
+    {
+      source.Trace("pause");
+      run->paused = true;
+      clock.Pause();
+      OMXClock::OMXSleep(PAUSE_MS);
+      clock.Resume();
+      run->paused = false;
+      source.Trace("resume");
+      paused_once = true;
+    }
+    OMXClock::OMXSleep(100);
+  }
+
+  double end = clock.GetAbsoluteClock();
+  source.Unregister();
+
+  pthread_join(video, NULL);
+  pthread_join(audio, NULL);
+  sem_destroy(&run->registered);
+
+  printf("%ld frames, %ld late (worst %.0f us), %ld resyncs, %lld advances, %.3f s virtual\n",
+         run->frames, run->late, run->worst_late, run->resyncs, (long long)source.GetAdvances(), end / 1e6);
+
+  OMXClock::SetTimeSource(NULL);
+}
+
+int main(int argc, char *argv[])
+{
+  Run first, second;
+  char first_trace[]  = "/tmp/OMXVirtualTimeTest.XXXXXX";
+  char second_trace[] = "/tmp/OMXVirtualTimeTest.XXXXXX";
+
+  CHECK(close(mkstemp(first_trace)) == 0);
+  CHECK(close(mkstemp(second_trace)) == 0);
+
+  double start = WallSeconds();
+  Play(&first, argc > 1 ? argv[1] : first_trace);
+  double took = WallSeconds() - start;
+  printf("%.0f s of media in %.2f s\n", MEDIA_US / 1e6, took);
+
+  CHECK_EQUAL(first.frames, MEDIA_US / FRAME_US);
+  CHECK_EQUAL(first.late, 0);
+  CHECK_EQUAL(first.resyncs, 0);
+  // at least ten times faster than realtime
+  CHECK(took < MEDIA_US / 1e6 / 10);
+
+  // and the same again
+  Play(&second, second_trace);
+  CHECK_EQUAL(second.frames, first.frames);
+  CHECK_EQUAL(second.late, first.late);
+  CHECK_EQUAL(second.worst_late, first.worst_late);
+  CHECK_EQUAL(second.resyncs, first.resyncs);
+
+  std::string trace = ReadFile(argc > 1 ? argv[1] : first_trace);
+  CHECK(!trace.empty());
+  CHECK(trace == ReadFile(second_trace));
+
+  unlink(first_trace);
+  unlink(second_trace);
+
+  return TestResult("OMXVirtualTimeTest");
+}
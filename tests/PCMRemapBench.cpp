@@ -0,0 +1,192 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// Mixing speed of CPCMRemap::Remap() against the lookup table path it
+// replaced. The old path went through every output channel's list of
+// inputs into a zeroed float buffer and then copied that out clamped,
+// ProcessInput() and ProcessOutput() in the history. It is kept here as the
+// reference, minus the rounding to integers ProcessOutput() did on float
+// samples, and both have to produce the same output.
+
+#include "utils/PCMRemap.h"
+#include "OMXTest.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <algorithm>
+#include <vector>
+
+class CPCMRemapBench : public CPCMRemap
+{
+public:
+  float Level(unsigned int out, unsigned int in) { return m_matrix[out][in]; }
+};
+
+struct LookupEntry
+{
+  unsigned int  in;
+  float         level;
+};
+
+// the lookup table path, one list of inputs per output
+class CLookupRemap
+{
+public:
+  CLookupRemap(CPCMRemapBench &remap, unsigned int in, unsigned int out) : m_in(in), m_out(out)
+  {
+    m_lookup.resize(out);
+    for(unsigned int o = 0; o < out; o++)
+      for(unsigned int i = 0; i < in; i++)
+        if(remap.Level(o, i) != 0.0f)
+        {
+          LookupEntry entry = { i, remap.Level(o, i) };
+          m_lookup[o].push_back(entry);
+        }
+  }
+
+  void Remap(const float *in, float *out, unsigned int samples)
+  {
+    if(m_buf.size() < samples * m_out)
+      m_buf.resize(samples * m_out);
+
+    memset(out, 0, samples * m_out * sizeof(float));
+    memset(&m_buf[0], 0, m_buf.size() * sizeof(float));
+
+    for(unsigned int ch = 0; ch < m_out; ch++)
+    {
+      std::vector<LookupEntry> &info = m_lookup[ch];
+      if(info.size() == 1 && info[0].level == 1.0f)
+      {
+        const float *src = in + info[0].in;
+        for(float *dst = out + ch, *end = dst + samples * m_out; dst < end; dst += m_out, src += m_in)
+          *dst = *src;
+        continue;
+      }
+
+      for(size_t e = 0; e < info.size(); e++)
+      {
+        const float *src = in + info[e].in;
+        for(float *dst = &m_buf[ch], *end = dst + samples * m_out; dst < end; dst += m_out, src += m_in)
+          *dst += *src * info[e].level;
+      }
+    }
+
+    for(unsigned int ch = 0; ch < m_out; ch++)
+    {
+      std::vector<LookupEntry> &info = m_lookup[ch];
+      if(info.size() == 1 && info[0].level == 1.0f)
+        continue;
+
+      const float *src = &m_buf[ch];
+      for(float *dst = out + ch, *end = dst + samples * m_out; dst < end; dst += m_out, src += m_out)
+        *dst = std::min(std::max(*src, -1.0f), 1.0f);
+    }
+  }
+
+private:
+  unsigned int                            m_in;
+  unsigned int                            m_out;
+  std::vector<std::vector<LookupEntry> >  m_lookup;
+  std::vector<float>                      m_buf;
+};
+
+static enum PCMChannels layout_20[] = { PCM_FRONT_LEFT, PCM_FRONT_RIGHT, PCM_INVALID };
+static enum PCMChannels layout_51[] = {
+  PCM_FRONT_LEFT, PCM_FRONT_RIGHT, PCM_FRONT_CENTER, PCM_LOW_FREQUENCY,
+  PCM_BACK_LEFT, PCM_BACK_RIGHT, PCM_INVALID
+};
+static enum PCMChannels layout_71[] = {
+  PCM_FRONT_LEFT, PCM_FRONT_RIGHT, PCM_FRONT_CENTER, PCM_LOW_FREQUENCY,
+  PCM_BACK_LEFT, PCM_BACK_RIGHT, PCM_SIDE_LEFT, PCM_SIDE_RIGHT, PCM_INVALID
+};
+
+// same as downmixing_coefficients_6 in OMXAudio.cpp, quiet enough not to clip
+static const float coefficients_6[12] = {
+  0.32,   0,
+  0,      0.32,
+  0.2263, 0.2263,
+  0.2263, 0.2263,
+  0.2263, 0,
+  0,      0.2263
+};
+
+static double Now()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+#define BENCH_FRAMES  4096
+#define BENCH_SECONDS 60
+
+static void Bench(const char *name, unsigned int in_ch, enum PCMChannels *in_map,
+                  unsigned int out_ch, enum PCMChannels *out_map, const float *matrix = NULL)
+{
+  CPCMRemapBench remap;
+  remap.SetInputFormat(in_ch, in_map, sizeof(float), 48000);
+  remap.SetOutputFormat(out_ch, out_map, true);
+  if(matrix)
+    remap.SetMatrix(matrix);
+
+  CLookupRemap lookup(remap, in_ch, out_ch);
+
+  std::vector<float> in(BENCH_FRAMES * in_ch);
+  for(size_t i = 0; i < in.size(); i++)
+    in[i] = 0.1f * sinf(i * 0.013f);
+  std::vector<float> out_new(BENCH_FRAMES * out_ch), out_old(BENCH_FRAMES * out_ch);
+
+  remap.Remap(&in[0], &out_new[0], BENCH_FRAMES);
+  lookup.Remap(&in[0], &out_old[0], BENCH_FRAMES);
+  for(size_t i = 0; i < out_new.size(); i++)
+    CHECK_CLOSE(out_new[i], out_old[i], 1e-6);
+
+  // a minute of 48kHz audio each
+  unsigned int blocks = 48000 * BENCH_SECONDS / BENCH_FRAMES;
+
+  double start = Now();
+  for(unsigned int b = 0; b < blocks; b++)
+    lookup.Remap(&in[0], &out_old[0], BENCH_FRAMES);
+  double before = Now() - start;
+
+  start = Now();
+  for(unsigned int b = 0; b < blocks; b++)
+    remap.Remap(&in[0], &out_new[0], BENCH_FRAMES);
+  double after = Now() - start;
+
+  double frames = (double)blocks * BENCH_FRAMES;
+  printf("%-18s %10.1f %10.1f %8.2fx\n", name, frames / before / 1e6, frames / after / 1e6, before / after);
+}
+
+int main(int argc, char *argv[])
+{
+  printf("%-18s %10s %10s %9s\n", "Mframes/s", "before", "after", "speedup");
+
+  Bench("2.0 -> 2.0", 2, layout_20, 2, layout_20);
+  Bench("5.1 -> 2.0", 6, layout_51, 2, layout_20);
+  Bench("5.1 -> 2.0 dolby", 6, layout_51, 2, layout_20, coefficients_6);
+  Bench("7.1 -> 2.0", 8, layout_71, 2, layout_20);
+  Bench("7.1 -> 5.1", 8, layout_71, 6, layout_51);
+
+  return TestResult("PCMRemapBench");
+}
@@ -0,0 +1,183 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// Downmixing through CPCMRemap the way COMXAudio does with --boost-on-downmix:
+// the un-normalised Dolby matrix, planar float in and out, limiter on.
+
+#include "utils/PCMRemap.h"
+#include "OMXTest.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+// same as downmixing_coefficients_6 in OMXAudio.cpp, a row per input channel
+static const float coefficients_6[12] = {
+  1,      0,
+  0,      1,
+  0.7071, 0.7071,
+  0.7071, 0.7071,
+  0.7071, 0,
+  0,      0.7071
+};
+
+static enum PCMChannels layout_51[7] = {
+  PCM_FRONT_LEFT, PCM_FRONT_RIGHT, PCM_FRONT_CENTER, PCM_LOW_FREQUENCY,
+  PCM_BACK_LEFT, PCM_BACK_RIGHT, PCM_INVALID
+};
+static enum PCMChannels layout_20[3] = { PCM_FRONT_LEFT, PCM_FRONT_RIGHT, PCM_INVALID };
+
+static void SetupDownmix(CPCMRemap &remap)
+{
+  remap.Reset();
+  remap.SetInputFormat(6, layout_51, sizeof(float), 48000);
+  remap.SetOutputFormat(2, layout_20, true);
+  remap.SetMatrix(coefficients_6);
+}
+
+// frames of planar 5.1, every channel a sine of its own frequency at level
+static std::vector<float> Planar51(unsigned int frames, float level, unsigned int offset = 0)
+{
+  std::vector<float> planes(frames * 6);
+  for(unsigned int ch = 0; ch < 6; ch++)
+    for(unsigned int i = 0; i < frames; i++)
+      planes[ch * frames + i] = level * sinf((float)(i + offset) * (0.01f + ch * 0.003f));
+  return planes;
+}
+
+static std::vector<float> Interleave(const std::vector<float> &planes, unsigned int channels)
+{
+  unsigned int frames = planes.size() / channels;
+  std::vector<float> out(planes.size());
+  for(unsigned int ch = 0; ch < channels; ch++)
+    for(unsigned int i = 0; i < frames; i++)
+      out[i * channels + ch] = planes[ch * frames + i];
+  return out;
+}
+
+static float Peak(const std::vector<float> &buf)
+{
+  float peak = 0.0f;
+  for(size_t i = 0; i < buf.size(); i++)
+    peak = std::max(peak, fabsf(buf[i]));
+  return peak;
+}
+
+// full scale 5.1 sums to more than 3x full scale in the front channels
+static void TestLimiterHoldsFullScale()
+{
+  CPCMRemap remap;
+  SetupDownmix(remap);
+
+  unsigned int frames = 1024;
+  for(int block = 0; block < 50; block++)
+  {
+    std::vector<float> in = Planar51(frames, 1.0f, block * frames);
+    std::vector<float> out(frames * 2);
+    remap.RemapPlanar(&in[0], &out[0], frames);
+    CHECK(Peak(out) <= 1.0f);
+  }
+  CHECK(remap.GetCurrentAttenuation() < 0.5f);
+}
+
+// planar and interleaved buffers go through the same mix and limiter
+static void TestPlanarMatchesInterleaved()
+{
+  CPCMRemap planar, interleaved;
+  SetupDownmix(planar);
+  SetupDownmix(interleaved);
+
+  unsigned int frames = 1000;
+  for(int block = 0; block < 20; block++)
+  {
+    std::vector<float> in = Planar51(frames, block < 10 ? 0.9f : 0.05f, block * frames);
+    std::vector<float> in_i = Interleave(in, 6);
+    std::vector<float> out(frames * 2), out_i(frames * 2);
+
+    planar.RemapPlanar(&in[0], &out[0], frames);
+    interleaved.Remap(&in_i[0], &out_i[0], frames);
+
+    std::vector<float> out_p = Interleave(out, 2);
+    CHECK(memcmp(&out_p[0], &out_i[0], out_i.size() * sizeof(float)) == 0);
+  }
+}
+
+// quiet input is mixed with the plain matrix, and once a peak is over the
+// gain comes back to 1.0 after the 25ms hold and 100ms release
+static void TestQuietInputIsExact()
+{
+  CPCMRemap remap;
+  SetupDownmix(remap);
+
+  unsigned int frames = 4800;
+  std::vector<float> out(frames * 2);
+
+  std::vector<float> loud = Planar51(frames, 1.0f);
+  remap.RemapPlanar(&loud[0], &out[0], frames);
+
+  // 200ms of quiet, the last of it has to be untouched
+  for(int block = 0; block < 3; block++)
+  {
+    std::vector<float> in = Planar51(frames, 0.1f, block * frames);
+    remap.RemapPlanar(&in[0], &out[0], frames);
+  }
+  CHECK_CLOSE(remap.GetCurrentAttenuation(), 1.0, 1e-6);
+
+  std::vector<float> in = Planar51(frames, 0.1f);
+  remap.RemapPlanar(&in[0], &out[0], frames);
+  for(unsigned int i = 0; i < frames; i += 97)
+  {
+    float left  = 0.0f, right = 0.0f;
+    for(unsigned int ch = 0; ch < 6; ch++)
+    {
+      left  += in[ch * frames + i] * coefficients_6[ch * 2];
+      right += in[ch * frames + i] * coefficients_6[ch * 2 + 1];
+    }
+    CHECK_CLOSE(out[i], left, 1e-6);
+    CHECK_CLOSE(out[frames + i], right, 1e-6);
+  }
+}
+
+// same layout in and out is a copy
+static void TestPassthrough()
+{
+  CPCMRemap remap;
+  remap.SetInputFormat(2, layout_20, sizeof(float), 48000);
+  remap.SetOutputFormat(2, layout_20, true);
+
+  float in[8] = { 0.5f, -0.5f, 1.0f, -1.0f, 0.25f, 0.125f, 0.0f, 0.75f };
+  float out[8];
+  remap.Remap(in, out, 4);
+  CHECK(memcmp(in, out, sizeof(in)) == 0);
+  remap.RemapPlanar(in, out, 4);
+  CHECK(memcmp(in, out, sizeof(in)) == 0);
+}
+
+int main(int argc, char *argv[])
+{
+  TestLimiterHoldsFullScale();
+  TestPlanarMatchesInterleaved();
+  TestQuietInputIsExact();
+  TestPassthrough();
+
+  return TestResult("PCMRemapTest");
+}
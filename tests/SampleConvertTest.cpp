@@ -0,0 +1,165 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+// The conversions COMXAudioCodecOMX does in place of libswresample have to
+// give the same bits. The reference is the CONV_FUNC table of
+// libswresample/audioconvert.c for the conversions to AV_SAMPLE_FMT_FLT.
+
+#include "utils/SampleConvert.h"
+#include "OMXTest.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static float SwrU8(uint8_t s)   { return (s - 0x80) * (1.0f / (1 << 7)); }
+static float SwrS16(int16_t s)  { return s * (1.0f / (1 << 15)); }
+static float SwrS32(int32_t s)  { return s * (1.0f / (1U << 31)); }
+static float SwrDbl(double s)   { return (float)s; }
+
+static bool SameBits(float a, float b)
+{
+  return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+template <typename T>
+static int Convert(const std::vector<T> &in, int channels, bool planar, float (*reference)(T))
+{
+  int samples = in.size() / channels;
+  std::vector<float>    out(in.size(), -2.0f);
+  std::vector<uint8_t*> in_planes(channels), out_planes(channels);
+
+  for (int c = 0; c < channels; c++)
+  {
+    in_planes[c]  = (uint8_t *)(&in[0] + (planar ? c * samples : 0));
+    out_planes[c] = (uint8_t *)(&out[0] + c * samples);
+  }
+
+  ConvertToFloatPlanar<T>(&out_planes[0], &in_planes[0], planar, channels, samples);
+
+  int mismatches = 0;
+  for (int c = 0; c < channels; c++)
+    for (int i = 0; i < samples; i++)
+    {
+      T s = planar ? in[c * samples + i] : in[i * channels + c];
+      if (!SameBits(out[c * samples + i], reference(s)))
+        mismatches++;
+    }
+  return mismatches;
+}
+
+// every value of the type once, in a stereo and a 5.1 layout
+template <typename T>
+static void CheckAll(float (*reference)(T), long long lo, long long hi)
+{
+  std::vector<T> in;
+  for (long long v = lo; v <= hi; v++)
+    in.push_back((T)v);
+  // pad to a multiple of six samples with the extremes
+  while (in.size() % 6)
+    in.push_back((T)(in.size() & 1 ? hi : lo));
+
+  CHECK_EQUAL(Convert<T>(in, 2, false, reference), 0);
+  CHECK_EQUAL(Convert<T>(in, 2, true,  reference), 0);
+  CHECK_EQUAL(Convert<T>(in, 6, false, reference), 0);
+  CHECK_EQUAL(Convert<T>(in, 6, true,  reference), 0);
+}
+
+static void TestU8()
+{
+  CheckAll<uint8_t>(SwrU8, 0, 255);
+  CHECK(SampleToFloat((uint8_t)0x00) == -1.0f);
+  CHECK(SampleToFloat((uint8_t)0x80) == 0.0f);
+}
+
+static void TestS16()
+{
+  CheckAll<int16_t>(SwrS16, INT16_MIN, INT16_MAX);
+  CHECK(SampleToFloat((int16_t)INT16_MIN) == -1.0f);
+  CHECK(SampleToFloat((int16_t)0) == 0.0f);
+}
+
+static void TestS32()
+{
+  // the extremes, every power of two either way and a spread of others
+  std::vector<int32_t> in;
+  in.push_back(INT32_MIN);
+  in.push_back(INT32_MAX);
+  in.push_back(0);
+  for (int b = 0; b < 31; b++)
+  {
+    in.push_back(1 << b);
+    in.push_back(-(1 << b));
+    in.push_back((1 << b) - 1);
+    in.push_back(-(1 << b) + 1);
+  }
+  srand(1);
+  while (in.size() % 6 || in.size() < 1 << 16)
+    in.push_back((int32_t)((uint32_t)rand() << 16 ^ (uint32_t)rand()));
+
+  CHECK_EQUAL(Convert<int32_t>(in, 2, false, SwrS32), 0);
+  CHECK_EQUAL(Convert<int32_t>(in, 6, true,  SwrS32), 0);
+  CHECK(SampleToFloat((int32_t)INT32_MIN) == -1.0f);
+  // rounds up to full scale, as libswresample does
+  CHECK(SampleToFloat((int32_t)INT32_MAX) == 1.0f);
+}
+
+static void TestFloat()
+{
+  std::vector<double> in;
+  in.push_back(0.0);
+  in.push_back(-0.0);
+  in.push_back(1.0);
+  in.push_back(-1.0);
+  in.push_back(1.5);
+  in.push_back(FLT_MIN / 2);
+  in.push_back(DBL_MIN);
+  in.push_back(1.0 / 3.0);
+  for (int i = 0; in.size() % 6 || in.size() < 4096; i++)
+    in.push_back(sin(i * 0.01) * (1.0 + 1e-9 * i));
+
+  CHECK_EQUAL(Convert<double>(in, 2, false, SwrDbl), 0);
+  CHECK_EQUAL(Convert<double>(in, 6, true,  SwrDbl), 0);
+
+  std::vector<float> flt(in.begin(), in.end());
+  std::vector<float> out(flt.size());
+  uint8_t *in_planes[2]  = { (uint8_t *)&flt[0], NULL };
+  uint8_t *out_planes[2] = { (uint8_t *)&out[0], (uint8_t *)&out[flt.size() / 2] };
+  ConvertToFloatPlanar<float>(out_planes, in_planes, false, 2, flt.size() / 2);
+
+  int mismatches = 0;
+  for (size_t i = 0; i < flt.size(); i++)
+    if (!SameBits(out[(i & 1) * flt.size() / 2 + i / 2], flt[i]))
+      mismatches++;
+  CHECK_EQUAL(mismatches, 0);
+}
+
+int main(int argc, char *argv[])
+{
+  TestU8();
+  TestS16();
+  TestS32();
+  TestFloat();
+
+  return TestResult("SampleConvertTest");
+}
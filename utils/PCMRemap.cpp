@@ -27,6 +27,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include <algorithm>
 
 #include "MathUtils.h"
 #include "PCMRemap.h"
@@ -35,6 +36,9 @@
 #include "../win32/PlatformDefs.h"
 #endif
 
+/* frames the limiter works on at a time, 1.3ms at 48kHz */
+#define PCM_LIMITER_BLOCK 64
+
 static enum PCMChannels PCMLayoutMap[PCM_MAX_LAYOUT][PCM_MAX_CH + 1] =
 {
   /* 2.0 */ {PCM_FRONT_LEFT, PCM_FRONT_RIGHT, PCM_INVALID},
@@ -169,6 +173,9 @@ CPCMRemap::CPCMRemap() :
   m_outChannels (0),
   m_inSampleSize(0),
   m_ignoreLayout(false),
+  m_passthrough (false),
+  m_maxGain     (1.0f),
+  m_sparse      (false),
   m_buf(NULL),
   m_bufsize(0),
   m_attenuation (1.0),
@@ -340,7 +347,7 @@ void CPCMRemap::ResolveChannels()
 
       /* append it to the table and set its input offset */
       dst->channel   = m_inMap[in_ch];
-      dst->in_offset = in_ch * 2;
+      dst->in_offset = in_ch * m_inSampleSize;
       dst->level     = info->level;
       m_counts[dst->channel]++;
     }
@@ -419,6 +426,50 @@ void CPCMRemap::BuildMap()
     }
     CLog::Log(LOGDEBUG, "CPCMRemap: %s = %s\n", PCMChannelStr(m_outMap[out_ch]).c_str(), s.c_str());
   }
+
+  /* flatten the lookup table into a dense out x in matrix for Remap() */
+  memset(m_matrix, 0, sizeof(m_matrix));
+  m_passthrough = m_inChannels == m_outChannels;
+  for(out_ch = 0; out_ch < m_outChannels; ++out_ch)
+  {
+    for(dst = m_lookupMap[m_outMap[out_ch]]; dst->channel != PCM_INVALID; ++dst)
+      m_matrix[out_ch][dst->in_offset / m_inSampleSize] += dst->level;
+
+    dst = m_lookupMap[m_outMap[out_ch]];
+    if (!dst->copy || dst->in_offset != (int)(out_ch * m_inSampleSize))
+      m_passthrough = false;
+  }
+
+  BuildTaps();
+}
+
+/*
+  the largest row sum of the matrix tells if the mix can go above full scale.
+  Matrices that are mostly zero, like the ones that only fold the extra
+  channels of 7.1 into 5.1, are mixed through the list of non zero levels
+*/
+void CPCMRemap::BuildTaps()
+{
+  unsigned int levels = 0;
+
+  m_maxGain = 1.0f;
+  for (unsigned int out_ch = 0; out_ch < m_outChannels; ++out_ch)
+  {
+    float rowGain = 0.0f;
+    m_tapCount[out_ch] = 0;
+    for (unsigned int in_ch = 0; in_ch < m_inChannels; ++in_ch)
+    {
+      if (m_matrix[out_ch][in_ch] == 0.0f)
+        continue;
+
+      m_taps[out_ch][m_tapCount[out_ch]++] = in_ch;
+      rowGain += fabs(m_matrix[out_ch][in_ch]);
+      levels++;
+    }
+    m_maxGain = std::max(m_maxGain, rowGain);
+  }
+
+  m_sparse = levels * 3 <= m_inChannels * m_outChannels;
 }
 
 void CPCMRemap::DumpMap(CStdString info, unsigned int channels, enum PCMChannels *channelMap)
@@ -486,7 +537,6 @@ enum PCMChannels *CPCMRemap::SetInputFormat(unsigned int channels, enum PCMChann
 
   return m_layoutMap;
 }
-#if 0
 /* sets the output format supported by the audio renderer */
 void CPCMRemap::SetOutputFormat(unsigned int channels, enum PCMChannels *channelMap, bool ignoreLayout/* = false */)
 {
@@ -504,6 +554,25 @@ void CPCMRemap::SetOutputFormat(unsigned int channels, enum PCMChannels *channel
   m_holdCounter = 0;
 }
 
+/* replaces the levels BuildMap() worked out for the formats set, levels holds
+   a row of output levels for every input channel */
+void CPCMRemap::SetMatrix(const float *levels)
+{
+  if (!m_inSet || !m_outSet) return;
+
+  memset(m_matrix, 0, sizeof(m_matrix));
+  m_passthrough = false;
+  for (unsigned int out_ch = 0; out_ch < m_outChannels; ++out_ch)
+    for (unsigned int in_ch = 0; in_ch < m_inChannels; ++in_ch)
+      m_matrix[out_ch][in_ch] = levels[in_ch * m_outChannels + out_ch];
+
+  BuildTaps();
+
+  m_attenuation = 1.0;
+  m_attenuationInc = 1.0;
+  m_holdCounter = 0;
+}
+
 void CPCMRemap::Remap(void *data, void *out, unsigned int samples, long drc)
 {
   float gain = 1.0f;
@@ -513,169 +582,211 @@ void CPCMRemap::Remap(void *data, void *out, unsigned int samples, long drc)
   Remap(data, out, samples, gain);
 }
 
-/* remap the supplied data into out, which must be pre-allocated */
-void CPCMRemap::Remap(void *data, void *out, unsigned int samples, float gain /*= 1.0f*/)
+/*
+  mixes float frames through the coefficient matrix, the channel counts are
+  template parameters for the common layouts so the compiler can unroll the
+  inner loops and keep the coefficients in registers. Planar buffers hold one
+  channel after the other, frames apart. Clipping is left to the limiter when
+  the matrix can exceed unity gain.
+*/
+template <unsigned int IN, unsigned int OUT, bool CLIP, bool PLANAR>
+static void MixFrames(const float *in, float *out, unsigned int frames, const float matrix[PCM_MAX_CH][PCM_MAX_CH], float gain)
 {
-  CheckBufferSize(samples * m_outChannels * sizeof(float));
-
-  //set output buffer to 0
-  memset(out, 0, samples * m_outChannels * m_inSampleSize);
+  const unsigned int inStep   = PLANAR ? 1 : IN;
+  const unsigned int outStep  = PLANAR ? 1 : OUT;
+  const unsigned int plane    = PLANAR ? frames : 1;
 
-  //set intermediate buffer to 0
-  memset(m_buf, 0, m_bufsize);
+  float m[OUT][IN];
+  for (unsigned int o = 0; o < OUT; o++)
+    for (unsigned int i = 0; i < IN; i++)
+      m[o][i] = matrix[o][i] * gain;
 
-  ProcessInput(data, out, samples, gain);
-  //AddGain(m_buf, samples * m_outChannels, gain);
-  //ProcessLimiter(samples, gain);
-  ProcessOutput(out, samples, gain);
+  for (unsigned int f = 0; f < frames; f++, in += inStep, out += outStep)
+  {
+    for (unsigned int o = 0; o < OUT; o++)
+    {
+      float sum = 0.0f;
+      for (unsigned int i = 0; i < IN; i++)
+        sum += in[i * plane] * m[o][i];
+      out[o * plane] = CLIP ? std::min(std::max(sum, -1.0f), 1.0f) : sum;
+    }
+  }
 }
 
-void CPCMRemap::CheckBufferSize(int size)
+static void MixFrames(const float *in, float *out, unsigned int frames, unsigned int inChannels, unsigned int outChannels, const float matrix[PCM_MAX_CH][PCM_MAX_CH], float gain, bool clip, bool planar)
 {
-  if (m_bufsize < size)
+  unsigned int inStep  = planar ? 1 : inChannels;
+  unsigned int outStep = planar ? 1 : outChannels;
+  unsigned int plane   = planar ? frames : 1;
+
+  for (unsigned int f = 0; f < frames; f++, in += inStep, out += outStep)
   {
-    m_bufsize = size;
-    m_buf = (float*)realloc(m_buf, m_bufsize);
+    for (unsigned int o = 0; o < outChannels; o++)
+    {
+      float sum = 0.0f;
+      for (unsigned int i = 0; i < inChannels; i++)
+        sum += in[i * plane] * matrix[o][i];
+      sum *= gain;
+      out[o * plane] = clip ? std::min(std::max(sum, -1.0f), 1.0f) : sum;
+    }
   }
 }
 
-void CPCMRemap::ProcessInput(void* data, void* out, unsigned int samples, float gain)
+/* the same through the non zero levels of every output only */
+template <bool CLIP, bool PLANAR>
+static void MixTaps(const float *in, float *out, unsigned int frames, unsigned int inChannels, unsigned int outChannels,
+                    const float matrix[PCM_MAX_CH][PCM_MAX_CH], const unsigned int *tapCount, const uint8_t taps[PCM_MAX_CH][PCM_MAX_CH], float gain)
 {
-  for (unsigned int ch = 0; ch < m_outChannels; ch++)
-  {
-    struct PCMMapInfo *info = m_lookupMap[m_outMap[ch]];
-    if (info->channel == PCM_INVALID)
-      continue;
-
-    if (info->copy && gain == 1.0f) //do direct copy
+  const unsigned int inStep   = PLANAR ? 1 : inChannels;
+  const unsigned int outStep  = PLANAR ? 1 : outChannels;
+  const unsigned int plane    = PLANAR ? frames : 1;
+
+  unsigned int offset[PCM_MAX_CH][PCM_MAX_CH];
+  float        m[PCM_MAX_CH][PCM_MAX_CH];
+  for (unsigned int o = 0; o < outChannels; o++)
+    for (unsigned int t = 0; t < tapCount[o]; t++)
     {
-      uint8_t* src = (uint8_t*)data + info->in_offset;
-      uint8_t* dst = (uint8_t*)out  + ch * m_inSampleSize;
-      uint8_t* dstend = dst + samples * m_outStride;
-      while (dst < dstend)
-      {
-        *(float*)dst = *(float*)src;
-        src += m_inStride;
-        dst += m_outStride;
-      }
+      offset[o][t] = taps[o][t] * plane;
+      m[o][t]      = matrix[o][taps[o][t]] * gain;
     }
-    else //needs some volume change or mixing, put into intermediate buffer
+
+  for (unsigned int f = 0; f < frames; f++, in += inStep, out += outStep)
+  {
+    for (unsigned int o = 0; o < outChannels; o++)
     {
-      for(; info->channel != PCM_INVALID; info++)
-      {
-        uint8_t* src = (uint8_t*)data + info->in_offset;
-        float*   dst = m_buf + ch;
-        float*   dstend = dst + samples * m_outChannels;
-        while (dst < dstend)
-        {
-          *dst += (float)(*(float*)src) * info->level;
-          src += m_inStride;
-          dst += m_outChannels;
-        }
-      }
+      float sum = 0.0f;
+      for (unsigned int t = 0; t < tapCount[o]; t++)
+        sum += in[offset[o][t]] * m[o][t];
+      out[o * plane] = CLIP ? std::min(std::max(sum, -1.0f), 1.0f) : sum;
     }
   }
 }
 
-void CPCMRemap::AddGain(float* buf, unsigned int samples, float gain)
+template <bool CLIP, bool PLANAR>
+static void MixFrames(const float *in, float *out, unsigned int frames, unsigned int inChannels, unsigned int outChannels, const float matrix[PCM_MAX_CH][PCM_MAX_CH], float gain)
 {
-  if (gain != 1.0f) //needs a gain change
-  {
-    float* ptr = m_buf;
-    float* end = m_buf + samples;
-    while (ptr < end)
-      *(ptr++) *= gain;
-  }
+       if (inChannels == 2 && outChannels == 2) MixFrames<2, 2, CLIP, PLANAR>(in, out, frames, matrix, gain);
+  else if (inChannels == 6 && outChannels == 2) MixFrames<6, 2, CLIP, PLANAR>(in, out, frames, matrix, gain);
+  else if (inChannels == 8 && outChannels == 2) MixFrames<8, 2, CLIP, PLANAR>(in, out, frames, matrix, gain);
+  else
+    MixFrames(in, out, frames, inChannels, outChannels, matrix, gain, CLIP, PLANAR);
+}
+
+/* remap the supplied data into out, which must be pre-allocated */
+void CPCMRemap::Remap(void *data, void *out, unsigned int samples, float gain /*= 1.0f*/)
+{
+  Mix((const float*)data, (float*)out, samples, gain, false);
+}
+
+/* same as Remap() for planar data, out gets the output channels one after the other */
+void CPCMRemap::RemapPlanar(void *data, void *out, unsigned int samples, float gain /*= 1.0f*/)
+{
+  Mix((const float*)data, (float*)out, samples, gain, true);
 }
 
-void CPCMRemap::ProcessLimiter(unsigned int samples, float gain)
+void CPCMRemap::Mix(const float *in, float *out, unsigned int samples, float gain, bool planar)
 {
-  //check total gain for each output channel
-  float highestgain = 1.0f;
-  for (unsigned int ch = 0; ch < m_outChannels; ch++)
+  /* same layout and no gain, nothing to mix */
+  if (m_passthrough && gain == 1.0f)
   {
-    struct PCMMapInfo *info = m_lookupMap[m_outMap[ch]];
-    if (info->channel == PCM_INVALID)
-      continue;
+    if (in != out)
+      memcpy(out, in, samples * m_outStride);
+    return;
+  }
 
-    float chgain = 0.0f;
-    for(; info->channel != PCM_INVALID; info++)
-      chgain += info->level * gain;
+  bool limit = m_maxGain * gain > 1.0001f;
 
-    if (chgain > highestgain)
-      highestgain = chgain;
+       if (m_sparse &&  limit &&  planar) MixTaps<false, true >(in, out, samples, m_inChannels, m_outChannels, m_matrix, m_tapCount, m_taps, gain);
+  else if (m_sparse &&  limit && !planar) MixTaps<false, false>(in, out, samples, m_inChannels, m_outChannels, m_matrix, m_tapCount, m_taps, gain);
+  else if (m_sparse && !limit &&  planar) MixTaps<true,  true >(in, out, samples, m_inChannels, m_outChannels, m_matrix, m_tapCount, m_taps, gain);
+  else if (m_sparse && !limit && !planar) MixTaps<true,  false>(in, out, samples, m_inChannels, m_outChannels, m_matrix, m_tapCount, m_taps, gain);
+  else if (limit &&  planar) MixFrames<false, true >(in, out, samples, m_inChannels, m_outChannels, m_matrix, gain);
+  else if (limit && !planar) MixFrames<false, false>(in, out, samples, m_inChannels, m_outChannels, m_matrix, gain);
+  else if (planar)           MixFrames<true,  true >(in, out, samples, m_inChannels, m_outChannels, m_matrix, gain);
+  else                       MixFrames<true,  false>(in, out, samples, m_inChannels, m_outChannels, m_matrix, gain);
+
+  /* without a chance to clip the limiter only resets */
+  if (limit)
+    ProcessLimiter(out, samples, m_maxGain * gain, planar);
+  else
+    ProcessLimiter(NULL, 0, m_maxGain * gain, planar);
+}
+
+void CPCMRemap::CheckBufferSize(int size)
+{
+  if (m_bufsize < size)
+  {
+    m_bufsize = size;
+    m_buf = (float*)realloc(m_buf, m_bufsize);
   }
+}
 
-  m_attenuationMin = 1.0f;
+/* highest absolute value in buf. Four independent maxima so the loop
+   pipelines on VFP and the compiler can vectorise it where there is SIMD */
+static float PeakAbs(const float *buf, unsigned int count)
+{
+  float p0 = 0.0f, p1 = 0.0f, p2 = 0.0f, p3 = 0.0f;
+  unsigned int i = 0;
 
-  //if one of the channels can clip, enable a limiter
-  if (highestgain > 1.0001f) 
+  for (; i + 4 <= count; i += 4)
   {
-    m_attenuationMin = m_attenuation;
+    p0 = std::max(p0, std::max(buf[i    ], -buf[i    ]));
+    p1 = std::max(p1, std::max(buf[i + 1], -buf[i + 1]));
+    p2 = std::max(p2, std::max(buf[i + 2], -buf[i + 2]));
+    p3 = std::max(p3, std::max(buf[i + 3], -buf[i + 3]));
+  }
+  for (; i < count; i++)
+    p0 = std::max(p0, std::max(buf[i], -buf[i]));
 
-    if (!m_limiterEnabled)
-    {
-      CLog::Log(LOGDEBUG, "CPCMRemap:: max gain: %f, enabling limiter", highestgain);
-      m_limiterEnabled = true;
-    }
+  return std::max(std::max(p0, p1), std::max(p2, p3));
+}
 
-    for (unsigned int i = 0; i < samples; i++)
-    {
-      //for each collection of samples, get the highest absolute value
-      float maxAbs = 0.0f;
-      for (unsigned int outch = 0; outch < m_outChannels; outch++)
-      {
-        float absval = fabs(m_buf[i * m_outChannels + outch]) / 32768.0f;
-        if (maxAbs < absval)
-          maxAbs = absval;
-      }
+/* highest absolute value of frames frames from pos on */
+static float BlockPeak(const float *buf, unsigned int pos, unsigned int frames, unsigned int samples, unsigned int channels, bool planar)
+{
+  if (!planar)
+    return PeakAbs(buf + pos * channels, frames * channels);
 
-      //if attenuatedAbs is higher than 1.0f, audio is clipping
-      float attenuatedAbs = maxAbs * m_attenuation;
-      if (attenuatedAbs > 1.0f)
-      {
-        //set m_attenuation so that m_attenuation * sample is the maximum output value
-        m_attenuation = 1.0f / maxAbs;
-        if (m_attenuation < m_attenuationMin)
-          m_attenuationMin = m_attenuation;
-        //value to add to m_attenuation to make it 1.0f
-        m_attenuationInc = 1.0f - m_attenuation;
-        //amount of samples to hold m_attenuation
-        m_holdCounter = MathUtils::round_int(m_sampleRate * 0.025f);
-      }
-      else if (m_attenuation < 1.0f && attenuatedAbs > 0.95f)
-      {
-        //if we're attenuating and we get within 5% of clipping, hold m_attenuation
-        m_attenuationInc = 1.0f - m_attenuation;
-        m_holdCounter = MathUtils::round_int(m_sampleRate * 0.025f);
-      }
+  float peak = 0.0f;
+  for (unsigned int ch = 0; ch < channels; ch++)
+    peak = std::max(peak, PeakAbs(buf + ch * samples + pos, frames));
+  return peak;
+}
 
-      //apply attenuation
-      for (unsigned int outch = 0; outch < m_outChannels; outch++)
-        m_buf[i * m_outChannels + outch] *= m_attenuation;
+/* multiplies frames frames from pos on with a gain moving linearly from start
+   to end, the gain never exceeds what keeps the block peak at full scale so
+   the clamp only catches rounding */
+static void ApplyGainRamp(float *buf, unsigned int pos, unsigned int frames, unsigned int samples, unsigned int channels, bool planar, float start, float end)
+{
+  float step    = frames ? (end - start) / frames : 0.0f;
+  float g       = start;
+  unsigned int frameStep = planar ? 1 : channels;
+  unsigned int plane     = planar ? samples : 1;
+
+  buf += pos * frameStep;
+  for (unsigned int f = 0; f < frames; f++, buf += frameStep, g += step)
+    for (unsigned int ch = 0; ch < channels; ch++)
+      buf[ch * plane] = std::min(std::max(buf[ch * plane] * g, -1.0f), 1.0f);
+}
 
-      if (m_holdCounter)
-      {
-        //hold m_attenuation
-        m_holdCounter--;
-      }
-      else if (m_attenuationInc > 0.0f)
-      {
-        //move m_attenuation to 1.0 in g_advancedSettings.m_limiterRelease seconds
-        m_attenuation += m_attenuationInc / m_sampleRate / 0.1f;
-        if (m_attenuation > 1.0f)
-        {
-          m_attenuation = 1.0f;
-          m_attenuationInc = 0.0f;
-        }
-      }
-    }
-  }
-  else
+/*
+  block based look-ahead limiter. The peak of every block decides the gain
+  that keeps it below full scale, the gain at the end of a block already
+  drops to what the next block needs so attacks are ramped in instead of
+  stepped. After a peak the gain is held for 25ms and then released to 1.0
+  in 100ms. Only the first block of a call can step, as the previous call
+  could not see it coming.
+*/
+void CPCMRemap::ProcessLimiter(float *buf, unsigned int samples, float gain, bool planar)
+{
+  m_attenuationMin = 1.0f;
+
+  //if none of the channels can clip, the limiter is not needed
+  if (!buf || gain <= 1.0001f)
   {
     if (m_limiterEnabled)
     {
-      CLog::Log(LOGDEBUG, "CPCMRemap:: max gain: %f, disabling limiter", highestgain);
+      CLog::Log(LOGDEBUG, "CPCMRemap:: max gain: %f, disabling limiter", gain);
       m_limiterEnabled = false;
     }
 
@@ -683,31 +794,77 @@ void CPCMRemap::ProcessLimiter(unsigned int samples, float gain)
     m_attenuation = 1.0f;
     m_attenuationInc = 0.0f;
     m_holdCounter = 0;
+    return;
   }
-}
 
-void CPCMRemap::ProcessOutput(void* out, unsigned int samples, float gain)
-{
-  //copy from intermediate buffer to output
-  for (unsigned int ch = 0; ch < m_outChannels; ch++)
+  if (!m_limiterEnabled)
   {
-    struct PCMMapInfo *info = m_lookupMap[m_outMap[ch]];
-    if (info->channel == PCM_INVALID)
-      continue;
+    CLog::Log(LOGDEBUG, "CPCMRemap:: max gain: %f, enabling limiter", gain);
+    m_limiterEnabled = true;
+  }
+
+  unsigned int channels = m_outChannels;
+  unsigned int hold     = MathUtils::round_int(m_sampleRate * 0.025f);
+  float        release  = (float)PCM_LIMITER_BLOCK / m_sampleRate / 0.1f;
+
+  m_attenuationMin = m_attenuation;
 
-    if (!info->copy || gain != 1.0f)
+  float peak     = 0.0f;
+  float nextPeak = BlockPeak(buf, 0, std::min(samples, (unsigned int)PCM_LIMITER_BLOCK), samples, channels, planar);
+
+  for (unsigned int pos = 0; pos < samples; pos += PCM_LIMITER_BLOCK)
+  {
+    unsigned int frames = std::min(samples - pos, (unsigned int)PCM_LIMITER_BLOCK);
+
+    peak     = nextPeak;
+    nextPeak = 0.0f;
+    if (pos + frames < samples)
     {
-      float* src = m_buf + ch;
-      uint8_t* dst = (uint8_t*)out + ch * m_inSampleSize;
-      uint8_t* dstend = dst + samples * m_outStride;
+      unsigned int next = std::min(samples - pos - frames, (unsigned int)PCM_LIMITER_BLOCK);
+      nextPeak = BlockPeak(buf, pos + frames, next, samples, channels, planar);
+    }
+
+    //the largest gain this and the next block can take without clipping
+    float target     = peak     > 1.0f ? 1.0f / peak     : 1.0f;
+    float nextTarget = nextPeak > 1.0f ? 1.0f / nextPeak : 1.0f;
 
-      while(dst < dstend)
+    float start = std::min(m_attenuation, target);
+    float end   = std::min(target, nextTarget);
+
+    if (end < m_attenuation)
+    {
+      //attack, ramp down to what the loudest of the two blocks needs
+      m_attenuationInc = 1.0f - end;
+      m_holdCounter    = hold;
+    }
+    else if (start < 1.0f && peak * start > 0.95f)
+    {
+      //if we're attenuating and we get within 5% of clipping, hold
+      end = start;
+      m_attenuationInc = 1.0f - start;
+      m_holdCounter    = hold;
+    }
+    else if (m_holdCounter)
+    {
+      end = start;
+      m_holdCounter = m_holdCounter > frames ? m_holdCounter - frames : 0;
+    }
+    else if (m_attenuationInc > 0.0f)
+    {
+      //move back to 1.0 in 100ms
+      end = std::min(end, start + m_attenuationInc * release * frames / PCM_LIMITER_BLOCK);
+      if (end >= 1.0f)
       {
-        *(float*)dst = MathUtils::round_int(std::min(std::max(*src, -1.0f), 1.0f));
-        src += m_outChannels;
-        dst += m_outStride;
+        end = 1.0f;
+        m_attenuationInc = 0.0f;
       }
     }
+
+    if (start < 1.0f || end < 1.0f)
+      ApplyGainRamp(buf, pos, frames, samples, channels, planar, start, end);
+
+    m_attenuation    = end;
+    m_attenuationMin = std::min(m_attenuationMin, std::min(start, end));
   }
 }
 
@@ -730,7 +887,7 @@ int CPCMRemap::FramesToInBytes(int frames)
 {
   return frames * m_inSampleSize * m_inChannels;
 }
-#endif
+
 CStdString CPCMRemap::PCMChannelStr(enum PCMChannels ename)
 {
   const char* PCMChannelName[] =
@@ -103,6 +103,12 @@ protected:
   int                m_inStride, m_outStride;
   struct PCMMapInfo  m_lookupMap[PCM_MAX_CH + 1][PCM_MAX_CH + 1];
   int                m_counts[PCM_MAX_CH];
+  float              m_matrix[PCM_MAX_CH][PCM_MAX_CH]; //!< output x input mixing levels, built by BuildMap()
+  bool               m_passthrough;                    //!< input and output layouts match 1:1
+  float              m_maxGain;                        //!< largest sum of levels into one output
+  bool               m_sparse;                         //!< mix through m_taps, most levels are zero
+  unsigned int       m_tapCount[PCM_MAX_CH];           //!< non zero levels per output
+  uint8_t            m_taps[PCM_MAX_CH][PCM_MAX_CH];   //!< their inputs
 
   float*             m_buf;
   int                m_bufsize;
@@ -116,16 +122,15 @@ protected:
   struct PCMMapInfo* ResolveChannel(enum PCMChannels channel, float level, bool ifExists, std::vector<enum PCMChannels> path, struct PCMMapInfo *tablePtr);
   void               ResolveChannels(); //!< Partial BuildMap(), just enough to see which output channels are active
   void               BuildMap();
+  void               BuildTaps();
   void               DumpMap(CStdString info, int unsigned channels, enum PCMChannels *channelMap);
   void               Dispose();
   CStdString         PCMChannelStr(enum PCMChannels ename);
   CStdString         PCMLayoutStr(enum PCMLayout ename);
 
   void               CheckBufferSize(int size);
-  void               ProcessInput(void* data, void* out, unsigned int samples, float gain);
-  void               AddGain(float* buf, unsigned int samples, float gain);
-  void               ProcessLimiter(unsigned int samples, float gain);
-  void               ProcessOutput(void* out, unsigned int samples, float gain);
+  void               Mix(const float *in, float *out, unsigned int samples, float gain, bool planar);
+  void               ProcessLimiter(float *buf, unsigned int samples, float gain, bool planar);
 
 public:
 
@@ -134,15 +139,15 @@ public:
 
   void Reset();
   enum PCMChannels *SetInputFormat (unsigned int channels, enum PCMChannels *channelMap, unsigned int sampleSize, unsigned int sampleRate);
-#if 0
   void SetOutputFormat(unsigned int channels, enum PCMChannels *channelMap, bool ignoreLayout = false);
   void Remap(void *data, void *out, unsigned int samples, long drc);
+  void SetMatrix(const float *levels);
   void Remap(void *data, void *out, unsigned int samples, float gain = 1.0f);
+  void RemapPlanar(void *data, void *out, unsigned int samples, float gain = 1.0f);
   bool CanRemap();
   int  InBytesToFrames (int bytes );
   int  FramesToOutBytes(int frames);
   int  FramesToInBytes (int frames);
-#endif
   float GetCurrentAttenuation() { return m_attenuationMin; }
 };
 
@@ -0,0 +1,62 @@
+/*
+ *      Copyright (C) 2005-2008 Team XBMC
+ *      http://www.xbmc.org
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with XBMC; see the file COPYING.  If not, write to
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+
+#ifndef _SAMPLE_CONVERT_H_
+#define _SAMPLE_CONVERT_H_
+
+#include <stdint.h>
+
+// Sample format conversions to planar float for COMXAudioCodecOMX. The
+// scaling matches libswresample so both conversion paths give the same samples.
+
+static inline float SampleToFloat(uint8_t s) { return (s - 0x80) * (1.0f / (1 << 7)); }
+static inline float SampleToFloat(int16_t s) { return s * (1.0f / (1 << 15)); }
+static inline float SampleToFloat(int32_t s) { return s * (1.0f / (1U << 31)); }
+static inline float SampleToFloat(float s)   { return s; }
+static inline float SampleToFloat(double s)  { return (float)s; }
+
+// in holds a plane per channel when planar, else in[0] holds all of them
+// interleaved. out always holds a float plane per channel
+template <typename T>
+static void ConvertToFloatPlanar(uint8_t **out, uint8_t **in, bool planar, int channels, int samples)
+{
+  if (planar)
+  {
+    for (int c = 0; c < channels; c++)
+    {
+      const T *src = (const T *)in[c];
+      float   *dst = (float *)out[c];
+      for (int i = 0; i < samples; i++)
+        dst[i] = SampleToFloat(src[i]);
+    }
+  }
+  else
+  {
+    // walk the interleaved input once and scatter into the planes
+    const T *src = (const T *)in[0];
+    for (int i = 0; i < samples; i++)
+      for (int c = 0; c < channels; c++)
+        ((float *)out[c])[i] = SampleToFloat(*src++);
+  }
+}
+
+#endif